@@ -0,0 +1,355 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * CPU backend benchmark
+ *
+ * Runs a fixed set of guest microkernels (see the guest directory) on every CPU
+ * backend compiled into the build and reports guest MIPS and emulated
+ * cycles per host nanosecond as JSON on stdout, one object per run.
+ *
+ * Usage: x86emu_cpu_bench [--model <cpu>] [--backend mame|86box]
+ *                         [--program <name>] [--repeat <n>]
+ *                         [--fpu accurate|fast]
+ *                         [--profile accurate|fast] [--matrix]
+ *                         [--trace off|regs|memory] [--trace-file <path>]
+ *
+ * --trace attaches an InstructionTracer recording all registers, plus
+ * data accesses with "memory", so traced and untraced runs of the same
+ * program give the cost of tracing. Closing the trace is timed too.
+ *
+ * --matrix runs every program once per accuracy configuration: the
+ * accurate baseline, each CPU accuracy switch turned off on its own, and
+ * the fast profile with all of them off, so the gain of each switch can
+ * be read off the "config" field.
+ */
+
+#include "guest_programs.h"
+#include "logger.h"
+#include "devices/cpu/i386/x86_cpu.h"
+#include "devices/cpu/i386/instruction_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace x86emu;
+
+namespace {
+
+// Must match common.inc
+constexpr uint32_t LOAD_BASE = 0x10000;
+constexpr uint32_t DONE_ADDR = 0x500;
+constexpr uint32_t DONE_MAGIC = 0xB007D0E5;
+constexpr uint32_t RESET_VECTOR = 0xFFFF0;
+
+// Cycles handed to Execute() between completion checks
+constexpr int EXECUTE_CHUNK = 100000;
+
+// Give up after this many emulated cycles
+constexpr uint64_t CYCLE_LIMIT = 4000000000ULL;
+
+struct GuestProgram {
+    const char* name;
+    const uint8_t* image;
+    size_t size;
+    // Guest instructions retired by the kernel (prologue excluded,
+    // REP iterations counted individually)
+    uint64_t instructions;
+};
+
+// Instruction counts are worked out from the loop constants in guest/*.S:
+// every instruction after ENTER_PROTECTED_MODE up to and including the
+// DONE store, one per REP iteration, HLT excluded. The sums next to each
+// entry follow the source top to bottom (setup + iterations x loop body);
+// update them together with the kernel.
+const GuestProgram PROGRAMS[] = {
+    // 4 + 1,000,000 x 12 + 1
+    { "alu",       guest::alu,       sizeof(guest::alu),       12000005 },
+    // 2 + 64 x (3 + 65,536 REP + 2) + 1 + 4 x (3 + 65,536 x 6 + 2) + 1
+    { "memcpy",    guest::memcpy,    sizeof(guest::memcpy),    5767512 },
+    // 3 + 200,000 x 11 + 1 + 1
+    { "x87",       guest::x87,       sizeof(guest::x87),       2200005 },
+    // 3 + 100,000 x 13 + 1 + 1
+    { "mmx",       guest::mmx,       sizeof(guest::mmx),       1300005 },
+    // 3 + 4,096 x 5 + 3 + 1,024 REP + 3 + 4 x 5 + 5 + 1 + 64 x (4 + 2,048 x 4 + 2) + 1
+    { "paging",    guest::paging,    sizeof(guest::paging),    546212 },
+    // 10 + 100,000 x 5 (int, incl, iretl in the handler, decl, jnz) + 1
+    { "interrupt", guest::interrupt, sizeof(guest::interrupt), 500011 },
+};
+
+struct BackendInfo {
+    const char* name;
+    CPUBackendType type;
+};
+
+const BackendInfo BACKENDS[] = {
+    { "mame",  CPUBackendType::MAME },
+    { "86box", CPUBackendType::BOX86 },
+};
+
+// CPU switches of the accuracy profile (see accuracy_profile.h)
+struct AccuracyConfig {
+    const char* name;
+    bool cpuCache;
+    bool cycleTiming;
+};
+
+const AccuracyConfig ACCURACY_CONFIGS[] = {
+    { "accurate",     true,  true },
+    { "no_cpu_cache", false, true },
+    { "flat_timing",  true,  false },
+    { "fast",         false, false },
+};
+
+enum class TraceMode {
+    OFF,
+    REGISTERS,
+    MEMORY,
+};
+
+const char* traceModeName(TraceMode mode)
+{
+    switch (mode) {
+        case TraceMode::REGISTERS: return "regs";
+        case TraceMode::MEMORY:    return "memory";
+        default:                   return "off";
+    }
+}
+
+struct Result {
+    uint64_t cycles;
+    double seconds;
+    bool completed;
+};
+
+void loadProgram(X86CPU& cpu, const GuestProgram& program)
+{
+    // Clear the completion marker
+    cpu.WriteDword(DONE_ADDR, 0);
+
+    for (size_t i = 0; i < program.size; i++) {
+        cpu.WriteByte(LOAD_BASE + static_cast<uint32_t>(i), program.image[i]);
+    }
+
+    // Reset stub: jmp far LOAD_BASE>>4:0000
+    const uint8_t stub[] = { 0xEA, 0x00, 0x00, LOAD_BASE >> 4 & 0xFF, LOAD_BASE >> 12 & 0xFF };
+    for (size_t i = 0; i < sizeof(stub); i++) {
+        cpu.WriteByte(RESET_VECTOR + static_cast<uint32_t>(i), stub[i]);
+    }
+}
+
+bool runProgram(const std::string& model, const BackendInfo& backend, const GuestProgram& program,
+                bool fastFPU, const AccuracyConfig& accuracy, TraceMode trace, const std::string& traceFile,
+                Result& result)
+{
+    X86CPU cpu(model, backend.type);
+    if (!cpu.Initialize()) {
+        return false;
+    }
+
+    if (fastFPU && !cpu.SetFastFPU(true)) {
+        std::fprintf(stderr, "Fast FPU mode not supported by %s backend\n", backend.name);
+    }
+
+    // Switches the backend does not model are reported as unsupported and
+    // leave the run identical to the accurate baseline
+    cpu.SetCacheEmulation(accuracy.cpuCache);
+    cpu.SetCycleAccurate(accuracy.cycleTiming);
+
+    cpu.Reset();
+    loadProgram(cpu, program);
+
+    InstructionTracer tracer;
+    if (trace != TraceMode::OFF) {
+        if (!tracer.open(traceFile, InstructionTracer::ALL_REGISTERS, trace == TraceMode::MEMORY)) {
+            std::fprintf(stderr, "Cannot create trace file %s\n", traceFile.c_str());
+            return false;
+        }
+        if (!cpu.SetTracer(&tracer)) {
+            std::fprintf(stderr, "Tracing not supported by %s backend\n", backend.name);
+            return false;
+        }
+    }
+
+    result.cycles = 0;
+    result.completed = false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    while (result.cycles < CYCLE_LIMIT) {
+        int executed = cpu.Execute(EXECUTE_CHUNK);
+        if (executed <= 0) {
+            break;
+        }
+
+        result.cycles += static_cast<uint64_t>(executed);
+
+        if (cpu.ReadDword(DONE_ADDR) == DONE_MAGIC) {
+            result.completed = true;
+            break;
+        }
+    }
+
+    if (trace != TraceMode::OFF) {
+        cpu.SetTracer(nullptr);
+        tracer.close();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+
+    cpu.Stop();
+    return true;
+}
+
+void printResult(const std::string& model, const BackendInfo& backend, const GuestProgram& program,
+                 bool fastFPU, const AccuracyConfig& accuracy, TraceMode trace, int run, const Result& result)
+{
+    double hostNs = result.seconds * 1e9;
+    double mips = (result.completed && result.seconds > 0.0)
+                      ? (program.instructions / result.seconds) / 1e6
+                      : 0.0;
+    double cyclesPerNs = hostNs > 0.0 ? result.cycles / hostNs : 0.0;
+
+    std::printf("{\"backend\": \"%s\", \"model\": \"%s\", \"program\": \"%s\", \"fpu\": \"%s\", \"config\": \"%s\", "
+                "\"trace\": \"%s\", \"run\": %d, "
+                "\"cycles\": %llu, \"host_ns\": %.0f, \"mips\": %.3f, \"cycles_per_ns\": %.5f, "
+                "\"completed\": %s}\n",
+                backend.name, model.c_str(), program.name, fastFPU ? "fast" : "accurate", accuracy.name,
+                traceModeName(trace), run,
+                static_cast<unsigned long long>(result.cycles), hostNs, mips, cyclesPerNs,
+                result.completed ? "true" : "false");
+    std::fflush(stdout);
+}
+
+void printUsage(const char* argv0)
+{
+    std::fprintf(stderr, "Usage: %s [--model <cpu>] [--backend mame|86box] [--program <name>] [--repeat <n>] "
+                         "[--fpu accurate|fast] [--profile accurate|fast] [--matrix] "
+                         "[--trace off|regs|memory] [--trace-file <path>]\n", argv0);
+    std::fprintf(stderr, "Programs:");
+    for (const auto& program : PROGRAMS) {
+        std::fprintf(stderr, " %s", program.name);
+    }
+    std::fprintf(stderr, "\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string model = "pentium";
+    std::string backendFilter;
+    std::string programFilter;
+    int repeat = 1;
+    bool fastFPU = false;
+    bool fastProfile = false;
+    bool matrix = false;
+    TraceMode trace = TraceMode::OFF;
+    std::string traceFile = "cpu_bench.trace";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--model" && hasValue) {
+            model = argv[++i];
+        } else if (arg == "--backend" && hasValue) {
+            backendFilter = argv[++i];
+        } else if (arg == "--program" && hasValue) {
+            programFilter = argv[++i];
+        } else if (arg == "--repeat" && hasValue) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--fpu" && hasValue && (std::string(argv[i + 1]) == "accurate" || std::string(argv[i + 1]) == "fast")) {
+            fastFPU = std::string(argv[++i]) == "fast";
+        } else if (arg == "--profile" && hasValue && (std::string(argv[i + 1]) == "accurate" || std::string(argv[i + 1]) == "fast")) {
+            fastProfile = std::string(argv[++i]) == "fast";
+        } else if (arg == "--matrix") {
+            matrix = true;
+        } else if (arg == "--trace" && hasValue) {
+            std::string mode = argv[++i];
+            if (mode == "off") {
+                trace = TraceMode::OFF;
+            } else if (mode == "regs") {
+                trace = TraceMode::REGISTERS;
+            } else if (mode == "memory") {
+                trace = TraceMode::MEMORY;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--trace-file" && hasValue) {
+            traceFile = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Keep stdout clean for the JSON stream
+    Logger::GetInstance()->setLevel(Logger::Level::WARN);
+
+    std::vector<const AccuracyConfig*> configs;
+    for (const auto& config : ACCURACY_CONFIGS) {
+        bool isProfile = std::string(config.name) == (fastProfile ? "fast" : "accurate");
+        if (matrix || isProfile) {
+            configs.push_back(&config);
+        }
+    }
+
+    int failures = 0;
+
+    for (const auto& backend : BACKENDS) {
+        if (!backendFilter.empty() && backendFilter != backend.name) {
+            continue;
+        }
+        if (!X86CPUFactory::IsBackendAvailable(backend.type)) {
+            std::fprintf(stderr, "Backend %s not available in this build\n", backend.name);
+            continue;
+        }
+
+        for (const auto& program : PROGRAMS) {
+            if (!programFilter.empty() && programFilter != program.name) {
+                continue;
+            }
+
+            for (const AccuracyConfig* config : configs) {
+                for (int run = 0; run < repeat; run++) {
+                    Result result;
+                    if (!runProgram(model, backend, program, fastFPU, *config, trace, traceFile, result)) {
+                        std::fprintf(stderr, "Failed to set up %s backend\n", backend.name);
+                        failures++;
+                        break;
+                    }
+
+                    printResult(model, backend, program, fastFPU, *config, trace, run, result);
+                    if (!result.completed) {
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
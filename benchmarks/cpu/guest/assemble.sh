@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# Assemble the CPU benchmark microkernels into flat binaries and
+# regenerate ../guest_programs.h. Requires GNU binutils with i386 support.
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+OUTPUT="$SCRIPT_DIR/../guest_programs.h"
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+PROGRAMS="alu memcpy x87 mmx paging interrupt"
+
+{
+    echo "/* Generated by benchmarks/cpu/guest/assemble.sh - do not edit */"
+    echo ""
+    echo "#ifndef X86EMULATOR_BENCH_GUEST_PROGRAMS_H"
+    echo "#define X86EMULATOR_BENCH_GUEST_PROGRAMS_H"
+    echo ""
+    echo "#include <cstdint>"
+    echo ""
+    echo "namespace guest {"
+    for name in $PROGRAMS; do
+        gcc -m32 -c -x assembler-with-cpp -I "$SCRIPT_DIR" "$SCRIPT_DIR/$name.S" -o "$WORK_DIR/$name.o"
+        ld -m elf_i386 -Ttext=0x10000 -e _start --oformat binary "$WORK_DIR/$name.o" -o "$WORK_DIR/$name.bin"
+        echo ""
+        echo "static const uint8_t ${name}[] = {"
+        xxd -i < "$WORK_DIR/$name.bin"
+        echo "};"
+    done
+    echo ""
+    echo "} // namespace guest"
+    echo ""
+    echo "#endif // X86EMULATOR_BENCH_GUEST_PROGRAMS_H"
+} > "$OUTPUT"
+
+echo "Wrote $OUTPUT"
@@ -0,0 +1,114 @@
+/* Generated by benchmarks/cpu/guest/assemble.sh - do not edit */
+
+#ifndef X86EMULATOR_BENCH_GUEST_PROGRAMS_H
+#define X86EMULATOR_BENCH_GUEST_PROGRAMS_H
+
+#include <cstdint>
+
+namespace guest {
+
+static const uint8_t alu[] = {
+  0xfa, 0x8c, 0xc8, 0x8e, 0xd8, 0x66, 0x0f, 0x01, 0x16, 0x88, 0x00, 0x0f,
+  0x20, 0xc0, 0x0c, 0x01, 0x0f, 0x22, 0xc0, 0x66, 0xea, 0x1b, 0x00, 0x01,
+  0x00, 0x08, 0x00, 0x66, 0xb8, 0x10, 0x00, 0x8e, 0xd8, 0x8e, 0xc0, 0x8e,
+  0xe0, 0x8e, 0xe8, 0x8e, 0xd0, 0xbc, 0xf0, 0xff, 0x09, 0x00, 0xb9, 0x40,
+  0x42, 0x0f, 0x00, 0xb8, 0x78, 0x56, 0x34, 0x12, 0xbb, 0xf0, 0xde, 0xbc,
+  0x9a, 0x31, 0xd2, 0x01, 0xd8, 0x31, 0xc2, 0xc1, 0xc3, 0x05, 0x29, 0xcb,
+  0x69, 0xc0, 0x93, 0x01, 0x00, 0x01, 0x81, 0xe2, 0xff, 0xff, 0xff, 0x7f,
+  0x09, 0xca, 0xc1, 0xea, 0x03, 0x8d, 0x74, 0x50, 0x01, 0x89, 0xf7, 0x49,
+  0x75, 0xdd, 0xc7, 0x05, 0x00, 0x05, 0x00, 0x00, 0xe5, 0xd0, 0x07, 0xb0,
+  0xf4, 0xeb, 0xfd, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xff, 0xff, 0x00, 0x00, 0x00, 0x9a, 0xcf, 0x00, 0xff, 0xff, 0x00, 0x00,
+  0x00, 0x92, 0xcf, 0x00, 0x17, 0x00, 0x70, 0x00, 0x01, 0x00
+};
+
+static const uint8_t memcpy[] = {
+  0xfa, 0x8c, 0xc8, 0x8e, 0xd8, 0x66, 0x0f, 0x01, 0x16, 0x90, 0x00, 0x0f,
+  0x20, 0xc0, 0x0c, 0x01, 0x0f, 0x22, 0xc0, 0x66, 0xea, 0x1b, 0x00, 0x01,
+  0x00, 0x08, 0x00, 0x66, 0xb8, 0x10, 0x00, 0x8e, 0xd8, 0x8e, 0xc0, 0x8e,
+  0xe0, 0x8e, 0xe8, 0x8e, 0xd0, 0xbc, 0xf0, 0xff, 0x09, 0x00, 0xfc, 0xbd,
+  0x40, 0x00, 0x00, 0x00, 0xbe, 0x00, 0x00, 0x10, 0x00, 0xbf, 0x00, 0x00,
+  0x20, 0x00, 0xb9, 0x00, 0x00, 0x01, 0x00, 0xf3, 0xa5, 0x4d, 0x75, 0xec,
+  0xbd, 0x04, 0x00, 0x00, 0x00, 0xbe, 0x00, 0x00, 0x10, 0x00, 0xbf, 0x00,
+  0x00, 0x20, 0x00, 0xb9, 0x00, 0x00, 0x01, 0x00, 0x8a, 0x06, 0x88, 0x07,
+  0x46, 0x47, 0x49, 0x75, 0xf7, 0x4d, 0x75, 0xe5, 0xc7, 0x05, 0x00, 0x05,
+  0x00, 0x00, 0xe5, 0xd0, 0x07, 0xb0, 0xf4, 0xeb, 0xfd, 0x8d, 0x76, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00,
+  0x00, 0x9a, 0xcf, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x92, 0xcf, 0x00,
+  0x17, 0x00, 0x78, 0x00, 0x01, 0x00
+};
+
+static const uint8_t x87[] = {
+  0xfa, 0x8c, 0xc8, 0x8e, 0xd8, 0x66, 0x0f, 0x01, 0x16, 0x80, 0x00, 0x0f,
+  0x20, 0xc0, 0x0c, 0x01, 0x0f, 0x22, 0xc0, 0x66, 0xea, 0x1b, 0x00, 0x01,
+  0x00, 0x08, 0x00, 0x66, 0xb8, 0x10, 0x00, 0x8e, 0xd8, 0x8e, 0xc0, 0x8e,
+  0xe0, 0x8e, 0xe8, 0x8e, 0xd0, 0xbc, 0xf0, 0xff, 0x09, 0x00, 0xdb, 0xe3,
+  0xb9, 0x40, 0x0d, 0x03, 0x00, 0xd9, 0xe8, 0xd9, 0xe8, 0xde, 0xc1, 0xd9,
+  0xeb, 0xd8, 0xc9, 0xd9, 0xfa, 0xd8, 0xf9, 0xd9, 0x1d, 0x64, 0x00, 0x01,
+  0x00, 0xd9, 0x05, 0x64, 0x00, 0x01, 0x00, 0xdd, 0xd8, 0x49, 0x75, 0xe3,
+  0xdd, 0xd8, 0xc7, 0x05, 0x00, 0x05, 0x00, 0x00, 0xe5, 0xd0, 0x07, 0xb0,
+  0xf4, 0xeb, 0xfd, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x9a, 0xcf, 0x00,
+  0xff, 0xff, 0x00, 0x00, 0x00, 0x92, 0xcf, 0x00, 0x17, 0x00, 0x68, 0x00,
+  0x01, 0x00
+};
+
+static const uint8_t mmx[] = {
+  0xfa, 0x8c, 0xc8, 0x8e, 0xd8, 0x66, 0x0f, 0x01, 0x16, 0xb0, 0x00, 0x0f,
+  0x20, 0xc0, 0x0c, 0x01, 0x0f, 0x22, 0xc0, 0x66, 0xea, 0x1b, 0x00, 0x01,
+  0x00, 0x08, 0x00, 0x66, 0xb8, 0x10, 0x00, 0x8e, 0xd8, 0x8e, 0xc0, 0x8e,
+  0xe0, 0x8e, 0xe8, 0x8e, 0xd0, 0xbc, 0xf0, 0xff, 0x09, 0x00, 0x0f, 0x6f,
+  0x05, 0x80, 0x00, 0x01, 0x00, 0x0f, 0x6f, 0x0d, 0x88, 0x00, 0x01, 0x00,
+  0xb9, 0xa0, 0x86, 0x01, 0x00, 0x0f, 0x6f, 0xd0, 0x0f, 0xfc, 0xd1, 0x0f,
+  0x6f, 0xda, 0x0f, 0xf5, 0xd9, 0x0f, 0xed, 0xd8, 0x0f, 0xd8, 0xd1, 0x0f,
+  0x63, 0xd3, 0x0f, 0x60, 0xda, 0x0f, 0xef, 0xc3, 0x0f, 0x7f, 0x05, 0x90,
+  0x00, 0x01, 0x00, 0x0f, 0x6f, 0x05, 0x90, 0x00, 0x01, 0x00, 0x49, 0x75,
+  0xd4, 0x0f, 0x77, 0xc7, 0x05, 0x00, 0x05, 0x00, 0x00, 0xe5, 0xd0, 0x07,
+  0xb0, 0xf4, 0xeb, 0xfd, 0x8d, 0x74, 0x26, 0x00, 0xef, 0xcd, 0xab, 0x89,
+  0x67, 0x45, 0x23, 0x01, 0x80, 0x01, 0x7f, 0x80, 0x7f, 0x01, 0x80, 0x7f,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x9a, 0xcf, 0x00,
+  0xff, 0xff, 0x00, 0x00, 0x00, 0x92, 0xcf, 0x00, 0x17, 0x00, 0x98, 0x00,
+  0x01, 0x00
+};
+
+static const uint8_t paging[] = {
+  0xfa, 0x8c, 0xc8, 0x8e, 0xd8, 0x66, 0x0f, 0x01, 0x16, 0xd0, 0x00, 0x0f,
+  0x20, 0xc0, 0x0c, 0x01, 0x0f, 0x22, 0xc0, 0x66, 0xea, 0x1b, 0x00, 0x01,
+  0x00, 0x08, 0x00, 0x66, 0xb8, 0x10, 0x00, 0x8e, 0xd8, 0x8e, 0xc0, 0x8e,
+  0xe0, 0x8e, 0xe8, 0x8e, 0xd0, 0xbc, 0xf0, 0xff, 0x09, 0x00, 0xbf, 0x00,
+  0x00, 0x30, 0x00, 0xb8, 0x03, 0x00, 0x00, 0x00, 0xb9, 0x00, 0x10, 0x00,
+  0x00, 0x89, 0x07, 0x05, 0x00, 0x10, 0x00, 0x00, 0x83, 0xc7, 0x04, 0x49,
+  0x75, 0xf3, 0xbf, 0x00, 0x00, 0x08, 0x00, 0x31, 0xc0, 0xb9, 0x00, 0x04,
+  0x00, 0x00, 0xf3, 0xab, 0xbf, 0x00, 0x00, 0x08, 0x00, 0xb8, 0x03, 0x00,
+  0x30, 0x00, 0xb9, 0x04, 0x00, 0x00, 0x00, 0x89, 0x07, 0x05, 0x00, 0x10,
+  0x00, 0x00, 0x83, 0xc7, 0x04, 0x49, 0x75, 0xf3, 0xb8, 0x00, 0x00, 0x08,
+  0x00, 0x0f, 0x22, 0xd8, 0x0f, 0x20, 0xc0, 0x0d, 0x00, 0x00, 0x00, 0x80,
+  0x0f, 0x22, 0xc0, 0xbd, 0x40, 0x00, 0x00, 0x00, 0x0f, 0x20, 0xd8, 0x0f,
+  0x22, 0xd8, 0xbe, 0x00, 0x00, 0x40, 0x00, 0xb9, 0x00, 0x08, 0x00, 0x00,
+  0x01, 0x0e, 0x81, 0xc6, 0x00, 0x10, 0x00, 0x00, 0x49, 0x75, 0xf5, 0x4d,
+  0x75, 0xe2, 0xc7, 0x05, 0x00, 0x05, 0x00, 0x00, 0xe5, 0xd0, 0x07, 0xb0,
+  0xf4, 0xeb, 0xfd, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xff, 0xff, 0x00, 0x00, 0x00, 0x9a, 0xcf, 0x00, 0xff, 0xff, 0x00, 0x00,
+  0x00, 0x92, 0xcf, 0x00, 0x17, 0x00, 0xb8, 0x00, 0x01, 0x00
+};
+
+static const uint8_t interrupt[] = {
+  0xfa, 0x8c, 0xc8, 0x8e, 0xd8, 0x66, 0x0f, 0x01, 0x16, 0x90, 0x00, 0x0f,
+  0x20, 0xc0, 0x0c, 0x01, 0x0f, 0x22, 0xc0, 0x66, 0xea, 0x1b, 0x00, 0x01,
+  0x00, 0x08, 0x00, 0x66, 0xb8, 0x10, 0x00, 0x8e, 0xd8, 0x8e, 0xc0, 0x8e,
+  0xe0, 0x8e, 0xe8, 0x8e, 0xd0, 0xbc, 0xf0, 0xff, 0x09, 0x00, 0xb8, 0x6e,
+  0x00, 0x01, 0x00, 0xbf, 0x00, 0x04, 0x09, 0x00, 0x66, 0x89, 0x07, 0x66,
+  0xc7, 0x47, 0x02, 0x08, 0x00, 0x66, 0xc7, 0x47, 0x04, 0x00, 0xee, 0xc1,
+  0xe8, 0x10, 0x66, 0x89, 0x47, 0x06, 0x0f, 0x01, 0x1d, 0x70, 0x00, 0x01,
+  0x00, 0x31, 0xdb, 0xb9, 0xa0, 0x86, 0x01, 0x00, 0xcd, 0x80, 0x49, 0x75,
+  0xfb, 0xc7, 0x05, 0x00, 0x05, 0x00, 0x00, 0xe5, 0xd0, 0x07, 0xb0, 0xf4,
+  0xeb, 0xfd, 0x43, 0xcf, 0xff, 0x07, 0x00, 0x00, 0x09, 0x00, 0x66, 0x90,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00,
+  0x00, 0x9a, 0xcf, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x92, 0xcf, 0x00,
+  0x17, 0x00, 0x78, 0x00, 0x01, 0x00
+};
+
+} // namespace guest
+
+#endif // X86EMULATOR_BENCH_GUEST_PROGRAMS_H
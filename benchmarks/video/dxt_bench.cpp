@@ -0,0 +1,172 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * DXT block decompression benchmark
+ *
+ * Decodes images of random DXT1, DXT3 and DXT5 blocks with the vector
+ * block decoder and with the texel-by-texel reference decoder, and
+ * reports the throughput of each as JSON on stdout, one object per run.
+ * That both decoders agree is checked by x86emu_geforce3_dxt_test.
+ *
+ * Usage: x86emu_dxt_bench [--format dxt1|dxt3|dxt5] [--size <texels>]
+ *                         [--repeat <n>]
+ */
+
+#include "geforce3_dxt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using GeForce3Dxt::Format;
+
+namespace {
+
+// Decode each image until at least this much time has passed
+constexpr double MIN_SECONDS = 0.5;
+
+struct FormatInfo {
+    const char* name;
+    Format format;
+};
+
+const FormatInfo FORMATS[] = {
+    { "dxt1", Format::DXT1 },
+    { "dxt3", Format::DXT3 },
+    { "dxt5", Format::DXT5 },
+};
+
+const char* isaName()
+{
+#if GEFORCE3_DXT_LANES == 8
+    return "avx2";
+#elif GEFORCE3_DXT_LANES == 4
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+std::vector<uint8_t> randomImage(Format format, int size)
+{
+    std::vector<uint8_t> image(GeForce3Dxt::ImageBytes(format, size, size));
+    std::mt19937 random(1234);
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = static_cast<uint8_t>(random());
+    }
+
+    // Make both DXT1 color modes and both DXT5 alpha modes common
+    size_t blockBytes = GeForce3Dxt::BlockBytes(format);
+    for (size_t block = 0; block + blockBytes <= image.size(); block += blockBytes) {
+        if ((block / blockBytes) & 1) {
+            uint8_t* color = &image[block + (format == Format::DXT1 ? 0 : 8)];
+            std::swap(color[0], color[2]);
+            std::swap(color[1], color[3]);
+            if (format == Format::DXT5) {
+                std::swap(image[block], image[block + 1]);
+            }
+        }
+    }
+    return image;
+}
+
+template<typename Decoder>
+double measure(Decoder decode, uint64_t& texels)
+{
+    texels = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do {
+        texels += decode();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < MIN_SECONDS);
+    return seconds;
+}
+
+void printResult(const FormatInfo& info, const char* decoder, int size, int run, uint64_t texels, double seconds)
+{
+    double mtexels = seconds > 0.0 ? (texels / seconds) / 1e6 : 0.0;
+    std::printf("{\"format\": \"%s\", \"decoder\": \"%s\", \"size\": %d, \"run\": %d, "
+                "\"texels\": %llu, \"host_ns\": %.0f, \"mtexels_per_s\": %.1f}\n",
+                info.name, decoder, size, run, static_cast<unsigned long long>(texels), seconds * 1e9, mtexels);
+    std::fflush(stdout);
+}
+
+void printUsage(const char* argv0)
+{
+    std::fprintf(stderr, "Usage: %s [--format dxt1|dxt3|dxt5] [--size <texels>] [--repeat <n>]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string formatFilter;
+    int size = 1024;
+    int repeat = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--format" && hasValue) {
+            formatFilter = argv[++i];
+        } else if (arg == "--size" && hasValue) {
+            size = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--repeat" && hasValue) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<uint32_t> decoded(static_cast<size_t>(size) * size);
+    std::vector<uint32_t> reference(decoded.size());
+
+    for (const auto& info : FORMATS) {
+        if (!formatFilter.empty() && formatFilter != info.name) {
+            continue;
+        }
+
+        std::vector<uint8_t> image = randomImage(info.format, size);
+
+        for (int run = 0; run < repeat; run++) {
+            uint64_t texels;
+            double seconds = measure([&] {
+                GeForce3Dxt::DecodeImage(info.format, image.data(), size, size, decoded.data());
+                return static_cast<uint64_t>(decoded.size());
+            }, texels);
+            printResult(info, isaName(), size, run, texels, seconds);
+
+            seconds = measure([&] {
+                GeForce3Dxt::DecodeImageReference(info.format, image.data(), size, size, reference.data());
+                return static_cast<uint64_t>(reference.size());
+            }, texels);
+            printResult(info, "reference", size, run, texels, seconds);
+        }
+    }
+
+    return 0;
+}
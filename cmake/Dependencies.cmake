@@ -39,4 +39,18 @@ endif()
 # Remove WinUAE section
 # if(X86EMU_USE_WINUAE AND NOT DEFINED FETCHCONTENT_BASE_DIR)
 #     x86emu_init_submodule(external/winuae)
-# endif()
\ No newline at end of file
+# endif()
+
+# Optional zstd for instruction trace compression
+find_package(PkgConfig QUIET)
+if(PkgConfig_FOUND)
+    pkg_check_modules(ZSTD QUIET IMPORTED_TARGET libzstd)
+endif()
+
+# Function to enable zstd on a target when it is available
+function(x86emu_use_zstd target)
+    if(ZSTD_FOUND)
+        target_compile_definitions(${target} PRIVATE X86EMU_HAVE_ZSTD=1)
+        target_link_libraries(${target} PRIVATE PkgConfig::ZSTD)
+    endif()
+endfunction()
@@ -0,0 +1,120 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ * 
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_ACCURACY_PROFILE_H
+#define X86EMULATOR_ACCURACY_PROFILE_H
+
+#include <string>
+
+/**
+ * @brief Emulation accuracy profile
+ * 
+ * Groups the accuracy features that cost throughput without changing
+ * what correct guest software computes, so they can be turned off
+ * together. The "accurate" profile enables every feature except the
+ * opt-in ones, the "fast" profile disables all of them. Individual
+ * features can be overridden after a profile is selected; opt-in
+ * features are only turned on that way.
+ * 
+ * Unsafe features are opt-in shortcuts that can change what the guest
+ * sees. No profile enables them, "fast" included.
+ * 
+ * The profile is selected from the machine configuration ([machine]
+ * profile, overrides in [accuracy]) before the CPU and devices are
+ * created. Components query it when they are set up.
+ */
+class AccuracyProfile {
+public:
+    /**
+     * @brief Switchable accuracy features
+     */
+    enum class Feature {
+        CPU_CACHE,      // Cache contents model of cores that have one (MAME Athlon XP)
+        CYCLE_TIMING,   // Per-model cycle timing tables (86Box recompiler)
+        W_CLIPPING,     // GeForce3 near-plane clipping of triangles (opt-in)
+        SYNC_PULLER,    // GeForce3 pushbuffer commands run on the CPU thread as DMAPUT is written
+        LAZY_CLEARS,    // GeForce3 clears fill memory on first GPU use; CPU reads of RAM
+                        // may see the old contents until then (opt-in, unsafe)
+        COUNT
+    };
+    
+    /**
+     * @brief Get the singleton instance
+     * 
+     * @return AccuracyProfile* Profile instance
+     */
+    static AccuracyProfile* GetInstance();
+    
+    /**
+     * @brief Select a named profile
+     * 
+     * Resets every feature to the profile default.
+     * 
+     * @param name "accurate" or "fast"
+     * @return true if the name is known
+     */
+    bool setProfile(const std::string& name);
+    
+    /**
+     * @brief Get the name of the selected profile
+     * 
+     * @return std::string Profile name
+     */
+    std::string getProfile() const { return m_profile; }
+    
+    /**
+     * @brief Check whether a feature is enabled
+     * 
+     * @param feature Feature
+     * @return true if enabled
+     */
+    bool isEnabled(Feature feature) const { return m_enabled[static_cast<int>(feature)]; }
+    
+    /**
+     * @brief Override a feature of the selected profile
+     * 
+     * @param feature Feature
+     * @param enable True to enable
+     */
+    void setEnabled(Feature feature, bool enable) { m_enabled[static_cast<int>(feature)] = enable; }
+    
+    /**
+     * @brief Get the configuration key of a feature
+     * 
+     * @param feature Feature
+     * @return const char* Key in the [accuracy] section
+     */
+    static const char* getFeatureName(Feature feature);
+    
+    /**
+     * @brief Check whether a feature trades correctness for speed
+     * 
+     * @param feature Feature
+     * @return true if enabling it can change guest-visible results
+     */
+    static bool isUnsafe(Feature feature);
+    
+private:
+    AccuracyProfile();
+    
+    std::string m_profile;
+    bool m_enabled[static_cast<int>(Feature::COUNT)];
+};
+
+#endif // X86EMULATOR_ACCURACY_PROFILE_H
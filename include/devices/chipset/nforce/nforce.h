@@ -34,6 +34,7 @@
 #include <memory>
 
 class NForce;
+class InterruptRouter;
 
 class SMBusDevice {
 public:
@@ -194,6 +195,9 @@ public:
     // Methods for interconnection with other devices
     void SetCPUInterface(CPU* cpu) { m_cpu = cpu; }
     
+    // Assert IRQs into the machine routing fabric instead of the local PICs
+    void SetInterruptRouter(InterruptRouter* router) { m_router = router; }
+    
     // Timer interrupt handling
     void PITChannel0Changed(bool state);
     void PITChannel1Changed(bool state);
@@ -235,6 +239,7 @@ private:
     DS12885* m_rtc;
     
     CPU* m_cpu;
+    InterruptRouter* m_router;
     bool m_interruptOutputState;
     bool m_dmaEop;
 };
@@ -482,6 +487,7 @@ public:
     
     // Setup methods
     void SetCPU(CPU* cpu);
+    void SetInterruptRouter(InterruptRouter* router);
     void SetBIOS(uint8_t* biosRom);
     void SetRAM(void* ramPtr, uint32_t ramSizeMB);
     
@@ -502,6 +508,7 @@ public:
     
 private:
     CPU* m_cpu;
+    InterruptRouter* m_router;
     PCIBus* m_pciBus;
     
     // nForce chipset components
@@ -32,12 +32,16 @@
 // Forward declarations
 namespace x86emu {
     class X86CPU;
+    class X86SMPSystem;
+    class GuestProfiler;
+    class InstructionTracer;
 }
 
 class ConfigManager;
 class MemoryManager;
 class IOManager;
 class InterruptController;
+class InterruptRouter;
 class DeviceManager;
 class TimerManager;
 class GraphicsAdapter;
@@ -290,6 +294,13 @@ public:
      * @return Pointer to the ConfigManager
      */
     ConfigManager* getConfigManager() const { return m_configManager.get(); }
+    
+    /**
+     * @brief Get the interrupt routing fabric devices assert their IRQs into
+     * 
+     * @return Pointer to the InterruptRouter, or nullptr before the CPU is initialized
+     */
+    InterruptRouter* getInterruptRouter() const { return m_intRouter.get(); }
 
     /**
      * @brief Get the CPU backend type
@@ -335,6 +346,71 @@ private:
      */
     bool initializeCPU();
     
+    /**
+     * @brief Apply the FPU mode from the configuration (cpu/fpu)
+     * 
+     * @return true if the mode was applied
+     * @return false if the mode name is invalid
+     */
+    bool configureFPU();
+    
+    /**
+     * @brief Apply the CPU switches of the accuracy profile
+     * 
+     * Backends that do not model a feature keep running without it.
+     * 
+     * @return true always; unsupported switches are only logged
+     */
+    bool configureAccuracy();
+    
+    /**
+     * @brief Connect the interrupt routing fabric to the CPU
+     * 
+     * Routes ISA lines to the 8259 of the CPU backend, or to the
+     * InterruptController for backends without one, and all lines to the
+     * I/O APIC when the SMP system provides one.
+     * 
+     * @return true if the fabric was set up
+     */
+    bool initializeInterrupts();
+    
+    /**
+     * @brief Report guest stores to translated code to the MemoryManager
+     * 
+     * The CPU backend keeps guest RAM itself, so the pages marked with
+     * MemoryManager::markCode() are watched in the backend and its stores
+     * to them come back through MemoryManager::notifyWrite().
+     * 
+     * @return true always; backends without support are only logged
+     */
+    bool configureCodeTracking();
+    
+    /**
+     * @brief Create the guest profiler if enabled in the configuration
+     * 
+     * @return true if profiling was set up or is disabled
+     * @return false if the profiler configuration is invalid
+     */
+    bool initializeProfiler();
+    
+    /**
+     * @brief Write guest profiler output files
+     */
+    void writeProfile();
+    
+    /**
+     * @brief Open the instruction trace if enabled in the configuration
+     * 
+     * @return true if tracing was set up or is disabled
+     * @return false if the trace configuration is invalid
+     */
+    bool initializeTracer();
+    
+    /**
+     * @brief Detach the instruction tracer and flush the trace file
+     */
+    void closeTrace();
+    
     /**
      * @brief Initialize the memory subsystem
      * 
@@ -388,9 +464,13 @@ private:
     // Core components
     std::unique_ptr<ConfigManager> m_configManager;
     std::unique_ptr<x86emu::X86CPU> m_cpu;
+    std::unique_ptr<x86emu::X86SMPSystem> m_smp;  // Set instead of m_cpu when cpu/count > 1
+    std::unique_ptr<x86emu::GuestProfiler> m_profiler;
+    std::unique_ptr<x86emu::InstructionTracer> m_tracer;
     std::unique_ptr<MemoryManager> m_memory;
     std::unique_ptr<IOManager> m_io;
     std::unique_ptr<InterruptController> m_intController;
+    std::unique_ptr<InterruptRouter> m_intRouter;
     std::unique_ptr<DeviceManager> m_deviceManager;
     std::unique_ptr<TimerManager> m_timerManager;
     
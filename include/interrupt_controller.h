@@ -20,16 +20,21 @@
 #ifndef X86EMULATOR_INTERRUPT_CONTROLLER_H
 #define X86EMULATOR_INTERRUPT_CONTROLLER_H
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <vector>
-#include <mutex>
 
 /**
  * @brief Interrupt controller for the emulator
  * 
  * Emulates the 8259A Programmable Interrupt Controller (PIC).
  * Handles IRQ management and interrupt cascading with two PICs.
+ * 
+ * setIRQ() may be called from any thread. It only updates atomic line
+ * and request words, so device threads never take a lock. All other
+ * methods belong to the CPU thread, which owns the PIC state machine
+ * and reruns it only when the request word has changed.
  */
 class InterruptController {
 public:
@@ -64,6 +69,8 @@ public:
     /**
      * @brief Assert an IRQ line
      * 
+     * Lock-free; safe to call from any thread.
+     * 
      * @param irq IRQ number (0-15)
      * @param state true to assert, false to deassert
      */
@@ -72,10 +79,13 @@ public:
     /**
      * @brief Check if an IRQ is pending
      * 
+     * A single atomic load when no IRQ line has changed since the last
+     * call; otherwise the PICs are re-evaluated first.
+     * 
      * @return true if an IRQ is pending
      * @return false if no IRQ is pending
      */
-    bool isPending() const;
+    bool isPending();
     
     /**
      * @brief Get the next pending interrupt vector
@@ -168,22 +178,23 @@ private:
     PIC m_pic1;  // Master PIC
     PIC m_pic2;  // Slave PIC
     
-    // IRQ states
-    uint16_t m_irqLines;     // Current IRQ line states
-    uint16_t m_irqRequests;  // IRQ requests
+    // IRQ states, written by any thread
+    std::atomic<uint16_t> m_irqLines;     // Current IRQ line states
+    std::atomic<uint16_t> m_irqRequests;  // IRQ requests latched on rising edges
+    
+    // CPU thread view of the request word
+    uint16_t m_irqRequestsSeen;  // Request word the PICs were last updated from
+    bool m_pending;              // Pending state of the PICs for that word
     
     // Interrupt callback
     InterruptCallback m_interruptCallback;
     
-    // Mutex for thread safety
-    mutable std::mutex m_mutex;
-    
     // Helper methods
     void updatePIC();
+    bool checkPending() const;
     bool picHasPendingInterrupt(const PIC& pic) const;
     int getHighestPriorityIRQ(const PIC& pic) const;
     void acknowledgeInterruptPIC(PIC& pic, int irq);
-    void setIRQLine(int irq, bool state);
 };
 
 #endif // X86EMULATOR_INTERRUPT_CONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,225 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ * 
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_INTERRUPT_ROUTER_H
+#define X86EMULATOR_INTERRUPT_ROUTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+class InterruptController;
+
+namespace x86emu {
+    class X86CPU;
+    class IOAPIC;
+}
+
+/**
+ * @brief Interrupt routing fabric
+ * 
+ * The single place devices assert interrupt lines into. Lines 0-15 are
+ * the ISA IRQs, lines 16-23 the PCI interrupt pins.
+ * 
+ * setIRQ() is lock-free and may be called from any thread: it records the
+ * new line state and rising edge in atomic words. update() runs on the
+ * CPU thread and delivers the changed lines through a route table
+ * resolved once when the targets are attached. Lines set while the CPU
+ * thread runs guest code inside an ExecutionScope, as port and MMIO
+ * handlers do, are delivered at once; lines set by other threads wait
+ * for the next update() between execution slices. The route table maps
+ * lines to targets only: vectors come from the acknowledge cycle of the
+ * PIC model, since the guest can reprogram them at any time.
+ * 
+ * - to the 8259 pair built into the CPU backend (86Box), or
+ * - to the InterruptController, which then drives the CPU INTR line
+ *   (backends without a PIC), and
+ * - to the I/O APIC pin of the same number when APICs are present.
+ * 
+ * PCI functions connect with PCIDevice::ConnectInterruptRouter(): INTx
+ * drives the line of its pin, and MSI writes go through sendMSI() to the
+ * MSI handler, which is the APIC bus of the SMP system.
+ * 
+ * Each interrupt is therefore tracked by exactly one PIC model.
+ */
+class InterruptRouter {
+public:
+    /**
+     * @brief Marks the calling thread as executing guest code
+     * 
+     * While a scope is open, setIRQ() calls from the same thread deliver
+     * the line at once instead of waiting for the next update().
+     */
+    class ExecutionScope {
+    public:
+        /**
+         * @brief Open the scope
+         * 
+         * @param router Router of the running CPU, or nullptr for none
+         */
+        explicit ExecutionScope(InterruptRouter* router);
+        
+        /**
+         * @brief Close the scope
+         */
+        ~ExecutionScope();
+        
+        ExecutionScope(const ExecutionScope&) = delete;
+        ExecutionScope& operator=(const ExecutionScope&) = delete;
+        
+    private:
+        InterruptRouter* m_previous;
+    };
+    
+    /**
+     * @brief Number of interrupt lines (16 ISA IRQs, 8 PCI pins)
+     */
+    static constexpr int LINE_COUNT = 24;
+    
+    /**
+     * @brief First PCI interrupt line (PIRQA)
+     */
+    static constexpr int PCI_LINE_BASE = 16;
+    
+    /**
+     * @brief Handler performing an MSI memory write
+     */
+    using MSIHandler = std::function<void(uint32_t address, uint32_t data)>;
+    
+    /**
+     * @brief Construct a router with no targets
+     */
+    InterruptRouter();
+    
+    /**
+     * @brief Destroy the router
+     */
+    ~InterruptRouter();
+    
+    /**
+     * @brief Attach the CPU that receives legacy (8259) interrupts
+     * 
+     * @param cpu CPU, or nullptr to detach
+     * @param backendPIC true if the CPU backend contains its own 8259 pair
+     */
+    void setCPU(x86emu::X86CPU* cpu, bool backendPIC);
+    
+    /**
+     * @brief Attach the 8259 model used when the backend has none
+     * 
+     * @param controller Interrupt controller, or nullptr to detach
+     */
+    void setController(InterruptController* controller);
+    
+    /**
+     * @brief Attach the I/O APIC
+     * 
+     * @param ioapic I/O APIC, or nullptr to detach
+     */
+    void setIOAPIC(x86emu::IOAPIC* ioapic);
+    
+    /**
+     * @brief Attach the target of message signalled interrupts
+     * 
+     * @param handler MSI handler, or nullptr to drop messages
+     */
+    void setMSIHandler(MSIHandler handler);
+    
+    /**
+     * @brief Send a message signalled interrupt
+     * 
+     * Safe to call from any thread. Dropped when no MSI handler is
+     * attached, as on systems without APICs.
+     * 
+     * @param address MSI address
+     * @param data MSI data
+     */
+    void sendMSI(uint32_t address, uint32_t data);
+    
+    /**
+     * @brief Set the state of an interrupt line
+     * 
+     * Lock-free; safe to call from any thread. Takes effect at once inside
+     * an ExecutionScope of this router, otherwise at the next update().
+     * 
+     * @param line Line number (0-23)
+     * @param state true to assert, false to deassert
+     */
+    void setIRQ(int line, bool state);
+    
+    /**
+     * @brief Deliver line changes to the targets
+     * 
+     * Must be called on the CPU thread, between execution slices.
+     */
+    void update();
+    
+    /**
+     * @brief Run the interrupt acknowledge cycle of the attached controller
+     * 
+     * This is the interrupt acknowledge handler of a CPU whose backend has
+     * no 8259 pair. A backend PIC acknowledges on its own, so with one
+     * attached this always returns -1.
+     * 
+     * @return Interrupt vector, or -1 if none is pending
+     */
+    int acknowledge();
+    
+    /**
+     * @brief Deassert all lines
+     */
+    void reset();
+    
+    /**
+     * @brief Get the current line states
+     * 
+     * @return One bit per line
+     */
+    uint32_t getLineState() const { return m_lines.load(std::memory_order_relaxed); }
+
+private:
+    // Route table bits
+    static constexpr uint8_t ROUTE_BACKEND = 0x01;
+    static constexpr uint8_t ROUTE_CONTROLLER = 0x02;
+    static constexpr uint8_t ROUTE_IOAPIC = 0x04;
+    
+    // Targets
+    x86emu::X86CPU* m_cpu;
+    bool m_backendPIC;
+    InterruptController* m_controller;
+    x86emu::IOAPIC* m_ioapic;
+    MSIHandler m_msiHandler;
+    
+    // Line state, written by any thread
+    std::atomic<uint32_t> m_lines;    // Current line states
+    std::atomic<uint32_t> m_edges;    // Rising edges not yet delivered
+    std::atomic<uint32_t> m_changed;  // Lines to look at in update()
+    
+    // CPU thread state
+    uint32_t m_delivered;             // Line states as last delivered
+    bool m_cpuIRQ;                    // INTR driven from the controller
+    uint8_t m_routes[LINE_COUNT];     // Targets of each line
+    
+    // Helper methods
+    void rebuildRoutes();
+    void deliver(int line, bool state);
+    void updateCPUIRQ();
+};
+
+#endif // X86EMULATOR_INTERRUPT_ROUTER_H
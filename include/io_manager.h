@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <mutex>
@@ -31,6 +32,11 @@
  * @brief I/O port manager for the emulator
  * 
  * Handles I/O port access and device registration.
+ * 
+ * Port callbacks run without the registry lock held, under a lock shared
+ * by all ranges of the same device. Accesses to one device are serialized
+ * while different devices can be reached from several CPU threads at once,
+ * and callbacks may register or unregister port ranges.
  */
 class IOManager {
 public:
@@ -53,6 +59,7 @@ public:
         std::string device;  // Device name
         IOReadCallback readCallback;  // Read callback
         IOWriteCallback writeCallback;  // Write callback
+        std::shared_ptr<std::recursive_mutex> deviceLock;  // Shared by the device's ranges
     };
     
     /**
@@ -40,6 +40,29 @@ public:
      */
     using MemoryCallback = std::function<void(uint32_t, uint32_t)>;
     
+    /**
+     * @brief Callback type for translated code invalidation
+     * 
+     * Receives the physical address and size of a write that hit code
+     * marked with markCode(). Called on the writing thread after the memory
+     * lock is released, so it may call markCode() and unmarkCode().
+     */
+    using CodeInvalidationCallback = std::function<void(uint32_t, uint32_t)>;
+    
+    /**
+     * @brief Callback type for code page watching
+     * 
+     * Receives a page address and whether the page holds translated code
+     * or is watched with watchWrites(). A CPU backend that keeps guest RAM
+     * itself uses it to report stores to those pages through notifyWrite().
+     */
+    using CodePageWatcher = std::function<void(uint32_t, bool)>;
+    
+    /**
+     * @brief Granularity of code tracking within a 4 KB page (64 bytes)
+     */
+    static constexpr uint32_t CODE_CHUNK_SHIFT = 6;
+    
     /**
      * @brief Memory access type
      */
@@ -142,6 +165,115 @@ public:
      */
     void writeDword(uint32_t address, uint32_t value);
     
+    /**
+     * @brief Write a block of memory on behalf of a bus master
+     * 
+     * Bus masters must use this or notifyWrite() so that translated code
+     * in the destination is invalidated.
+     * 
+     * @param address Physical memory address
+     * @param data Source data
+     * @param size Number of bytes
+     * @return true if the write was successful
+     * @return false if the range is invalid or not writable
+     */
+    bool writeBlock(uint32_t address, const uint8_t* data, uint32_t size);
+    
+    /**
+     * @brief Report a write made without going through the MemoryManager
+     * 
+     * Used for DMA done through getPointer(), and for the stores of a CPU
+     * backend that keeps guest RAM itself, which reports them for the
+     * pages given to the code page watcher.
+     * 
+     * @param address Physical memory address
+     * @param size Number of bytes written
+     */
+    void notifyWrite(uint32_t address, uint32_t size);
+    
+    /**
+     * @brief Mark a range as containing translated code
+     * 
+     * Writes to the 64-byte chunks covered by the range invoke the code
+     * invalidation callbacks once, after which the marks are cleared until
+     * the code is translated again.
+     * 
+     * @param address Physical memory address
+     * @param size Range size
+     */
+    void markCode(uint32_t address, uint32_t size);
+    
+    /**
+     * @brief Clear the translated code marks of a range
+     * 
+     * @param address Physical memory address
+     * @param size Range size
+     */
+    void unmarkCode(uint32_t address, uint32_t size);
+    
+    /**
+     * @brief Check if a 4 KB page contains translated code
+     * 
+     * @param address Any address within the page
+     * @return true if any part of the page is marked as code
+     * @return false if the page holds no translated code
+     */
+    bool pageContainsCode(uint32_t address) const;
+    
+    /**
+     * @brief Register a callback for writes to translated code
+     * 
+     * @param callback Callback function
+     * @return Registration ID, or 0 if registration failed
+     */
+    uint32_t registerCodeInvalidationCallback(CodeInvalidationCallback callback);
+    
+    /**
+     * @brief Unregister a code invalidation callback
+     * 
+     * @param id Registration ID
+     * @return true if unregistration was successful
+     * @return false if unregistration failed
+     */
+    bool unregisterCodeInvalidationCallback(uint32_t id);
+    
+    /**
+     * @brief Set the watcher told which pages hold translated code
+     * 
+     * Called with the memory lock held when a page gains its first code
+     * chunk or write watch, and when it loses the last of both.
+     * 
+     * @param watcher Watcher, or nullptr to remove it
+     */
+    void setCodePageWatcher(CodePageWatcher watcher);
+    
+    /**
+     * @brief Check if stores the CPU backend makes itself are reported
+     * 
+     * @return true if a code page watcher is set, so stores to watched
+     * pages reach notifyWrite() and the write callbacks
+     */
+    bool hasCodePageWatcher() const;
+    
+    /**
+     * @brief Have the CPU backend report stores to the pages of a range
+     * 
+     * Watches nest; each call needs a matching unwatchWrites(). Stores
+     * come back through notifyWrite() and reach the write callbacks.
+     * 
+     * @param address Physical memory address
+     * @param size Range size
+     */
+    void watchWrites(uint32_t address, uint32_t size);
+    
+    /**
+     * @brief Drop a watch taken with watchWrites()
+     * 
+     * @param address Physical memory address
+     * @param size Range size
+     */
+    void unwatchWrites(uint32_t address, uint32_t size);
+    
     /**
      * @brief Register a memory region
      * 
@@ -221,6 +353,11 @@ public:
     /**
      * @brief Register a callback for memory access
      * 
+     * The callback gets the address and size of every access overlapping
+     * the range and runs with the memory lock held, so it must not call
+     * back into the MemoryManager. Write callbacks run after the data is
+     * stored, and also for writes reported through notifyWrite().
+     * 
      * @param address Start address
      * @param size Region size
      * @param type Access type
@@ -305,6 +442,20 @@ private:
     std::vector<CallbackInfo> m_callbacks;
     uint32_t m_nextCallbackId;
     
+    // Translated code tracking: one mask per 4 KB page, bit n set when
+    // 64-byte chunk n of the page holds code
+    struct CodeCallbackInfo {
+        uint32_t id;
+        CodeInvalidationCallback callback;
+    };
+    
+    std::vector<uint64_t> m_codeChunks;
+    std::vector<CodeCallbackInfo> m_codeCallbacks;
+    CodePageWatcher m_codePageWatcher;
+    
+    // Nesting count of watchWrites() per 4 KB page
+    std::vector<uint32_t> m_writeWatches;
+    
     // Memory sizes
     uint32_t m_totalSize;
     uint32_t m_conventionalSize;
@@ -316,6 +467,11 @@ private:
     // Helper methods
     void notifyCallbacks(uint32_t address, uint32_t size, AccessType type);
     bool checkAccess(uint32_t address, uint32_t size, AccessType type) const;
+    std::vector<CodeInvalidationCallback> checkCodeWrite(uint32_t address, uint32_t size);
+    std::vector<CodeInvalidationCallback> invalidateCode(uint32_t address, uint32_t size);
+    static void runCodeCallbacks(const std::vector<CodeInvalidationCallback>& callbacks, uint32_t address, uint32_t size);
+    static uint64_t codeChunkMask(uint32_t offset, uint32_t size);
+    bool pageWatched(uint32_t page) const { return m_codeChunks[page] != 0 || m_writeWatches[page] != 0; }
 };
 
 #endif // X86EMULATOR_MEMORY_MANAGER_H
\ No newline at end of file
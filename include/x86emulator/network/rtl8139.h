@@ -3,6 +3,7 @@
 #include "x86emulator/network_device.h"
 #include <array>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <queue>
 #include <string>
@@ -73,6 +74,12 @@ public:
      */
     void SetIRQ(int irq);
     
+    /**
+     * Set the callback driving the interrupt output.
+     * @param callback Called with the new state whenever it changes
+     */
+    void SetIRQCallback(std::function<void(bool state)> callback);
+    
 private:
     // RTL8139 register offsets
     enum RegisterOffsets {
@@ -207,6 +214,10 @@ private:
     // IRQ number
     int m_irq;
     
+    // Interrupt output
+    std::function<void(bool state)> m_irqCallback;
+    bool m_irqState;
+    
     // Packet callback
     PacketCallback m_packetCallback;
     void* m_callbackUserData;
@@ -253,6 +264,9 @@ private:
     // Check if interrupts are enabled for a specific cause
     bool IsInterruptEnabled(uint16_t cause) const;
     
+    // Drive the interrupt output from the status and mask registers
+    void UpdateInterrupt();
+    
     // Process a received packet
     void ProcessReceivedPacket(const uint8_t* data, size_t size);
     
@@ -44,6 +44,14 @@ public:
      */
     void SetIRQ(int irq);
     
+    /**
+     * Expose an MSI capability to the guest.
+     * The RTL8139 has none; this lets guests that support MSI give the
+     * adapter its own vector instead of a shared INTx line.
+     * @param enable true to add the capability
+     */
+    void SetMSICapable(bool enable);
+    
     /**
      * Get the RTL8139 network adapter.
      * @return Pointer to the RTL8139 adapter
@@ -2,17 +2,40 @@
 
 #include "x86emulator/device.h"
 #include <cstdint>
+#include <functional>
 #include <string>
 
+class InterruptRouter;
+
 namespace x86emu {
 
 /**
  * @brief Base class for PCI devices.
  * 
  * This class provides the interface for PCI device emulation.
+ * 
+ * Devices raise their interrupt through SetInterruptLevel(). By default
+ * this drives the INTx line handed to SetInterruptCallback(), which the
+ * board routes to a PIC or I/O APIC pin. A device that places an MSI
+ * capability in its configuration space (EnableMSICapability()) instead
+ * sends a message through SetMSICallback() once the guest enables MSI,
+ * giving it a private vector that no other device shares.
+ * 
+ * ConnectInterruptRouter() installs both callbacks for a device on the
+ * machine's InterruptRouter.
  */
 class PCIDevice : public Device {
 public:
+    /**
+     * Callback driving the INTx line.
+     */
+    using InterruptCallback = std::function<void(bool state)>;
+    
+    /**
+     * Callback performing an MSI memory write.
+     */
+    using MSICallback = std::function<void(uint32_t address, uint32_t data)>;
+    
     /**
      * Constructor with device name and description.
      * @param name Unique identifier for the device
@@ -98,11 +121,97 @@ public:
      * @param function Function number
      */
     void SetPCIAddress(uint8_t bus, uint8_t device, uint8_t function);
+    
+    /**
+     * Set the callback driving the INTx line.
+     * @param callback Callback function
+     */
+    void SetInterruptCallback(InterruptCallback callback);
+    
+    /**
+     * Set the callback performing MSI writes.
+     * @param callback Callback function
+     */
+    void SetMSICallback(MSICallback callback);
+    
+    /**
+     * Connect INTx and MSI to the machine's interrupt routing fabric.
+     * INTx drives the router line of the PIRQ the slot is wired to; MSI
+     * writes reach the APIC bus through the router.
+     * @param router Interrupt router
+     * @param pirq PIRQ line of the slot (0-7)
+     */
+    void ConnectInterruptRouter(InterruptRouter* router, int pirq);
+    
+    /**
+     * Check whether the guest has enabled MSI.
+     * @return true if interrupts are sent as messages
+     */
+    bool IsMSIEnabled() const;
 
 protected:
+    // Standard MSI capability with a 32-bit address and one message
+    static constexpr uint8_t MSI_CAP_ID = 0x05;
+    static constexpr uint8_t MSI_CAP_SIZE = 0x0C;
+    
+    // Status register bit advertising a capabilities list
+    static constexpr uint16_t STATUS_CAP_LIST = 0x0010;
+    
+    /**
+     * Place an MSI capability in the configuration space.
+     * The device must still report offset from its capabilities pointer
+     * (0x34) and set STATUS_CAP_LIST in its status register.
+     * @param offset Configuration space offset of the capability, or 0 to remove it
+     * @param next Offset of the next capability, or 0
+     */
+    void EnableMSICapability(uint8_t offset, uint8_t next = 0);
+    
+    /**
+     * Get the configuration space offset of the MSI capability.
+     * @return Offset, or 0 if the device has none
+     */
+    uint8_t GetMSICapabilityOffset() const;
+    
+    /**
+     * Read from the MSI capability.
+     * @param reg Register offset
+     * @param size Size of the read (1, 2, or 4 bytes)
+     * @param value Receives the value read
+     * @return true if reg lies in the capability
+     */
+    bool ReadMSICapability(uint8_t reg, int size, uint32_t& value) const;
+    
+    /**
+     * Write to the MSI capability.
+     * @param reg Register offset
+     * @param value Value to write
+     * @param size Size of the write (1, 2, or 4 bytes)
+     * @return true if reg lies in the capability
+     */
+    bool WriteMSICapability(uint8_t reg, uint32_t value, int size);
+    
+    /**
+     * Set the state of the device interrupt.
+     * Drives INTx, or sends one message per rising edge when MSI is enabled.
+     * @param state true to assert, false to deassert
+     */
+    void SetInterruptLevel(bool state);
+    
     uint8_t m_bus;      // PCI bus number
     uint8_t m_device;   // PCI device number
     uint8_t m_function; // PCI function number
+
+private:
+    InterruptCallback m_interruptCallback;
+    MSICallback m_msiCallback;
+    bool m_interruptLevel;  // Current state of the device interrupt
+    
+    // MSI capability
+    uint8_t m_msiOffset;    // 0 if the device has no MSI capability
+    uint8_t m_msiNext;
+    uint16_t m_msiControl;
+    uint32_t m_msiAddress;
+    uint16_t m_msiData;
 };
 
 } // namespace x86emu
\ No newline at end of file
@@ -4,11 +4,26 @@
 #include <cstring>
 #include <functional>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <limits>
 #include <cmath>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "device.h"
 #include "pci.h"
 #include "rasterizer.h"
+#include "geforce3_spans.h"
+#include "geforce3_trace.h"
+
+class MemoryManager;
 
 // GeForce3 (NV20) GPU emulation
 class GeForce3 : public PCIDevice
@@ -29,12 +44,59 @@ public:
     void SetRamBase(void* base, uint32_t size);
     void OnVBlank(int state);
     uint32_t ScreenUpdate(uint32_t* bitmap, int width, int height);
+    // The callback runs from DeliverIRQ(), never with the GPU lock held. The
+    // puller thread calls it as soon as it raises an interrupt, so it must be
+    // thread-safe, e.g. InterruptRouter::setIRQ()
     void SetIRQCallback(std::function<void(int state)> callback) { m_irqCallback = callback; }
+    // Pass the last IRQ level the GPU posted to the callback; MMIO accesses,
+    // OnVBlank() and the puller thread do this too
+    void DeliverIRQ();
+    
+    // Report a write to the RAM given to SetRamBase() that bypassed WriteMemory().
+    // Lock-free, so it may be called from any thread with any lock held; the
+    // GPU picks the pages up on its next texture or depth buffer check
+    void NotifyMemoryWrite(uint32_t offset, uint32_t size);
+    // Promise that every write to the RAM not made by the GPU reaches
+    // NotifyMemoryWrite(). Without it each cached texture is checksummed on
+    // lookup; AttachMemoryManager() sets it
+    void SetCpuWritesReported(bool reported);
+    // Called for every RAM range the GPU writes, as offsets into the RAM given
+    // to SetRamBase(); runs with the GPU lock held and must not call the GPU
+    void SetRamWriteCallback(std::function<void(uint32_t offset, uint32_t size)> callback);
+    // Render into size bytes of a MemoryManager's RAM from address on; GPU
+    // writes reach MemoryManager::notifyWrite() so translated code is dropped,
+    // and writes through the MemoryManager reach NotifyMemoryWrite()
+    void AttachMemoryManager(MemoryManager* memory, uint32_t address, uint32_t size);
     
     // Debug helpers
     bool ToggleRegisterCombinerUsage();
     bool ToggleWaitVBlankSupport();
     bool ToggleClippingWSupport();
+    void SetClippingWSupport(bool enable);
+    
+    // Pixel pipeline cache statistics
+    struct PixelPipelineStats {
+        uint64_t lookups;   // One per draw
+        uint64_t hits;
+        size_t states;      // Distinct render states seen
+    };
+    PixelPipelineStats GetPixelPipelineStats();
+    
+    // Pushbuffer method statistics
+    struct MethodStats {
+        uint64_t methods;       // Method words executed
+        uint64_t bulkMethods;   // Of those, words consumed by bulk handlers
+    };
+    MethodStats GetMethodStats();
+    
+    // Command trace for tools/gf3_replay
+    //
+    // Records register and configuration writes, vblanks and the RAM the
+    // GPU reads from then on. A replay starts from a freshly reset GPU, so
+    // tracing is started before the guest first touches it. Pushbuffers
+    // run on the thread writing DMAPUT while a trace is recorded.
+    bool StartTrace(const std::string& path);
+    void StopTrace();
 
 private:
     // VGA CRTC registers
@@ -409,6 +471,36 @@ private:
         int enabled;  // bitmask
     };
     
+    // Texture decoded to linear A8R8G8B8, texel (x, y) at texels[y * width + x]
+    struct DecodedTexture {
+        std::vector<uint32_t> texels;
+        int width;
+        int height;
+        uint32_t firstPage;     // Guest memory pages the texture was decoded from
+        uint32_t lastPage;
+        uint32_t epoch;         // m_textureEpoch when decoded
+        uint64_t checkedWrites; // m_ramWrites when last found up to date
+        uint64_t checksum;      // Of the source bytes, kept unless CPU writes are reported
+    };
+    
+    // Everything the decode of a texture reads
+    struct TextureCacheKey {
+        uint32_t address;
+        TexFormat format;
+        int width;
+        int height;
+        int dilate;
+        int pitch;              // Rectangular textures only
+        
+        bool operator==(const TextureCacheKey& other) const {
+            return memcmp(this, &other, sizeof(*this)) == 0;
+        }
+    };
+    
+    struct TextureCacheKeyHash {
+        size_t operator()(const TextureCacheKey& key) const;
+    };
+    
     struct TextureState {
         int enabled;
         int sizeS;
@@ -436,6 +528,7 @@ private:
         int addrModeS;
         int addrModeT;
         int addrModeR;
+        const DecodedTexture* decoded;  // Bound at draw begin, nullptr if unused
     };
     
     struct BitBlitState {
@@ -535,54 +628,104 @@ private:
         int stages;
     };
     
-    struct CombinerVariables {
-        float A[4];
-        float B[4];
-        float C[4];
-        float D[4];
-        float E[4];
-        float F[4];
-        float G;
-        float EF[4];
-        float sumClamp[4];
-    };
-    
-    struct CombinerFunctions {
-        float RGBop1[4];
-        float RGBop2[4];
-        float RGBop3[4];
-        float Aop1;
-        float Aop2;
-        float Aop3;
-    };
-    
-    struct CombinerRegisters {
-        float primaryColor[4];
-        float secondaryColor[4];
-        float texture0Color[4];
-        float texture1Color[4];
-        float texture2Color[4];
-        float texture3Color[4];
-        float color0[4];
-        float color1[4];
-        float spare0[4];
-        float spare1[4];
-        float fogColor[4];
-        float zero[4];
-    };
-    
-    struct CombinerWork {
-        CombinerVariables variables;
-        CombinerFunctions functions;
-        CombinerRegisters registers;
-        float output[4];
-    };
-    
     struct Combiner {
-        CombinerWork work[16]; // Support for multiple threads
         CombinerSetup setup;
     };
     
+    // Compiled register combiner program
+    //
+    // The combiner setup is compiled into a flat list of ops that each run
+    // over a whole block of pixels. Registers and variables are stored one
+    // channel array per block, so every op is a plain loop the compiler
+    // vectorizes. Programs depend only on the structure of the setup;
+    // constant inputs (zero, fog and the per-stage constant colors) are
+    // read from the CombinerContext of the draw and mapped once per block.
+    enum class CombinerOpCode {
+        LOAD_RGB,           // variable.rgb = map(register.rgb or register.aaa)
+        LOAD_ALPHA,         // variable.a = map(register.b or register.a)
+        CONSTANT_RGB,       // variable.rgb = mapped constant
+        CONSTANT_ALPHA,     // variable.a = mapped constant
+        STAGE,              // General combiner outputs
+        FINAL_SUMS,         // EF and color sum
+        FINAL_OUTPUT        // A * B + (1 - A) * C + D, G
+    };
+    
+    // Variables A-D are shared by the general and final stages
+    enum CombinerVariable {
+        COMBINER_A,
+        COMBINER_B,
+        COMBINER_C,
+        COMBINER_D,
+        COMBINER_E,
+        COMBINER_F,
+        COMBINER_G,
+        COMBINER_VARIABLES
+    };
+    
+    static constexpr int COMBINER_REGISTERS = 16;
+    
+    // Constant slots of a CombinerContext
+    enum CombinerConstant {
+        COMBINER_CONSTANT_ZERO,
+        COMBINER_CONSTANT_FOG,
+        COMBINER_CONSTANT_STAGE,                            // COLOR0 and COLOR1 of each general stage
+        COMBINER_CONSTANT_FINAL = COMBINER_CONSTANT_STAGE + 16,
+        COMBINER_CONSTANTS = COMBINER_CONSTANT_FINAL + 2
+    };
+    
+    struct CombinerStageOutput {
+        bool dotAB;
+        bool dotCD;
+        bool mux;
+        float bias;
+        float scale;
+        int abOutput;       // Register index, -1 if not written
+        int cdOutput;
+        int sumOutput;
+    };
+    
+    struct CombinerOp {
+        CombinerOpCode code;
+        int variable;
+        int source;             // Register read by loads, constant slot of constant loads
+        int channel;            // Source channel, -1 for red/green/blue
+        CombinerMapFunction mapping;
+        CombinerStageOutput rgb;
+        CombinerStageOutput alpha;
+        bool sumClamp;
+    };
+    
+    struct CombinerProgramKey {
+        CombinerSetup setup;    // Unused stages and all constant colors are zeroed
+        
+        bool operator==(const CombinerProgramKey& other) const {
+            return memcmp(this, &other, sizeof(*this)) == 0;
+        }
+    };
+    
+    struct CombinerProgramKeyHash {
+        size_t operator()(const CombinerProgramKey& key) const;
+    };
+    
+    struct CombinerProgram {
+        std::vector<CombinerOp> ops;
+    };
+    
+    // Everything a draw hands to its combiner program. Queued triangles
+    // point at the context of their draw, so neither a new program nor new
+    // constants have to wait for them.
+    struct CombinerContext {
+        const CombinerProgram* program;
+        float constants[COMBINER_CONSTANTS][4];
+    };
+    
+    // Working storage of one block of pixels
+    struct CombinerBlock {
+        float registers[COMBINER_REGISTERS][4][GeForce3Spans::BLOCK_SIZE];
+        float variables[COMBINER_VARIABLES][4][GeForce3Spans::BLOCK_SIZE];
+        float output[4][GeForce3Spans::BLOCK_SIZE];
+    };
+    
     // Matrix state
     struct MatrixState {
         float modelview[4][4];
@@ -608,6 +751,48 @@ private:
         int a0x;
     };
     
+    // Vertex program predecoded for execution
+    //
+    // Operands and destinations are resolved once per program, so running
+    // an instruction only selects data. Vertices are processed in batches
+    // of VERTEX_PROGRAM_LANES with every register stored as one lane array
+    // per component.
+    static constexpr int VERTEX_PROGRAM_LANES = 8;
+    static constexpr int VERTEX_PROGRAM_TEMPS = 16;
+    
+    struct VertexProgramOperand {
+        int type;           // 0 = zero, 1 = temporary, 2 = vertex input, 3 = constant
+        int index;
+        int swizzle[4];
+        bool negate;
+        bool relative;      // Constant index is offset by a0.x
+    };
+    
+    struct VertexProgramOp {
+        VectorOp vecOperation;
+        ScalarOp scaOperation;
+        VertexProgramOperand operands[3];
+        // Destinations, a zero mask when not written
+        int vecTempIndex, vecTempMask;
+        int vecOutputIndex, vecOutputMask;
+        int vecConstantIndex, vecConstantMask;
+        int scaTempIndex, scaTempMask;
+        int scaOutputIndex, scaOutputMask;
+    };
+    
+    struct CompiledVertexProgram {
+        std::vector<VertexProgramOp> ops;
+        // False if a vertex can observe state left by the previous one, in
+        // which case vertices run one at a time
+        bool batched;
+    };
+    
+    struct VertexProgramBatch {
+        float temps[VERTEX_PROGRAM_TEMPS][4][VERTEX_PROGRAM_LANES];
+        float outputs[16][4][VERTEX_PROGRAM_LANES];
+        int a0x[VERTEX_PROGRAM_LANES];
+    };
+    
     // Channel state
     struct ChannelState {
         struct {
@@ -620,23 +805,52 @@ private:
         } channel[32];
     };
     
-    // Rasterizer extent for rendering scanlines
-    struct RasterizerExtent_t {
-        int32_t startx;
-        int32_t stopx;
-        struct {
-            double start;
-            double dpdx;
-        } param[26]; // One per vertex parameter
+    using RenderMethod = void (GeForce3::*)(int32_t, const RasterizerExtent_t&, void*, int);
+    
+    // Method dispatch tables, one per object class and indexed by method / 4
+    using MethodHandler = void (GeForce3::*)(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
+    using BulkMethodHandler = void (GeForce3::*)(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                                                 uint32_t address, const uint32_t* parameters, uint32_t count);
+    
+    struct MethodEntry {
+        MethodHandler handler;      // nullptr if the method has no effect
+        BulkMethodHandler bulk;     // Takes a whole run of parameters, or nullptr
+        uint16_t bulkLast;          // Last method index the bulk handler covers
+        bool runsAhead;             // May run while the rasterizer is busy
+    };
+    
+    static constexpr int METHOD_COUNT = 0x2000 / 4;
+    
+    struct MethodTable {
+        MethodEntry entries[METHOD_COUNT];
     };
     
     // Method handling
-    void ExecuteMethod(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
+    static bool IsVertexSubmissionMethod(uint32_t method);
+    static const MethodTable* GetMethodTable(uint32_t objClass);
+    static std::unique_ptr<MethodTable> BuildMethodTable(uint32_t objClass);
+    void ExecuteMethods(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t address,
+                        uint32_t count, bool increasing);
     void ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
     void ExecuteMethodM2MF(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
     void ExecuteMethodSurf2D(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
     void ExecuteMethodBlit(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
     
+    // Handlers of the methods that arrive in long runs
+    void MethodVertexProgramUpload(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
+    void MethodVertexConstantUpload(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
+    void MethodMatrix(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
+    void MethodDrawIndices(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
+    void MethodPersistentVertexAttribute(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter);
+    void BulkVertexProgramUpload(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                                 uint32_t address, const uint32_t* parameters, uint32_t count);
+    void BulkVertexConstantUpload(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                                  uint32_t address, const uint32_t* parameters, uint32_t count);
+    void BulkDrawIndices(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                         uint32_t address, const uint32_t* parameters, uint32_t count);
+    void BulkDrawRawVertices(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                             uint32_t address, const uint32_t* parameters, uint32_t count);
+    
     void HandleTextureMethod(uint32_t method, uint32_t parameter);
     void HandleDrawCommand(uint32_t parameter);
     void HandleDrawIndices(int multiply, uint32_t parameter);
@@ -652,14 +866,16 @@ private:
     
     // Vertex processing
     void DecodeVertexInstruction(int address);
-    void ExecuteVertexProgram();
-    bool ExecuteVertexInstruction();
-    void GenerateInput(float* output, bool negate, int type, int tempIndex, const int* swizzle);
-    void ComputeVectorOperation(float* output, VectorOp op, const float* a, const float* b, const float* c);
-    void ComputeScalarOperation(float* output, ScalarOp op, const float* a, const float* b, const float* c);
-    void AssignToRegister(int index, const float* value, int mask);
-    void AssignToOutput(int index, const float* value, int mask);
-    void AssignToConstant(int index, const float* value, int mask);
+    void CompileVertexProgram();
+    void ExecuteVertexProgram(const VertexNV* const* inputs, VertexNV* outputs, int count);
+    void RunVertexProgramBatch(const VertexNV* const* inputs, VertexNV* outputs, int count);
+    void GenerateInputs(VertexProgramBatch& batch, const VertexProgramOperand& operand,
+                        const VertexNV* const inputs[VERTEX_PROGRAM_LANES], float output[4][VERTEX_PROGRAM_LANES]);
+    static void ComputeVectorOperation(float output[4][VERTEX_PROGRAM_LANES], VectorOp op,
+                                       const float a[4][VERTEX_PROGRAM_LANES], const float b[4][VERTEX_PROGRAM_LANES],
+                                       const float c[4][VERTEX_PROGRAM_LANES]);
+    static void ComputeScalarOperation(float* output, ScalarOp op, const float* a, const float* b, const float* c);
+    static void AssignToLanes(float destination[4][VERTEX_PROGRAM_LANES], const float value[4][VERTEX_PROGRAM_LANES], int mask);
     
     // DMA and object management
     void ReadDMAObject(uint32_t handle, uint32_t& offset, uint32_t& size);
@@ -677,7 +893,7 @@ private:
     
     // Primitive assembly and rendering
     void AssemblePrimitive(int source, int count);
-    void ConvertVertices(VertexNV* source, NV2AVertex_t* destination);
+    void ConvertVertices(VertexNV* source, NV2AVertex_t* destination, bool transformed = false);
     uint32_t RenderTriangleClipping(const Rectangle& cliprect, NV2AVertex_t& v1, NV2AVertex_t& v2, NV2AVertex_t& v3);
     int ClipTriangleW(NV2AVertex_t vi[3], NV2AVertex_t* vo);
     uint32_t RenderTriangleCulling(const Rectangle& cliprect, NV2AVertex_t& v1, NV2AVertex_t& v2, NV2AVertex_t& v3);
@@ -687,10 +903,169 @@ private:
     void RenderTextureSimple(int32_t scanline, const RasterizerExtent_t& extent, void* objectData, int threadId);
     void RenderRegisterCombiners(int32_t scanline, const RasterizerExtent_t& extent, void* objectData, int threadId);
     
+    // Render-state specialized pixel pipelines
+    //
+    // A span writer is instantiated for every combination of depth buffer
+    // format, enabled tests and color path, so the per-pixel code only
+    // contains the enabled stages. The remaining state (comparison
+    // functions, stencil and blend operations) is decoded into the
+    // pipeline once per render state.
+    enum class PixelDepth {
+        NONE,
+        Z16,
+        Z24S8
+    };
+    
+    enum class PixelColorMode {
+        WRITE,      // Full color mask, no blending or logic op
+        BLEND,      // Full color mask, blending
+        GENERAL     // Partial color mask and/or logic op
+    };
+    
+    enum class PixelFormat {
+        RGB565,
+        XRGB32,
+        ARGB32,
+        B8,
+        COUNT
+    };
+    
+    // Color path 0 writes no color, path 1 has an unsupported color format
+    static constexpr int PIXEL_COLOR_PATHS = 2 + 3 * static_cast<int>(PixelFormat::COUNT);
+    static constexpr int SPAN_WRITER_COUNT = 3 * 2 * 2 * 2 * PIXEL_COLOR_PATHS;
+    
+    struct PixelPipeline;
+    using SpanWriter = void (GeForce3::*)(const PixelPipeline&, int, int, int, const uint32_t*, const int32_t*);
+    
+    struct PixelStateKey {
+        uint32_t writer;
+        uint32_t depthWrite;
+        uint32_t alphaFunc;
+        uint32_t stencilFunc;
+        uint32_t stencilOpFail;
+        uint32_t depthFunc;
+        uint32_t stencilOpZFail;
+        uint32_t stencilOpZPass;
+        uint32_t blendEquation;
+        uint32_t blendSource;
+        uint32_t blendDest;
+        uint32_t logicalOp;     // 0 when disabled
+        
+        bool operator==(const PixelStateKey& other) const {
+            return memcmp(this, &other, sizeof(*this)) == 0;
+        }
+    };
+    
+    struct PixelStateKeyHash {
+        size_t operator()(const PixelStateKey& key) const;
+    };
+    
+    struct PixelPipeline {
+        SpanWriter writer;
+        bool depthWrite;
+        ComparisonOp alphaFunc;
+        ComparisonOp stencilFunc;
+        ComparisonOp depthFunc;
+        StencilOp stencilOpFail;
+        StencilOp stencilOpZFail;
+        StencilOp stencilOpZPass;
+        bool blendingEnabled;
+        BlendEquation blendEquation;
+        BlendFactor blendSource;
+        BlendFactor blendDest;
+        bool logicalOpEnabled;
+        LogicalOp logicalOp;
+        bool earlyDepth;            // The depth test may run before shading
+        bool silentDepthReject;     // Pixels failing the depth test change nothing
+    };
+    
+    void SelectPixelPipeline();
+    PixelStateKey ComputePixelStateKey() const;
+    void WriteSpan(int x, int y, int count, const uint32_t* color, const int32_t* z);
+    template<int Index>
+    void WriteSpanIndexed(const PixelPipeline& pipeline, int x, int y, int count, const uint32_t* color, const int32_t* z);
+    template<size_t... Index>
+    static std::array<SpanWriter, sizeof...(Index)> MakeSpanWriters(std::index_sequence<Index...>);
+    template<PixelFormat Format>
+    uint8_t* ReadPixelAs(int x, int y, int32_t color[4]);
+    
+    template<typename T>
+    static bool ComparePixelValue(ComparisonOp op, T value, T reference);
+    static uint32_t ApplyStencilOp(StencilOp op, uint32_t stencil, uint32_t reference);
+    static void BlendFactorValues(BlendFactor factor, const int32_t source[4], const int32_t frameBuffer[4],
+                                  const int32_t blendColor[4], int32_t result[4]);
+    void BlendPixel(const PixelPipeline& pipeline, int32_t source[4], const int32_t frameBuffer[4]);
+    static void LogicalOpPixel(LogicalOp op, int32_t source[4], const int32_t frameBuffer[4]);
+    
+    // Clears
+    //
+    // A clear fills a rectangle of the color or depth buffer, replacing
+    // the pixel bits in mask. With lazy clears it is only recorded, and
+    // each rasterizer tile of rows it covers is filled the first time a
+    // render thread touches it. Everything else that reads or writes GPU
+    // memory fills all remaining tiles first.
+    struct SurfaceClear {
+        uint8_t* buffer;
+        uint32_t pitch;
+        int bytesPerPixel;
+        int left, right, top, bottom;   // Inclusive, clipped to the surface
+        uint32_t value;                 // In the pixel format of the surface
+        uint32_t mask;
+    };
+    
+    struct PendingClear {
+        SurfaceClear clear;
+        bool active;
+        std::vector<uint8_t> tiles;     // Nonzero while a rasterizer tile is not filled yet
+    };
+    
+    void clear_render_target(int what, uint32_t value);
+    void clear_depth_buffer(int what, uint32_t value);
+    bool ClipClear(SurfaceClear& clear, uint32_t surfaceSize);
+    void ClearSurface(PendingClear& pending, const SurfaceClear& clear);
+    static void FillSurface(const SurfaceClear& clear, int top, int bottom);
+    void ResolveClearTile(int y);
+    void ResolveClears();
+    
+    // Hierarchical Z and early depth rejection
+    static constexpr int HIZ_TILE_SHIFT = 3;
+    static constexpr int HIZ_TILE_SIZE = 1 << HIZ_TILE_SHIFT;
+    static_assert(Rasterizer::TILE_HEIGHT % HIZ_TILE_SIZE == 0, "Hierarchical Z tiles must not straddle rasterizer tiles");
+    
+    struct HiZTile {
+        uint32_t minDepth;
+        uint32_t maxDepth;
+    };
+    
+    bool EarlyDepthTest(int x, int y, int count, const int32_t* z, uint8_t* pass);
+    static bool HierarchicalZRejects(ComparisonOp op, uint32_t zMin, uint32_t zMax, const HiZTile& tile);
+    bool HierarchicalZMatches() const;
+    void SyncHierarchicalZ();
+    void RebuildHierarchicalZ();
+    bool HierarchicalZWritten();
+    void ClearHierarchicalZ(uint32_t depth);
+    void WidenHierarchicalZ(int x, int y, uint32_t depth);
+    
     // Pixel processing
     void WritePixel(int x, int y, uint32_t color, int z);
     uint8_t* ReadPixel(int x, int y, int32_t color[4]);
+    uint8_t* PixelAddress(int x, int y);
     uint32_t GetTexel(int texUnit, int x, int y);
+    uint32_t DecodeTexel(const TextureState& texture, int x, int y);
+    
+    // Decoded texture cache
+    void BindTextures();
+    const DecodedTexture* LookupTexture(const TextureState& texture);
+    void DecodeTexture(const TextureState& texture, DecodedTexture& decoded);
+    static uint32_t TextureBytes(const TextureCacheKey& key);
+    void MarkMemoryDirty(uint32_t offset, uint32_t size);
+    void MemoryWritten(uint32_t offset, uint32_t size);
+    void CollectCpuWrites();
+    bool CpuWritesReported() const;
+    uint64_t TextureChecksum(const TextureCacheKey& key) const;
+    void ClearTextureCache();
+    void DetachMemoryManager();
+    void MarkRenderTargetDirty();
     uint32_t BilinearFilter(uint32_t c00, uint32_t c10, uint32_t c01, uint32_t c11, int xFrac, int yFrac);
     
     // Color conversion helpers
@@ -701,27 +1076,17 @@ private:
     uint32_t ConvertFloatToARGB8(float reg[4]);
     
     // Combiner methods
-    float CombinerMapInputFunction(CombinerMapFunction code, float value);
-    void CombinerMapInputFunctionArray(CombinerMapFunction code, float* data);
-    void InitializeCombinerRegisters(int threadId, float rgba[7][4]);
-    void InitializeCombinerStage(int threadId, int stageNumber);
-    void InitializeFinalCombiner(int threadId);
-    float CombinerMapInputSelect(int threadId, CombinerInputRegister code, int index);
-    float* CombinerMapInputSelectArray(int threadId, CombinerInputRegister code);
-    float* CombinerMapOutputSelectArray(int threadId, CombinerInputRegister code);
-    void MapCombinerStageInput(int threadId, int stageNumber);
-    void MapCombinerStageOutput(int threadId, int stageNumber);
-    void MapFinalCombinerInput(int threadId);
-    void FinalCombinerOutput(int threadId);
-    
-    void CombinerFunction_AB(int threadId, float result[4]);
-    void CombinerFunction_AdotB(int threadId, float result[4]);
-    void CombinerFunction_CD(int threadId, float result[4]);
-    void CombinerFunction_CdotD(int threadId, float result[4]);
-    void CombinerFunction_ABmuxCD(int threadId, float result[4]);
-    void CombinerFunction_ABsumCD(int threadId, float result[4]);
-    void ComputeRGBOutputs(int threadId, int stageNumber);
-    void ComputeAlphaOutputs(int threadId, int stageNumber);
+    static float CombinerMapInputFunction(CombinerMapFunction code, float value);
+    static void CombinerMapInputSpan(CombinerMapFunction code, float* data, int count);
+    void SelectCombinerProgram();
+    void CompileCombinerProgram(const CombinerProgramKey& key, CombinerProgram& program);
+    static void CompileCombinerInput(CombinerProgram& program, const int constants[COMBINER_REGISTERS],
+                                     int variable, bool alpha, CombinerInputRegister input, int component,
+                                     CombinerMapFunction mapping);
+    static CombinerStageOutput CompileCombinerStageOutput(const CombinerMapOut& mapout);
+    void UpdateCombinerContext(const CombinerProgram* program);
+    static void RunCombinerProgram(const CombinerContext& context, CombinerBlock& block, int count);
+    static void RunCombinerStage(const CombinerOp& op, CombinerBlock& block, int count);
     
     // Texture address transformation functions
     uint32_t Dilate0(uint32_t value, int bits);
@@ -735,6 +1100,16 @@ private:
     // Miscellaneous helper methods
     void PerformBlit();
     void ProcessGPUCommands();
+    bool CommandsPending();
+    void WakePuller();
+    void PullerLoop();
+    void StopPuller();
+    void YieldToHost();
+    std::unique_lock<std::mutex> LockGPU();
+    uint32_t ReadConfigRegister(uint8_t reg, int size);
+    void PostIRQ(bool state);
+    void PublishChannel(int channel);
+    void PublishConfig();
     uint8_t* DirectAccessPtr(uint32_t address);
     void UpdateRenderTargetSize();
     void ComputeSuperSampleFactors();
@@ -759,6 +1134,10 @@ private:
     
     ChannelState m_channelState;
     std::function<void(int state)> m_irqCallback;
+    std::function<void(uint32_t offset, uint32_t size)> m_ramWriteCallback;
+    MemoryManager* m_memory;            // From AttachMemoryManager(), not owned
+    uint32_t m_memoryAddress;           // Where the RAM starts in it
+    uint32_t m_memoryCallbackId;        // Its write callback, 0 if none
     
     // Render state
     Rectangle m_renderTargetLimits;
@@ -813,11 +1192,17 @@ private:
     VertexNV* m_vertexOutput;
     VertexNV m_vertexTemp;
     
-    std::function<void(int32_t, const RasterizerExtent_t&, void*, int)> m_renderCallback;
+    Rasterizer::RenderCallback m_renderCallback;
+    RenderMethod m_renderMethod;
     MatrixState m_matrices;
     VertexProgramState m_vertexProgram;
     int m_vertexPipeline;
     
+    // Predecoded vertex program, rebuilt after instruction uploads
+    CompiledVertexProgram m_vertexProgramCode;
+    bool m_vertexProgramDirty;
+    VertexNV m_vertexBatchOutput[256];
+    
     // Blending and rasterization state
     uint32_t m_colorMask;
     bool m_backfaceCullingEnabled;
@@ -858,8 +1243,60 @@ private:
     Combiner m_combiner;
     bool m_combinerEnabled;
     
+    // Compiled combiner programs by setup structure, flushed when full
+    static constexpr size_t MAX_COMBINER_PROGRAMS = 256;
+    std::unordered_map<CombinerProgramKey, CombinerProgram, CombinerProgramKeyHash> m_combinerPrograms;
+    
+    // Contexts of the draws since the rasterizer last drained; the last
+    // one is current. Bounded by MAX_COMBINER_CONTEXTS.
+    static constexpr size_t MAX_COMBINER_CONTEXTS = 256;
+    std::deque<CombinerContext> m_combinerContexts;
+    CombinerContext* m_combinerContext;
+    
     // Command processing
     int m_pullerWaiting;
+    uint64_t m_methodsExecuted;
+    uint64_t m_bulkMethodsExecuted;
+    
+    // Pushbuffer puller thread, if commands run asynchronously. The thread
+    // holds m_gpuMutex while it executes a packet; every public entry point
+    // takes it through LockGPU() before touching GPU state.
+    bool m_asyncPuller;
+    bool m_pullerStopping;
+    std::thread m_pullerThread;
+    std::mutex m_gpuMutex;
+    std::condition_variable m_pullerWake;
+    std::atomic<int> m_gpuLockWaiters;     // Threads blocked in LockGPU()
+    std::atomic<int> m_postedIRQ;          // IRQ level for DeliverIRQ(), -1 if unchanged
+    std::mutex m_irqMutex;                 // Keeps levels in order across threads
+    
+    // Registers the guest polls while a packet runs, readable without
+    // m_gpuMutex. They are stored under it whenever their source changes.
+    std::atomic<uint32_t> m_publishedMMIOBase;      // 0 while memory space is disabled
+    std::atomic<uint32_t> m_publishedDMAGet[32];
+    std::atomic<uint32_t> m_publishedReference[32];
+    
+    // Delivers posted IRQs once the GPU lock, taken after it, is released
+    struct IRQScope {
+        GeForce3& gpu;
+        ~IRQScope() { gpu.DeliverIRQ(); }
+    };
+    
+    // Command trace being recorded, or nullptr
+    //
+    // Entry points record themselves and place a TraceScope after taking
+    // the GPU lock; when it goes out of scope, memory the GPU wrote
+    // meanwhile is known to the trace and needs no recording.
+    struct TraceScope {
+        GeForce3& gpu;
+        ~TraceScope() { if (gpu.m_trace) gpu.SyncTraceWrites(); }
+    };
+    
+    std::unique_ptr<GeForce3TraceWriter> m_trace;
+    void TraceConsume(uint32_t offset, uint32_t size);
+    void TraceWritten(uint32_t offset, uint32_t size);
+    void TraceVertexFetch(uint32_t index, int count);
+    void SyncTraceWrites();
     
     // Debug flags
     bool m_enableWaitVblank;
@@ -868,6 +1305,54 @@ private:
     // Rasterizer pointer
     Rasterizer* m_rasterizer;
     
+    // Pixel pipelines by render state; entries are never removed
+    std::unordered_map<PixelStateKey, PixelPipeline, PixelStateKeyHash> m_pixelPipelines;
+    const PixelPipeline* m_pixelPipeline;
+    uint64_t m_pixelPipelineLookups;
+    uint64_t m_pixelPipelineHits;
+    
+    // Decoded textures; dropped all at once when they grow past the limit
+    static constexpr uint32_t RAM_PAGE_SHIFT = 12;
+    static constexpr size_t TEXTURE_CACHE_LIMIT = 64 * 1024 * 1024;
+    std::unordered_map<TextureCacheKey, DecodedTexture, TextureCacheKeyHash> m_textureCache;
+    size_t m_textureCacheBytes;
+    
+    // Guest memory write tracking: each page holds the epoch of its last
+    // write and a texture is stale once a page it spans reaches its epoch
+    std::vector<uint32_t> m_ramPageEpoch;
+    uint32_t m_textureEpoch;    // Bumped for every decoded texture and hierarchical Z sync
+    uint64_t m_ramWrites;       // Bumped for every tracked write
+    
+    // Pages written behind the GPU's back, set by NotifyMemoryWrite() from
+    // any thread and folded into m_ramPageEpoch under the GPU lock
+    std::unique_ptr<std::atomic<uint8_t>[]> m_cpuDirtyPages;
+    std::atomic<bool> m_cpuWritesPending;
+    bool m_cpuWritesReported;
+    
+    // Hierarchical Z: conservative depth bounds of square tiles of the depth
+    // buffer, in the 24-bit domain the depth test compares in. Depth writes
+    // only widen the bounds of their tile; clears and rebuilds make them
+    // exact again. A tile never straddles two rasterizer tiles, so only one
+    // render thread at a time touches it. Everything else is changed with
+    // the rasterizer idle.
+    struct HierarchicalZ {
+        std::vector<HiZTile> tiles;
+        int tilesX;
+        int tilesY;
+        const uint32_t* buffer;     // Depth buffer the tiles describe
+        uint32_t pitch;
+        uint32_t size;
+        DepthFormat format;
+        bool valid;
+        uint32_t epoch;             // Writes from this epoch on are not in the tiles
+        uint64_t checkedWrites;     // m_ramWrites when last found up to date
+    };
+    HierarchicalZ m_hiZ;
+    
+    // Clears waiting to be filled, color buffer first
+    bool m_lazyClears;
+    PendingClear m_pendingClears[2];
+    
     // Dilate tables
     uint32_t m_dilated0[16][2048];
     uint32_t m_dilated1[16][2048];
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// DXT1/DXT3/DXT5 block decompression to A8R8G8B8
+//
+// Blocks are expanded whole, 4x4 texels at a time, so the per-block
+// palette work is done once instead of once per texel. Palettes are
+// built in scalar code and the per-texel selection runs in vector lanes.
+// The instruction set is chosen at build time: AVX2 (8 texels per step),
+// SSE2 (4 texels per step) or plain scalar code. Every path produces the
+// same texels as DecodeBlockReference().
+//
+// DXT1 blocks with color0 <= color1 decode index 3 to opaque black, which
+// is what the GeForce3 texel fetch has always returned for it.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GEFORCE3_DXT_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define GEFORCE3_DXT_LANES 4
+#else
+#define GEFORCE3_DXT_LANES 1
+#endif
+
+namespace GeForce3Dxt {
+
+enum class Format {
+    DXT1,
+    DXT3,
+    DXT5
+};
+
+// Bytes per 4x4 block
+constexpr int BlockBytes(Format format)
+{
+    return format == Format::DXT1 ? 8 : 16;
+}
+
+inline uint32_t Load16(const uint8_t* p)
+{
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t Load32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t Load64(const uint8_t* p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Opaque color from 5/6/5-bit channels
+inline uint32_t PackColor(uint32_t r, uint32_t g, uint32_t b)
+{
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+// The four colors of a color block
+//
+// threeColor enables the DXT1 mode selected by color0 <= color1; DXT3 and
+// DXT5 always use four colors.
+inline void ColorPalette(uint32_t color0, uint32_t color1, bool threeColor, uint32_t palette[4])
+{
+    uint32_t r0 = color0 >> 11, g0 = (color0 >> 5) & 63, b0 = color0 & 31;
+    uint32_t r1 = color1 >> 11, g1 = (color1 >> 5) & 63, b1 = color1 & 31;
+
+    palette[0] = PackColor(r0, g0, b0);
+    palette[1] = PackColor(r1, g1, b1);
+    if (!threeColor || color0 > color1) {
+        palette[2] = PackColor((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3);
+        palette[3] = PackColor((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3);
+    } else {
+        palette[2] = PackColor((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2);
+        palette[3] = 0xFF000000;
+    }
+}
+
+// The eight alphas of a DXT5 alpha block
+inline void AlphaPalette(uint32_t alpha0, uint32_t alpha1, uint32_t palette[8])
+{
+    palette[0] = alpha0;
+    palette[1] = alpha1;
+    if (alpha0 > alpha1) {
+        for (uint32_t k = 2; k < 8; k++)
+            palette[k] = ((8 - k) * alpha0 + (k - 1) * alpha1) / 7;
+    } else {
+        for (uint32_t k = 2; k < 6; k++)
+            palette[k] = ((6 - k) * alpha0 + (k - 1) * alpha1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// Decode one block texel by texel; rows of dest are pitch texels apart
+inline void DecodeBlockReference(Format format, const uint8_t* block, uint32_t* dest, size_t pitch)
+{
+    const uint8_t* colorBlock = format == Format::DXT1 ? block : block + 8;
+    uint32_t colors[4];
+    ColorPalette(Load16(colorBlock), Load16(colorBlock + 2), format == Format::DXT1, colors);
+    uint32_t codes = Load32(colorBlock + 4);
+
+    uint32_t alphas[8];
+    uint64_t alphaCodes = Load64(block);
+    if (format == Format::DXT5) {
+        AlphaPalette(block[0], block[1], alphas);
+        alphaCodes >>= 16;
+    }
+
+    for (int i = 0; i < 16; i++) {
+        uint32_t color = colors[(codes >> (i * 2)) & 3];
+        if (format == Format::DXT3) {
+            uint32_t alpha = (alphaCodes >> (i * 4)) & 15;
+            color = (color & 0x00FFFFFF) | ((alpha * 17) << 24);
+        } else if (format == Format::DXT5) {
+            color = (color & 0x00FFFFFF) | (alphas[(alphaCodes >> (i * 3)) & 7] << 24);
+        }
+        dest[(i >> 2) * pitch + (i & 3)] = color;
+    }
+}
+
+#if GEFORCE3_DXT_LANES > 1
+
+// ColorPalette() in 16-bit lanes, returning the four colors as 32-bit lanes
+//
+// Divisions by 3 are (x * 0xAAAB) >> 17, which is exact for 16-bit x.
+inline __m128i ColorPaletteVector(uint32_t color0, uint32_t color1, bool threeColor)
+{
+    // Blue, green, red, 0 of color0, then of color1
+    short c0 = static_cast<short>(color0), c1 = static_cast<short>(color1);
+    __m128i colors = _mm_setr_epi16(c0, c0, c0, 0, c1, c1, c1, 0);
+    __m128i channels = _mm_or_si128(_mm_mulhi_epu16(colors, _mm_setr_epi16(0, 1 << 11, 1 << 5, 0, 0, 1 << 11, 1 << 5, 0)),
+                                    _mm_and_si128(colors, _mm_setr_epi16(31, 0, 0, 0, 31, 0, 0, 0)));
+    channels = _mm_and_si128(channels, _mm_setr_epi16(31, 63, 31, 0, 31, 63, 31, 0));
+    __m128i swapped = _mm_shuffle_epi32(channels, _MM_SHUFFLE(1, 0, 3, 2));
+
+    __m128i interpolated;
+    if (!threeColor || color0 > color1) {
+        __m128i sum = _mm_add_epi16(_mm_add_epi16(channels, channels), swapped);
+        interpolated = _mm_srli_epi16(_mm_mulhi_epu16(sum, _mm_set1_epi16(static_cast<short>(0xAAAB))), 1);
+    } else {
+        // Color 3 is left black
+        interpolated = _mm_srli_epi16(_mm_add_epi16(channels, swapped), 1);
+        interpolated = _mm_and_si128(interpolated, _mm_setr_epi32(-1, -1, 0, 0));
+    }
+
+    // Expand 5 and 6 bits to 8 by replicating the top bits
+    const __m128i scale = _mm_setr_epi16(8, 4, 8, 0, 8, 4, 8, 0);
+    const __m128i replicate = _mm_setr_epi16(1 << 14, 1 << 12, 1 << 14, 0, 1 << 14, 1 << 12, 1 << 14, 0);
+    channels = _mm_or_si128(_mm_mullo_epi16(channels, scale), _mm_mulhi_epu16(channels, replicate));
+    interpolated = _mm_or_si128(_mm_mullo_epi16(interpolated, scale), _mm_mulhi_epu16(interpolated, replicate));
+
+    return _mm_or_si128(_mm_packus_epi16(channels, interpolated), _mm_set1_epi32(static_cast<int>(0xFF000000)));
+}
+
+// DXT3 alpha rows, each texel's 4-bit alpha expanded to bits 24..31
+inline void ExplicitAlphaRows(const uint8_t* block, __m128i rows[4])
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowNibbles = _mm_set1_epi8(0x0F);
+    __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block));
+
+    // One byte per texel in texel order, then a * 17 (every byte is below 16)
+    __m128i alpha = _mm_unpacklo_epi8(_mm_and_si128(bytes, lowNibbles),
+                                      _mm_and_si128(_mm_srli_epi16(bytes, 4), lowNibbles));
+    alpha = _mm_or_si128(alpha, _mm_slli_epi16(alpha, 4));
+
+    __m128i low = _mm_unpacklo_epi8(zero, alpha);
+    __m128i high = _mm_unpackhi_epi8(zero, alpha);
+    rows[0] = _mm_unpacklo_epi16(zero, low);
+    rows[1] = _mm_unpackhi_epi16(zero, low);
+    rows[2] = _mm_unpacklo_epi16(zero, high);
+    rows[3] = _mm_unpackhi_epi16(zero, high);
+}
+
+// Replace the alpha of color rows with alpha rows
+inline void MergeAlphaRows(__m128i colors[4], const __m128i alphas[4])
+{
+    const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+    for (int r = 0; r < 4; r++)
+        colors[r] = _mm_or_si128(_mm_and_si128(colors[r], rgb), alphas[r]);
+}
+
+#endif
+
+#if GEFORCE3_DXT_LANES == 8
+
+// Color rows, two rows per palette permute
+inline void ColorRows(__m128i palette, uint32_t codes, __m128i rows[4])
+{
+    const __m256i shiftsLow = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i shiftsHigh = _mm256_setr_epi32(16, 18, 20, 22, 24, 26, 28, 30);
+    const __m256i mask = _mm256_set1_epi32(3);
+    __m256i colors = _mm256_broadcastsi128_si256(palette);
+    __m256i all = _mm256_set1_epi32(static_cast<int>(codes));
+
+    __m256i low = _mm256_permutevar8x32_epi32(colors, _mm256_and_si256(_mm256_srlv_epi32(all, shiftsLow), mask));
+    __m256i high = _mm256_permutevar8x32_epi32(colors, _mm256_and_si256(_mm256_srlv_epi32(all, shiftsHigh), mask));
+    rows[0] = _mm256_castsi256_si128(low);
+    rows[1] = _mm256_extracti128_si256(low, 1);
+    rows[2] = _mm256_castsi256_si128(high);
+    rows[3] = _mm256_extracti128_si256(high, 1);
+}
+
+// DXT5 alpha rows from the 48 bits of 3-bit codes
+inline void InterpolatedAlphaRows(const uint32_t palette[8], uint64_t codes, __m128i rows[4])
+{
+    const __m256i shifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i mask = _mm256_set1_epi32(7);
+    __m256i alphas = _mm256_slli_epi32(_mm256_setr_epi32(palette[0], palette[1], palette[2], palette[3],
+                                                         palette[4], palette[5], palette[6], palette[7]), 24);
+
+    __m256i lowCodes = _mm256_set1_epi32(static_cast<int>(codes & 0xFFFFFF));
+    __m256i highCodes = _mm256_set1_epi32(static_cast<int>((codes >> 24) & 0xFFFFFF));
+    __m256i low = _mm256_permutevar8x32_epi32(alphas, _mm256_and_si256(_mm256_srlv_epi32(lowCodes, shifts), mask));
+    __m256i high = _mm256_permutevar8x32_epi32(alphas, _mm256_and_si256(_mm256_srlv_epi32(highCodes, shifts), mask));
+    rows[0] = _mm256_castsi256_si128(low);
+    rows[1] = _mm256_extracti128_si256(low, 1);
+    rows[2] = _mm256_castsi256_si128(high);
+    rows[3] = _mm256_extracti128_si256(high, 1);
+}
+
+#elif GEFORCE3_DXT_LANES == 4
+
+// Color rows, selecting each palette entry by comparing masked codes
+inline void ColorRows(__m128i palette, uint32_t codes, __m128i rows[4])
+{
+    const __m128i laneMask = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+    const __m128i colors[4] = {
+        _mm_shuffle_epi32(palette, _MM_SHUFFLE(0, 0, 0, 0)),
+        _mm_shuffle_epi32(palette, _MM_SHUFFLE(1, 1, 1, 1)),
+        _mm_shuffle_epi32(palette, _MM_SHUFFLE(2, 2, 2, 2)),
+        _mm_shuffle_epi32(palette, _MM_SHUFFLE(3, 3, 3, 3))
+    };
+    __m128i keys[4];
+    for (int k = 0; k < 4; k++)
+        keys[k] = _mm_setr_epi32(k, k << 2, k << 4, k << 6);
+
+    for (int r = 0; r < 4; r++) {
+        __m128i rowCodes = _mm_and_si128(_mm_set1_epi32(static_cast<int>((codes >> (r * 8)) & 0xFF)), laneMask);
+        __m128i row = _mm_setzero_si128();
+        for (int k = 0; k < 4; k++)
+            row = _mm_or_si128(row, _mm_and_si128(_mm_cmpeq_epi32(rowCodes, keys[k]), colors[k]));
+        rows[r] = row;
+    }
+}
+
+// DXT5 alpha rows from the 48 bits of 3-bit codes
+//
+// Selecting from eight entries by comparison costs more than a table
+// lookup without a variable shuffle, so the lookup stays scalar.
+inline void InterpolatedAlphaRows(const uint32_t palette[8], uint64_t codes, __m128i rows[4])
+{
+    uint32_t alphas[8];
+    for (int k = 0; k < 8; k++)
+        alphas[k] = palette[k] << 24;
+
+    alignas(16) uint32_t texels[16];
+    for (int i = 0; i < 16; i++)
+        texels[i] = alphas[(codes >> (i * 3)) & 7];
+    for (int r = 0; r < 4; r++)
+        rows[r] = _mm_load_si128(reinterpret_cast<const __m128i*>(texels + r * 4));
+}
+
+#endif
+
+// Decode one block; rows of dest are pitch texels apart
+inline void DecodeBlock(Format format, const uint8_t* block, uint32_t* dest, size_t pitch)
+{
+#if GEFORCE3_DXT_LANES > 1
+    const uint8_t* colorBlock = format == Format::DXT1 ? block : block + 8;
+    __m128i palette = ColorPaletteVector(Load16(colorBlock), Load16(colorBlock + 2), format == Format::DXT1);
+
+    __m128i rows[4];
+    ColorRows(palette, Load32(colorBlock + 4), rows);
+
+    if (format == Format::DXT3) {
+        __m128i alphas[4];
+        ExplicitAlphaRows(block, alphas);
+        MergeAlphaRows(rows, alphas);
+    } else if (format == Format::DXT5) {
+        uint32_t alphaPalette[8];
+        AlphaPalette(block[0], block[1], alphaPalette);
+        __m128i alphas[4];
+        InterpolatedAlphaRows(alphaPalette, Load64(block) >> 16, alphas);
+        MergeAlphaRows(rows, alphas);
+    }
+
+    for (int r = 0; r < 4; r++)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + r * pitch), rows[r]);
+#else
+    DecodeBlockReference(format, block, dest, pitch);
+#endif
+}
+
+// Decode a width x height image to linear texels, texel (x, y) at
+// dest[y * width + x]
+//
+// Blocks are stored row by row, width / 4 blocks per row. Edge blocks of
+// images smaller than a block are decoded whole and cropped.
+template<void (*BlockDecoder)(Format, const uint8_t*, uint32_t*, size_t)>
+void DecodeImageWith(Format format, const uint8_t* source, int width, int height, uint32_t* dest)
+{
+    const size_t blockBytes = BlockBytes(format);
+    const size_t blocksPerRow = static_cast<size_t>(width) >> 2;
+    uint32_t texels[16];
+
+    for (int y = 0; y < height; y += 4) {
+        for (int x = 0; x < width; x += 4) {
+            const uint8_t* block = source + ((x >> 2) + (y >> 2) * blocksPerRow) * blockBytes;
+            uint32_t* target = dest + static_cast<size_t>(y) * width + x;
+            if (x + 4 <= width && y + 4 <= height) {
+                BlockDecoder(format, block, target, width);
+                continue;
+            }
+
+            BlockDecoder(format, block, texels, 4);
+            for (int r = 0; r < 4 && y + r < height; r++) {
+                for (int c = 0; c < 4 && x + c < width; c++)
+                    target[static_cast<size_t>(r) * width + c] = texels[r * 4 + c];
+            }
+        }
+    }
+}
+
+inline void DecodeImage(Format format, const uint8_t* source, int width, int height, uint32_t* dest)
+{
+    DecodeImageWith<DecodeBlock>(format, source, width, height, dest);
+}
+
+inline void DecodeImageReference(Format format, const uint8_t* source, int width, int height, uint32_t* dest)
+{
+    DecodeImageWith<DecodeBlockReference>(format, source, width, height, dest);
+}
+
+// Bytes DecodeImage() reads for a width x height image
+inline size_t ImageBytes(Format format, int width, int height)
+{
+    size_t blocksPerRow = static_cast<size_t>(width) >> 2;
+    if (blocksPerRow == 0)
+        return BlockBytes(format);
+    return blocksPerRow * ((static_cast<size_t>(height) + 3) >> 2) * BlockBytes(format);
+}
+
+} // namespace GeForce3Dxt
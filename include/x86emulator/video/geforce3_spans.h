@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Span kernels for the GeForce3 fixed-function render callbacks
+//
+// Each kernel computes the per-pixel values of a block of pixels several
+// lanes at a time and leaves texel fetches and WritePixel() to the caller.
+// The vector paths perform the same double precision operations in the
+// same order as the scalar code, so results are bit-exact with it on every
+// host. The kernel set is picked once at run time: AVX (4 pixels per step)
+// if the host has it, SSE2 (2 pixels per step) on other x86 hosts, or
+// plain scalar code.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#define GEFORCE3_SPAN_SSE2 1
+#else
+#define GEFORCE3_SPAN_SSE2 0
+#endif
+
+namespace GeForce3Spans {
+
+// Pixels per block handed to a kernel
+constexpr int BLOCK_SIZE = 64;
+
+// Interpolants of a Gouraud shaded span, colors in B, G, R, A order
+struct ColorSpan {
+    double zStart, zStep;
+    double wStart, wStep;
+    double colorStart[4];
+    double colorStep[4];
+};
+
+// Interpolants of a perspective-correct textured span
+//
+// The accumulators advance by repeated addition, pixel by pixel, and are
+// left pointing at the first pixel after the block.
+struct TextureSpan {
+    double z, zStep;
+    double w, wStep;
+    double s, sStep;
+    double t, tStep;
+    double scaleS, scaleT;
+};
+
+inline int32_t ClampColor(int32_t value)
+{
+    return std::clamp<int32_t>(value, 0, 255);
+}
+
+namespace Scalar {
+
+// Compute color and depth of pixels first..first+count-1 (count <= BLOCK_SIZE)
+//
+// Matches z = int(zStart + x * zStep), w = 1 / (wStart + x * wStep) and
+// c = clamp(int((cStart + x * cStep) * w * 255)) for each pixel x.
+inline void ComputeColorSpan(const ColorSpan& span, int first, int count, uint32_t* argb, int32_t* z)
+{
+    for (int i = 0; i < count; i++) {
+        double x = first + i;
+        z[i] = static_cast<int32_t>(span.zStart + x * span.zStep);
+
+        double w = 1.0 / (span.wStart + x * span.wStep);
+        int32_t channel[4];
+        for (int c = 0; c < 4; c++) {
+            channel[c] = ClampColor(static_cast<int32_t>((span.colorStart[c] + x * span.colorStep[c]) * w * 255.0));
+        }
+        argb[i] = (channel[3] << 24) | (channel[2] << 16) | (channel[1] << 8) | channel[0];
+    }
+}
+
+// Compute depth and 24.8 fixed-point texel coordinates of the next count
+// pixels (count <= BLOCK_SIZE) and advance the accumulators past them
+//
+// Matches z = int(z), w = 1 / w, s = int(s * w * scaleS) and
+// t = int(t * w * scaleT) for each pixel, followed by one step of each
+// accumulator.
+inline void ComputeTextureSpan(TextureSpan& span, int count, int32_t* z, int32_t* s, int32_t* t)
+{
+    for (int i = 0; i < count; i++) {
+        double w = 1.0 / span.w;
+        z[i] = static_cast<int32_t>(span.z);
+        s[i] = static_cast<int32_t>(span.s * w * span.scaleS);
+        t[i] = static_cast<int32_t>(span.t * w * span.scaleT);
+        span.z += span.zStep;
+        span.w += span.wStep;
+        span.s += span.sStep;
+        span.t += span.tStep;
+    }
+}
+
+} // namespace Scalar
+
+} // namespace GeForce3Spans
+
+// The vector kernels share one body, instantiated for each vector width.
+// The AVX one is compiled for AVX whatever the build flags and only runs
+// on hosts that have it.
+#if GEFORCE3_SPAN_SSE2
+#define GEFORCE3_SPAN_LANES 2
+#define GEFORCE3_SPAN_TARGET
+#include "geforce3_spans_lanes.h"
+#undef GEFORCE3_SPAN_LANES
+#undef GEFORCE3_SPAN_TARGET
+
+#define GEFORCE3_SPAN_LANES 4
+#if defined(_MSC_VER)
+#define GEFORCE3_SPAN_TARGET
+#else
+#define GEFORCE3_SPAN_TARGET __attribute__((target("avx")))
+#endif
+#include "geforce3_spans_lanes.h"
+#undef GEFORCE3_SPAN_LANES
+#undef GEFORCE3_SPAN_TARGET
+#endif
+
+namespace GeForce3Spans {
+
+struct Kernels {
+    const char* name;
+    void (*color)(const ColorSpan& span, int first, int count, uint32_t* argb, int32_t* z);
+    void (*texture)(TextureSpan& span, int count, int32_t* z, int32_t* s, int32_t* t);
+};
+
+inline bool HostHasAVX()
+{
+#if !GEFORCE3_SPAN_SSE2
+    return false;
+#elif defined(_MSC_VER)
+    // The OS has to save the upper halves of the YMM registers as well
+    int info[4];
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)))
+        return false;
+    return (_xgetbv(0) & 6) == 6;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+#endif
+}
+
+// Kernel sets this host can run, fastest first; the scalar one is last
+inline std::vector<Kernels> AvailableKernels()
+{
+    std::vector<Kernels> kernels;
+#if GEFORCE3_SPAN_SSE2
+    if (HostHasAVX())
+        kernels.push_back({ "avx", &AVX::ComputeColorSpan, &AVX::ComputeTextureSpan });
+    kernels.push_back({ "sse2", &SSE2::ComputeColorSpan, &SSE2::ComputeTextureSpan });
+#endif
+    kernels.push_back({ "scalar", &Scalar::ComputeColorSpan, &Scalar::ComputeTextureSpan });
+    return kernels;
+}
+
+// Kernel set used by the render callbacks
+inline const Kernels& SelectedKernels()
+{
+    static const Kernels kernels = AvailableKernels().front();
+    return kernels;
+}
+
+inline void ComputeColorSpan(const ColorSpan& span, int first, int count, uint32_t* argb, int32_t* z)
+{
+    SelectedKernels().color(span, first, count, argb, z);
+}
+
+inline void ComputeTextureSpan(TextureSpan& span, int count, int32_t* z, int32_t* s, int32_t* t)
+{
+    SelectedKernels().texture(span, count, z, s, t);
+}
+
+} // namespace GeForce3Spans
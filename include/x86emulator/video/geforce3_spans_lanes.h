@@ -0,0 +1,113 @@
+// Vector span kernels, included by geforce3_spans.h once per vector width
+//
+// GEFORCE3_SPAN_LANES selects the width (2 for SSE2, 4 for AVX) and
+// GEFORCE3_SPAN_TARGET the instruction set every function is compiled for.
+// No include guard: each inclusion defines a namespace of its own.
+
+namespace GeForce3Spans {
+
+#if GEFORCE3_SPAN_LANES == 4
+namespace AVX {
+
+typedef __m256d SpanVector;
+
+GEFORCE3_SPAN_TARGET inline SpanVector SpanSet(double value) { return _mm256_set1_pd(value); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanIndex(int x) { return _mm256_set_pd(x + 3, x + 2, x + 1, x); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanLoad(const double* p) { return _mm256_loadu_pd(p); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanAdd(SpanVector a, SpanVector b) { return _mm256_add_pd(a, b); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanMul(SpanVector a, SpanVector b) { return _mm256_mul_pd(a, b); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanDiv(SpanVector a, SpanVector b) { return _mm256_div_pd(a, b); }
+GEFORCE3_SPAN_TARGET inline __m128i SpanTruncate(SpanVector v) { return _mm256_cvttpd_epi32(v); }
+GEFORCE3_SPAN_TARGET inline void SpanStore(int32_t* p, __m128i v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+GEFORCE3_SPAN_TARGET inline void SpanStore(uint32_t* p, __m128i v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+#else
+namespace SSE2 {
+
+typedef __m128d SpanVector;
+
+GEFORCE3_SPAN_TARGET inline SpanVector SpanSet(double value) { return _mm_set1_pd(value); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanIndex(int x) { return _mm_set_pd(x + 1, x); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanLoad(const double* p) { return _mm_loadu_pd(p); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanAdd(SpanVector a, SpanVector b) { return _mm_add_pd(a, b); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanMul(SpanVector a, SpanVector b) { return _mm_mul_pd(a, b); }
+GEFORCE3_SPAN_TARGET inline SpanVector SpanDiv(SpanVector a, SpanVector b) { return _mm_div_pd(a, b); }
+GEFORCE3_SPAN_TARGET inline __m128i SpanTruncate(SpanVector v) { return _mm_cvttpd_epi32(v); }
+GEFORCE3_SPAN_TARGET inline void SpanStore(int32_t* p, __m128i v) { _mm_storel_epi64(reinterpret_cast<__m128i*>(p), v); }
+GEFORCE3_SPAN_TARGET inline void SpanStore(uint32_t* p, __m128i v) { _mm_storel_epi64(reinterpret_cast<__m128i*>(p), v); }
+#endif
+
+// Clamp 32-bit lanes to 0..255 with SSE2 only
+GEFORCE3_SPAN_TARGET inline __m128i SpanClampColor(__m128i v)
+{
+    const __m128i max = _mm_set1_epi32(255);
+    v = _mm_and_si128(v, _mm_cmpgt_epi32(v, _mm_setzero_si128()));
+    __m128i over = _mm_cmpgt_epi32(v, max);
+    return _mm_or_si128(_mm_andnot_si128(over, v), _mm_and_si128(over, max));
+}
+
+// Scalar::ComputeColorSpan() several pixels at a time
+GEFORCE3_SPAN_TARGET inline void ComputeColorSpan(const ColorSpan& span, int first, int count, uint32_t* argb, int32_t* z)
+{
+    int i = 0;
+
+    const SpanVector one = SpanSet(1.0);
+    const SpanVector scale = SpanSet(255.0);
+    for (; i + GEFORCE3_SPAN_LANES <= count; i += GEFORCE3_SPAN_LANES) {
+        SpanVector x = SpanIndex(first + i);
+
+        SpanStore(z + i, SpanTruncate(SpanAdd(SpanSet(span.zStart), SpanMul(x, SpanSet(span.zStep)))));
+
+        SpanVector w = SpanDiv(one, SpanAdd(SpanSet(span.wStart), SpanMul(x, SpanSet(span.wStep))));
+        __m128i channel[4];
+        for (int c = 0; c < 4; c++) {
+            SpanVector value = SpanAdd(SpanSet(span.colorStart[c]), SpanMul(x, SpanSet(span.colorStep[c])));
+            channel[c] = SpanClampColor(SpanTruncate(SpanMul(SpanMul(value, w), scale)));
+        }
+
+        __m128i color = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(channel[3], 24), _mm_slli_epi32(channel[2], 16)),
+                                     _mm_or_si128(_mm_slli_epi32(channel[1], 8), channel[0]));
+        SpanStore(argb + i, color);
+    }
+
+    Scalar::ComputeColorSpan(span, first + i, count - i, argb + i, z + i);
+}
+
+// Scalar::ComputeTextureSpan() several pixels at a time
+GEFORCE3_SPAN_TARGET inline void ComputeTextureSpan(TextureSpan& span, int count, int32_t* z, int32_t* s, int32_t* t)
+{
+    int i = 0;
+
+    // The accumulators are serial sums; only the per-pixel math runs in lanes
+    alignas(32) double zs[BLOCK_SIZE], ws[BLOCK_SIZE], ss[BLOCK_SIZE], ts[BLOCK_SIZE];
+    for (int n = 0; n < count; n++) {
+        zs[n] = span.z;
+        ws[n] = span.w;
+        ss[n] = span.s;
+        ts[n] = span.t;
+        span.z += span.zStep;
+        span.w += span.wStep;
+        span.s += span.sStep;
+        span.t += span.tStep;
+    }
+
+    const SpanVector one = SpanSet(1.0);
+    const SpanVector scaleS = SpanSet(span.scaleS);
+    const SpanVector scaleT = SpanSet(span.scaleT);
+    for (; i + GEFORCE3_SPAN_LANES <= count; i += GEFORCE3_SPAN_LANES) {
+        SpanVector w = SpanDiv(one, SpanLoad(ws + i));
+        SpanStore(z + i, SpanTruncate(SpanLoad(zs + i)));
+        SpanStore(s + i, SpanTruncate(SpanMul(SpanMul(SpanLoad(ss + i), w), scaleS)));
+        SpanStore(t + i, SpanTruncate(SpanMul(SpanMul(SpanLoad(ts + i), w), scaleT)));
+    }
+
+    for (; i < count; i++) {
+        double w = 1.0 / ws[i];
+        z[i] = static_cast<int32_t>(zs[i]);
+        s[i] = static_cast<int32_t>(ss[i] * w * span.scaleS);
+        t[i] = static_cast<int32_t>(ts[i] * w * span.scaleT);
+    }
+}
+
+} // namespace AVX / SSE2
+
+} // namespace GeForce3Spans
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// GeForce3 command trace format
+//
+// A trace holds everything the GPU took in from outside during a session,
+// so it can be run again with nothing but the GPU (tools/gf3_replay). All
+// values are little endian.
+//
+// File header:
+//   char[8] magic "GF3TRACE", u32 version, u32 flags (0)
+//
+// Followed by records until end of file, each starting with a u8 tag:
+//   TAG_RAM             u32 size           RAM handed to SetRamBase(), zeroed
+//   TAG_RESET                              Reset()
+//   TAG_CONFIG_WRITE    u8 reg, u8 size, u32 value
+//   TAG_REGISTER_WRITE  u8 size, u32 address, u32 value   WriteMemory()
+//   TAG_VBLANK          u8 state           OnVBlank()
+//   TAG_SCREEN          u32 width, u32 height   ScreenUpdate()
+//   TAG_MEMORY          u32 offset, u32 length, length bytes
+//
+// Memory records carry RAM the GPU read (pushbuffers, textures, vertex
+// buffers, blit sources, the scanned out frame) where it differs from what
+// the trace already holds. They belong to the record before them: a replay
+// copies them into RAM before running that record. Memory the GPU wrote
+// itself is not recorded; the replay writes it again.
+namespace GeForce3Trace {
+
+constexpr char MAGIC[8] = { 'G', 'F', '3', 'T', 'R', 'A', 'C', 'E' };
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t HEADER_SIZE = 16;
+
+constexpr uint8_t TAG_RAM = 0x01;
+constexpr uint8_t TAG_RESET = 0x02;
+constexpr uint8_t TAG_CONFIG_WRITE = 0x03;
+constexpr uint8_t TAG_REGISTER_WRITE = 0x04;
+constexpr uint8_t TAG_VBLANK = 0x05;
+constexpr uint8_t TAG_SCREEN = 0x06;
+constexpr uint8_t TAG_MEMORY = 0x07;
+
+// Memory is compared and recorded in blocks of this many bytes
+constexpr uint32_t MEMORY_BLOCK = 256;
+
+inline uint32_t Load32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace GeForce3Trace
+
+// Trace file writer
+//
+// Keeps a shadow copy of guest RAM holding what a replay will have in
+// memory at this point of the trace, and records the blocks of every range
+// the GPU reads that differ from it. Ranges the GPU writes are reported
+// with Written() and copied into the shadow by SyncWrites() once the
+// writes have landed. The caller serializes all calls.
+class GeForce3TraceWriter
+{
+public:
+    GeForce3TraceWriter();
+    ~GeForce3TraceWriter();
+
+    GeForce3TraceWriter(const GeForce3TraceWriter&) = delete;
+    GeForce3TraceWriter& operator=(const GeForce3TraceWriter&) = delete;
+
+    bool Open(const std::string& path);
+    bool Close();   // False if anything failed to reach the file
+    bool IsOpen() const { return m_file != nullptr; }
+
+    // Records
+    void Ram(uint32_t size);
+    void Reset();
+    void ConfigWrite(uint8_t reg, uint32_t value, int size);
+    void RegisterWrite(uint32_t address, uint32_t value, int size);
+    void VBlank(int state);
+    void Screen(int width, int height);
+
+    // Record whatever the replay is missing of ram[offset..offset+size)
+    void Consume(const uint8_t* ram, uint32_t offset, uint32_t size);
+
+    // GPU writes waiting for SyncWrites()
+    void Written(uint32_t offset, uint32_t size);
+    bool HasWrites() const { return !m_written.empty(); }
+    bool WritesOverlap(uint32_t offset, uint32_t size) const;
+    void SyncWrites(const uint8_t* ram);
+
+    uint64_t GetBytesWritten() const { return m_bytesWritten; }
+
+private:
+    void Put8(uint8_t value);
+    void Put32(uint32_t value);
+    void PutBytes(const uint8_t* data, size_t size);
+    void Flush();
+
+    std::FILE* m_file;
+    std::vector<uint8_t> m_buffer;
+    std::vector<uint8_t> m_shadow;
+    std::vector<std::pair<uint32_t, uint32_t>> m_written;  // Start and end of each GPU-written range
+    uint64_t m_bytesWritten;
+    bool m_writeFailed;
+};
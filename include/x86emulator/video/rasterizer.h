@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Maximum number of interpolated parameters per vertex
+constexpr int RASTERIZER_MAX_PARAMS = 26;
+
+// Screen-space vertex handed to the rasterizer
+struct RasterizerVertex_t {
+    float x;
+    float y;
+    float p[RASTERIZER_MAX_PARAMS];
+};
+
+// One span of a scanline, with each parameter at startx and its x gradient
+struct RasterizerExtent_t {
+    int32_t startx;
+    int32_t stopx;      // Exclusive
+    struct {
+        double start;
+        double dpdx;
+    } param[RASTERIZER_MAX_PARAMS];
+};
+
+// Tile-binned multithreaded triangle rasterizer
+//
+// RenderTriangle() only sets a triangle up and bins it into every screen
+// tile it touches. A tile is a band of TILE_HEIGHT full-width scanlines,
+// so a span is never split and each pixel receives exactly the
+// interpolants a serial scanline walk would produce. Triangles are
+// collected in batches; a full batch is handed to the worker pool while
+// the caller keeps queueing into the next one. Workers take whole tiles
+// and render each tile's triangles in submission order, so output is
+// identical to serial rendering regardless of the number of threads.
+//
+// Render callbacks run on worker threads. They receive a threadId below
+// MAX_THREADS that is unique among concurrently running callbacks, and
+// must only touch pixels of the scanline they were given. Everything the
+// callbacks read must stay unchanged until Wait() returns; callers call
+// Wait() before changing such state, reading the render target back or
+// presenting it.
+class Rasterizer
+{
+public:
+    using RenderCallback = std::function<void(int32_t, const RasterizerExtent_t&, void*, int)>;
+
+    static constexpr int MAX_THREADS = 16;
+    static constexpr int TILE_HEIGHT = 16;
+    static constexpr size_t BATCH_SIZE = 512;
+
+    // threads = total rendering threads including the caller, 0 = one per core
+    explicit Rasterizer(int threads = 0);
+    ~Rasterizer();
+
+    Rasterizer(const Rasterizer&) = delete;
+    Rasterizer& operator=(const Rasterizer&) = delete;
+
+    // Queue a triangle; returns the number of scanlines it covers
+    //
+    // The callback object is referenced, not copied, and must stay alive
+    // and unchanged until the next Wait().
+    template<int ParamCount, typename Rect>
+    uint32_t RenderTriangle(const Rect& cliprect, const RenderCallback& callback, void* objectData,
+                            const RasterizerVertex_t& v1, const RasterizerVertex_t& v2,
+                            const RasterizerVertex_t& v3);
+
+    // Render everything queued so far and return when it is in memory
+    void Wait();
+
+    // True if no triangles are queued or being rendered
+    bool IsIdle() const { return m_active == nullptr && m_batches[m_filling].triangles.empty(); }
+
+    int GetThreadCount() const { return static_cast<int>(m_workers.size()) + 1; }
+
+private:
+    struct Triangle {
+        const RenderCallback* callback;
+        void* objectData;
+        int32_t minY;
+        int32_t maxY;       // Inclusive
+        int32_t clipLeft;
+        int32_t clipRight;  // Exclusive
+        int paramCount;
+        // Vertices sorted by y
+        double x0, y0, x1, y1, x2, y2;
+        // Plane equation of each parameter, relative to vertex 0
+        double p0[RASTERIZER_MAX_PARAMS];
+        double dpdx[RASTERIZER_MAX_PARAMS];
+        double dpdy[RASTERIZER_MAX_PARAMS];
+    };
+
+    struct Batch {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> tiles;   // Triangle indices per tile
+        int32_t tileCount = 0;
+        std::atomic<int32_t> nextTile{0};
+        std::atomic<int32_t> tilesRemaining{0};
+    };
+
+    Triangle& Queue();
+    void Flush();
+    void Dispatch(Batch* batch);
+    void Finish();
+    void RenderTiles(Batch* batch, int threadId);
+    static void RenderScanline(const Triangle& tri, int32_t y, int threadId);
+    void WorkerLoop(int threadId);
+
+    Batch m_batches[2];
+    int m_filling;          // Batch receiving new triangles
+    Batch* m_active;        // Batch being rendered, or nullptr
+    int m_busyWorkers;      // Workers inside the active batch
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    uint64_t m_generation;  // Bumped for every dispatched batch
+    bool m_stopping;
+};
+
+template<int ParamCount, typename Rect>
+uint32_t Rasterizer::RenderTriangle(const Rect& cliprect, const RenderCallback& callback, void* objectData,
+                                    const RasterizerVertex_t& v1, const RasterizerVertex_t& v2,
+                                    const RasterizerVertex_t& v3)
+{
+    static_assert(ParamCount >= 0 && ParamCount <= RASTERIZER_MAX_PARAMS, "Too many parameters");
+
+    // Sort the vertices by y
+    const RasterizerVertex_t* a = &v1;
+    const RasterizerVertex_t* b = &v2;
+    const RasterizerVertex_t* c = &v3;
+    if (b->y < a->y) std::swap(a, b);
+    if (c->y < b->y) std::swap(b, c);
+    if (b->y < a->y) std::swap(a, b);
+
+    // Pixel centers at y + 0.5 inside [a.y, c.y)
+    int32_t minY = std::max<int32_t>(static_cast<int32_t>(std::ceil(a->y - 0.5f)),
+                                     std::max<int32_t>(cliprect.top(), 0));
+    int32_t maxY = std::min<int32_t>(static_cast<int32_t>(std::ceil(c->y - 0.5f)) - 1, cliprect.bottom());
+    if (minY > maxY || cliprect.left() > cliprect.right())
+        return 0;
+
+    double x0 = a->x, y0 = a->y;
+    double dx1 = b->x - x0, dy1 = b->y - y0;
+    double dx2 = c->x - x0, dy2 = c->y - y0;
+    double area = dx1 * dy2 - dx2 * dy1;
+    if (area == 0.0)
+        return 0;
+
+    Triangle& tri = Queue();
+    tri.callback = &callback;
+    tri.objectData = objectData;
+    tri.minY = minY;
+    tri.maxY = maxY;
+    tri.clipLeft = cliprect.left();
+    tri.clipRight = cliprect.right() + 1;
+    tri.paramCount = ParamCount;
+    tri.x0 = x0;
+    tri.y0 = y0;
+    tri.x1 = b->x;
+    tri.y1 = b->y;
+    tri.x2 = c->x;
+    tri.y2 = c->y;
+
+    double invArea = 1.0 / area;
+    for (int n = 0; n < ParamCount; n++) {
+        double p0 = a->p[n];
+        double dp1 = b->p[n] - p0;
+        double dp2 = c->p[n] - p0;
+        tri.p0[n] = p0;
+        tri.dpdx[n] = (dp1 * dy2 - dp2 * dy1) * invArea;
+        tri.dpdy[n] = (dp2 * dx1 - dp1 * dx2) * invArea;
+    }
+
+    // Bin into every tile the triangle touches
+    Batch& batch = m_batches[m_filling];
+    uint32_t index = static_cast<uint32_t>(batch.triangles.size() - 1);
+    int32_t firstTile = minY / TILE_HEIGHT;
+    int32_t lastTile = maxY / TILE_HEIGHT;
+    if (lastTile >= static_cast<int32_t>(batch.tiles.size()))
+        batch.tiles.resize(lastTile + 1);
+    batch.tileCount = std::max(batch.tileCount, lastTile + 1);
+    for (int32_t t = firstTile; t <= lastTile; t++)
+        batch.tiles[t].push_back(index);
+
+    if (batch.triangles.size() >= BATCH_SIZE)
+        Flush();
+
+    return static_cast<uint32_t>(maxY - minY + 1);
+}
@@ -0,0 +1,81 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ * 
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "accuracy_profile.h"
+
+namespace {
+    const char* const FEATURE_NAMES[] = {
+        "cpu_cache",
+        "cycle_timing",
+        "w_clipping",
+        "sync_puller",
+        "lazy_clears"
+    };
+    
+    static_assert(sizeof(FEATURE_NAMES) / sizeof(FEATURE_NAMES[0]) ==
+                  static_cast<size_t>(AccuracyProfile::Feature::COUNT),
+                  "Feature name missing");
+    
+    // Off in every profile, as before profiles existed; only an explicit
+    // override turns them on
+    bool isOptIn(AccuracyProfile::Feature feature)
+    {
+        return feature == AccuracyProfile::Feature::W_CLIPPING || AccuracyProfile::isUnsafe(feature);
+    }
+}
+
+AccuracyProfile::AccuracyProfile()
+{
+    setProfile("accurate");
+}
+
+AccuracyProfile* AccuracyProfile::GetInstance()
+{
+    static AccuracyProfile instance;
+    return &instance;
+}
+
+bool AccuracyProfile::setProfile(const std::string& name)
+{
+    bool enable;
+    
+    if (name == "accurate") {
+        enable = true;
+    } else if (name == "fast") {
+        enable = false;
+    } else {
+        return false;
+    }
+    
+    m_profile = name;
+    for (int i = 0; i < static_cast<int>(Feature::COUNT); i++) {
+        m_enabled[i] = enable && !isOptIn(static_cast<Feature>(i));
+    }
+    return true;
+}
+
+const char* AccuracyProfile::getFeatureName(Feature feature)
+{
+    return FEATURE_NAMES[static_cast<int>(feature)];
+}
+
+bool AccuracyProfile::isUnsafe(Feature feature)
+{
+    return feature == Feature::LAZY_CLEARS;
+}
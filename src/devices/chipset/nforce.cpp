@@ -119,6 +119,7 @@ int AS99127FSensor3::executeCommand(int command, int rw, int data) {
 NForce::NForce(const DeviceConfig& config)
     : Chipset(config),
       m_cpu(nullptr),
+      m_router(nullptr),
       m_pciBus(nullptr),
       m_cpuBridge(nullptr),
       m_memoryCtrl(nullptr),
@@ -190,6 +191,11 @@ bool NForce::Initialize() {
         m_isaBridge->SetCPUInterface(m_cpu);
     }
     
+    // Assert IRQs into the machine's routing fabric when there is one
+    if (m_router) {
+        m_isaBridge->SetInterruptRouter(m_router);
+    }
+    
     // SMBus Controller
     DeviceConfig smbusConfig = m_config;
     smbusConfig.set("vendor_id", 0x10de);
@@ -355,6 +361,14 @@ void NForce::SetCPU(CPU* cpu) {
     }
 }
 
+void NForce::SetInterruptRouter(InterruptRouter* router) {
+    m_router = router;
+    
+    if (m_isaBridge) {
+        m_isaBridge->SetInterruptRouter(router);
+    }
+}
+
 void NForce::SetBIOS(uint8_t* biosRom) {
     // Forward to CPU bridge which handles the BIOS mapping
 }
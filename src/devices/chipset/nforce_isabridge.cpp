@@ -19,6 +19,7 @@
 
 #include "devices/chipset/nforce/nforce.h"
 #include "devices/cpu/cpu.h"
+#include "interrupt_router.h"
 #include "log.h"
 
 NFORCE_ISABridge::NFORCE_ISABridge(const DeviceConfig& config)
@@ -44,6 +45,7 @@ NFORCE_ISABridge::NFORCE_ISABridge(const DeviceConfig& config)
       m_pit(nullptr),
       m_rtc(nullptr),
       m_cpu(nullptr),
+      m_router(nullptr),
       m_interruptOutputState(false),
       m_dmaEop(false)
 {
@@ -329,6 +331,11 @@ void NFORCE_ISABridge::WriteIO(uint16_t port, uint32_t value, int size) {
 }
 
 uint32_t NFORCE_ISABridge::AcknowledgeIRQ() {
+    if (m_router) {
+        int vector = m_router->acknowledge();
+        return vector < 0 ? 0xFF : static_cast<uint32_t>(vector);
+    }
+    
     if (m_pic1) {
         return m_pic1->Acknowledge();
     }
@@ -336,6 +343,11 @@ uint32_t NFORCE_ISABridge::AcknowledgeIRQ() {
 }
 
 void NFORCE_ISABridge::AssertIRQ(int irqNum) {
+    if (m_router) {
+        m_router->setIRQ(irqNum, true);
+        return;
+    }
+    
     if (irqNum < 8) {
         if (m_pic1) {
             m_pic1->AssertIRQ(irqNum);
@@ -350,6 +362,11 @@ void NFORCE_ISABridge::AssertIRQ(int irqNum) {
 }
 
 void NFORCE_ISABridge::DeassertIRQ(int irqNum) {
+    if (m_router) {
+        m_router->setIRQ(irqNum, false);
+        return;
+    }
+    
     if (irqNum < 8) {
         if (m_pic1) {
             m_pic1->DeassertIRQ(irqNum);
@@ -20,20 +20,97 @@
 #include "86box_integration.h"
 #include <string.h>
 #include <stdio.h>
+#include <memory>
+#include <vector>
 
 // Include 86Box CPU headers
 extern "C" {
+#include "86box/86box.h"
 #include "86box/cpu.h"
 #include "86box/cpu/x86.h"
+#include "86box/cpu/x86seg.h"
 #include "86box/machine.h"
 #include "86box/io.h"
 #include "86box/mem.h"
+#include "86box/pic.h"
+
+#ifdef USE_DYNAREC
+void codegen_timing_set_flat(int flat);
+#endif
 }
 
 // Global variables
 namespace {
     void* g_irqCallback = nullptr;
     bool g_initialized = false;
+    
+    // Register window mapped into the 86Box address space
+    struct MMIOWindow {
+        mem_mapping_t mapping;
+        uint32_t base;
+        x86emu::MMIOReadHandler read;
+        x86emu::MMIOWriteHandler write;
+    };
+    
+    std::vector<std::unique_ptr<MMIOWindow>> g_mmioWindows;
+    x86emu::InterruptAcknowledgeHandler g_interruptAcknowledge;
+    x86emu::CodeWriteHandler g_codeWriteHandler;
+    
+    // Narrow accesses are merged into the aligned dword
+    uint32_t mmioRead(uint32_t addr, void* priv)
+    {
+        MMIOWindow* window = static_cast<MMIOWindow*>(priv);
+        return window->read((addr - window->base) & ~3u) >> ((addr & 3) * 8);
+    }
+    
+    uint8_t mmioReadByte(uint32_t addr, void* priv)
+    {
+        return static_cast<uint8_t>(mmioRead(addr, priv));
+    }
+    
+    uint16_t mmioReadWord(uint32_t addr, void* priv)
+    {
+        return static_cast<uint16_t>(mmioRead(addr, priv));
+    }
+    
+    void mmioWrite(uint32_t addr, uint32_t value, uint32_t mask, void* priv)
+    {
+        MMIOWindow* window = static_cast<MMIOWindow*>(priv);
+        uint32_t offset = (addr - window->base) & ~3u;
+        int shift = (addr & 3) * 8;
+        
+        if (mask != 0xFFFFFFFF) {
+            value = (window->read(offset) & ~(mask << shift)) | ((value & mask) << shift);
+        }
+        window->write(offset, value);
+    }
+    
+    void mmioWriteByte(uint32_t addr, uint8_t value, void* priv)
+    {
+        mmioWrite(addr, value, 0xFF, priv);
+    }
+    
+    void mmioWriteWord(uint32_t addr, uint16_t value, void* priv)
+    {
+        mmioWrite(addr, value, 0xFFFF, priv);
+    }
+    
+    void mmioWriteDword(uint32_t addr, uint32_t value, void* priv)
+    {
+        mmioWrite(addr, value, 0xFFFFFFFF, priv);
+    }
+    
+    int localInterruptAcknowledge(void* priv)
+    {
+        (void)priv;
+        return g_interruptAcknowledge ? g_interruptAcknowledge() : -1;
+    }
+    
+    void codeWrite(uint32_t addr, int size, void* priv)
+    {
+        (void)priv;
+        g_codeWriteHandler(addr, static_cast<uint32_t>(size));
+    }
 }
 
 // C++ implementation of wrapper functions
@@ -87,6 +164,14 @@ void ShutdownCPU()
 {
     if (g_initialized) {
         // Any cleanup needed for 86Box CPU
+        for (auto& window : g_mmioWindows) {
+            mem_mapping_disable(&window->mapping);
+        }
+        pic_set_lapic(NULL, NULL);
+        pic_set_lapic_pending(0);
+        g_interruptAcknowledge = nullptr;
+        mem_set_code_write_handler(NULL, NULL);
+        g_codeWriteHandler = nullptr;
         g_initialized = false;
     }
 }
@@ -101,6 +186,11 @@ int ExecuteCPU(int cycles)
     return cpu_exec(cycles);
 }
 
+uint64_t GetInstructionCount()
+{
+    return cpu_instructions;
+}
+
 void StopCPU()
 {
     if (g_initialized) {
@@ -110,11 +200,12 @@ void StopCPU()
 
 void AssertIRQ(int irqLine, bool state)
 {
-    if (g_initialized) {
+    // The 86Box core has its own 8259 pair, so ISA lines go straight to it
+    if (g_initialized && irqLine >= 0 && irqLine < 16) {
         if (state) {
-            pic_set_irq(irqLine);
+            picint(1 << irqLine);
         } else {
-            pic_clear_irq(irqLine);
+            picintc(1 << irqLine);
         }
     }
 }
@@ -131,6 +222,55 @@ void SetIRQCallback(void* callback)
     g_irqCallback = callback;
 }
 
+bool MapMMIO(uint32_t base, uint32_t size, MMIOReadHandler read, MMIOWriteHandler write)
+{
+    if (!g_initialized || !read || !write) {
+        return false;
+    }
+    
+    auto window = std::make_unique<MMIOWindow>();
+    window->base = base;
+    window->read = std::move(read);
+    window->write = std::move(write);
+    
+    mem_mapping_add(&window->mapping, base, size,
+                    mmioReadByte, mmioReadWord, mmioRead,
+                    mmioWriteByte, mmioWriteWord, mmioWriteDword,
+                    NULL, MEM_MAPPING_EXTERNAL, window.get());
+    g_mmioWindows.push_back(std::move(window));
+    return true;
+}
+
+void SetInterruptAcknowledge(InterruptAcknowledgeHandler acknowledge)
+{
+    g_interruptAcknowledge = std::move(acknowledge);
+    pic_set_lapic(g_interruptAcknowledge ? localInterruptAcknowledge : NULL, NULL);
+}
+
+void SetLocalInterrupt(bool pending)
+{
+    if (g_initialized) {
+        pic_set_lapic_pending(pending ? 1 : 0);
+    }
+}
+
+void SetCodeWriteHandler(CodeWriteHandler handler)
+{
+    // Clear the hook first so no store sees a half-assigned handler
+    mem_set_code_write_handler(NULL, NULL);
+    g_codeWriteHandler = std::move(handler);
+    if (g_codeWriteHandler) {
+        mem_set_code_write_handler(codeWrite, NULL);
+    }
+}
+
+void WatchCodePage(uint32_t address, bool watch)
+{
+    if (g_initialized) {
+        mem_watch_code_page(address, watch ? 1 : 0);
+    }
+}
+
 uint8_t ReadMemoryByte(uint32_t address)
 {
     if (!g_initialized) {
@@ -213,6 +353,9 @@ uint32_t GetRegister(int regIndex)
         case 7: return cpu_state.esp;
         case 8: return cpu_state.pc;
         case 9: return cpu_state.flags;
+        case 10: return cpu_state.seg_cs.seg;
+        case 11: return cpu_state.CR0.l;
+        case 12: return CPL;
         // Add more registers as needed
         default: return 0;
     }
@@ -236,6 +379,8 @@ void SetRegister(int regIndex, uint32_t value)
         case 7: cpu_state.esp = value; break;
         case 8: cpu_state.pc = value; break;
         case 9: cpu_state.flags = value; break;
+        case 10: loadcs(value & 0xFFFF); break;
+        case 11: cpu_state.CR0.l = value; break;
         // Add more registers as needed
     }
 }
@@ -246,12 +391,52 @@ const char* GetDisassembly(uint32_t pc, char* buffer, size_t buffer_size)
         return "";
     }
     
-    // This would depend on 86Box's disassembly functions
-    // For now, just return a placeholder
-    snprintf(buffer, buffer_size, "Instruction at 0x%08X", pc);
+    // No disassembler is linked in; show CS:EIP and the raw opcode bytes
+    uint32_t linear = cpu_state.seg_cs.base + pc;
+    int length = snprintf(buffer, buffer_size, "%04X:%08X ", CS, pc);
+    
+    for (uint32_t i = 0; i < 8 && length > 0 && static_cast<size_t>(length) < buffer_size; i++) {
+        uint64_t address = linear + i;
+        if (cr0 >> 31) {
+            address = mmutranslate_noabrt(linear + i, 0);
+            if (address > 0xffffffffULL) {
+                break;
+            }
+        }
+        length += snprintf(buffer + length, buffer_size - length, " %02X",
+                           mem_readb_phys(static_cast<uint32_t>(address)));
+    }
+    
     return buffer;
 }
 
+void SetFastFPU(bool enable)
+{
+    fpu_fast = enable ? 1 : 0;
+}
+
+void SetTraceHooks(const i386_trace_hooks* hooks)
+{
+    cpu_trace = hooks;
+    
+    // Drop cached translations so data accesses go through the traced slow paths
+    flushmmucache();
+
+#ifdef USE_DYNAREC
+    // Recompiled blocks embed the trace call (or lack it), so rebuild them
+    codegen_reset();
+#endif
+}
+
+void SetFlatTiming(bool enable)
+{
+#ifdef USE_DYNAREC
+    codegen_timing_set_flat(enable ? 1 : 0);
+#else
+    cpu_flat_timing = enable ? 1 : 0;
+#endif
+}
+
 } // namespace box86
 } // namespace x86emu
 
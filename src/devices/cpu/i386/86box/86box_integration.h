@@ -23,6 +23,12 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "../common/i386_trace.h"
+
+#ifdef __cplusplus
+#include "../common/i386_interface.h"
+#endif
+
 // Define C++ wrapper functions for 86Box's CPU implementation
 #ifdef __cplusplus
 namespace x86emu {
@@ -34,9 +40,15 @@ void ResetCPU();
 void ShutdownCPU();
 int ExecuteCPU(int cycles);
 void StopCPU();
+uint64_t GetInstructionCount();
 void AssertIRQ(int irqLine, bool state);
 void AssertNMI(bool state);
 void SetIRQCallback(void* callback);
+bool MapMMIO(uint32_t base, uint32_t size, MMIOReadHandler read, MMIOWriteHandler write);
+void SetInterruptAcknowledge(InterruptAcknowledgeHandler acknowledge);
+void SetLocalInterrupt(bool pending);
+void SetCodeWriteHandler(CodeWriteHandler handler);
+void WatchCodePage(uint32_t address, bool watch);
 uint8_t ReadMemoryByte(uint32_t address);
 uint16_t ReadMemoryWord(uint32_t address);
 uint32_t ReadMemoryDword(uint32_t address);
@@ -48,6 +60,9 @@ void WriteIOByte(uint16_t port, uint8_t value);
 uint32_t GetRegister(int regIndex);
 void SetRegister(int regIndex, uint32_t value);
 const char* GetDisassembly(uint32_t pc, char* buffer, size_t buffer_size);
+void SetFastFPU(bool enable);
+void SetTraceHooks(const i386_trace_hooks* hooks);
+void SetFlatTiming(bool enable);
 
 } // namespace box86
 } // namespace x86emu
@@ -100,6 +100,11 @@ void Box86I386Adapter::Resume()
     m_paused = false;
 }
 
+uint64_t Box86I386Adapter::GetInstructionCount()
+{
+    return m_initialized ? box86::GetInstructionCount() : 0;
+}
+
 void Box86I386Adapter::AssertIRQ(int irqLine, bool state)
 {
     if (m_initialized) {
@@ -121,6 +126,49 @@ void Box86I386Adapter::SetIRQCallback(void* callback)
     }
 }
 
+bool Box86I386Adapter::MapMMIO(uint32_t base, uint32_t size, MMIOReadHandler read, MMIOWriteHandler write)
+{
+    if (!m_initialized) {
+        return false;
+    }
+    
+    return box86::MapMMIO(base, size, read, write);
+}
+
+bool Box86I386Adapter::SetInterruptAcknowledge(InterruptAcknowledgeHandler acknowledge)
+{
+    if (!m_initialized) {
+        return false;
+    }
+    
+    box86::SetInterruptAcknowledge(acknowledge);
+    return true;
+}
+
+void Box86I386Adapter::SetLocalInterrupt(bool pending)
+{
+    if (m_initialized) {
+        box86::SetLocalInterrupt(pending);
+    }
+}
+
+bool Box86I386Adapter::SetCodeWriteHandler(CodeWriteHandler handler)
+{
+    if (!m_initialized) {
+        return false;
+    }
+    
+    box86::SetCodeWriteHandler(handler);
+    return true;
+}
+
+void Box86I386Adapter::WatchCodePage(uint32_t address, bool watch)
+{
+    if (m_initialized) {
+        box86::WatchCodePage(address, watch);
+    }
+}
+
 uint8_t Box86I386Adapter::ReadByte(uint32_t address)
 {
     if (!m_initialized) {
@@ -219,6 +267,34 @@ void Box86I386Adapter::ExecuteCPUID()
     // Could be implemented by calling a specific function
 }
 
+bool Box86I386Adapter::SetFastFPU(bool enable)
+{
+    // Only affects the softfloat FPU; the legacy FPU already uses host doubles
+    box86::SetFastFPU(enable);
+    return true;
+}
+
+bool Box86I386Adapter::SetTraceHooks(const i386_trace_hooks* hooks)
+{
+    // Memory tracing runs the interpreter; register-only tracing stays recompiled
+    box86::SetTraceHooks(hooks);
+    return true;
+}
+
+bool Box86I386Adapter::SetCycleAccurate(bool enable)
+{
+    // Per-model timing tables of the recompiler; the interpreter keeps its own
+    box86::SetFlatTiming(!enable);
+    return true;
+}
+
+bool Box86I386Adapter::SetCacheEmulation(bool enable)
+{
+    // 86Box only models cache timing, never cache contents
+    (void)enable;
+    return false;
+}
+
 std::string Box86I386Adapter::GetDisassembly(uint32_t pc)
 {
     if (!m_initialized) {
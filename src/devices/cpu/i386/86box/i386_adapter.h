@@ -50,12 +50,22 @@ public:
     void Stop() override;
     void Pause() override;
     void Resume() override;
+    uint64_t GetInstructionCount() override;
     
     // Interrupt handling
     void AssertIRQ(int irqLine, bool state) override;
     void AssertNMI(bool state) override;
     void SetIRQCallback(void* callback) override;
     
+    // Local APIC hookup
+    bool MapMMIO(uint32_t base, uint32_t size, MMIOReadHandler read, MMIOWriteHandler write) override;
+    bool SetInterruptAcknowledge(InterruptAcknowledgeHandler acknowledge) override;
+    void SetLocalInterrupt(bool pending) override;
+    
+    // Code write tracking
+    bool SetCodeWriteHandler(CodeWriteHandler handler) override;
+    void WatchCodePage(uint32_t address, bool watch) override;
+    
     // Memory access
     uint8_t ReadByte(uint32_t address) override;
     uint16_t ReadWord(uint32_t address) override;
@@ -77,6 +87,16 @@ public:
     void ExecuteRDTSC() override;
     void ExecuteCPUID() override;
     
+    // FPU configuration
+    bool SetFastFPU(bool enable) override;
+    
+    // Instruction tracing
+    bool SetTraceHooks(const i386_trace_hooks* hooks) override;
+    
+    // Accuracy trade-offs
+    bool SetCycleAccurate(bool enable) override;
+    bool SetCacheEmulation(bool enable) override;
+    
     // Debug support
     std::string GetDisassembly(uint32_t pc) override;
     
@@ -16,9 +16,16 @@ void (*codegen_timing_block_start)(void);
 void (*codegen_timing_block_end)(void);
 int (*codegen_timing_jump_cycles)(void);
 
+/*Model selected by the CPU, kept so the flat model can be switched off again*/
+static codegen_timing_t *codegen_timing_model;
+
 void
 codegen_timing_set(codegen_timing_t *timing)
 {
+    codegen_timing_model = timing;
+    if (cpu_flat_timing)
+        timing = &codegen_timing_flat;
+
     codegen_timing_start       = timing->start;
     codegen_timing_prefix      = timing->prefix;
     codegen_timing_opcode      = timing->opcode;
@@ -27,6 +34,15 @@ codegen_timing_set(codegen_timing_t *timing)
     codegen_timing_jump_cycles = timing->jump_cycles;
 }
 
+/*Blocks compiled from now on use the new model; existing blocks keep their cycle counts*/
+void
+codegen_timing_set_flat(int flat)
+{
+    cpu_flat_timing = flat;
+    if (codegen_timing_model)
+        codegen_timing_set(codegen_timing_model);
+}
+
 int codegen_in_recompile;
 
 /* This is for compatibility with new x87 code. */
@@ -314,8 +314,10 @@ extern codegen_timing_t codegen_timing_winchip2;
 extern codegen_timing_t codegen_timing_k5;
 extern codegen_timing_t codegen_timing_k6;
 extern codegen_timing_t codegen_timing_p6;
+extern codegen_timing_t codegen_timing_flat;
 
 void codegen_timing_set(codegen_timing_t *timing);
+void codegen_timing_set_flat(int flat);
 
 extern int block_current;
 extern int block_pos;
@@ -25,6 +25,7 @@
 #    include "codegen_accumulate.h"
 #    include "codegen_ops.h"
 #    include "codegen_ops_x86-64.h"
+#    include "codegen_perfmap.h"
 
 int      codegen_flat_ds;
 int      codegen_flat_ss;
@@ -69,6 +70,8 @@ codegen_init(void)
 
     for (int c = 0; c < BLOCK_SIZE; c++)
         codeblock[c].valid = 0;
+
+    codegen_perfmap_init();
 }
 
 void
@@ -461,6 +464,10 @@ codegen_block_end_recompile(codeblock_t *block)
     if (block_pos > BLOCK_GPF_OFFSET)
         fatal("Over limit!\n");
 
+    /*Map the block body only; the GPF and exit stubs sit at fixed offsets after it*/
+    if (codegen_perfmap_enabled)
+        codegen_perfmap_add(block->data, block_pos, block->pc);
+
     remove_from_block_list(block, block->pc);
     block->next = block->prev = NULL;
     block->next_2 = block->prev_2 = NULL;
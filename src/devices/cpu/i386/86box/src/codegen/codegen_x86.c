@@ -64,6 +64,7 @@
 #    include "codegen_accumulate.h"
 #    include "codegen_ops.h"
 #    include "codegen_ops_x86.h"
+#    include "codegen_perfmap.h"
 
 int      codegen_flat_ds;
 int      codegen_flat_ss;
@@ -1239,6 +1240,8 @@ codegen_init(void)
     block_pos                   = (block_pos + 15) & ~15;
     mem_check_write_l           = (uint32_t) gen_MEM_CHECK_WRITE_L();
 
+    codegen_perfmap_init();
+
 #    ifndef _MSC_VER
     asm(
         "fstcw %0\n"
@@ -1602,6 +1605,10 @@ codegen_block_end_recompile(codeblock_t *block)
     if (block_pos > BLOCK_GPF_OFFSET)
         fatal("Over limit!\n");
 
+    /*Map the block body only; the GPF and exit stubs sit at fixed offsets after it*/
+    if (codegen_perfmap_enabled)
+        codegen_perfmap_add(block->data, block_pos, block->pc);
+
     remove_from_block_list(block, block->pc);
     block->next = block->prev = NULL;
     block->next_2 = block->prev_2 = NULL;
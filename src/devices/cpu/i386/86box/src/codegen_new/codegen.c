@@ -65,9 +65,16 @@ void (*codegen_timing_block_start)(void);
 void (*codegen_timing_block_end)(void);
 int (*codegen_timing_jump_cycles)(void);
 
+/*Model selected by the CPU, kept so the flat model can be switched off again*/
+static codegen_timing_t *codegen_timing_model;
+
 void
 codegen_timing_set(codegen_timing_t *timing)
 {
+    codegen_timing_model = timing;
+    if (cpu_flat_timing)
+        timing = &codegen_timing_flat;
+
     codegen_timing_start       = timing->start;
     codegen_timing_prefix      = timing->prefix;
     codegen_timing_opcode      = timing->opcode;
@@ -76,6 +83,15 @@ codegen_timing_set(codegen_timing_t *timing)
     codegen_timing_jump_cycles = timing->jump_cycles;
 }
 
+/*Blocks compiled from now on use the new model; existing blocks keep their cycle counts*/
+void
+codegen_timing_set_flat(int flat)
+{
+    cpu_flat_timing = flat;
+    if (codegen_timing_model)
+        codegen_timing_set(codegen_timing_model);
+}
+
 int codegen_in_recompile;
 
 static int      last_op_ssegs;
@@ -405,6 +421,15 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
 
     codegen_timing_start();
 
+    if (cpu_trace) {
+        /*Report the instruction before any of it executes. The hook rebuilds
+          the flags, so nothing known about them at compile time survives*/
+        uop_MOV_IMM(ir, IREG_pc, old_pc);
+        uop_LOAD_FUNC_ARG_IMM(ir, 0, fastreadl(cs + old_pc));
+        uop_CALL_FUNC(ir, cpu_trace_instruction);
+        codegen_flags_changed = 0;
+    }
+
     while (!over) {
         switch (opcode) {
             case 0x0f:
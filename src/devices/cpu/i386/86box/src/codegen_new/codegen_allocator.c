@@ -18,6 +18,7 @@
 
 #include "codegen.h"
 #include "codegen_allocator.h"
+#include "codegen_perfmap.h"
 
 typedef struct mem_block_t {
     uint32_t offset; /*Offset into mem_block_alloc*/
@@ -122,3 +123,18 @@ codegen_allocator_clean_blocks(UNUSED(struct mem_block_t *block))
     }
 #endif
 }
+
+void
+codegen_allocator_perfmap_add(mem_block_t *block, uint8_t *cur, int cur_size, uint32_t pc)
+{
+    while (1) {
+        uint8_t *ptr = &mem_block_alloc[block->offset];
+
+        codegen_perfmap_add(ptr, (ptr == cur) ? cur_size : MEM_BLOCK_SIZE, pc);
+
+        if (block->next)
+            block = &mem_blocks[block->next - 1];
+        else
+            break;
+    }
+}
@@ -33,6 +33,9 @@ void codegen_allocator_free(struct mem_block_t *block);
 uint8_t *codeblock_allocator_get_ptr(struct mem_block_t *block);
 /*Cache clean memory block list*/
 void codegen_allocator_clean_blocks(struct mem_block_t *block);
+/*Record block and any chained blocks in the perf map. cur is the block memory
+  currently being written, of which only the first cur_size bytes are used*/
+void codegen_allocator_perfmap_add(struct mem_block_t *block, uint8_t *cur, int cur_size, uint32_t pc);
 
 extern int codegen_allocator_usage;
 
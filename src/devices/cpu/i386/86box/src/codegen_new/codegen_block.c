@@ -22,6 +22,7 @@
 #include "codegen_allocator.h"
 #include "codegen_backend.h"
 #include "codegen_ir.h"
+#include "codegen_perfmap.h"
 #include "codegen_reg.h"
 
 uint8_t *block_write_data = NULL;
@@ -219,6 +220,7 @@ codegen_init(void)
 {
     codegen_check_regs();
     codegen_allocator_init();
+    codegen_perfmap_init();
 
     codegen_backend_init();
     block_free_list = 0;
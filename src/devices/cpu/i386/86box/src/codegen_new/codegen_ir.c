@@ -8,6 +8,7 @@
 #include "codegen_allocator.h"
 #include "codegen_backend.h"
 #include "codegen_ir.h"
+#include "codegen_perfmap.h"
 #include "codegen_reg.h"
 
 extern int       has_ea;
@@ -189,6 +190,8 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
     }
 
     codegen_backend_epilogue(block);
+    if (codegen_perfmap_enabled)
+        codegen_allocator_perfmap_add(block->head_mem_block, block_write_data, block_pos, block->pc);
     block_write_data = NULL;
 #if 0
     if (has_ea)
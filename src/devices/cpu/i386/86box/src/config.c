@@ -396,6 +396,8 @@ load_machine(void)
     fpu_softfloat = !!ini_section_get_int(cat, "fpu_softfloat", 0);
     if ((fpu_type != FPU_NONE) && machine_has_flags(machine, MACHINE_SOFTFLOAT_ONLY))
         fpu_softfloat = 1;
+    fpu_fast = !!ini_section_get_int(cat, "fpu_fast", 0);
+    cpu_flat_timing = !!ini_section_get_int(cat, "cpu_flat_timing", 0);
 
     p = ini_section_get_string(cat, "time_sync", NULL);
     if (p != NULL) {
@@ -2185,6 +2187,16 @@ save_machine(void)
     else
         ini_section_set_int(cat, "fpu_softfloat", fpu_softfloat);
 
+    if (fpu_fast == 0)
+        ini_section_delete_var(cat, "fpu_fast");
+    else
+        ini_section_set_int(cat, "fpu_fast", fpu_fast);
+
+    if (cpu_flat_timing == 0)
+        ini_section_delete_var(cat, "cpu_flat_timing");
+    else
+        ini_section_set_int(cat, "cpu_flat_timing", cpu_flat_timing);
+
     if (time_sync & TIME_SYNC_ENABLED)
         if (time_sync & TIME_SYNC_UTC)
             ini_section_set_string(cat, "time_sync", "utc");
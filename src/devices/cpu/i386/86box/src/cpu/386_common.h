@@ -21,6 +21,7 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+#include <string.h>
 
 #ifdef OPS_286_386
 #    define readmemb_n(s, a, b)     readmembl_no_mmut_2386((s) + (a), b)
@@ -309,6 +310,106 @@ int checkio(uint32_t port, int mask);
         return 1;                                     \
     }
 
+/* Bulk REP string support.  Returns how many elements (at most count) of a
+   string operand starting at seg:off can be reached through one host
+   pointer: they have to lie in a single directly mapped RAM page, inside the
+   segment limits and without wrapping the offset.  *p receives the host
+   address of the lowest byte of the run.  Anything else returns 0 and is
+   left to the per-element path, which also raises any faults. */
+static __inline uint32_t
+rep_bulk_span(x86seg *seg, uint32_t off, uint32_t count, int size, int addr32, uintptr_t *lookup, uint8_t **p)
+{
+    uint32_t addr = seg->base + off;
+    uint32_t page = addr & 0xfff;
+    uint32_t n;
+
+    if ((seg->base == 0xffffffff) || (lookup[addr >> 12] == (uintptr_t) LOOKUP_INV) || ((page + size) > 0x1000))
+        return 0;
+    if ((off < seg->limit_low) || (((uint64_t) off + size - 1) > seg->limit_high))
+        return 0;
+#ifdef USE_DEBUG_REGS_486
+    if (dr[7] & 0xFF)
+        return 0;
+#endif
+
+    if (cpu_state.flags & D_FLAG) {
+        n = page / size;
+        if (n > ((off - seg->limit_low) / size))
+            n = (off - seg->limit_low) / size;
+        n++;
+        if (n > count)
+            n = count;
+        addr -= (n - 1) * size;
+    } else {
+        n = (0x1000 - page) / size;
+        if (n > (((uint64_t) seg->limit_high - off + 1) / size))
+            n = ((uint64_t) seg->limit_high - off + 1) / size;
+        if (!addr32 && (n > ((0x10000 - off) / size)))
+            n = (0x10000 - off) / size;
+        if (n > count)
+            n = count;
+    }
+
+    *p = (uint8_t *) (lookup[addr >> 12] + (uintptr_t) addr);
+    return n;
+}
+
+/* Number of elements a bulk step may do before the REP slice runs out of its
+   cycle budget, matching where the per-element loop would stop. */
+static __inline uint32_t
+rep_bulk_max(uint32_t count, int budget, int cost)
+{
+    uint32_t n;
+
+    if (budget < 0)
+        return 0;
+    n = (budget / cost) + 1;
+    return (n < count) ? n : count;
+}
+
+/* Does up to count elements of REP MOVS with one host copy, returns how many
+   were done.  Overlapping runs are left to the per-element path. */
+static __inline uint32_t
+rep_bulk_movs(uint32_t src, uint32_t dest, uint32_t count, int size, int addr32)
+{
+    uint8_t *s = NULL;
+    uint8_t *d = NULL;
+    uint32_t n;
+
+    n = rep_bulk_span(cpu_state.ea_seg, src, count, size, addr32, readlookup2, &s);
+    if (n > 1)
+        n = rep_bulk_span(&cpu_state.seg_es, dest, n, size, addr32, writelookup2, &d);
+    /* A shorter destination run moves the lowest source byte when counting down. */
+    if ((n > 1) && (cpu_state.flags & D_FLAG))
+        n = rep_bulk_span(cpu_state.ea_seg, src, n, size, addr32, readlookup2, &s);
+    if ((n < 2) || ((d < (s + n * size)) && (s < (d + n * size))))
+        return 0;
+
+    memcpy(d, s, n * size);
+    return n;
+}
+
+/* Does up to count elements of REP STOS with one host fill, returns how many
+   were done. */
+static __inline uint32_t
+rep_bulk_stos(uint32_t dest, uint32_t count, int size, int addr32, uint32_t val)
+{
+    uint8_t *d = NULL;
+    uint32_t n;
+
+    n = rep_bulk_span(&cpu_state.seg_es, dest, count, size, addr32, writelookup2, &d);
+    if (n < 2)
+        return 0;
+
+    if (size == 1)
+        memset(d, val, n);
+    else {
+        for (uint32_t i = 0; i < n; i++)
+            memcpy(d + i * size, &val, size);
+    }
+    return n;
+}
+
 #ifdef OPS_286_386
 /* TODO: Introduce functions to read exec. */
 static __inline uint8_t
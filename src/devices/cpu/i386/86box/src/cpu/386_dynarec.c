@@ -56,6 +56,9 @@ int inrecomp                = 0;
 int cpu_block_end           = 0;
 int cpu_end_block_after_ins = 0;
 
+const i386_trace_hooks *cpu_trace = NULL;
+uint64_t                cpu_instructions = 0;
+
 #ifdef ENABLE_386_DYNAREC_LOG
 int x386_dynarec_do_log = ENABLE_386_DYNAREC_LOG;
 
@@ -190,6 +193,36 @@ fetch_ea_16_long(uint32_t rmdat)
 
 #include "x86_flags.h"
 
+/* Reports the instruction at CS:EIP to the trace hooks. Only the four
+   bytes the interpreter has already fetched are recorded, fetching more
+   could fault at the end of a page or segment. Recompiled code calls this
+   with the four bytes read at compile time. */
+void
+cpu_trace_instruction(uint32_t fetchdat)
+{
+    uint32_t regs[I386_TRACE_REG_COUNT];
+    uint8_t  bytes[4];
+
+    flags_rebuild();
+
+    regs[I386_TRACE_REG_EAX]    = EAX;
+    regs[I386_TRACE_REG_ECX]    = ECX;
+    regs[I386_TRACE_REG_EDX]    = EDX;
+    regs[I386_TRACE_REG_EBX]    = EBX;
+    regs[I386_TRACE_REG_ESP]    = ESP;
+    regs[I386_TRACE_REG_EBP]    = EBP;
+    regs[I386_TRACE_REG_ESI]    = ESI;
+    regs[I386_TRACE_REG_EDI]    = EDI;
+    regs[I386_TRACE_REG_EFLAGS] = cpu_state.flags | ((uint32_t) cpu_state.eflags << 16);
+
+    bytes[0] = fetchdat & 0xff;
+    bytes[1] = (fetchdat >> 8) & 0xff;
+    bytes[2] = (fetchdat >> 16) & 0xff;
+    bytes[3] = fetchdat >> 24;
+
+    cpu_trace->instruction(cpu_trace->opaque, cs + cpu_state.pc, CS, bytes, 4, regs);
+}
+
 #define PREFETCH_RUN(instr_cycles, bytes, modrm, reads, reads_l, writes, writes_l, ea32)      \
     do {                                                                                      \
         if (cpu_prefetch_cycles)                                                              \
@@ -300,6 +333,9 @@ exec386_dynarec_int(void)
 #    endif
 
         if (!cpu_state.abrt) {
+            if (cpu_trace)
+                cpu_trace_instruction(fetchdat);
+
             opcode = fetchdat & 0xFF;
             fetchdat >>= 8;
 
@@ -310,6 +346,7 @@ exec386_dynarec_int(void)
 #    endif
 
             cpu_state.pc++;
+            cpu_instructions++;
 #    ifdef USE_DEBUG_REGS_486
             cpu_state.eflags &= ~(RF_FLAG);
 #    endif
@@ -510,6 +547,7 @@ exec386_dynarec_dyn(void)
 #    endif
         inrecomp = 1;
         code();
+        cpu_instructions += block->ins;
 #    ifdef USE_ACYCS
         acycs = 0;
 #    endif
@@ -556,10 +594,14 @@ exec386_dynarec_dyn(void)
 #    endif
 
             if (!cpu_state.abrt) {
+                if (cpu_trace)
+                    cpu_trace_instruction(fetchdat);
+
                 opcode = fetchdat & 0xFF;
                 fetchdat >>= 8;
 
                 cpu_state.pc++;
+                cpu_instructions++;
 
                 codegen_generate_call(opcode, x86_opcodes[(opcode | cpu_state.op32) & 0x3ff], fetchdat, cpu_state.pc, cpu_state.pc - 1);
 
@@ -660,10 +702,14 @@ exec386_dynarec_dyn(void)
 #    endif
 
             if (!cpu_state.abrt) {
+                if (cpu_trace)
+                    cpu_trace_instruction(fetchdat);
+
                 opcode = fetchdat & 0xFF;
                 fetchdat >>= 8;
 
                 cpu_state.pc++;
+                cpu_instructions++;
 
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
 
@@ -764,7 +810,11 @@ exec386_dynarec(int32_t cycs)
             cycles_old       = cycles;
             oldtsc           = tsc;
             tsc_old          = tsc;
-            if ((!CACHE_ON()) || cpu_override_dynarec) /*Interpret block*/
+#    ifdef USE_NEW_DYNAREC
+            if ((!CACHE_ON()) || cpu_override_dynarec || (cpu_trace && cpu_trace->memory)) /*Interpret block*/
+#    else
+            if ((!CACHE_ON()) || cpu_override_dynarec || cpu_trace) /*Interpret block*/
+#    endif
             {
                 exec386_dynarec_int();
             } else {
@@ -924,6 +974,9 @@ exec386(int32_t cycs)
                 if (in_smm)
                     x386_dynarec_log("[%04X:%08X] %08X\n", CS, cpu_state.pc, fetchdat);
 #endif
+                if (cpu_trace)
+                    cpu_trace_instruction(fetchdat);
+
                 opcode = fetchdat & 0xFF;
                 fetchdat >>= 8;
 #ifdef USE_DEBUG_REGS_486
@@ -933,6 +986,7 @@ exec386(int32_t cycs)
 #endif
 
                 cpu_state.pc++;
+                cpu_instructions++;
 #ifdef USE_DEBUG_REGS_486
                 cpu_state.eflags &= ~(RF_FLAG);
 #endif
@@ -0,0 +1,60 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(__unix__) || defined(__APPLE__)
+#    include <unistd.h>
+#endif
+
+#include "codegen_perfmap.h"
+
+int codegen_perfmap_enabled = 0;
+
+static FILE *perfmap_file = NULL;
+static int   perfmap_initialized = 0;
+
+void
+codegen_perfmap_init(void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    const char *env;
+    char        path[64];
+
+    if (perfmap_initialized)
+        return;
+    perfmap_initialized = 1;
+
+    env = getenv("X86EMU_PERF_MAP");
+    if (!env || !atoi(env))
+        return;
+
+    snprintf(path, sizeof(path), "/tmp/perf-%ld.map", (long) getpid());
+    perfmap_file = fopen(path, "w");
+    if (!perfmap_file)
+        return;
+
+    /*Blocks are translated at a high rate; buffer writes and flush at exit*/
+    setvbuf(perfmap_file, NULL, _IOFBF, 1 << 16);
+    atexit(codegen_perfmap_close);
+    codegen_perfmap_enabled = 1;
+#endif
+}
+
+void
+codegen_perfmap_close(void)
+{
+    if (perfmap_file) {
+        fclose(perfmap_file);
+        perfmap_file = NULL;
+    }
+    codegen_perfmap_enabled = 0;
+}
+
+void
+codegen_perfmap_add(const void *code, int size, uint32_t pc)
+{
+    if (!perfmap_file || size <= 0)
+        return;
+
+    fprintf(perfmap_file, "%" PRIxPTR " %x x86:%08x\n", (uintptr_t) code, size, pc);
+}
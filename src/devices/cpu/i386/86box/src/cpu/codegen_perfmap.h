@@ -0,0 +1,25 @@
+#ifndef _CODEGEN_PERFMAP_H_
+#define _CODEGEN_PERFMAP_H_
+
+#include <stdint.h>
+
+/*Linux perf map support for recompiled code.
+
+  When the X86EMU_PERF_MAP environment variable is set to a non-zero value,
+  every translated block is recorded in /tmp/perf-<pid>.map as
+  "<host start> <size> x86:<guest linear pc>", which lets perf report and
+  perf script attribute samples taken inside the code cache to guest code.
+
+  Code cache memory is reused, so a host range may appear several times;
+  perf uses the most recent entry covering a sample address.*/
+
+extern int codegen_perfmap_enabled;
+
+/*Open the map file if enabled by the environment. Safe to call repeatedly*/
+void codegen_perfmap_init(void);
+/*Flush and close the map file*/
+void codegen_perfmap_close(void);
+/*Record a range of generated host code for the block at guest address pc*/
+void codegen_perfmap_add(const void *code, int size, uint32_t pc);
+
+#endif
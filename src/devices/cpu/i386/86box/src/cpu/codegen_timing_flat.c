@@ -0,0 +1,60 @@
+/*
+ * Flat timing model for the recompiler.
+ *
+ * Every instruction costs one cycle, regardless of CPU model, operands or
+ * pairing. Used instead of the per-model tables when cpu_flat_timing is
+ * set, trading cycle accuracy for cheaper block compilation.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/plat_unused.h>
+
+#include "x86.h"
+#include "x86_ops.h"
+#include "x87_sf.h"
+#include "x87.h"
+#include "codegen.h"
+
+static void
+codegen_timing_flat_start(void)
+{
+    //
+}
+
+static void
+codegen_timing_flat_prefix(UNUSED(uint8_t prefix), UNUSED(uint32_t fetchdat))
+{
+    //
+}
+
+static void
+codegen_timing_flat_opcode(UNUSED(uint8_t opcode), UNUSED(uint32_t fetchdat), UNUSED(int op_32), UNUSED(uint32_t op_pc))
+{
+    codegen_block_cycles++;
+}
+
+static void
+codegen_timing_flat_block_start(void)
+{
+    //
+}
+
+static void
+codegen_timing_flat_block_end(void)
+{
+    //
+}
+
+codegen_timing_t codegen_timing_flat = {
+    codegen_timing_flat_start,
+    codegen_timing_flat_prefix,
+    codegen_timing_flat_opcode,
+    codegen_timing_flat_block_start,
+    codegen_timing_flat_block_end,
+    NULL
+};
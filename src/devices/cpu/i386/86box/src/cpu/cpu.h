@@ -21,6 +21,8 @@
 #ifndef EMU_CPU_H
 #define EMU_CPU_H
 
+#include "../../../common/i386_trace.h"
+
 enum {
     FPU_NONE,
     FPU_8087,
@@ -829,6 +831,15 @@ extern uint16_t *MMEP[8];
 extern int  cpu_block_end;
 extern int  cpu_override_dynarec;
 
+/* Instruction trace hooks, NULL unless tracing. Memory tracing runs the
+   interpreter; register-only tracing keeps the new recompiler, which calls
+   cpu_trace_instruction() ahead of every instruction it emits. */
+extern const i386_trace_hooks *cpu_trace;
+extern void                    cpu_trace_instruction(uint32_t fetchdat);
+
+/* Instructions retired; recompiled blocks count their full length. */
+extern uint64_t cpu_instructions;
+
 extern void mmx_init(void);
 extern void prefetch_flush(void);
 
@@ -1,6 +1,7 @@
-#define REP_OPS(size, CNT_REG, SRC_REG, DEST_REG)                                                                 \
+#define REP_OPS(size, CNT_REG, SRC_REG, DEST_REG, ADDR32)                                                         \
     static int opREP_INSB_##size(UNUSED(uint32_t fetchdat))                                                       \
     {                                                                                                             \
+        int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);                                      \
         addr64 = 0x00000000;                                                                                      \
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
@@ -24,6 +25,19 @@
                 DEST_REG++;                                                                                       \
             CNT_REG--;                                                                                            \
             cycles -= 15;                                                                                         \
+            if ((CNT_REG > 1) && !(cpu_state.flags & D_FLAG) && !trap) {                                          \
+                uint8_t *p;                                                                                       \
+                uint32_t bulk;                                                                                    \
+                                                                                                                  \
+                bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, 15);                                            \
+                bulk = rep_bulk_span(&cpu_state.seg_es, DEST_REG, bulk, 1, ADDR32, writelookup2, &p);             \
+                if (bulk > 1) {                                                                                   \
+                    inb_block(DX, p, bulk);                                                                       \
+                    DEST_REG += bulk;                                                                             \
+                    CNT_REG -= bulk;                                                                              \
+                    cycles -= (int) bulk * 15;                                                                    \
+                }                                                                                                 \
+            }                                                                                                     \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -34,6 +48,7 @@
     }                                                                                                             \
     static int opREP_INSW_##size(UNUSED(uint32_t fetchdat))                                                       \
     {                                                                                                             \
+        int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);                                      \
         addr64a[0] = addr64a[1] = 0x00000000;                                                                     \
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
@@ -57,6 +72,19 @@
                 DEST_REG += 2;                                                                                    \
             CNT_REG--;                                                                                            \
             cycles -= 15;                                                                                         \
+            if ((CNT_REG > 1) && !(cpu_state.flags & D_FLAG) && !trap) {                                          \
+                uint8_t *p;                                                                                       \
+                uint32_t bulk;                                                                                    \
+                                                                                                                  \
+                bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, 15);                                            \
+                bulk = rep_bulk_span(&cpu_state.seg_es, DEST_REG, bulk, 2, ADDR32, writelookup2, &p);             \
+                if (bulk > 1) {                                                                                   \
+                    inw_block(DX, p, bulk);                                                                       \
+                    DEST_REG += bulk * 2;                                                                         \
+                    CNT_REG -= bulk;                                                                              \
+                    cycles -= (int) bulk * 15;                                                                    \
+                }                                                                                                 \
+            }                                                                                                     \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -67,6 +95,7 @@
     }                                                                                                             \
     static int opREP_INSL_##size(UNUSED(uint32_t fetchdat))                                                       \
     {                                                                                                             \
+        int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);                                      \
         addr64a[0] = addr64a[1] = addr64a[2] = addr64a[3] = 0x00000000;                                           \
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
@@ -90,6 +119,19 @@
                 DEST_REG += 4;                                                                                    \
             CNT_REG--;                                                                                            \
             cycles -= 15;                                                                                         \
+            if ((CNT_REG > 1) && !(cpu_state.flags & D_FLAG) && !trap) {                                          \
+                uint8_t *p;                                                                                       \
+                uint32_t bulk;                                                                                    \
+                                                                                                                  \
+                bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, 15);                                            \
+                bulk = rep_bulk_span(&cpu_state.seg_es, DEST_REG, bulk, 4, ADDR32, writelookup2, &p);             \
+                if (bulk > 1) {                                                                                   \
+                    inl_block(DX, p, bulk);                                                                       \
+                    DEST_REG += bulk * 4;                                                                         \
+                    CNT_REG -= bulk;                                                                              \
+                    cycles -= (int) bulk * 15;                                                                    \
+                }                                                                                                 \
+            }                                                                                                     \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -101,6 +143,7 @@
                                                                                                                   \
     static int opREP_OUTSB_##size(UNUSED(uint32_t fetchdat))                                                      \
     {                                                                                                             \
+        int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);                                      \
         if (CNT_REG > 0) {                                                                                        \
             uint8_t temp;                                                                                         \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
@@ -116,6 +159,19 @@
                 SRC_REG++;                                                                                        \
             CNT_REG--;                                                                                            \
             cycles -= 14;                                                                                         \
+            if ((CNT_REG > 1) && !(cpu_state.flags & D_FLAG) && !trap) {                                          \
+                uint8_t *p;                                                                                       \
+                uint32_t bulk;                                                                                    \
+                                                                                                                  \
+                bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, 14);                                            \
+                bulk = rep_bulk_span(cpu_state.ea_seg, SRC_REG, bulk, 1, ADDR32, readlookup2, &p);                \
+                if (bulk > 1) {                                                                                   \
+                    outb_block(DX, p, bulk);                                                                      \
+                    SRC_REG += bulk;                                                                              \
+                    CNT_REG -= bulk;                                                                              \
+                    cycles -= (int) bulk * 14;                                                                    \
+                }                                                                                                 \
+            }                                                                                                     \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -126,6 +182,7 @@
     }                                                                                                             \
     static int opREP_OUTSW_##size(UNUSED(uint32_t fetchdat))                                                      \
     {                                                                                                             \
+        int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);                                      \
         if (CNT_REG > 0) {                                                                                        \
             uint16_t temp;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
@@ -141,6 +198,19 @@
                 SRC_REG += 2;                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= 14;                                                                                         \
+            if ((CNT_REG > 1) && !(cpu_state.flags & D_FLAG) && !trap) {                                          \
+                uint8_t *p;                                                                                       \
+                uint32_t bulk;                                                                                    \
+                                                                                                                  \
+                bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, 14);                                            \
+                bulk = rep_bulk_span(cpu_state.ea_seg, SRC_REG, bulk, 2, ADDR32, readlookup2, &p);                \
+                if (bulk > 1) {                                                                                   \
+                    outw_block(DX, p, bulk);                                                                      \
+                    SRC_REG += bulk * 2;                                                                          \
+                    CNT_REG -= bulk;                                                                              \
+                    cycles -= (int) bulk * 14;                                                                    \
+                }                                                                                                 \
+            }                                                                                                     \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -151,6 +221,7 @@
     }                                                                                                             \
     static int opREP_OUTSL_##size(UNUSED(uint32_t fetchdat))                                                      \
     {                                                                                                             \
+        int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);                                      \
         if (CNT_REG > 0) {                                                                                        \
             uint32_t temp;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
@@ -166,6 +237,19 @@
                 SRC_REG += 4;                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= 14;                                                                                         \
+            if ((CNT_REG > 1) && !(cpu_state.flags & D_FLAG) && !trap) {                                          \
+                uint8_t *p;                                                                                       \
+                uint32_t bulk;                                                                                    \
+                                                                                                                  \
+                bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, 14);                                            \
+                bulk = rep_bulk_span(cpu_state.ea_seg, SRC_REG, bulk, 4, ADDR32, readlookup2, &p);                \
+                if (bulk > 1) {                                                                                   \
+                    outl_block(DX, p, bulk);                                                                      \
+                    SRC_REG += bulk * 4;                                                                          \
+                    CNT_REG -= bulk;                                                                              \
+                    cycles -= (int) bulk * 14;                                                                    \
+                }                                                                                                 \
+            }                                                                                                     \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -187,9 +271,26 @@
         }                                                                                                         \
         while (CNT_REG > 0) {                                                                                     \
             uint8_t temp;                                                                                         \
+            uint32_t bulk;                                                                                        \
                                                                                                                   \
             CHECK_READ_REP(cpu_state.ea_seg, SRC_REG, SRC_REG);                                                   \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG);                                               \
+            bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, is486 ? 3 : 4);                                     \
+            bulk = rep_bulk_movs(SRC_REG, DEST_REG, bulk, 1, ADDR32);                                             \
+            if (bulk) {                                                                                           \
+                if (cpu_state.flags & D_FLAG) {                                                                   \
+                    DEST_REG -= bulk;                                                                             \
+                    SRC_REG -= bulk;                                                                              \
+                } else {                                                                                          \
+                    DEST_REG += bulk;                                                                             \
+                    SRC_REG += bulk;                                                                              \
+                }                                                                                                 \
+                CNT_REG -= bulk;                                                                                  \
+                cycles -= (int) bulk * (is486 ? 3 : 4);                                                           \
+                if (cycles < cycles_end)                                                                          \
+                    break;                                                                                        \
+                continue;                                                                                         \
+            }                                                                                                     \
             high_page = 0;                                                                                        \
             do_mmut_rb(cpu_state.ea_seg->base, SRC_REG, &addr64);                                                 \
             if (cpu_state.abrt)                                                                                   \
@@ -236,9 +337,26 @@
         }                                                                                                         \
         while (CNT_REG > 0) {                                                                                     \
             uint16_t temp;                                                                                        \
+            uint32_t bulk;                                                                                        \
                                                                                                                   \
             CHECK_READ_REP(cpu_state.ea_seg, SRC_REG, SRC_REG + 1UL);                                             \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG + 1UL);                                         \
+            bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, is486 ? 3 : 4);                                     \
+            bulk = rep_bulk_movs(SRC_REG, DEST_REG, bulk, 2, ADDR32);                                             \
+            if (bulk) {                                                                                           \
+                if (cpu_state.flags & D_FLAG) {                                                                   \
+                    DEST_REG -= bulk * 2;                                                                         \
+                    SRC_REG -= bulk * 2;                                                                          \
+                } else {                                                                                          \
+                    DEST_REG += bulk * 2;                                                                         \
+                    SRC_REG += bulk * 2;                                                                          \
+                }                                                                                                 \
+                CNT_REG -= bulk;                                                                                  \
+                cycles -= (int) bulk * (is486 ? 3 : 4);                                                           \
+                if (cycles < cycles_end)                                                                          \
+                    break;                                                                                        \
+                continue;                                                                                         \
+            }                                                                                                     \
             high_page = 0;                                                                                        \
             do_mmut_rw(cpu_state.ea_seg->base, SRC_REG, addr64a);                                                 \
             if (cpu_state.abrt)                                                                                   \
@@ -285,9 +403,26 @@
         }                                                                                                         \
         while (CNT_REG > 0) {                                                                                     \
             uint32_t temp;                                                                                        \
+            uint32_t bulk;                                                                                        \
                                                                                                                   \
             CHECK_READ_REP(cpu_state.ea_seg, SRC_REG, SRC_REG + 3UL);                                             \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG + 3UL);                                         \
+            bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, is486 ? 3 : 4);                                     \
+            bulk = rep_bulk_movs(SRC_REG, DEST_REG, bulk, 4, ADDR32);                                             \
+            if (bulk) {                                                                                           \
+                if (cpu_state.flags & D_FLAG) {                                                                   \
+                    DEST_REG -= bulk * 4;                                                                         \
+                    SRC_REG -= bulk * 4;                                                                          \
+                } else {                                                                                          \
+                    DEST_REG += bulk * 4;                                                                         \
+                    SRC_REG += bulk * 4;                                                                          \
+                }                                                                                                 \
+                CNT_REG -= bulk;                                                                                  \
+                cycles -= (int) bulk * (is486 ? 3 : 4);                                                           \
+                if (cycles < cycles_end)                                                                          \
+                    break;                                                                                        \
+                continue;                                                                                         \
+            }                                                                                                     \
             high_page = 0;                                                                                        \
             do_mmut_rl(cpu_state.ea_seg->base, SRC_REG, addr64a);                                                 \
             if (cpu_state.abrt)                                                                                   \
@@ -330,7 +465,22 @@
         if (CNT_REG > 0)                                                                                          \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         while (CNT_REG > 0) {                                                                                     \
+            uint32_t bulk;                                                                                        \
+                                                                                                                  \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG);                                               \
+            bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, is486 ? 4 : 5);                                     \
+            bulk = rep_bulk_stos(DEST_REG, bulk, 1, ADDR32, AL);                                                  \
+            if (bulk) {                                                                                           \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG -= bulk;                                                                             \
+                else                                                                                              \
+                    DEST_REG += bulk;                                                                             \
+                CNT_REG -= bulk;                                                                                  \
+                cycles -= (int) bulk * (is486 ? 4 : 5);                                                           \
+                if (cycles < cycles_end)                                                                          \
+                    break;                                                                                        \
+                continue;                                                                                         \
+            }                                                                                                     \
             writememb(es, DEST_REG, AL);                                                                          \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
@@ -358,7 +508,22 @@
         if (CNT_REG > 0)                                                                                          \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         while (CNT_REG > 0) {                                                                                     \
+            uint32_t bulk;                                                                                        \
+                                                                                                                  \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG + 1UL);                                         \
+            bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, is486 ? 4 : 5);                                     \
+            bulk = rep_bulk_stos(DEST_REG, bulk, 2, ADDR32, AX);                                                  \
+            if (bulk) {                                                                                           \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG -= bulk * 2;                                                                         \
+                else                                                                                              \
+                    DEST_REG += bulk * 2;                                                                         \
+                CNT_REG -= bulk;                                                                                  \
+                cycles -= (int) bulk * (is486 ? 4 : 5);                                                           \
+                if (cycles < cycles_end)                                                                          \
+                    break;                                                                                        \
+                continue;                                                                                         \
+            }                                                                                                     \
             writememw(es, DEST_REG, AX);                                                                          \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
@@ -386,7 +551,22 @@
         if (CNT_REG > 0)                                                                                          \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         while (CNT_REG > 0) {                                                                                     \
+            uint32_t bulk;                                                                                        \
+                                                                                                                  \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG + 3UL);                                         \
+            bulk = rep_bulk_max(CNT_REG, cycles - cycles_end, is486 ? 4 : 5);                                     \
+            bulk = rep_bulk_stos(DEST_REG, bulk, 4, ADDR32, EAX);                                                 \
+            if (bulk) {                                                                                           \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG -= bulk * 4;                                                                         \
+                else                                                                                              \
+                    DEST_REG += bulk * 4;                                                                         \
+                CNT_REG -= bulk;                                                                                  \
+                cycles -= (int) bulk * (is486 ? 4 : 5);                                                           \
+                if (cycles < cycles_end)                                                                          \
+                    break;                                                                                        \
+                continue;                                                                                         \
+            }                                                                                                     \
             writememl(es, DEST_REG, EAX);                                                                         \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
@@ -745,8 +925,8 @@
         return cpu_state.abrt;                                                                                    \
     }
 
-REP_OPS(a16, CX, SI, DI)
-REP_OPS(a32, ECX, ESI, EDI)
+REP_OPS(a16, CX, SI, DI, 0)
+REP_OPS(a32, ECX, ESI, EDI, 1)
 REP_OPS_CMPS_SCAS(a16_NE, CX, SI, DI, 0)
 REP_OPS_CMPS_SCAS(a16_E, CX, SI, DI, 1)
 REP_OPS_CMPS_SCAS(a32_NE, ECX, ESI, EDI, 0)
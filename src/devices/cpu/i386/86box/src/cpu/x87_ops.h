@@ -532,6 +532,7 @@ typedef union {
 
 #include "softfloat3e/softfloat-specialize.h"
 #include "softfloat3e/fpu_trans.h"
+#include "x87_ops_sf_fast.h"
 
 #include "x87_ops_sf_arith.h"
 #include "x87_ops_sf_compare.h"
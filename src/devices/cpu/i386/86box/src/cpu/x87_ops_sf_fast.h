@@ -0,0 +1,97 @@
+/*
+ * Host-native fast path for the softfloat FPU.
+ *
+ * When fpu_fast is set, FADD/FSUB/FMUL/FDIV/FSQRT evaluate with host
+ * long double (extended precision control) or double (double precision
+ * control) arithmetic if the rounding mode is round-to-nearest and all
+ * operands and the result are ordinary normal numbers. Precision loss
+ * and the C1 round-up bit are reported exactly as softfloat would.
+ * Everything else, including single precision control, goes through
+ * the regular extF80 routines.
+ */
+#ifndef EMU_X87_OPS_SF_FAST_H
+#define EMU_X87_OPS_SF_FAST_H
+
+#include "../../../common/x87_fast_math.h"
+
+static __inline int
+x87_fast_op(int op, extFloat80_t a, extFloat80_t b, extFloat80_t *r, struct softfloat_status_t *status)
+{
+    int prec;
+    int flags;
+
+    if (status->softfloat_roundingMode != softfloat_round_near_even)
+        return 0;
+
+    switch (status->extF80_roundingPrecision) {
+        case 80:
+            prec = X87_FAST_PREC_EXTENDED;
+            break;
+        case 64:
+            prec = X87_FAST_PREC_DOUBLE;
+            break;
+        default:
+            return 0;
+    }
+
+    if (!x87_fast_calc(op, prec, a.signif, a.signExp, b.signif, b.signExp, &r->signif, &r->signExp, &flags))
+        return 0;
+
+    if (flags & X87_FAST_INEXACT)
+        softfloat_raiseFlags(status, softfloat_flag_inexact);
+    if (flags & X87_FAST_ROUNDUP)
+        softfloat_setRoundingUp(status);
+    return 1;
+}
+
+static __inline extFloat80_t
+x87_fast_add(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_fast && x87_fast_op(X87_FAST_ADD, a, b, &r, status))
+        return r;
+    return extF80_add(a, b, status);
+}
+
+static __inline extFloat80_t
+x87_fast_sub(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_fast && x87_fast_op(X87_FAST_SUB, a, b, &r, status))
+        return r;
+    return extF80_sub(a, b, status);
+}
+
+static __inline extFloat80_t
+x87_fast_mul(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_fast && x87_fast_op(X87_FAST_MUL, a, b, &r, status))
+        return r;
+    return extF80_mul(a, b, status);
+}
+
+static __inline extFloat80_t
+x87_fast_div(extFloat80_t a, extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_fast && x87_fast_op(X87_FAST_DIV, a, b, &r, status))
+        return r;
+    return extF80_div(a, b, status);
+}
+
+static __inline extFloat80_t
+x87_fast_sqrt(extFloat80_t a, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_fast && x87_fast_op(X87_FAST_SQRT, a, a, &r, status))
+        return r;
+    return extF80_sqrt(a, status);
+}
+
+#endif /*EMU_X87_OPS_SF_FAST_H*/
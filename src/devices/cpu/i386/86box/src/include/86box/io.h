@@ -110,6 +110,13 @@ extern void     outw(uint16_t port, uint16_t val);
 extern uint32_t inl(uint16_t port);
 extern void     outl(uint16_t port, uint32_t val);
 
+extern void inb_block(uint16_t port, uint8_t *buf, uint32_t count);
+extern void inw_block(uint16_t port, uint8_t *buf, uint32_t count);
+extern void inl_block(uint16_t port, uint8_t *buf, uint32_t count);
+extern void outb_block(uint16_t port, const uint8_t *buf, uint32_t count);
+extern void outw_block(uint16_t port, const uint8_t *buf, uint32_t count);
+extern void outl_block(uint16_t port, const uint8_t *buf, uint32_t count);
+
 extern void *io_trap_add(void (*func)(int size, uint16_t addr, uint8_t write, uint8_t val, void *priv),
                          void *priv);
 extern void  io_trap_remap(void *handle, int enable, uint16_t addr, uint16_t size);
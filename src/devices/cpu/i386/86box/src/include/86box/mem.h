@@ -439,6 +439,8 @@ extern int mem_addr_is_ram(uint32_t addr);
 extern uint64_t mmutranslate_noabrt(uint32_t addr, int rw);
 
 extern void mem_invalidate_range(uint32_t start_addr, uint32_t end_addr);
+extern void mem_set_code_write_handler(void (*handler)(uint32_t addr, int size, void *priv), void *priv);
+extern void mem_watch_code_page(uint32_t addr, int watch);
 
 extern void mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page);
 extern void mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page);
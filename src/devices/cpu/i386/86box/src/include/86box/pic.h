@@ -86,6 +86,8 @@ extern uint8_t pic_read_ocw(uint8_t pic_id, uint8_t ocw);
 extern int     picint_is_level(int irq);
 extern void    picint_common(uint16_t num, int level, int set, uint8_t *irq_state);
 extern int     picinterrupt(void);
+extern void    pic_set_lapic(int (*ack)(void *priv), void *priv);
+extern void    pic_set_lapic_pending(int pending);
 
 #define PIC_IRQ_EDGE                    0
 #define PIC_IRQ_LEVEL                   1
@@ -812,6 +812,153 @@ outl(uint16_t port, uint32_t val)
     return;
 }
 
+/* Returns the only handler claiming the given port when a block transfer of
+   the given width can call it directly.  That is the case when no PCI config
+   window or Amstrad latch is involved and in*()/out*() would not merge any
+   narrower handler into the access, so calling the handler in a loop gives
+   exactly the same results. */
+static io_t *
+io_block_handler(uint16_t port, int size, int write)
+{
+    io_t *p;
+    io_t *q;
+
+#ifdef USE_DEBUG_REGS_486
+    if (dr[7] & 0xFF)
+        return NULL;
+#endif
+
+    if (amstrad_latch & 0x80000000)
+        return NULL;
+    if ((pci_flags & FLAG_CONFIG_IO_ON) && ((port + size) > pci_base) && (port < (pci_base + pci_size)))
+        return NULL;
+    if ((pci_flags & FLAG_CONFIG_DEV0_IO_ON) && ((port + size) > 0xc000) && (port < 0xc100))
+        return NULL;
+
+    p = io[port];
+    if (!p || p->next)
+        return NULL;
+
+    for (int i = 0; i < size; i++) {
+        for (q = io[(port + i) & 0xffff]; q; q = q->next) {
+            switch (size) {
+                case 1:
+                    if (write ? !q->outb : !q->inb)
+                        return NULL;
+                    break;
+                case 2:
+                    if (write ? (!q->outw && q->outb) : (!q->inw && q->inb))
+                        return NULL;
+                    if (!i && (write ? !q->outw : !q->inw))
+                        return NULL;
+                    break;
+                default:
+                    if (write ? (!q->outl && (q->outw || q->outb)) : (!q->inl && (q->inw || q->inb)))
+                        return NULL;
+                    if (!i && (write ? !q->outl : !q->inl))
+                        return NULL;
+                    break;
+            }
+        }
+    }
+
+    return p;
+}
+
+/* Block transfers for REP INS/OUTS.  Elements are stored in guest (little
+   endian) order at buf, count is the number of elements. */
+void
+inb_block(uint16_t port, uint8_t *buf, uint32_t count)
+{
+    io_t *p = io_block_handler(port, 1, 0);
+
+    if (p) {
+        io_port = port;
+        for (uint32_t i = 0; i < count; i++)
+            buf[i] = p->inb(port, p->priv);
+    } else {
+        for (uint32_t i = 0; i < count; i++)
+            buf[i] = inb(port);
+    }
+}
+
+void
+inw_block(uint16_t port, uint8_t *buf, uint32_t count)
+{
+    io_t    *p = io_block_handler(port, 2, 0);
+    uint16_t val;
+
+    if (p)
+        io_port = port;
+    for (uint32_t i = 0; i < count; i++) {
+        val = p ? p->inw(port, p->priv) : inw(port);
+        memcpy(&buf[i << 1], &val, 2);
+    }
+}
+
+void
+inl_block(uint16_t port, uint8_t *buf, uint32_t count)
+{
+    io_t    *p = io_block_handler(port, 4, 0);
+    uint32_t val;
+
+    if (p)
+        io_port = port;
+    for (uint32_t i = 0; i < count; i++) {
+        val = p ? p->inl(port, p->priv) : inl(port);
+        memcpy(&buf[i << 2], &val, 4);
+    }
+}
+
+void
+outb_block(uint16_t port, const uint8_t *buf, uint32_t count)
+{
+    io_t *p = io_block_handler(port, 1, 1);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (p) {
+            io_port = port;
+            io_val  = buf[i];
+            p->outb(port, buf[i], p->priv);
+        } else
+            outb(port, buf[i]);
+    }
+}
+
+void
+outw_block(uint16_t port, const uint8_t *buf, uint32_t count)
+{
+    io_t    *p = io_block_handler(port, 2, 1);
+    uint16_t val;
+
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(&val, &buf[i << 1], 2);
+        if (p) {
+            io_port = port;
+            io_val  = val;
+            p->outw(port, val, p->priv);
+        } else
+            outw(port, val);
+    }
+}
+
+void
+outl_block(uint16_t port, const uint8_t *buf, uint32_t count)
+{
+    io_t    *p = io_block_handler(port, 4, 1);
+    uint32_t val;
+
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(&val, &buf[i << 2], 4);
+        if (p) {
+            io_port = port;
+            io_val  = val;
+            p->outl(port, val, p->priv);
+        } else
+            outl(port, val);
+    }
+}
+
 static uint8_t
 io_trap_readb(uint16_t addr, void *priv)
 {
@@ -308,6 +308,29 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
 #define rammap(x)                ((uint32_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 2) & MEM_GRANULARITY_QMASK]
 #define rammap64(x)              ((uint64_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 3) & MEM_GRANULARITY_PMASK]
 
+/* Report a data access to the instruction tracer. Reads carry no value. */
+#define MEM_TRACE(addr, size, write, val)                                                      \
+    do {                                                                                      \
+        if (cpu_trace && cpu_trace->memory)                                                   \
+            cpu_trace->memory(cpu_trace->opaque, addr, size, write, write, (uint64_t) (val)); \
+    } while (0)
+
+/* Pages holding code translated by an external code cache, one bit per 4 KB
+   page. Stores to them never take the write lookup fast path and are
+   reported to the code write handler. */
+static uint32_t code_watch_map[(1 << 20) / 32];
+static void   (*code_write_handler)(uint32_t addr, int size, void *priv) = NULL;
+static void    *code_write_priv = NULL;
+
+#define mem_code_watched(addr) (code_watch_map[(addr) >> 17] & (1U << (((addr) >> 12) & 31)))
+
+static __inline void
+mem_code_write(uint32_t addr, int size)
+{
+    if (code_write_handler && mem_code_watched(addr))
+        code_write_handler(addr, size, code_write_priv);
+}
+
 static __inline uint64_t
 mmutranslatereal_normal(uint32_t addr, int rw)
 {
@@ -609,7 +632,8 @@ addreadlookup(uint32_t virt, uint32_t phys)
     uint32_t a;
 #endif
 
-    if (virt == 0xffffffff)
+    /* Keep every data access on the slow paths while tracing. */
+    if ((virt == 0xffffffff) || (cpu_trace && cpu_trace->memory))
         return;
 
     if (readlookup2[virt >> 12] != (uintptr_t) LOOKUP_INV)
@@ -646,7 +670,7 @@ addwritelookup(uint32_t virt, uint32_t phys)
     uint32_t a;
 #endif
 
-    if (virt == 0xffffffff)
+    if ((virt == 0xffffffff) || (cpu_trace && cpu_trace->memory))
         return;
 
     if (page_lookup[virt >> 12])
@@ -659,15 +683,15 @@ addwritelookup(uint32_t virt, uint32_t phys)
 
 #ifdef USE_NEW_DYNAREC
 #    ifdef USE_DYNAREC
-    if (pages[phys >> 12].block || (phys & ~0xfff) == recomp_page) {
+    if (pages[phys >> 12].block || (phys & ~0xfff) == recomp_page || mem_code_watched(phys)) {
 #    else
-    if (pages[phys >> 12].block) {
+    if (pages[phys >> 12].block || mem_code_watched(phys)) {
 #    endif
 #else
 #    ifdef USE_DYNAREC
-    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || (phys & ~0xfff) == recomp_page) {
+    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || (phys & ~0xfff) == recomp_page || mem_code_watched(phys)) {
 #    else
-    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3]) {
+    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || mem_code_watched(phys)) {
 #    endif
 #endif
         page_lookup[virt >> 12]  = &pages[phys >> 12];
@@ -827,6 +851,7 @@ readmembl(uint32_t addr)
     uint64_t       a;
 
     GDBSTUB_MEM_ACCESS(addr, GDBSTUB_MEM_READ, 1);
+    MEM_TRACE(addr, 1, 0, 0);
 #ifdef USE_DEBUG_REGS_486
     mem_debug_check_addr(addr, read_type);
 #endif
@@ -859,6 +884,7 @@ writemembl(uint32_t addr, uint8_t val)
     uint64_t       a;
 
     GDBSTUB_MEM_ACCESS(addr, GDBSTUB_MEM_WRITE, 1);
+    MEM_TRACE(addr, 1, 1, val);
 #ifdef USE_DEBUG_REGS_486
     mem_debug_check_addr(addr, 2);
 #endif
@@ -894,6 +920,7 @@ readmembl_no_mmut(uint32_t addr, uint32_t a64)
     mem_mapping_t *map;
 
     GDBSTUB_MEM_ACCESS(addr, GDBSTUB_MEM_READ, 1);
+    MEM_TRACE(addr, 1, 0, 0);
 
     mem_logical_addr = addr;
 
@@ -919,6 +946,7 @@ writemembl_no_mmut(uint32_t addr, uint32_t a64, uint8_t val)
     mem_mapping_t *map;
 
     GDBSTUB_MEM_ACCESS(addr, GDBSTUB_MEM_WRITE, 1);
+    MEM_TRACE(addr, 1, 1, val);
 
     mem_logical_addr = addr;
 
@@ -953,6 +981,7 @@ readmemwl(uint32_t addr)
     mem_debug_check_addr(addr + 1, read_type);
 #endif
     GDBSTUB_MEM_ACCESS_FAST(addr64a, GDBSTUB_MEM_READ, 2);
+    MEM_TRACE(addr, 2, 0, 0);
 
     mem_logical_addr = addr;
 
@@ -1015,6 +1044,7 @@ writememwl(uint32_t addr, uint16_t val)
     mem_debug_check_addr(addr + 1, 2);
 #endif
     GDBSTUB_MEM_ACCESS_FAST(addr64a, GDBSTUB_MEM_WRITE, 2);
+    MEM_TRACE(addr, 2, 1, val);
 
     mem_logical_addr = addr;
 
@@ -1087,6 +1117,7 @@ readmemwl_no_mmut(uint32_t addr, uint32_t *a64)
     mem_mapping_t *map;
 
     GDBSTUB_MEM_ACCESS(addr, GDBSTUB_MEM_READ, 2);
+    MEM_TRACE(addr, 2, 0, 0);
 
     mem_logical_addr = addr;
 
@@ -1133,6 +1164,7 @@ writememwl_no_mmut(uint32_t addr, uint32_t *a64, uint16_t val)
     mem_mapping_t *map;
 
     GDBSTUB_MEM_ACCESS(addr, GDBSTUB_MEM_WRITE, 2);
+    MEM_TRACE(addr, 2, 1, val);
 
     mem_logical_addr = addr;
 
@@ -1197,6 +1229,7 @@ readmemll(uint32_t addr)
 #endif
     }
     GDBSTUB_MEM_ACCESS_FAST(addr64a, GDBSTUB_MEM_READ, 4);
+    MEM_TRACE(addr, 4, 0, 0);
 
     mem_logical_addr = addr;
 
@@ -1275,6 +1308,7 @@ writememll(uint32_t addr, uint32_t val)
 #endif
     }
     GDBSTUB_MEM_ACCESS_FAST(addr64a, GDBSTUB_MEM_WRITE, 4);
+    MEM_TRACE(addr, 4, 1, val);
 
     mem_logical_addr = addr;
 
@@ -1365,6 +1399,7 @@ readmemll_no_mmut(uint32_t addr, uint32_t *a64)
     mem_mapping_t *map;
 
     GDBSTUB_MEM_ACCESS(addr, GDBSTUB_MEM_READ, 4);
+    MEM_TRACE(addr, 4, 0, 0);
 
     mem_logical_addr = addr;
 
@@ -1413,6 +1448,7 @@ writememll_no_mmut(uint32_t addr, uint32_t *a64, uint32_t val)
     mem_mapping_t *map;
 
     GDBSTUB_MEM_ACCESS(addr, GDBSTUB_MEM_WRITE, 4);
+    MEM_TRACE(addr, 4, 1, val);
 
     mem_logical_addr = addr;
 
@@ -1483,6 +1519,7 @@ readmemql(uint32_t addr)
 #endif
     }
     GDBSTUB_MEM_ACCESS_FAST(addr64a, GDBSTUB_MEM_READ, 8);
+    MEM_TRACE(addr, 8, 0, 0);
 
     mem_logical_addr = addr;
 
@@ -1571,6 +1608,7 @@ writememql(uint32_t addr, uint64_t val)
 #endif
     }
     GDBSTUB_MEM_ACCESS_FAST(addr64a, GDBSTUB_MEM_WRITE, 8);
+    MEM_TRACE(addr, 8, 1, val);
 
     mem_logical_addr = addr;
 
@@ -1997,6 +2035,7 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page)
         page->byte_dirty_mask[byte_offset] |= byte_mask;
         if ((page->byte_code_present_mask[byte_offset] & byte_mask) && !page_in_evict_list(page))
             page_add_to_evict_list(page);
+        mem_code_write(addr, 1);
     }
 }
 
@@ -2032,6 +2071,7 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page)
 
         if ((page->byte_code_present_mask[byte_offset] & byte_mask) && !page_in_evict_list(page))
             page_add_to_evict_list(page);
+        mem_code_write(addr, 2);
     }
 }
 
@@ -2064,6 +2104,7 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
             if ((page->byte_code_present_mask[byte_offset + 1] & byte_mask_2) && !page_in_evict_list(page))
                 page_add_to_evict_list(page);
         }
+        mem_code_write(addr, 4);
     }
 }
 #else
@@ -2081,6 +2122,7 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page)
         uint64_t mask = (uint64_t) 1 << ((addr >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         page->mem[addr & 0xfff] = val;
+        mem_code_write(addr, 1);
     }
 }
 
@@ -2100,6 +2142,7 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page)
             mask |= (mask << 1);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         *(uint16_t *) &page->mem[addr & 0xfff] = val;
+        mem_code_write(addr, 2);
     }
 }
 
@@ -2119,6 +2162,7 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
             mask |= (mask << 1);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         *(uint32_t *) &page->mem[addr & 0xfff] = val;
+        mem_code_write(addr, 4);
     }
 }
 #endif
@@ -2133,8 +2177,10 @@ mem_write_ram(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         ram[addr] = val;
+        mem_code_write(addr, 1);
+    }
 }
 
 void
@@ -2147,8 +2193,10 @@ mem_write_ramw(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         *(uint16_t *) &ram[addr] = val;
+        mem_code_write(addr, 2);
+    }
 }
 
 void
@@ -2161,8 +2209,10 @@ mem_write_raml(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         *(uint32_t *) &ram[addr] = val;
+        mem_code_write(addr, 4);
+    }
 }
 
 static uint8_t
@@ -2330,6 +2380,32 @@ mem_invalidate_range(uint32_t start_addr, uint32_t end_addr)
 #endif
 }
 
+void
+mem_set_code_write_handler(void (*handler)(uint32_t addr, int size, void *priv), void *priv)
+{
+    code_write_handler = handler;
+    code_write_priv    = priv;
+
+    if (handler == NULL)
+        memset(code_watch_map, 0, sizeof(code_watch_map));
+}
+
+void
+mem_watch_code_page(uint32_t addr, int watch)
+{
+    uint32_t bit = 1U << ((addr >> 12) & 31);
+
+    if (watch) {
+        if (code_watch_map[addr >> 17] & bit)
+            return;
+        code_watch_map[addr >> 17] |= bit;
+
+        /* Stores may already go straight to the page */
+        flushmmucache_write();
+    } else
+        code_watch_map[addr >> 17] &= ~bit;
+}
+
 static __inline int
 mem_mapping_access_allowed(uint32_t flags, uint16_t access)
 {
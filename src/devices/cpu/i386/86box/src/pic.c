@@ -66,6 +66,12 @@ static uint16_t latched_irqs   = 0x0000;
 
 static void (*update_pending)(void);
 
+/* Local APIC in front of the 8259: while it has an interrupt to deliver,
+   int_pending stays set and picinterrupt() asks it for the vector first. */
+static int pic_lapic_pending = 0;
+static int (*pic_lapic_ack)(void *priv) = NULL;
+static void *pic_lapic_priv = NULL;
+
 #ifdef ENABLE_PIC_LOG
 int pic_do_log = ENABLE_PIC_LOG;
 
@@ -224,7 +230,7 @@ static __inline void
 pic_update_pending_xt(void)
 {
     if (!(pic.interrupt & 0x20))
-        pic.int_pending = (find_best_interrupt(&pic) != -1);
+        pic.int_pending = (find_best_interrupt(&pic) != -1) || pic_lapic_pending;
 }
 
 /* Only check if PIC 1 frozen, because it should not happen
@@ -240,7 +246,7 @@ pic_update_pending_at(void)
         else
             pic.irr &= ~(1 << pic2.icw3);
 
-        pic.int_pending = (find_best_interrupt(&pic) != -1);
+        pic.int_pending = (find_best_interrupt(&pic) != -1) || pic_lapic_pending;
     }
 }
 
@@ -857,11 +863,40 @@ pic_irq_ack(void)
     return ret;
 }
 
+void
+pic_set_lapic(int (*ack)(void *priv), void *priv)
+{
+    pic_lapic_ack  = ack;
+    pic_lapic_priv = priv;
+}
+
+void
+pic_set_lapic_pending(int pending)
+{
+    pic_lapic_pending = pending;
+
+    if (update_pending != NULL)
+        update_pending();
+    else if (pending)
+        pic.int_pending = 1;
+}
+
 int
 picinterrupt(void)
 {
     int ret = -1;
 
+    if (pic_lapic_pending && (pic_lapic_ack != NULL)) {
+        ret = pic_lapic_ack(pic_lapic_priv);
+        if (ret != -1)
+            return ret;
+
+        /* Masked by the task priority since the check; the acknowledge
+           dropped the line, so only the 8259 can still be pending. */
+        if (!pic.int_pending)
+            return -1;
+    }
+
     if (pic.int_pending) {
         if (pic_slave_on(&pic, pic.interrupt)) {
             if (!pic.slaves[pic.interrupt]->int_pending) {
@@ -20,11 +20,60 @@
 #ifndef X86EMULATOR_I386_INTERFACE_H
 #define X86EMULATOR_I386_INTERFACE_H
 
+#include "i386_trace.h"
+
 #include <cstdint>
+#include <functional>
 #include <string>
 
 namespace x86emu {
 
+/**
+ * @brief Register indices accepted by GetRegister/SetRegister
+ *
+ * General purpose registers follow the order used by the backend
+ * integration layers; the remaining entries expose control state.
+ */
+enum I386Register {
+    I386_REG_EAX = 0,
+    I386_REG_EBX = 1,
+    I386_REG_ECX = 2,
+    I386_REG_EDX = 3,
+    I386_REG_ESI = 4,
+    I386_REG_EDI = 5,
+    I386_REG_EBP = 6,
+    I386_REG_ESP = 7,
+    I386_REG_EIP = 8,
+    I386_REG_EFLAGS = 9,
+    I386_REG_CS = 10,   // CS selector
+    I386_REG_CR0 = 11,  // Control register 0
+    I386_REG_CPL = 12   // Current privilege level (read-only)
+};
+
+/**
+ * @brief Handlers of a memory-mapped register window
+ *
+ * Offsets are relative to the window base and dword aligned; backends
+ * merge narrower accesses into dword accesses.
+ */
+using MMIOReadHandler = std::function<uint32_t(uint32_t offset)>;
+using MMIOWriteHandler = std::function<void(uint32_t offset, uint32_t value)>;
+
+/**
+ * @brief Interrupt acknowledge of an external or local interrupt controller
+ *
+ * Returns the vector to take, or -1 to fall back to the backend's 8259.
+ */
+using InterruptAcknowledgeHandler = std::function<int()>;
+
+/**
+ * @brief Receives guest stores to watched code pages
+ *
+ * Called with the physical address and size of each store that changed
+ * memory in a page passed to WatchCodePage().
+ */
+using CodeWriteHandler = std::function<void(uint32_t address, uint32_t size)>;
+
 /**
  * @brief Interface for x86 CPU implementations
  * 
@@ -50,11 +99,23 @@ public:
     virtual void Pause() = 0;
     virtual void Resume() = 0;
     
+    // Instructions retired since the backend was initialized
+    virtual uint64_t GetInstructionCount() = 0;
+    
     // Interrupt handling
     virtual void AssertIRQ(int irqLine, bool state) = 0;
     virtual void AssertNMI(bool state) = 0;
     virtual void SetIRQCallback(void* callback) = 0;
     
+    // Local APIC hookup; return false if the backend cannot host one
+    virtual bool MapMMIO(uint32_t base, uint32_t size, MMIOReadHandler read, MMIOWriteHandler write) = 0;
+    virtual bool SetInterruptAcknowledge(InterruptAcknowledgeHandler acknowledge) = 0;
+    virtual void SetLocalInterrupt(bool pending) = 0;
+    
+    // Code write tracking for external code caches; return false if unsupported
+    virtual bool SetCodeWriteHandler(CodeWriteHandler handler) = 0;
+    virtual void WatchCodePage(uint32_t address, bool watch) = 0;
+    
     // Memory access
     virtual uint8_t ReadByte(uint32_t address) = 0;
     virtual uint16_t ReadWord(uint32_t address) = 0;
@@ -76,6 +137,16 @@ public:
     virtual void ExecuteRDTSC() = 0;
     virtual void ExecuteCPUID() = 0;
     
+    // FPU configuration
+    virtual bool SetFastFPU(bool enable) = 0;
+    
+    // Instruction tracing; hooks is nullptr to stop tracing
+    virtual bool SetTraceHooks(const i386_trace_hooks* hooks) = 0;
+    
+    // Accuracy trade-offs; return false if the backend has no such model
+    virtual bool SetCycleAccurate(bool enable) = 0;
+    virtual bool SetCacheEmulation(bool enable) = 0;
+    
     // Debug support
     virtual std::string GetDisassembly(uint32_t pc) = 0;
 };
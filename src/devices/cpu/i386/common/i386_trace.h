@@ -0,0 +1,62 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_I386_TRACE_H
+#define X86EMULATOR_I386_TRACE_H
+
+/*
+ * Instruction trace hooks shared by the CPU cores.
+ *
+ * Plain C so it can be included from both the MAME (C++) and 86Box (C)
+ * cores. A core holds a pointer to an i386_trace_hooks table that is NULL
+ * while tracing is off, so the cost of the hooks in normal operation is
+ * one pointer test per instruction or slow-path memory access.
+ *
+ * instruction() is called before an instruction executes, with the linear
+ * address of its first byte, the CS selector, the opcode bytes the core
+ * has at hand and the registers in I386_TRACE_REG_* order.
+ *
+ * memory() is called for each data access with its linear address and
+ * size in bytes. Writes always carry the value; reads carry it when the
+ * core knows it at the point of the hook (has_value).
+ */
+
+#include <stdint.h>
+
+#define I386_TRACE_REG_EAX    0
+#define I386_TRACE_REG_ECX    1
+#define I386_TRACE_REG_EDX    2
+#define I386_TRACE_REG_EBX    3
+#define I386_TRACE_REG_ESP    4
+#define I386_TRACE_REG_EBP    5
+#define I386_TRACE_REG_ESI    6
+#define I386_TRACE_REG_EDI    7
+#define I386_TRACE_REG_EFLAGS 8
+#define I386_TRACE_REG_COUNT  9
+
+/* Longest x86 instruction */
+#define I386_TRACE_MAX_INSN 15
+
+typedef struct i386_trace_hooks {
+    void *opaque;
+    void (*instruction)(void *opaque, uint32_t eip, uint16_t cs, const uint8_t *bytes, uint32_t length, const uint32_t *regs);
+    void (*memory)(void *opaque, uint32_t address, uint32_t size, int write, int has_value, uint64_t value);
+} i386_trace_hooks;
+
+#endif /* X86EMULATOR_I386_TRACE_H */
@@ -0,0 +1,360 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_X87_FAST_MATH_H
+#define X86EMULATOR_X87_FAST_MATH_H
+
+/*
+ * Host-native x87 arithmetic shared by the backend FPU fast paths.
+ *
+ * Plain C so it can be included from both the MAME (C++) and 86Box (C)
+ * cores. Values are passed in the 80-bit register format (64-bit
+ * significand with explicit integer bit, sign and 15-bit biased exponent).
+ *
+ * Results are computed with host double (53-bit precision control) or
+ * host long double (64-bit precision control) arithmetic, which rounds
+ * to nearest-even exactly like softfloat. The rounding error needed for
+ * the precision exception and the C1 "rounded up" bit is recovered
+ * without touching the host floating-point environment:
+ *   - double: error-free transformations (TwoSum, Dekker product);
+ *   - long double: TwoSum for add/sub, and an exact 128-bit integer
+ *     comparison of a*b, a, a against r, r*b, r*r for mul/div/sqrt.
+ *
+ * Only normal operands and results well inside the exponent range are
+ * handled. Anything else (zeros, denormals, infinities, NaNs, overflow,
+ * underflow, single precision control) returns 0 and the caller falls
+ * back to softfloat, which remains the reference implementation.
+ *
+ * The double transformations require that a*b-c is not contracted into a
+ * fused multiply-add, which compilers do by default once FMA is enabled
+ * (-mfma, -march=haswell and later). Contraction is switched off around
+ * them below. They also require double arithmetic without excess
+ * precision, which is checked with FLT_EVAL_METHOD.
+ */
+
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#    if (LDBL_MANT_DIG == 64) && defined(__SIZEOF_INT128__)
+#        define X87_FAST_HAVE_EXTENDED 1
+#    endif
+#    if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+#        define X87_FAST_HAVE_DOUBLE 1
+#    endif
+#endif
+
+#ifndef X87_FAST_HAVE_EXTENDED
+#    define X87_FAST_HAVE_EXTENDED 0
+#endif
+#ifndef X87_FAST_HAVE_DOUBLE
+#    define X87_FAST_HAVE_DOUBLE 0
+#endif
+
+enum {
+    X87_FAST_ADD = 0,
+    X87_FAST_SUB,
+    X87_FAST_MUL,
+    X87_FAST_DIV,
+    X87_FAST_SQRT
+};
+
+/* Precision control */
+#define X87_FAST_PREC_DOUBLE   53
+#define X87_FAST_PREC_EXTENDED 64
+
+/* Result flags */
+#define X87_FAST_INEXACT 0x01 /* Result was rounded */
+#define X87_FAST_ROUNDUP 0x02 /* Magnitude was rounded up (x87 C1) */
+
+#define X87_FAST_EXP_BIAS 16383
+
+/*
+ * Accepted unbiased exponents. The bounds keep every intermediate of the
+ * error computations finite and normal.
+ */
+#define X87_FAST_DOUBLE_EXP_LIMIT   900
+#define X87_FAST_EXTENDED_EXP_LIMIT 16000
+
+static inline int
+x87_fast_exp_ok(uint16_t sign_exp, int limit)
+{
+    int exp = (int) (sign_exp & 0x7fff) - X87_FAST_EXP_BIAS;
+
+    return exp >= -limit && exp <= limit;
+}
+
+#if X87_FAST_HAVE_DOUBLE
+/*
+ * No multiply-add contraction in the error-free transformations. GCC
+ * ignores the STDC pragma and only contracts when the target has FMA; it
+ * then gets the option per function, which keeps these helpers from being
+ * inlined into callers built with contraction on.
+ */
+#    if defined(__clang__)
+#        pragma float_control(push)
+#        pragma STDC FP_CONTRACT OFF
+#    elif defined(__FP_FAST_FMA)
+#        pragma GCC push_options
+#        pragma GCC optimize("fp-contract=off")
+#    endif
+
+/* Veltkamp split constant for a 53-bit significand, 2^27 + 1 */
+#    define X87_FAST_DOUBLE_SPLIT 134217729.0
+
+static inline double
+x87_fast_to_d(uint64_t signif, uint16_t sign_exp)
+{
+    uint64_t bits = ((uint64_t) (sign_exp >> 15) << 63)
+                  | ((uint64_t) ((sign_exp & 0x7fff) - X87_FAST_EXP_BIAS + 1023) << 52)
+                  | ((signif >> 11) & 0x000fffffffffffffULL);
+    double   value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline void
+x87_fast_from_d(double value, uint64_t *signif, uint16_t *sign_exp)
+{
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    *signif   = (bits << 11) | 0x8000000000000000ULL;
+    *sign_exp = (uint16_t) (((bits >> 63) << 15) | (((bits >> 52) & 0x7ff) - 1023 + X87_FAST_EXP_BIAS));
+}
+
+/* Exact error of the double product p = fl(a * b) */
+static inline double
+x87_fast_prod_err_d(double a, double b, double p)
+{
+    double ca = X87_FAST_DOUBLE_SPLIT * a;
+    double ah = ca - (ca - a);
+    double al = a - ah;
+    double cb = X87_FAST_DOUBLE_SPLIT * b;
+    double bh = cb - (cb - b);
+    double bl = b - bh;
+
+    return (((ah * bh - p) + ah * bl) + al * bh) + al * bl;
+}
+
+static inline int
+x87_fast_calc_d(int op, uint64_t as, uint16_t ae, uint64_t bs, uint16_t be,
+                uint64_t *rs, uint16_t *re, int *flags)
+{
+    double a;
+    double b;
+    double res;
+    double err;
+    double p;
+    int    up;
+
+    /* Operands must be exact doubles: softfloat rounds only the result */
+    if (!(as >> 63) || (as & 0x7ff) || !x87_fast_exp_ok(ae, X87_FAST_DOUBLE_EXP_LIMIT))
+        return 0;
+    if ((op != X87_FAST_SQRT) && (!(bs >> 63) || (bs & 0x7ff) || !x87_fast_exp_ok(be, X87_FAST_DOUBLE_EXP_LIMIT)))
+        return 0;
+
+    a = x87_fast_to_d(as, ae);
+    b = x87_fast_to_d(bs, be);
+
+    switch (op) {
+        case X87_FAST_SUB:
+            b = -b;
+            /* fall through */
+        case X87_FAST_ADD:
+            res = a + b;
+            p   = res - a;
+            err = (a - (res - p)) + (b - p); /* a + b = res + err */
+            up  = (err < 0) != (res < 0);
+            break;
+        case X87_FAST_MUL:
+            res = a * b;
+            err = x87_fast_prod_err_d(a, b, res); /* a * b = res + err */
+            up  = (err < 0) != (res < 0);
+            break;
+        case X87_FAST_DIV:
+            res = a / b;
+            p   = res * b;
+            err = (a - p) - x87_fast_prod_err_d(res, b, p); /* a - res * b */
+            up  = (err < 0) != (a < 0);
+            break;
+        case X87_FAST_SQRT:
+            if (ae & 0x8000)
+                return 0;
+            res = __builtin_sqrt(a);
+            p   = res * res;
+            err = (a - p) - x87_fast_prod_err_d(res, res, p); /* a - res * res */
+            up  = err < 0;
+            break;
+        default:
+            return 0;
+    }
+
+    /* Cancellation may leave a zero or tiny sum */
+    if (res == 0)
+        return 0;
+    x87_fast_from_d(res, rs, re);
+    if (!x87_fast_exp_ok(*re, X87_FAST_DOUBLE_EXP_LIMIT))
+        return 0;
+
+    *flags = (err != 0) ? (X87_FAST_INEXACT | (up ? X87_FAST_ROUNDUP : 0)) : 0;
+    return 1;
+}
+
+#    if defined(__clang__)
+#        pragma float_control(pop)
+#    elif defined(__FP_FAST_FMA)
+#        pragma GCC pop_options
+#    endif
+#endif
+
+#if X87_FAST_HAVE_EXTENDED
+__extension__ typedef unsigned __int128 x87_fast_u128;
+
+static inline long double
+x87_fast_to_ld(uint64_t signif, uint16_t sign_exp)
+{
+    unsigned char bytes[sizeof(long double)] = { 0 };
+    long double   value;
+
+    memcpy(bytes, &signif, 8);
+    memcpy(bytes + 8, &sign_exp, 2);
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static inline void
+x87_fast_from_ld(long double value, uint64_t *signif, uint16_t *sign_exp)
+{
+    unsigned char bytes[sizeof(long double)];
+
+    memcpy(bytes, &value, sizeof(value));
+    memcpy(signif, bytes, 8);
+    memcpy(sign_exp, bytes + 8, 2);
+}
+
+static inline int
+x87_fast_calc_ld(int op, uint64_t as, uint16_t ae, uint64_t bs, uint16_t be,
+                 uint64_t *rs, uint16_t *re, int *flags)
+{
+    x87_fast_u128     exact;
+    x87_fast_u128     rounded;
+    long double       a;
+    long double       b;
+    long double       res;
+    int               shift;
+
+    if (!(as >> 63) || !x87_fast_exp_ok(ae, X87_FAST_EXTENDED_EXP_LIMIT))
+        return 0;
+    if ((op != X87_FAST_SQRT) && (!(bs >> 63) || !x87_fast_exp_ok(be, X87_FAST_EXTENDED_EXP_LIMIT)))
+        return 0;
+
+    a = x87_fast_to_ld(as, ae);
+    b = x87_fast_to_ld(bs, be);
+
+    /*
+     * For mul/div/sqrt both sides of r = op(a, b) are brought to integer
+     * form with the significands; shift is fixed by the exponents and is
+     * always 63 or 64 for normal results.
+     */
+    switch (op) {
+        case X87_FAST_SUB:
+            b = -b;
+            /* fall through */
+        case X87_FAST_ADD: {
+            long double p;
+            long double err;
+
+            res = a + b;
+            if (res == 0)
+                return 0;
+            p   = res - a;
+            err = (a - (res - p)) + (b - p); /* a + b = res + err */
+            x87_fast_from_ld(res, rs, re);
+            if (!x87_fast_exp_ok(*re, X87_FAST_EXTENDED_EXP_LIMIT))
+                return 0;
+            *flags = (err != 0) ? (X87_FAST_INEXACT | (((err < 0) != (res < 0)) ? X87_FAST_ROUNDUP : 0)) : 0;
+            return 1;
+        }
+        case X87_FAST_MUL:
+            res = a * b;
+            x87_fast_from_ld(res, rs, re);
+            /* |res| << shift vs |a| * |b| */
+            shift   = (*re & 0x7fff) - (ae & 0x7fff) - (be & 0x7fff) + X87_FAST_EXP_BIAS + 63;
+            exact   = (x87_fast_u128) as * bs;
+            rounded = (x87_fast_u128) *rs << (shift & 127);
+            break;
+        case X87_FAST_DIV:
+            res = a / b;
+            x87_fast_from_ld(res, rs, re);
+            /* |res| * |b| vs |a| << shift */
+            shift   = (ae & 0x7fff) - (be & 0x7fff) - (*re & 0x7fff) + X87_FAST_EXP_BIAS + 63;
+            exact   = (x87_fast_u128) as << (shift & 127);
+            rounded = (x87_fast_u128) *rs * bs;
+            break;
+        case X87_FAST_SQRT:
+            if (ae & 0x8000)
+                return 0;
+            res = __builtin_sqrtl(a);
+            x87_fast_from_ld(res, rs, re);
+            /* |res| * |res| vs |a| << shift */
+            shift   = (ae & 0x7fff) - 2 * (*re & 0x7fff) + X87_FAST_EXP_BIAS + 63;
+            exact   = (x87_fast_u128) as << (shift & 127);
+            rounded = (x87_fast_u128) *rs * *rs;
+            break;
+        default:
+            return 0;
+    }
+
+    if (shift < 63 || shift > 64 || !x87_fast_exp_ok(*re, X87_FAST_EXTENDED_EXP_LIMIT))
+        return 0;
+
+    *flags = (rounded != exact) ? (X87_FAST_INEXACT | ((rounded > exact) ? X87_FAST_ROUNDUP : 0)) : 0;
+    return 1;
+}
+#endif
+
+/*
+ * Compute op(a, b) (b is ignored for X87_FAST_SQRT) with round-to-nearest
+ * at the given precision control.
+ *
+ * Returns 1 and fills the result and X87_FAST_* flags if the fast path
+ * produced the same result as softfloat, 0 if the caller must fall back.
+ */
+static inline int
+x87_fast_calc(int op, int prec, uint64_t as, uint16_t ae, uint64_t bs, uint16_t be,
+              uint64_t *rs, uint16_t *re, int *flags)
+{
+    switch (prec) {
+#if X87_FAST_HAVE_EXTENDED
+        case X87_FAST_PREC_EXTENDED:
+            return x87_fast_calc_ld(op, as, ae, bs, be, rs, re, flags);
+#endif
+#if X87_FAST_HAVE_DOUBLE
+        case X87_FAST_PREC_DOUBLE:
+            return x87_fast_calc_d(op, as, ae, bs, be, rs, re, flags);
+#endif
+        default:
+            return 0;
+    }
+}
+
+#endif /* X86EMULATOR_X87_FAST_MATH_H */
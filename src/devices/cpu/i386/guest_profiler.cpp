@@ -0,0 +1,381 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "guest_profiler.h"
+#include "x86_cpu.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace x86emu {
+
+namespace {
+    // Slice length used in host-time mode between clock checks
+    constexpr int HOST_TIME_SLICE = 2000;
+
+    constexpr uint32_t DEFAULT_BLOCK_SIZE = 64;
+
+    constexpr uint32_t CR0_PE = 0x00000001;
+    constexpr uint32_t EFLAGS_VM = 0x00020000;
+}
+
+GuestProfiler::GuestProfiler(Mode mode, uint32_t interval)
+    : m_mode(mode)
+    , m_interval(std::max<uint32_t>(interval, 1))
+    , m_blockMask(~(DEFAULT_BLOCK_SIZE - 1))
+    , m_cyclesSinceSample(0)
+    , m_nextSample(std::chrono::steady_clock::now())
+    , m_totalSamples(0)
+{
+}
+
+GuestProfiler::~GuestProfiler()
+{
+}
+
+bool GuestProfiler::loadSymbolMap(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        Logger::GetInstance()->error("Failed to open symbol map: %s", path.c_str());
+        return false;
+    }
+
+    std::vector<Symbol> symbols;
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string addressText, second, third;
+
+        if (!(stream >> addressText >> second)) {
+            continue;
+        }
+
+        char* end = nullptr;
+        unsigned long address = std::strtoul(addressText.c_str(), &end, 16);
+        if (end == addressText.c_str() || *end != '\0') {
+            continue;
+        }
+
+        // nm / System.map: "address type name"; otherwise "address name"
+        Symbol symbol;
+        symbol.address = static_cast<uint32_t>(address);
+        if (second.size() == 1 && (stream >> third)) {
+            symbol.name = third;
+        } else {
+            symbol.name = second;
+        }
+        symbols.push_back(symbol);
+    }
+
+    std::sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) {
+        return a.address < b.address;
+    });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_symbols = std::move(symbols);
+
+    Logger::GetInstance()->info("Loaded %zu guest symbols from %s", m_symbols.size(), path.c_str());
+    return !m_symbols.empty();
+}
+
+void GuestProfiler::setBlockSize(uint32_t bytes)
+{
+    uint32_t size = 1;
+    while (size * 2 <= bytes && size < 0x80000000u) {
+        size *= 2;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_blockMask = ~(size - 1);
+}
+
+int GuestProfiler::getSliceCycles() const
+{
+    if (m_mode == Mode::CYCLES) {
+        return static_cast<int>(std::min<uint32_t>(m_interval, 0x7FFFFFFF));
+    }
+
+    return HOST_TIME_SLICE;
+}
+
+void GuestProfiler::onSlice(X86CPU& cpu, int cycles)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_mode == Mode::CYCLES) {
+            m_cyclesSinceSample += static_cast<uint64_t>(std::max(cycles, 0));
+            if (m_cyclesSinceSample < m_interval) {
+                return;
+            }
+            m_cyclesSinceSample -= m_interval;
+        } else {
+            auto now = std::chrono::steady_clock::now();
+            if (now < m_nextSample) {
+                return;
+            }
+            m_nextSample = now + std::chrono::microseconds(m_interval);
+        }
+    }
+
+    sample(cpu);
+}
+
+void GuestProfiler::sample(X86CPU& cpu)
+{
+    uint32_t eip = cpu.GetRegister(I386_REG_EIP);
+    uint32_t cs = cpu.GetRegister(I386_REG_CS) & 0xFFFF;
+    uint32_t cr0 = cpu.GetRegister(I386_REG_CR0);
+    uint32_t eflags = cpu.GetRegister(I386_REG_EFLAGS);
+
+    ExecMode mode;
+    uint32_t linear;
+    uint8_t cpl;
+
+    if (!(cr0 & CR0_PE)) {
+        mode = ExecMode::REAL;
+        linear = (cs << 4) + (eip & 0xFFFF);
+        cpl = 0;
+    } else if (eflags & EFLAGS_VM) {
+        mode = ExecMode::V86;
+        linear = (cs << 4) + (eip & 0xFFFF);
+        cpl = 3;
+    } else {
+        // The CS base is not exposed by the backends; protected mode
+        // guests are assumed to use a zero-based code segment.
+        mode = ExecMode::PROTECTED;
+        linear = eip;
+        cpl = static_cast<uint8_t>(cpu.GetRegister(I386_REG_CPL) & 3);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_samples[makeKey(linear, cpl, mode)]++;
+    m_totalSamples++;
+}
+
+void GuestProfiler::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_samples.clear();
+    m_totalSamples = 0;
+    m_cyclesSinceSample = 0;
+}
+
+uint64_t GuestProfiler::getSampleCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_totalSamples;
+}
+
+std::vector<GuestProfiler::HotSpot> GuestProfiler::getHotAddresses(size_t count) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unordered_map<uint32_t, uint64_t> byAddress;
+    for (const auto& entry : m_samples) {
+        byAddress[static_cast<uint32_t>(entry.first)] += entry.second;
+    }
+
+    std::vector<HotSpot> result;
+    result.reserve(byAddress.size());
+    for (const auto& entry : byAddress) {
+        HotSpot spot;
+        spot.address = entry.first;
+        spot.samples = entry.second;
+        spot.percent = m_totalSamples ? 100.0 * entry.second / m_totalSamples : 0.0;
+
+        const Symbol* symbol = findSymbol(entry.first);
+        if (symbol) {
+            char offset[16];
+            std::snprintf(offset, sizeof(offset), "+0x%X", entry.first - symbol->address);
+            spot.name = symbol->name + offset;
+        } else {
+            spot.name = formatAddress(entry.first);
+        }
+        result.push_back(spot);
+    }
+
+    std::sort(result.begin(), result.end(), [](const HotSpot& a, const HotSpot& b) {
+        return a.samples > b.samples;
+    });
+    if (result.size() > count) {
+        result.resize(count);
+    }
+
+    return result;
+}
+
+std::vector<GuestProfiler::HotSpot> GuestProfiler::getHotBlocks(size_t count) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unordered_map<std::string, HotSpot> byBlock;
+    for (const auto& entry : m_samples) {
+        uint32_t start;
+        std::string name = blockName(static_cast<uint32_t>(entry.first), &start);
+
+        HotSpot& spot = byBlock[name];
+        spot.name = name;
+        spot.address = start;
+        spot.samples += entry.second;
+    }
+
+    std::vector<HotSpot> result;
+    result.reserve(byBlock.size());
+    for (auto& entry : byBlock) {
+        entry.second.percent = m_totalSamples ? 100.0 * entry.second.samples / m_totalSamples : 0.0;
+        result.push_back(entry.second);
+    }
+
+    std::sort(result.begin(), result.end(), [](const HotSpot& a, const HotSpot& b) {
+        return a.samples > b.samples;
+    });
+    if (result.size() > count) {
+        result.resize(count);
+    }
+
+    return result;
+}
+
+bool GuestProfiler::writeFoldedStacks(const std::string& path) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        Logger::GetInstance()->error("Failed to write profile: %s", path.c_str());
+        return false;
+    }
+
+    // Fold identical stacks; std::map keeps the output stable
+    std::map<std::string, uint64_t> stacks;
+    for (const auto& entry : m_samples) {
+        uint32_t linear = static_cast<uint32_t>(entry.first);
+        uint8_t cpl = static_cast<uint8_t>((entry.first >> 32) & 3);
+        ExecMode mode = static_cast<ExecMode>(entry.first >> 34);
+
+        std::string stack = modeName(mode);
+        stack += ";ring" + std::to_string(cpl);
+        stack += ";" + blockName(linear, nullptr);
+        stack += ";" + formatAddress(linear);
+        stacks[stack] += entry.second;
+    }
+
+    for (const auto& entry : stacks) {
+        file << entry.first << " " << entry.second << "\n";
+    }
+
+    Logger::GetInstance()->info("Wrote %llu guest profile samples to %s",
+                                static_cast<unsigned long long>(m_totalSamples), path.c_str());
+    return true;
+}
+
+bool GuestProfiler::writeReport(const std::string& path, size_t count) const
+{
+    std::vector<HotSpot> blocks = getHotBlocks(count);
+    std::vector<HotSpot> addresses = getHotAddresses(count);
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        Logger::GetInstance()->error("Failed to write profile report: %s", path.c_str());
+        return false;
+    }
+
+    char line[256];
+
+    std::snprintf(line, sizeof(line), "Total samples: %llu\n\n",
+                  static_cast<unsigned long long>(getSampleCount()));
+    file << line;
+
+    file << "Hot blocks:\n";
+    for (const auto& spot : blocks) {
+        std::snprintf(line, sizeof(line), "  %6.2f%%  %10llu  %08X  %s\n", spot.percent,
+                      static_cast<unsigned long long>(spot.samples), spot.address, spot.name.c_str());
+        file << line;
+    }
+
+    file << "\nHot addresses:\n";
+    for (const auto& spot : addresses) {
+        std::snprintf(line, sizeof(line), "  %6.2f%%  %10llu  %08X  %s\n", spot.percent,
+                      static_cast<unsigned long long>(spot.samples), spot.address, spot.name.c_str());
+        file << line;
+    }
+
+    return true;
+}
+
+const GuestProfiler::Symbol* GuestProfiler::findSymbol(uint32_t address) const
+{
+    auto it = std::upper_bound(m_symbols.begin(), m_symbols.end(), address,
+                               [](uint32_t value, const Symbol& symbol) {
+                                   return value < symbol.address;
+                               });
+    if (it == m_symbols.begin()) {
+        return nullptr;
+    }
+
+    return &*(it - 1);
+}
+
+std::string GuestProfiler::blockName(uint32_t address, uint32_t* blockStart) const
+{
+    const Symbol* symbol = findSymbol(address);
+    if (symbol) {
+        if (blockStart) {
+            *blockStart = symbol->address;
+        }
+        return symbol->name;
+    }
+
+    uint32_t start = address & m_blockMask;
+    if (blockStart) {
+        *blockStart = start;
+    }
+    return "block_" + formatAddress(start);
+}
+
+std::string GuestProfiler::formatAddress(uint32_t address)
+{
+    char text[16];
+    std::snprintf(text, sizeof(text), "0x%08X", address);
+    return text;
+}
+
+const char* GuestProfiler::modeName(ExecMode mode)
+{
+    switch (mode) {
+        case ExecMode::REAL:
+            return "real";
+        case ExecMode::PROTECTED:
+            return "protected";
+        case ExecMode::V86:
+            return "v86";
+        default:
+            return "unknown";
+    }
+}
+
+} // namespace x86emu
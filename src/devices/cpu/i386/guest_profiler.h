@@ -0,0 +1,208 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_GUEST_PROFILER_H
+#define X86EMULATOR_GUEST_PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace x86emu {
+
+class X86CPU;
+
+/**
+ * @brief Sampling profiler for guest code
+ *
+ * Records the guest CS:EIP, privilege level and execution mode at a fixed
+ * interval without instrumenting the guest. X86CPU splits Execute() into
+ * slices while a profiler is attached and calls onSlice() between slices,
+ * so registers are always read from the emulation thread.
+ *
+ * Samples are aggregated into a hot-address histogram and a hot-block
+ * histogram (symbol, or fixed-size address block when no symbol is known),
+ * and can be written as folded stacks for flamegraph.pl / speedscope.
+ */
+class GuestProfiler {
+public:
+    /**
+     * @brief Sampling trigger
+     */
+    enum class Mode {
+        CYCLES,     // Sample every N guest cycles
+        HOST_TIME   // Sample every N host microseconds
+    };
+
+    /**
+     * @brief Guest execution mode at the time of a sample
+     */
+    enum class ExecMode : uint8_t {
+        REAL = 0,
+        PROTECTED = 1,
+        V86 = 2
+    };
+
+    /**
+     * @brief Histogram entry
+     */
+    struct HotSpot {
+        std::string name;   // Symbol or formatted address
+        uint32_t address;   // Linear address (block start for blocks)
+        uint64_t samples;   // Sample count
+        double percent;     // Share of all samples
+    };
+
+    /**
+     * @brief Construct a new profiler
+     *
+     * @param mode Sampling trigger
+     * @param interval Cycles (CYCLES) or microseconds (HOST_TIME) between samples
+     */
+    GuestProfiler(Mode mode, uint32_t interval);
+
+    /**
+     * @brief Destroy the profiler
+     */
+    ~GuestProfiler();
+
+    /**
+     * @brief Load a symbol map
+     *
+     * Accepts nm / System.map style lines ("address [type] name") and
+     * linker-map style lines ("address name"). Addresses are linear and
+     * hexadecimal, with or without a 0x prefix. Other lines are ignored.
+     *
+     * @param path Map file path
+     * @return true if at least one symbol was loaded
+     */
+    bool loadSymbolMap(const std::string& path);
+
+    /**
+     * @brief Set the block size used for unsymbolized addresses
+     *
+     * @param bytes Block size, rounded down to a power of two
+     */
+    void setBlockSize(uint32_t bytes);
+
+    /**
+     * @brief Get the number of cycles X86CPU should run between checks
+     *
+     * @return int Slice length in cycles
+     */
+    int getSliceCycles() const;
+
+    /**
+     * @brief Account executed cycles and take a sample if one is due
+     *
+     * @param cpu CPU to sample
+     * @param cycles Cycles executed since the last call
+     */
+    void onSlice(X86CPU& cpu, int cycles);
+
+    /**
+     * @brief Take a sample unconditionally
+     *
+     * @param cpu CPU to sample
+     */
+    void sample(X86CPU& cpu);
+
+    /**
+     * @brief Discard all samples
+     */
+    void clear();
+
+    /**
+     * @brief Get the total number of samples
+     *
+     * @return uint64_t Sample count
+     */
+    uint64_t getSampleCount() const;
+
+    /**
+     * @brief Get the hottest addresses
+     *
+     * @param count Maximum number of entries
+     * @return std::vector<HotSpot> Entries sorted by sample count
+     */
+    std::vector<HotSpot> getHotAddresses(size_t count) const;
+
+    /**
+     * @brief Get the hottest blocks (symbols or address blocks)
+     *
+     * @param count Maximum number of entries
+     * @return std::vector<HotSpot> Entries sorted by sample count
+     */
+    std::vector<HotSpot> getHotBlocks(size_t count) const;
+
+    /**
+     * @brief Write folded stacks ("mode;ring;block;address count")
+     *
+     * @param path Output file path
+     * @return true if the file was written
+     */
+    bool writeFoldedStacks(const std::string& path) const;
+
+    /**
+     * @brief Write the hot-address and hot-block histograms as text
+     *
+     * @param path Output file path
+     * @param count Maximum entries per histogram
+     * @return true if the file was written
+     */
+    bool writeReport(const std::string& path, size_t count = 50) const;
+
+private:
+    struct Symbol {
+        uint32_t address;
+        std::string name;
+    };
+
+    // Sample key: linear address, CPL and execution mode
+    static uint64_t makeKey(uint32_t linear, uint8_t cpl, ExecMode mode) {
+        return (static_cast<uint64_t>(mode) << 34) | (static_cast<uint64_t>(cpl) << 32) | linear;
+    }
+
+    const Symbol* findSymbol(uint32_t address) const;
+    std::string blockName(uint32_t address, uint32_t* blockStart) const;
+    static std::string formatAddress(uint32_t address);
+    static const char* modeName(ExecMode mode);
+
+    Mode m_mode;
+    uint32_t m_interval;
+    uint32_t m_blockMask;
+
+    // Trigger state
+    uint64_t m_cyclesSinceSample;
+    std::chrono::steady_clock::time_point m_nextSample;
+
+    std::vector<Symbol> m_symbols;   // Sorted by address
+    std::unordered_map<uint64_t, uint64_t> m_samples;
+    uint64_t m_totalSamples;
+
+    // Mutex for thread safety (vCPUs may share one profiler)
+    mutable std::mutex m_mutex;
+};
+
+} // namespace x86emu
+
+#endif // X86EMULATOR_GUEST_PROFILER_H
@@ -0,0 +1,406 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "instruction_trace.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef X86EMU_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace x86emu {
+
+namespace {
+    // Per-thread ring size; a power of two
+    constexpr uint32_t RING_SIZE = 4 * 1024 * 1024;
+
+    // Records are handed to the writer in chunks of this size
+    constexpr uint32_t CHUNK_SIZE = 256 * 1024;
+
+    // Writer poll interval, so partially filled chunks of idle threads are flushed
+    constexpr auto WRITER_INTERVAL = std::chrono::milliseconds(100);
+
+#ifdef X86EMU_HAVE_ZSTD
+    // Fastest level; trace data compresses well even at this level
+    constexpr int ZSTD_LEVEL = 1;
+#endif
+
+    // Largest record: instruction header, opcode bytes and every register
+    constexpr uint32_t MAX_RECORD = 10 + I386_TRACE_MAX_INSN + 4 * I386_TRACE_REG_COUNT;
+
+    std::atomic<uint64_t> g_nextSession{1};
+
+    struct ThreadRing {
+        uint64_t session = 0;
+        void* ring = nullptr;
+    };
+    thread_local ThreadRing t_ring;
+
+    inline uint8_t* put16(uint8_t* p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+        return p + 2;
+    }
+
+    inline uint8_t* put32(uint8_t* p, uint32_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+        p[2] = static_cast<uint8_t>(v >> 16);
+        p[3] = static_cast<uint8_t>(v >> 24);
+        return p + 4;
+    }
+
+    inline uint32_t log2Size(uint32_t size)
+    {
+        uint32_t n = 0;
+        while ((1u << n) < size && n < trace_format::MEM_SIZE_MASK) {
+            n++;
+        }
+        return n;
+    }
+}
+
+/**
+ * @brief Single-producer single-consumer byte ring owned by one thread
+ */
+struct InstructionTracer::Ring {
+    uint32_t thread;
+    std::unique_ptr<uint8_t[]> data;
+    std::atomic<uint64_t> head{0};   // Written by the producer
+    std::atomic<uint64_t> tail{0};   // Written by the writer thread
+
+    // Producer-only delta state
+    uint32_t regs[I386_TRACE_REG_COUNT];
+    bool haveRegs = false;
+    std::atomic<uint64_t> instructions{0};
+
+    explicit Ring(uint32_t id) : thread(id), data(new uint8_t[RING_SIZE]) {}
+};
+
+InstructionTracer::InstructionTracer()
+    : m_file(nullptr)
+    , m_registerMask(ALL_REGISTERS)
+    , m_codec(trace_format::CODEC_NONE)
+    , m_session(0)
+    , m_hooks()
+    , m_stopping(false)
+    , m_bytesRaw(0)
+    , m_bytesStored(0)
+    , m_writeFailed(false)
+{
+}
+
+InstructionTracer::~InstructionTracer()
+{
+    close();
+}
+
+bool InstructionTracer::open(const std::string& path, uint32_t registerMask, bool recordMemory)
+{
+    close();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        Logger::GetInstance()->error("Failed to create instruction trace: %s", path.c_str());
+        return false;
+    }
+
+    m_path = path;
+    m_registerMask = registerMask & ALL_REGISTERS;
+#ifdef X86EMU_HAVE_ZSTD
+    m_codec = trace_format::CODEC_ZSTD;
+    m_compressed.resize(ZSTD_compressBound(CHUNK_SIZE));
+#else
+    m_codec = trace_format::CODEC_NONE;
+#endif
+    m_session = g_nextSession.fetch_add(1);
+    m_bytesRaw = 0;
+    m_bytesStored = 0;
+    m_writeFailed = false;
+    m_chunk.resize(CHUNK_SIZE);
+
+    uint8_t header[trace_format::HEADER_SIZE];
+    std::memcpy(header, trace_format::MAGIC, sizeof(trace_format::MAGIC));
+    uint8_t* p = header + sizeof(trace_format::MAGIC);
+    p = put32(p, trace_format::VERSION);
+    p = put32(p, m_codec);
+    p = put32(p, m_registerMask);
+    put32(p, recordMemory ? trace_format::FLAG_MEMORY : 0);
+    if (std::fwrite(header, sizeof(header), 1, m_file) != 1) {
+        Logger::GetInstance()->error("Failed to write instruction trace: %s", path.c_str());
+        std::fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    m_hooks.opaque = this;
+    m_hooks.instruction = &InstructionTracer::instructionHook;
+    m_hooks.memory = recordMemory ? &InstructionTracer::memoryHook : nullptr;
+
+    m_stopping = false;
+    m_writer = std::thread(&InstructionTracer::writerLoop, this);
+
+    Logger::GetInstance()->info("Instruction trace started: %s (%s)", path.c_str(),
+                                m_codec == trace_format::CODEC_ZSTD ? "zstd" : "uncompressed");
+    return true;
+}
+
+void InstructionTracer::close()
+{
+    if (!m_file) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_stopping = true;
+    }
+    m_writerWake.notify_one();
+    m_writer.join();
+
+    uint64_t instructions = getInstructionCount();
+    std::fclose(m_file);
+    m_file = nullptr;
+    m_hooks = i386_trace_hooks();
+
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_rings.clear();
+    }
+
+    if (m_writeFailed) {
+        Logger::GetInstance()->error("Instruction trace is incomplete: %s", m_path.c_str());
+    }
+    Logger::GetInstance()->info("Instruction trace closed: %llu instructions, %llu bytes (%llu before compression)",
+                                static_cast<unsigned long long>(instructions),
+                                static_cast<unsigned long long>(m_bytesStored),
+                                static_cast<unsigned long long>(m_bytesRaw));
+}
+
+const i386_trace_hooks* InstructionTracer::getHooks() const
+{
+    return m_file ? &m_hooks : nullptr;
+}
+
+uint64_t InstructionTracer::getInstructionCount() const
+{
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    uint64_t count = 0;
+    for (const auto& ring : m_rings) {
+        count += ring->instructions.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+InstructionTracer::Ring* InstructionTracer::getRing()
+{
+    if (t_ring.session == m_session) {
+        return static_cast<Ring*>(t_ring.ring);
+    }
+
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    m_rings.push_back(std::make_unique<Ring>(static_cast<uint32_t>(m_rings.size())));
+    t_ring.session = m_session;
+    t_ring.ring = m_rings.back().get();
+    return m_rings.back().get();
+}
+
+void InstructionTracer::append(Ring* ring, const uint8_t* data, uint32_t length)
+{
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+    // Wait for the writer rather than drop records
+    while (RING_SIZE - (head - ring->tail.load(std::memory_order_acquire)) < length) {
+        m_writerWake.notify_one();
+        std::this_thread::yield();
+    }
+
+    uint32_t offset = static_cast<uint32_t>(head & (RING_SIZE - 1));
+    uint32_t first = std::min(length, RING_SIZE - offset);
+    std::memcpy(&ring->data[offset], data, first);
+    if (first < length) {
+        std::memcpy(&ring->data[0], data + first, length - first);
+    }
+    ring->head.store(head + length, std::memory_order_release);
+
+    // Wake the writer each time a full chunk becomes available
+    if ((head / CHUNK_SIZE) != ((head + length) / CHUNK_SIZE)) {
+        m_writerWake.notify_one();
+    }
+}
+
+void InstructionTracer::instruction(uint32_t eip, uint16_t cs, const uint8_t* bytes, uint32_t length,
+                                    const uint32_t* regs)
+{
+    Ring* ring = getRing();
+    length = std::min<uint32_t>(length, I386_TRACE_MAX_INSN);
+
+    uint32_t changed = m_registerMask;
+    if (ring->haveRegs) {
+        changed = 0;
+        for (int i = 0; i < I386_TRACE_REG_COUNT; i++) {
+            if (regs[i] != ring->regs[i]) {
+                changed |= 1u << i;
+            }
+        }
+        changed &= m_registerMask;
+    }
+    ring->haveRegs = true;
+
+    uint8_t record[MAX_RECORD];
+    uint8_t* p = record;
+    *p++ = trace_format::TAG_INSTRUCTION;
+    *p++ = static_cast<uint8_t>(length);
+    p = put16(p, static_cast<uint16_t>(changed));
+    p = put32(p, eip);
+    p = put16(p, cs);
+    std::memcpy(p, bytes, length);
+    p += length;
+    for (int i = 0; i < I386_TRACE_REG_COUNT; i++) {
+        if (changed & (1u << i)) {
+            p = put32(p, regs[i]);
+            ring->regs[i] = regs[i];
+        }
+    }
+
+    append(ring, record, static_cast<uint32_t>(p - record));
+    ring->instructions.store(ring->instructions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void InstructionTracer::memoryAccess(uint32_t address, uint32_t size, bool write, bool hasValue, uint64_t value)
+{
+    uint8_t record[13];
+    uint8_t* p = record;
+    hasValue = hasValue && size <= 8;
+    *p++ = static_cast<uint8_t>(trace_format::TAG_MEMORY | (hasValue ? trace_format::MEM_HAS_VALUE : 0) |
+                                (write ? trace_format::MEM_WRITE : 0) | log2Size(size));
+    p = put32(p, address);
+    if (hasValue) {
+        for (uint32_t i = 0; i < size; i++) {
+            *p++ = static_cast<uint8_t>(value >> (i * 8));
+        }
+    }
+
+    append(getRing(), record, static_cast<uint32_t>(p - record));
+}
+
+void InstructionTracer::instructionHook(void* opaque, uint32_t eip, uint16_t cs, const uint8_t* bytes,
+                                        uint32_t length, const uint32_t* regs)
+{
+    static_cast<InstructionTracer*>(opaque)->instruction(eip, cs, bytes, length, regs);
+}
+
+void InstructionTracer::memoryHook(void* opaque, uint32_t address, uint32_t size, int write, int hasValue,
+                                   uint64_t value)
+{
+    static_cast<InstructionTracer*>(opaque)->memoryAccess(address, size, write != 0, hasValue != 0, value);
+}
+
+void InstructionTracer::writerLoop()
+{
+    std::vector<Ring*> rings;
+
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(m_writerMutex);
+            m_writerWake.wait_for(lock, WRITER_INTERVAL);
+            stopping = m_stopping;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_ringsMutex);
+            rings.clear();
+            for (const auto& ring : m_rings) {
+                rings.push_back(ring.get());
+            }
+        }
+
+        // Full chunks only while running, so chunks stay large and compress well
+        bool busy;
+        do {
+            busy = false;
+            for (Ring* ring : rings) {
+                busy = drain(ring, stopping) || busy;
+            }
+        } while (busy);
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    std::fflush(m_file);
+}
+
+bool InstructionTracer::drain(Ring* ring, bool all)
+{
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t available = ring->head.load(std::memory_order_acquire) - tail;
+    if (available == 0 || (!all && available < CHUNK_SIZE)) {
+        return false;
+    }
+
+    uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(available, CHUNK_SIZE));
+    uint32_t offset = static_cast<uint32_t>(tail & (RING_SIZE - 1));
+    uint32_t first = std::min(length, RING_SIZE - offset);
+    std::memcpy(m_chunk.data(), &ring->data[offset], first);
+    if (first < length) {
+        std::memcpy(m_chunk.data() + first, &ring->data[0], length - first);
+    }
+    ring->tail.store(tail + length, std::memory_order_release);
+
+    writeChunk(ring->thread, m_chunk.data(), length);
+    return true;
+}
+
+void InstructionTracer::writeChunk(uint32_t thread, const uint8_t* data, uint32_t length)
+{
+    const uint8_t* payload = data;
+    uint32_t stored = length;
+
+#ifdef X86EMU_HAVE_ZSTD
+    size_t size = ZSTD_compress(m_compressed.data(), m_compressed.size(), data, length, ZSTD_LEVEL);
+    if (!ZSTD_isError(size) && size < length) {
+        payload = m_compressed.data();
+        stored = static_cast<uint32_t>(size);
+    }
+#endif
+
+    uint8_t header[trace_format::CHUNK_HEADER_SIZE];
+    uint8_t* p = put32(header, thread);
+    p = put32(p, length);
+    put32(p, stored);
+
+    if (std::fwrite(header, sizeof(header), 1, m_file) != 1 ||
+        std::fwrite(payload, stored, 1, m_file) != 1) {
+        m_writeFailed = true;
+    }
+
+    m_bytesRaw += length;
+    m_bytesStored += sizeof(header) + stored;
+}
+
+} // namespace x86emu
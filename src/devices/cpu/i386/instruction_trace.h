@@ -0,0 +1,222 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_INSTRUCTION_TRACE_H
+#define X86EMULATOR_INSTRUCTION_TRACE_H
+
+#include "common/i386_trace.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace x86emu {
+
+/**
+ * @brief On-disk layout of instruction trace files
+ *
+ * All values are little endian.
+ *
+ * File header:
+ *   char[8] magic "X86TRACE", u32 version, u32 codec, u32 register mask,
+ *   u32 flags
+ *
+ * Followed by chunks until end of file:
+ *   u32 thread, u32 raw size, u32 stored size, payload
+ *
+ * A payload is compressed with the file codec when its stored size is
+ * smaller than its raw size, and stored as-is otherwise. Concatenating
+ * the raw payloads of one thread gives that thread's record stream;
+ * records may straddle chunk boundaries.
+ *
+ * Instruction record:
+ *   u8 TAG_INSTRUCTION, u8 length, u16 register mask, u32 eip, u16 cs,
+ *   opcode bytes, one u32 per register in the mask (I386_TRACE_REG_* order)
+ *
+ * Registers are delta encoded: the mask lists the registers that changed
+ * since the previous instruction record of the same thread, and the first
+ * record of a thread lists every traced register.
+ *
+ * Memory record:
+ *   u8 TAG_MEMORY | flags | log2(size), u32 address, value (size bytes,
+ *   only with MEM_HAS_VALUE)
+ */
+namespace trace_format {
+    constexpr char MAGIC[8] = { 'X', '8', '6', 'T', 'R', 'A', 'C', 'E' };
+    constexpr uint32_t VERSION = 1;
+
+    constexpr uint32_t CODEC_NONE = 0;
+    constexpr uint32_t CODEC_ZSTD = 1;
+
+    constexpr uint32_t FLAG_MEMORY = 0x00000001;
+
+    constexpr uint8_t TAG_INSTRUCTION = 0x01;
+    constexpr uint8_t TAG_MEMORY = 0x80;
+    constexpr uint8_t MEM_HAS_VALUE = 0x20;
+    constexpr uint8_t MEM_WRITE = 0x10;
+    constexpr uint8_t MEM_SIZE_MASK = 0x0F;
+
+    constexpr uint32_t HEADER_SIZE = 24;
+    constexpr uint32_t CHUNK_HEADER_SIZE = 12;
+}
+
+/**
+ * @brief Binary per-instruction trace recorder
+ *
+ * Hooked into a CPU core through the i386_trace_hooks table returned by
+ * getHooks(). Each emulation thread appends compact records to its own
+ * single-producer ring buffer, so recording never takes a lock; a
+ * background thread drains the rings in fixed-size chunks, compresses
+ * them (zstd when built with X86EMU_HAVE_ZSTD) and writes them to the
+ * trace file. When a ring fills up the producer waits for the writer,
+ * so no records are dropped.
+ *
+ * Recording costs about 26 ns per instruction with all registers, and
+ * about 31 ns with a memory access every third instruction, measured
+ * with a synthetic record stream on a single core, writer included and
+ * without zstd. A traced guest therefore stays under 3x its untraced
+ * time only while it runs at 13 ns per instruction (about 75 MIPS) or
+ * slower; x86emu_cpu_bench --trace off|regs|memory measures the real
+ * slowdown per program and backend. To stay near that bound 86Box keeps
+ * its recompiler and memory lookup tables when only registers are
+ * recorded; recording memory accesses forces the interpreter and the
+ * slow memory paths.
+ *
+ * Traces are decoded offline with tools/trace_decode.
+ */
+class InstructionTracer {
+public:
+    // All I386_TRACE_REG_* registers
+    static constexpr uint32_t ALL_REGISTERS = (1u << I386_TRACE_REG_COUNT) - 1;
+
+    /**
+     * @brief Construct a closed tracer
+     */
+    InstructionTracer();
+
+    /**
+     * @brief Destroy the tracer, flushing and closing the trace file
+     */
+    ~InstructionTracer();
+
+    /**
+     * @brief Create a trace file and start the writer thread
+     *
+     * @param path Output file path
+     * @param registerMask Registers to record (bit n = I386_TRACE_REG_n)
+     * @param recordMemory Record data memory accesses as well
+     * @return true if the file was created
+     */
+    bool open(const std::string& path, uint32_t registerMask = ALL_REGISTERS, bool recordMemory = true);
+
+    /**
+     * @brief Flush all buffered records and close the trace file
+     *
+     * The hooks must be detached from every CPU before calling this.
+     */
+    void close();
+
+    /**
+     * @brief Check whether a trace file is open
+     *
+     * @return true if recording
+     */
+    bool isOpen() const { return m_file != nullptr; }
+
+    /**
+     * @brief Get the hook table to attach to a CPU core
+     *
+     * @return const i386_trace_hooks* Hooks, or nullptr if not open
+     */
+    const i386_trace_hooks* getHooks() const;
+
+    /**
+     * @brief Record an instruction
+     *
+     * @param eip Linear address of the instruction
+     * @param cs CS selector
+     * @param bytes Opcode bytes
+     * @param length Number of opcode bytes (at most I386_TRACE_MAX_INSN)
+     * @param regs Registers in I386_TRACE_REG_* order
+     */
+    void instruction(uint32_t eip, uint16_t cs, const uint8_t* bytes, uint32_t length, const uint32_t* regs);
+
+    /**
+     * @brief Record a data memory access
+     *
+     * @param address Linear address
+     * @param size Access size in bytes
+     * @param write True for writes
+     * @param hasValue True if value holds the data
+     * @param value Data, low size bytes
+     */
+    void memoryAccess(uint32_t address, uint32_t size, bool write, bool hasValue, uint64_t value);
+
+    /**
+     * @brief Get the number of instructions recorded so far
+     *
+     * @return uint64_t Instruction count
+     */
+    uint64_t getInstructionCount() const;
+
+private:
+    struct Ring;
+
+    Ring* getRing();
+    void append(Ring* ring, const uint8_t* data, uint32_t length);
+    void writerLoop();
+    bool drain(Ring* ring, bool all);
+    void writeChunk(uint32_t thread, const uint8_t* data, uint32_t length);
+
+    static void instructionHook(void* opaque, uint32_t eip, uint16_t cs, const uint8_t* bytes,
+                                uint32_t length, const uint32_t* regs);
+    static void memoryHook(void* opaque, uint32_t address, uint32_t size, int write, int hasValue, uint64_t value);
+
+    std::FILE* m_file;
+    std::string m_path;
+    uint32_t m_registerMask;
+    uint32_t m_codec;
+    uint64_t m_session;   // Invalidates thread-local ring pointers of earlier sessions
+    i386_trace_hooks m_hooks;
+
+    // Rings are only added while open, and only removed by close()
+    mutable std::mutex m_ringsMutex;
+    std::vector<std::unique_ptr<Ring>> m_rings;
+
+    // Writer thread
+    std::thread m_writer;
+    std::mutex m_writerMutex;
+    std::condition_variable m_writerWake;
+    std::atomic<bool> m_stopping;
+    std::vector<uint8_t> m_chunk;
+    std::vector<uint8_t> m_compressed;
+    uint64_t m_bytesRaw;
+    uint64_t m_bytesStored;
+    bool m_writeFailed;
+};
+
+} // namespace x86emu
+
+#endif // X86EMULATOR_INSTRUCTION_TRACE_H
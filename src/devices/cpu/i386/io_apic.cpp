@@ -0,0 +1,224 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "io_apic.h"
+
+namespace x86emu {
+
+// Version register: 24 redirection entries (max index 23), version 0x11
+constexpr uint32_t IOAPIC_VERSION = 0x00170011;
+
+IOAPIC::IOAPIC(uint8_t apicId)
+    : m_id(apicId)
+{
+    reset();
+}
+
+IOAPIC::~IOAPIC()
+{
+}
+
+void IOAPIC::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_select = 0;
+    m_pinState = 0;
+
+    for (auto& entry : m_redirection) {
+        entry = RTE_MASKED;
+    }
+}
+
+uint32_t IOAPIC::readRegister(uint32_t offset) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    offset &= 0xF0;
+
+    if (offset == REG_SELECT) {
+        return m_select;
+    }
+    if (offset != REG_WINDOW) {
+        return 0;
+    }
+
+    if (m_select >= INDEX_REDIRECTION && m_select < INDEX_REDIRECTION + PIN_COUNT * 2) {
+        uint64_t entry = m_redirection[(m_select - INDEX_REDIRECTION) >> 1];
+        return static_cast<uint32_t>((m_select & 1) ? entry >> 32 : entry);
+    }
+
+    switch (m_select) {
+        case INDEX_ID:
+        case INDEX_ARBITRATION:
+            return static_cast<uint32_t>(m_id & 0x0F) << 24;
+        case INDEX_VERSION:
+            return IOAPIC_VERSION;
+        default:
+            return 0;
+    }
+}
+
+void IOAPIC::writeRegister(uint32_t offset, uint32_t value)
+{
+    LocalAPIC::IPIMessage message;
+    int count = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        offset &= 0xF0;
+
+        if (offset == REG_SELECT) {
+            m_select = static_cast<uint8_t>(value);
+        } else if (offset == REG_WINDOW) {
+            if (m_select >= INDEX_REDIRECTION && m_select < INDEX_REDIRECTION + PIN_COUNT * 2) {
+                int pin = (m_select - INDEX_REDIRECTION) >> 1;
+                uint64_t& entry = m_redirection[pin];
+
+                if (m_select & 1) {
+                    // Only the destination field is implemented in the high half
+                    entry = (entry & 0x00000000FFFFFFFFULL) | (static_cast<uint64_t>(value & 0xFF000000) << 32);
+                } else {
+                    entry = (entry & (0xFFFFFFFF00000000ULL | RTE_READ_ONLY)) | (value & ~RTE_READ_ONLY);
+                    if (!(entry & RTE_LEVEL)) {
+                        entry &= ~RTE_REMOTE_IRR;
+                    }
+
+                    // Unmasking a level-triggered pin that is still asserted delivers it
+                    if ((entry & RTE_LEVEL) && (m_pinState & (1u << pin)) && prepareDelivery(pin, message)) {
+                        count = 1;
+                    }
+                }
+            } else if (m_select == INDEX_ID) {
+                m_id = static_cast<uint8_t>((value >> 24) & 0x0F);
+            }
+        }
+    }
+
+    deliver(&message, count);
+}
+
+void IOAPIC::setIRQ(int pin, bool state)
+{
+    if (pin < 0 || pin >= PIN_COUNT) {
+        return;
+    }
+
+    LocalAPIC::IPIMessage message;
+    int count = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t mask = 1u << pin;
+        bool oldState = (m_pinState & mask) != 0;
+
+        if (state) {
+            m_pinState |= mask;
+        } else {
+            m_pinState &= ~mask;
+        }
+
+        // Edge-triggered pins fire on the rising edge, level-triggered
+        // pins whenever they are asserted and not awaiting an EOI
+        bool level = (m_redirection[pin] & RTE_LEVEL) != 0;
+        if (state && (level || !oldState) && prepareDelivery(pin, message)) {
+            count = 1;
+        }
+    }
+
+    deliver(&message, count);
+}
+
+void IOAPIC::endOfInterrupt(uint8_t vector)
+{
+    LocalAPIC::IPIMessage messages[PIN_COUNT];
+    int count = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (int pin = 0; pin < PIN_COUNT; pin++) {
+            uint64_t& entry = m_redirection[pin];
+            if ((entry & 0xFF) != vector || !(entry & RTE_REMOTE_IRR)) {
+                continue;
+            }
+
+            entry &= ~RTE_REMOTE_IRR;
+            if ((m_pinState & (1u << pin)) && prepareDelivery(pin, messages[count])) {
+                count++;
+            }
+        }
+    }
+
+    deliver(messages, count);
+}
+
+void IOAPIC::setDeliveryCallback(DeliveryCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_deliveryCallback = callback;
+}
+
+uint8_t IOAPIC::getId() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_id;
+}
+
+bool IOAPIC::prepareDelivery(int pin, LocalAPIC::IPIMessage& message)
+{
+    uint64_t& entry = m_redirection[pin];
+
+    if (entry & (RTE_MASKED | RTE_REMOTE_IRR)) {
+        return false;
+    }
+
+    message.sourceId = m_id;
+    message.vector = static_cast<uint8_t>(entry & 0xFF);
+    message.mode = static_cast<LocalAPIC::DeliveryMode>((entry >> 8) & 7);
+    message.logical = (entry & 0x800) != 0;
+    message.level = true;
+    message.triggerLevel = (entry & RTE_LEVEL) != 0;
+    message.shorthand = LocalAPIC::Shorthand::NONE;
+    message.destination = static_cast<uint8_t>(entry >> 56);
+
+    // Remote IRR holds a level-triggered pin until the EOI comes back
+    if (message.triggerLevel) {
+        entry |= RTE_REMOTE_IRR;
+    }
+    return true;
+}
+
+void IOAPIC::deliver(const LocalAPIC::IPIMessage* messages, int count)
+{
+    // Called without the lock held: delivery may come back through an EOI
+    DeliveryCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        callback = m_deliveryCallback;
+    }
+
+    for (int i = 0; i < count && callback; i++) {
+        callback(messages[i]);
+    }
+}
+
+} // namespace x86emu
@@ -0,0 +1,164 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_IO_APIC_H
+#define X86EMULATOR_IO_APIC_H
+
+#include "local_apic.h"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace x86emu {
+
+/**
+ * @brief I/O APIC emulation
+ *
+ * Routes device interrupt pins to local APICs. Each of the 24 pins has its
+ * own redirection entry (vector, delivery mode, destination, trigger mode
+ * and mask), so every PCI function can be given a private vector instead
+ * of sharing one of the few 8259 lines with other devices.
+ *
+ * Registers are accessed indirectly through IOREGSEL (offset 0x00) and
+ * IOWIN (offset 0x10). Interrupts are sent on the APIC bus through the
+ * delivery callback. Level-triggered pins set Remote IRR when delivered
+ * and are re-armed by the EOI broadcast from the local APICs.
+ */
+class IOAPIC {
+public:
+    /**
+     * @brief Default physical base address of the register window
+     */
+    static constexpr uint32_t DEFAULT_BASE = 0xFEC00000;
+
+    /**
+     * @brief Number of interrupt input pins
+     */
+    static constexpr int PIN_COUNT = 24;
+
+    /**
+     * @brief Callback used to send an interrupt on the APIC bus
+     */
+    using DeliveryCallback = std::function<void(const LocalAPIC::IPIMessage&)>;
+
+    /**
+     * @brief Construct a new I/O APIC
+     *
+     * @param apicId I/O APIC ID
+     */
+    explicit IOAPIC(uint8_t apicId);
+
+    /**
+     * @brief Destroy the I/O APIC
+     */
+    ~IOAPIC();
+
+    /**
+     * @brief Reset the I/O APIC to its power-on state (all pins masked)
+     */
+    void reset();
+
+    /**
+     * @brief Read a register of the window
+     *
+     * @param offset Offset within the register window
+     * @return Register value
+     */
+    uint32_t readRegister(uint32_t offset) const;
+
+    /**
+     * @brief Write a register of the window
+     *
+     * @param offset Offset within the register window
+     * @param value Value to write
+     */
+    void writeRegister(uint32_t offset, uint32_t value);
+
+    /**
+     * @brief Set the state of an interrupt pin
+     *
+     * The state is the logical asserted state of the line; the polarity
+     * bit is kept for the guest but not applied.
+     *
+     * @param pin Pin number (0-23)
+     * @param state true to assert, false to deassert
+     */
+    void setIRQ(int pin, bool state);
+
+    /**
+     * @brief Handle an EOI broadcast from a local APIC
+     *
+     * Clears Remote IRR of the level-triggered pins using the vector and
+     * redelivers those that are still asserted.
+     *
+     * @param vector Vector that was retired
+     */
+    void endOfInterrupt(uint8_t vector);
+
+    /**
+     * @brief Set the callback used to send interrupts
+     *
+     * @param callback Callback function
+     */
+    void setDeliveryCallback(DeliveryCallback callback);
+
+    /**
+     * @brief Get the I/O APIC ID
+     *
+     * @return I/O APIC ID
+     */
+    uint8_t getId() const;
+
+private:
+    // Register window offsets
+    static constexpr uint32_t REG_SELECT = 0x00;
+    static constexpr uint32_t REG_WINDOW = 0x10;
+
+    // Indirect register indices
+    static constexpr uint8_t INDEX_ID = 0x00;
+    static constexpr uint8_t INDEX_VERSION = 0x01;
+    static constexpr uint8_t INDEX_ARBITRATION = 0x02;
+    static constexpr uint8_t INDEX_REDIRECTION = 0x10;
+
+    // Redirection entry bits
+    static constexpr uint64_t RTE_DELIVERY_STATUS = 0x00001000;
+    static constexpr uint64_t RTE_REMOTE_IRR = 0x00004000;
+    static constexpr uint64_t RTE_LEVEL = 0x00008000;
+    static constexpr uint64_t RTE_MASKED = 0x00010000;
+    static constexpr uint64_t RTE_READ_ONLY = RTE_DELIVERY_STATUS | RTE_REMOTE_IRR;
+
+    uint8_t m_id;
+    uint8_t m_select;
+    uint64_t m_redirection[PIN_COUNT];
+    uint32_t m_pinState;     // Asserted pins, one bit per pin
+
+    DeliveryCallback m_deliveryCallback;
+
+    // Mutex for thread safety (devices may raise pins from their own threads)
+    mutable std::mutex m_mutex;
+
+    // Helper methods
+    bool prepareDelivery(int pin, LocalAPIC::IPIMessage& message);
+    void deliver(const LocalAPIC::IPIMessage* messages, int count);
+};
+
+} // namespace x86emu
+
+#endif // X86EMULATOR_IO_APIC_H
@@ -0,0 +1,406 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "local_apic.h"
+
+#include <cstring>
+
+namespace x86emu {
+
+// Version register: integrated APIC, 6 LVT entries (max LVT index 5)
+constexpr uint32_t APIC_VERSION = 0x00050014;
+
+LocalAPIC::LocalAPIC(uint8_t apicId)
+    : m_id(apicId)
+{
+    reset();
+}
+
+LocalAPIC::~LocalAPIC()
+{
+}
+
+void LocalAPIC::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_tpr = 0;
+    m_ldr = 0;
+    m_dfr = 0xFFFFFFFF;
+    m_svr = 0x000000FF;   // APIC software disabled, spurious vector 0xFF
+    m_esr = 0;
+    m_icrLow = 0;
+    m_icrHigh = 0;
+
+    for (auto& lvt : m_lvt) {
+        lvt = LVT_MASKED;
+    }
+
+    std::memset(m_irr, 0, sizeof(m_irr));
+    std::memset(m_isr, 0, sizeof(m_isr));
+    std::memset(m_tmr, 0, sizeof(m_tmr));
+
+    m_timerInitial = 0;
+    m_timerCurrent = 0;
+    m_timerDivide = 0;
+    m_timerRemainder = 0;
+}
+
+uint32_t LocalAPIC::readRegister(uint32_t offset) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    offset &= 0xFF0;
+
+    if (offset >= REG_ISR && offset < REG_ISR + 0x80) {
+        return m_isr[(offset - REG_ISR) >> 4];
+    }
+    if (offset >= REG_TMR && offset < REG_TMR + 0x80) {
+        return m_tmr[(offset - REG_TMR) >> 4];
+    }
+    if (offset >= REG_IRR && offset < REG_IRR + 0x80) {
+        return m_irr[(offset - REG_IRR) >> 4];
+    }
+    if (offset >= REG_LVT_TIMER && offset <= REG_LVT_ERROR) {
+        return m_lvt[(offset - REG_LVT_TIMER) >> 4];
+    }
+
+    switch (offset) {
+        case REG_ID:
+            return static_cast<uint32_t>(m_id) << 24;
+        case REG_VERSION:
+            return APIC_VERSION;
+        case REG_TPR:
+            return m_tpr;
+        case REG_APR:
+            return 0;
+        case REG_PPR:
+            return static_cast<uint32_t>(processorPriority());
+        case REG_LDR:
+            return m_ldr;
+        case REG_DFR:
+            return m_dfr;
+        case REG_SVR:
+            return m_svr;
+        case REG_ESR:
+            return m_esr;
+        case REG_ICR_LOW:
+            return m_icrLow;
+        case REG_ICR_HIGH:
+            return m_icrHigh;
+        case REG_TIMER_INITIAL:
+            return m_timerInitial;
+        case REG_TIMER_CURRENT:
+            return m_timerCurrent;
+        case REG_TIMER_DIVIDE:
+            return m_timerDivide;
+        default:
+            return 0;
+    }
+}
+
+void LocalAPIC::writeRegister(uint32_t offset, uint32_t value)
+{
+    IPIMessage message;
+    bool sendMessage = false;
+    int eoiVector = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        offset &= 0xFF0;
+
+        if (offset >= REG_LVT_TIMER && offset <= REG_LVT_ERROR) {
+            uint32_t& lvt = m_lvt[(offset - REG_LVT_TIMER) >> 4];
+            lvt = value;
+            // LVT entries are masked while the APIC is software disabled
+            if (!(m_svr & 0x100)) {
+                lvt |= LVT_MASKED;
+            }
+            return;
+        }
+
+        switch (offset) {
+            case REG_TPR:
+                m_tpr = value & 0xFF;
+                break;
+
+            case REG_EOI: {
+                int vector = highestBit(m_isr);
+                if (vector >= 0) {
+                    // Level-triggered vectors are also retired at the I/O APIC
+                    if (m_tmr[vector >> 5] & (1u << (vector & 31))) {
+                        eoiVector = vector;
+                    }
+                    m_isr[vector >> 5] &= ~(1u << (vector & 31));
+                    m_tmr[vector >> 5] &= ~(1u << (vector & 31));
+                }
+                break;
+            }
+
+            case REG_LDR:
+                m_ldr = value & 0xFF000000;
+                break;
+
+            case REG_DFR:
+                m_dfr = value | 0x0FFFFFFF;
+                break;
+
+            case REG_SVR:
+                m_svr = value & 0x3FF;
+                if (!(m_svr & 0x100)) {
+                    for (auto& lvt : m_lvt) {
+                        lvt |= LVT_MASKED;
+                    }
+                }
+                break;
+
+            case REG_ESR:
+                m_esr = 0;
+                break;
+
+            case REG_ICR_HIGH:
+                m_icrHigh = value & 0xFF000000;
+                break;
+
+            case REG_ICR_LOW:
+                m_icrLow = value & ~ICR_DELIVERY_PENDING;
+
+                message.sourceId = m_id;
+                message.vector = static_cast<uint8_t>(value & 0xFF);
+                message.mode = static_cast<DeliveryMode>((value >> 8) & 7);
+                message.logical = (value & 0x800) != 0;
+                message.level = (value & 0x4000) != 0;
+                message.triggerLevel = (value & 0x8000) != 0;
+                message.shorthand = static_cast<Shorthand>((value >> 18) & 3);
+                message.destination = static_cast<uint8_t>(m_icrHigh >> 24);
+                sendMessage = true;
+                break;
+
+            case REG_TIMER_INITIAL:
+                m_timerInitial = value;
+                m_timerCurrent = value;
+                m_timerRemainder = 0;
+                break;
+
+            case REG_TIMER_DIVIDE:
+                m_timerDivide = value & 0x0B;
+                break;
+
+            default:
+                // ID, version, PPR, ISR/TMR/IRR and current count are read-only
+                break;
+        }
+    }
+
+    // Send outside the lock: a self-IPI re-enters acceptInterrupt()
+    if (sendMessage && m_ipiCallback) {
+        m_ipiCallback(message);
+    }
+
+    // Likewise for the EOI broadcast, which may redeliver a still asserted line
+    if (eoiVector >= 0 && m_eoiCallback) {
+        m_eoiCallback(static_cast<uint8_t>(eoiVector));
+    }
+}
+
+void LocalAPIC::acceptInterrupt(uint8_t vector, bool level)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Vectors 0-15 are reserved and raise an illegal vector error
+    if (vector < 16) {
+        m_esr |= 0x40;
+        return;
+    }
+
+    setIRRBit(vector, level);
+}
+
+bool LocalAPIC::hasPendingInterrupt() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!(m_svr & 0x100)) {
+        return false;
+    }
+
+    int vector = highestBit(m_irr);
+    if (vector < 0) {
+        return false;
+    }
+
+    return (vector & 0xF0) > (processorPriority() & 0xF0);
+}
+
+int LocalAPIC::acknowledgeInterrupt()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    int vector = highestBit(m_irr);
+    if (vector < 0 || (vector & 0xF0) <= (processorPriority() & 0xF0)) {
+        return static_cast<int>(m_svr & 0xFF);
+    }
+
+    m_irr[vector >> 5] &= ~(1u << (vector & 31));
+    m_isr[vector >> 5] |= (1u << (vector & 31));
+    return vector;
+}
+
+void LocalAPIC::tick(int cycles)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_timerCurrent == 0 || cycles <= 0) {
+        return;
+    }
+
+    // Scale bus cycles by the divide configuration
+    uint32_t divisor = timerDivisor();
+    uint64_t total = static_cast<uint64_t>(cycles) + m_timerRemainder;
+    uint64_t ticks = total / divisor;
+    m_timerRemainder = static_cast<uint32_t>(total % divisor);
+
+    if (ticks < m_timerCurrent) {
+        m_timerCurrent -= static_cast<uint32_t>(ticks);
+        return;
+    }
+
+    // Timer expired
+    uint32_t lvt = m_lvt[0];
+    if (!(lvt & LVT_MASKED)) {
+        setIRRBit(static_cast<uint8_t>(lvt & 0xFF), false);
+    }
+
+    if ((lvt & LVT_TIMER_PERIODIC) && m_timerInitial != 0) {
+        uint64_t overrun = ticks - m_timerCurrent;
+        m_timerCurrent = m_timerInitial - static_cast<uint32_t>(overrun % m_timerInitial);
+    } else {
+        m_timerCurrent = 0;
+    }
+}
+
+bool LocalAPIC::matchesDestination(const IPIMessage& message) const
+{
+    switch (message.shorthand) {
+        case Shorthand::SELF:
+            return message.sourceId == m_id;
+        case Shorthand::ALL_INCLUDING_SELF:
+            return true;
+        case Shorthand::ALL_EXCLUDING_SELF:
+            return message.sourceId != m_id;
+        case Shorthand::NONE:
+            break;
+    }
+
+    if (!message.logical) {
+        // Physical destination mode
+        return message.destination == 0xFF || message.destination == m_id;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint8_t logicalId = static_cast<uint8_t>(m_ldr >> 24);
+    if ((m_dfr >> 28) == 0xF) {
+        // Flat model: destination is a bitmask of logical IDs
+        return (message.destination & logicalId) != 0;
+    }
+
+    // Cluster model: high nibble selects cluster, low nibble the members
+    return ((message.destination >> 4) == (logicalId >> 4) || (message.destination >> 4) == 0xF) &&
+           (message.destination & logicalId & 0x0F) != 0;
+}
+
+void LocalAPIC::setIPICallback(IPICallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ipiCallback = callback;
+}
+
+void LocalAPIC::setEOICallback(EOICallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_eoiCallback = callback;
+}
+
+LocalAPIC::IPIMessage LocalAPIC::decodeMSI(uint32_t address, uint32_t data)
+{
+    IPIMessage message;
+
+    // Not sent by a CPU, so shorthands never apply
+    message.sourceId = 0xFF;
+    message.vector = static_cast<uint8_t>(data & 0xFF);
+    message.mode = static_cast<DeliveryMode>((data >> 8) & 7);
+    message.logical = (address & 0x4) != 0;
+    message.level = (data & 0x4000) != 0;
+    message.triggerLevel = (data & 0x8000) != 0;
+    message.shorthand = Shorthand::NONE;
+    message.destination = static_cast<uint8_t>((address >> 12) & 0xFF);
+    return message;
+}
+
+bool LocalAPIC::isEnabled() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (m_svr & 0x100) != 0;
+}
+
+int LocalAPIC::highestBit(const uint32_t bits[8])
+{
+    for (int i = 7; i >= 0; i--) {
+        if (bits[i]) {
+            for (int bit = 31; bit >= 0; bit--) {
+                if (bits[i] & (1u << bit)) {
+                    return (i << 5) | bit;
+                }
+            }
+        }
+    }
+
+    return -1;
+}
+
+int LocalAPIC::processorPriority() const
+{
+    int isrVector = highestBit(m_isr);
+    int isrClass = isrVector >= 0 ? (isrVector & 0xF0) : 0;
+    int tprClass = static_cast<int>(m_tpr & 0xF0);
+
+    return tprClass >= isrClass ? static_cast<int>(m_tpr & 0xFF) : isrClass;
+}
+
+uint32_t LocalAPIC::timerDivisor() const
+{
+    // Divide configuration bits 0,1,3 encode a power of two (0b111 = 1)
+    uint32_t code = (m_timerDivide & 0x03) | ((m_timerDivide & 0x08) >> 1);
+    return code == 7 ? 1 : (2u << code);
+}
+
+void LocalAPIC::setIRRBit(uint8_t vector, bool level)
+{
+    m_irr[vector >> 5] |= (1u << (vector & 31));
+
+    if (level) {
+        m_tmr[vector >> 5] |= (1u << (vector & 31));
+    } else {
+        m_tmr[vector >> 5] &= ~(1u << (vector & 31));
+    }
+}
+
+} // namespace x86emu
@@ -0,0 +1,274 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_LOCAL_APIC_H
+#define X86EMULATOR_LOCAL_APIC_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace x86emu {
+
+/**
+ * @brief Local APIC emulation
+ *
+ * One instance exists per virtual CPU. Implements the xAPIC register file
+ * (IRR/ISR/TMR, task priority, spurious vector, LVT timer and the interrupt
+ * command register). Interprocessor interrupts written to the ICR are handed
+ * to the owning system through the IPI callback, which routes them to the
+ * destination APICs.
+ */
+class LocalAPIC {
+public:
+    /**
+     * @brief Default physical base address of the APIC register page
+     */
+    static constexpr uint32_t DEFAULT_BASE = 0xFEE00000;
+
+    /**
+     * @brief Interrupt delivery modes (ICR / LVT bits 8-10)
+     */
+    enum class DeliveryMode {
+        FIXED = 0,
+        LOWEST_PRIORITY = 1,
+        SMI = 2,
+        NMI = 4,
+        INIT = 5,
+        STARTUP = 6,
+        EXTINT = 7
+    };
+
+    /**
+     * @brief Destination shorthand (ICR bits 18-19)
+     */
+    enum class Shorthand {
+        NONE = 0,
+        SELF = 1,
+        ALL_INCLUDING_SELF = 2,
+        ALL_EXCLUDING_SELF = 3
+    };
+
+    /**
+     * @brief Decoded interprocessor interrupt
+     */
+    struct IPIMessage {
+        uint8_t sourceId;        // APIC ID of the sender
+        uint8_t vector;          // Interrupt vector
+        DeliveryMode mode;       // Delivery mode
+        bool logical;            // Logical destination mode
+        bool level;              // Level (assert) bit
+        bool triggerLevel;       // Level-triggered (ICR bit 15)
+        Shorthand shorthand;     // Destination shorthand
+        uint8_t destination;     // Destination field
+    };
+
+    /**
+     * @brief Callback used to send an IPI on the APIC bus
+     */
+    using IPICallback = std::function<void(const IPIMessage&)>;
+
+    /**
+     * @brief Callback used to broadcast the EOI of a level-triggered vector
+     */
+    using EOICallback = std::function<void(uint8_t vector)>;
+
+    /**
+     * @brief Construct a new Local APIC
+     *
+     * @param apicId APIC ID (also the vCPU index)
+     */
+    explicit LocalAPIC(uint8_t apicId);
+
+    /**
+     * @brief Destroy the Local APIC
+     */
+    ~LocalAPIC();
+
+    /**
+     * @brief Reset the APIC to its power-on state
+     */
+    void reset();
+
+    /**
+     * @brief Read an APIC register
+     *
+     * @param offset Offset within the APIC page
+     * @return Register value
+     */
+    uint32_t readRegister(uint32_t offset) const;
+
+    /**
+     * @brief Write an APIC register
+     *
+     * @param offset Offset within the APIC page
+     * @param value Value to write
+     */
+    void writeRegister(uint32_t offset, uint32_t value);
+
+    /**
+     * @brief Accept an interrupt from the APIC bus or an I/O APIC
+     *
+     * @param vector Interrupt vector
+     * @param level true for level-triggered interrupts
+     */
+    void acceptInterrupt(uint8_t vector, bool level = false);
+
+    /**
+     * @brief Check if an interrupt can be delivered to the CPU
+     *
+     * @return true if an unmasked interrupt above the processor priority is pending
+     */
+    bool hasPendingInterrupt() const;
+
+    /**
+     * @brief Acknowledge the highest priority pending interrupt
+     *
+     * Moves the vector from IRR to ISR.
+     *
+     * @return Interrupt vector, or the spurious vector if none is pending
+     */
+    int acknowledgeInterrupt();
+
+    /**
+     * @brief Advance the APIC timer
+     *
+     * @param cycles Number of bus clock cycles elapsed
+     */
+    void tick(int cycles);
+
+    /**
+     * @brief Check whether this APIC matches an IPI destination
+     *
+     * @param message IPI message
+     * @return true if the message is addressed to this APIC
+     */
+    bool matchesDestination(const IPIMessage& message) const;
+
+    /**
+     * @brief Set the callback used to send IPIs
+     *
+     * @param callback Callback function
+     */
+    void setIPICallback(IPICallback callback);
+
+    /**
+     * @brief Set the callback used to broadcast EOIs to the I/O APICs
+     *
+     * @param callback Callback function
+     */
+    void setEOICallback(EOICallback callback);
+
+    /**
+     * @brief Check whether an address lies in the MSI address window
+     *
+     * @param address Physical address of a bus master write
+     * @return true if the write is an MSI message
+     */
+    static bool isMSIAddress(uint32_t address) { return (address & 0xFFF00000) == DEFAULT_BASE; }
+
+    /**
+     * @brief Decode a message signalled interrupt into an APIC bus message
+     *
+     * @param address MSI address (destination ID, destination mode)
+     * @param data MSI data (vector, delivery mode, trigger mode)
+     * @return Decoded message
+     */
+    static IPIMessage decodeMSI(uint32_t address, uint32_t data);
+
+    /**
+     * @brief Get the APIC ID
+     *
+     * @return APIC ID
+     */
+    uint8_t getId() const { return m_id; }
+
+    /**
+     * @brief Check if the APIC is software enabled (SVR bit 8)
+     *
+     * @return true if enabled
+     */
+    bool isEnabled() const;
+
+private:
+    // Register offsets
+    static constexpr uint32_t REG_ID = 0x020;
+    static constexpr uint32_t REG_VERSION = 0x030;
+    static constexpr uint32_t REG_TPR = 0x080;
+    static constexpr uint32_t REG_APR = 0x090;
+    static constexpr uint32_t REG_PPR = 0x0A0;
+    static constexpr uint32_t REG_EOI = 0x0B0;
+    static constexpr uint32_t REG_LDR = 0x0D0;
+    static constexpr uint32_t REG_DFR = 0x0E0;
+    static constexpr uint32_t REG_SVR = 0x0F0;
+    static constexpr uint32_t REG_ISR = 0x100;
+    static constexpr uint32_t REG_TMR = 0x180;
+    static constexpr uint32_t REG_IRR = 0x200;
+    static constexpr uint32_t REG_ESR = 0x280;
+    static constexpr uint32_t REG_ICR_LOW = 0x300;
+    static constexpr uint32_t REG_ICR_HIGH = 0x310;
+    static constexpr uint32_t REG_LVT_TIMER = 0x320;
+    static constexpr uint32_t REG_LVT_THERMAL = 0x330;
+    static constexpr uint32_t REG_LVT_PERF = 0x340;
+    static constexpr uint32_t REG_LVT_LINT0 = 0x350;
+    static constexpr uint32_t REG_LVT_LINT1 = 0x360;
+    static constexpr uint32_t REG_LVT_ERROR = 0x370;
+    static constexpr uint32_t REG_TIMER_INITIAL = 0x380;
+    static constexpr uint32_t REG_TIMER_CURRENT = 0x390;
+    static constexpr uint32_t REG_TIMER_DIVIDE = 0x3E0;
+
+    static constexpr uint32_t LVT_MASKED = 0x00010000;
+    static constexpr uint32_t LVT_TIMER_PERIODIC = 0x00020000;
+    static constexpr uint32_t ICR_DELIVERY_PENDING = 0x00001000;
+
+    uint8_t m_id;
+    uint32_t m_tpr;
+    uint32_t m_ldr;
+    uint32_t m_dfr;
+    uint32_t m_svr;
+    uint32_t m_esr;
+    uint32_t m_icrLow;
+    uint32_t m_icrHigh;
+    uint32_t m_lvt[6];       // Timer, thermal, perf, LINT0, LINT1, error
+    uint32_t m_irr[8];       // Interrupt request register (256 bits)
+    uint32_t m_isr[8];       // In-service register (256 bits)
+    uint32_t m_tmr[8];       // Trigger mode register (256 bits)
+
+    // Timer state
+    uint32_t m_timerInitial;
+    uint32_t m_timerCurrent;
+    uint32_t m_timerDivide;
+    uint32_t m_timerRemainder;
+
+    IPICallback m_ipiCallback;
+    EOICallback m_eoiCallback;
+
+    // Mutex for thread safety (IPIs arrive from other vCPU threads)
+    mutable std::mutex m_mutex;
+
+    // Helper methods
+    static int highestBit(const uint32_t bits[8]);
+    int processorPriority() const;
+    uint32_t timerDivisor() const;
+    void setIRRBit(uint8_t vector, bool level);
+};
+
+} // namespace x86emu
+
+#endif // X86EMULATOR_LOCAL_APIC_H
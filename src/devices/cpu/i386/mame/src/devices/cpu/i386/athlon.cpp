@@ -14,6 +14,18 @@ athlonxp_device::athlonxp_device(const machine_config &mconfig, const char *tag,
 {
 	// TODO: put correct value
 	set_vtlb_dynamic_entries(256);
+	m_cache_emulation = true;
+}
+
+void athlonxp_device::set_cache_emulation(bool enable)
+{
+	// flush the cache before bypassing it, so no dirty line is lost
+	if (m_cache_emulation && !enable)
+	{
+		cache_writeback();
+		cache_invalidate();
+	}
+	m_cache_emulation = enable;
 }
 
 /*****************************************************************************/
@@ -167,6 +179,8 @@ int athlonxp_device::check_cacheable(offs_t address)
 	offs_t block;
 	int disabled;
 
+	if (!m_cache_emulation)
+		return 0;
 	disabled = 0;
 	if (m_cr[0] & (1 << 30))
 		disabled = 128;
@@ -15,6 +15,9 @@ public:
 	// construction/destruction
 	athlonxp_device(const machine_config &mconfig, const char *tag, device_t *owner, uint32_t clock);
 
+	// when off, every access bypasses the cache as if it were uncacheable
+	virtual void set_cache_emulation(bool enable) override;
+
 protected:
 	virtual void opcode_cpuid() override;
 	virtual uint64_t opcode_rdmsr(bool &valid_msr) override;
@@ -68,6 +71,7 @@ private:
 	uint64_t m_msr_mtrrfix[11];
 	uint8_t m_memory_ranges_1m[1024 / 4];
 	cpucache<17, 9, Cache2Way, CacheLineBytes64> cache; // 512 sets, 2 ways (cachelines per set), 64 bytes per cacheline
+	bool m_cache_emulation;
 };
 
 
@@ -22,6 +22,8 @@
 #include "i386.h"
 #include "i386priv.h"
 #include "x87priv.h"
+#include "i386simd.h"
+#include "../../../../../common/x87_fast_math.h"
 #include "cycles.h"
 #include "i386ops.h"
 
@@ -75,6 +77,9 @@ i386_device::i386_device(const machine_config &mconfig, device_type type, const
 {
 	// 32 unified
 	set_vtlb_dynamic_entries(32);
+
+	m_x87_fast = false;
+	m_trace = nullptr;
 }
 
 i386sx_device::i386sx_device(const machine_config &mconfig, const char *tag, device_t *owner, uint32_t clock)
@@ -1750,6 +1755,24 @@ uint8_t i386_device::read8_debug(uint32_t ea, uint8_t *data)
 	return 1;
 }
 
+void i386_device::i386_trace_instruction()
+{
+	uint8_t bytes[I386_TRACE_MAX_INSN];
+	uint32_t regs[I386_TRACE_REG_COUNT];
+	uint32_t length;
+
+	// the instruction length is not known yet, so pass the longest possible one
+	for (length = 0; length < I386_TRACE_MAX_INSN; length++)
+		if (!read8_debug(m_pc + length, &bytes[length]))
+			break;
+
+	for (int i = EAX; i <= EDI; i++)
+		regs[I386_TRACE_REG_EAX + i] = REG32(i);
+	regs[I386_TRACE_REG_EFLAGS] = get_flags();
+
+	m_trace->instruction(m_trace->opaque, m_pc, m_sreg[CS].selector, bytes, length, regs);
+}
+
 uint32_t i386_device::i386_get_debug_desc(I386_SREG *seg)
 {
 	uint32_t base, limit, address;
@@ -2830,6 +2853,8 @@ void i386_device::execute_run()
 		m_prev_eip = m_eip;
 
 		debugger_instruction_hook(m_pc);
+		if (m_trace)
+			i386_trace_instruction();
 
 		if(m_delayed_interrupt_enable != 0)
 		{
@@ -15,6 +15,7 @@
 #include "divtlb.h"
 
 #include "i386dasm.h"
+#include "../../../../../common/i386_trace.h"
 
 #define INPUT_LINE_A20      1
 #define INPUT_LINE_SMI      2
@@ -35,6 +36,15 @@ public:
 	auto smiact() { return m_smiact.bind(); }
 	auto ferr() { return m_ferr_handler.bind(); }
 
+	// use the host FPU for common x87 arithmetic when it matches SoftFloat
+	void set_x87_fast(bool enable) { m_x87_fast = enable; }
+
+	// report every instruction and data access to the given hooks, nullptr to stop
+	void set_trace_hooks(const i386_trace_hooks *hooks) { m_trace = hooks; }
+
+	// model the contents of the on-chip cache, for the cores that have one
+	virtual void set_cache_emulation(bool enable) {}
+
 	uint64_t debug_segbase(int params, const uint64_t *param);
 	uint64_t debug_seglimit(int params, const uint64_t *param);
 	uint64_t debug_segofftovirt(int params, const uint64_t *param);
@@ -368,6 +378,8 @@ protected:
 	uint16_t m_x87_cs;
 	uint32_t m_x87_inst_ptr;
 	uint16_t m_x87_opcode;
+	bool m_x87_fast;
+	const i386_trace_hooks *m_trace;
 
 	i386_modrm_func m_opcode_table_x87_d8[256];
 	i386_modrm_func m_opcode_table_x87_d9[256];
@@ -443,19 +455,20 @@ protected:
 	inline uint8_t FETCH();
 	inline uint16_t FETCH16();
 	inline uint32_t FETCH32();
-	inline uint8_t READ8(uint32_t ea) { return READ8PL(ea, m_CPL); }
-	inline uint16_t READ16(uint32_t ea) { return READ16PL(ea, m_CPL); }
-	inline uint32_t READ32(uint32_t ea) { return READ32PL(ea, m_CPL); }
-	inline uint64_t READ64(uint32_t ea) { return READ64PL(ea, m_CPL); }
+	inline void TRACE_MEM(uint32_t ea, int size, int write, uint64_t value) { if (m_trace && m_trace->memory) m_trace->memory(m_trace->opaque, ea, size, write, 1, value); }
+	inline uint8_t READ8(uint32_t ea) { uint8_t value = READ8PL(ea, m_CPL); TRACE_MEM(ea, 1, 0, value); return value; }
+	inline uint16_t READ16(uint32_t ea) { uint16_t value = READ16PL(ea, m_CPL); TRACE_MEM(ea, 2, 0, value); return value; }
+	inline uint32_t READ32(uint32_t ea) { uint32_t value = READ32PL(ea, m_CPL); TRACE_MEM(ea, 4, 0, value); return value; }
+	inline uint64_t READ64(uint32_t ea) { uint64_t value = READ64PL(ea, m_CPL); TRACE_MEM(ea, 8, 0, value); return value; }
 	virtual uint8_t READ8PL(uint32_t ea, uint8_t privilege);
 	virtual uint16_t READ16PL(uint32_t ea, uint8_t privilege);
 	virtual uint32_t READ32PL(uint32_t ea, uint8_t privilege);
 	virtual uint64_t READ64PL(uint32_t ea, uint8_t privilege);
 	inline void WRITE_TEST(uint32_t ea);
-	inline void WRITE8(uint32_t ea, uint8_t value) { WRITE8PL(ea, m_CPL, value); }
-	inline void WRITE16(uint32_t ea, uint16_t value) { WRITE16PL(ea, m_CPL, value); }
-	inline void WRITE32(uint32_t ea, uint32_t value) { WRITE32PL(ea, m_CPL, value); }
-	inline void WRITE64(uint32_t ea, uint64_t value) { WRITE64PL(ea, m_CPL, value); }
+	inline void WRITE8(uint32_t ea, uint8_t value) { WRITE8PL(ea, m_CPL, value); TRACE_MEM(ea, 1, 1, value); }
+	inline void WRITE16(uint32_t ea, uint16_t value) { WRITE16PL(ea, m_CPL, value); TRACE_MEM(ea, 2, 1, value); }
+	inline void WRITE32(uint32_t ea, uint32_t value) { WRITE32PL(ea, m_CPL, value); TRACE_MEM(ea, 4, 1, value); }
+	inline void WRITE64(uint32_t ea, uint64_t value) { WRITE64PL(ea, m_CPL, value); TRACE_MEM(ea, 8, 1, value); }
 	virtual void WRITE8PL(uint32_t ea, uint8_t privilege, uint8_t value);
 	virtual void WRITE16PL(uint32_t ea, uint8_t privilege, uint16_t value);
 	virtual void WRITE32PL(uint32_t ea, uint8_t privilege, uint32_t value);
@@ -538,6 +551,7 @@ protected:
 	void i386_decode_four_byte3af2();
 	void i386_decode_four_byte38f3();
 	uint8_t read8_debug(uint32_t ea, uint8_t *data);
+	void i386_trace_instruction();
 	uint32_t i386_get_debug_desc(I386_SREG *seg);
 	void CYCLES(int x);
 	inline void CYCLES_RM(int modrm, int r, int m);
@@ -615,6 +629,8 @@ protected:
 	void i386_outsb();
 	void i386_outsw();
 	void i386_outsd();
+	uint32_t i386_rep_bulk_span(int seg, uint32_t offset, uint32_t count, int size, int write, uint8_t **ptr);
+	uint32_t i386_rep_bulk(uint8_t opcode, uint32_t count, int32_t cycle_adjustment);
 	void i386_repeat(int invert_flag);
 	void i386_rep();
 	void i386_repne();
@@ -1408,6 +1424,7 @@ protected:
 	floatx80 x87_sub(floatx80 a, floatx80 b);
 	floatx80 x87_mul(floatx80 a, floatx80 b);
 	floatx80 x87_div(floatx80 a, floatx80 b);
+	bool x87_fast_op(int op, floatx80 a, floatx80 b, floatx80 &result);
 	void x87_fadd_m32real(uint8_t modrm);
 	void x87_fadd_m64real(uint8_t modrm);
 	void x87_fadd_st_sti(uint8_t modrm);
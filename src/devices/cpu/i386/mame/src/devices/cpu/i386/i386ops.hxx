@@ -1096,6 +1096,164 @@ void i386_device::i386_outsd()             // Opcode 0x6f
 	i386_outs_generic(4);
 }
 
+// Returns how many elements (at most count) of a string operand starting at
+// seg:offset lie in one page of directly mapped memory and inside the segment
+// limit, and the host address of the lowest byte they cover. Page faults and
+// limit violations are left to the per-iteration path by returning 0.
+uint32_t i386_device::i386_rep_bulk_span(int seg, uint32_t offset, uint32_t count, int size, int write, uint8_t **ptr)
+{
+	uint32_t linear = m_sreg[seg].base + offset;
+	uint32_t page = linear & 0xfff;
+	uint32_t n, last, address, error;
+
+	if (page + size > 0x1000)
+		return 0;
+
+	if (m_DF)
+	{
+		n = std::min(page / size, offset / size) + 1;
+		n = std::min(n, count);
+		last = offset - (n - 1) * size;
+	}
+	else
+	{
+		n = (0x1000 - page) / size;
+		if (!m_address_size)
+			n = std::min(n, (0x10000 - offset) / size);
+		n = std::min(n, count);
+		last = offset + (n - 1) * size;
+	}
+
+	if (n < 2 || i386_limit_check(seg, offset, size) || i386_limit_check(seg, last, size))
+		return 0;
+
+	address = linear;
+	if (!translate_address(m_CPL, write ? TR_WRITE : TR_READ, &address, &error))
+		return 0;
+	address &= m_a20_mask;
+	if (m_DF)
+		address -= (n - 1) * size;
+
+	uint8_t *base = (uint8_t *)(write ? m_program->get_write_ptr(address) : m_program->get_read_ptr(address));
+	uint8_t *end = (uint8_t *)(write ? m_program->get_write_ptr(address + n * size - 1) : m_program->get_read_ptr(address + n * size - 1));
+	if (!base || end != base + n * size - 1)
+		return 0;
+
+	*ptr = base;
+	return n;
+}
+
+// Runs the remaining iterations of REP MOVS/STOS/INS/OUTS a page at a time
+// with host block copies while the operands stay in RAM, charging the same
+// cycles as the per-iteration loop. Returns the new count register value.
+uint32_t i386_device::i386_rep_bulk(uint8_t opcode, uint32_t count, int32_t cycle_adjustment)
+{
+	int size = (opcode & 1) ? (m_operand_size ? 4 : 2) : 1;
+	int src_seg = m_segment_prefix ? m_segment_override : DS;
+	int32_t cost;
+	uint8_t *src, *dst;
+	uint32_t n;
+
+	// host copies assume guest byte order, and bypass debugger watchpoints
+	if (ENDIANNESS_NATIVE != ENDIANNESS_LITTLE || m_TF || debugger_enabled())
+		return count;
+
+	switch (opcode)
+	{
+		case 0xa4: case 0xa5:
+			cost = PROTECTED_MODE ? m_cycle_table_pm[CYCLES_MOVS] : m_cycle_table_rm[CYCLES_MOVS];
+			break;
+		case 0xaa: case 0xab:
+			cost = PROTECTED_MODE ? m_cycle_table_pm[CYCLES_STOS] : m_cycle_table_rm[CYCLES_STOS];
+			break;
+		case 0x6c: case 0x6d:
+			cost = PROTECTED_MODE ? m_cycle_table_pm[CYCLES_INS] : m_cycle_table_rm[CYCLES_INS];
+			break;
+		case 0x6e: case 0x6f:
+			cost = PROTECTED_MODE ? m_cycle_table_pm[CYCLES_OUTS] : m_cycle_table_rm[CYCLES_OUTS];
+			break;
+		default:
+			return count;
+	}
+	cost += cycle_adjustment;
+
+	while (count > 1 && m_cycles > 0)
+	{
+		uint32_t si = m_address_size ? REG32(ESI) : REG16(SI);
+		uint32_t di = m_address_size ? REG32(EDI) : REG16(DI);
+		uint32_t limit = (cost > 0) ? std::min<uint32_t>(count, (m_cycles + cost - 1) / cost) : count;
+
+		switch (opcode)
+		{
+			case 0xa4: case 0xa5:
+				n = i386_rep_bulk_span(src_seg, si, limit, size, 0, &src);
+				n = n ? i386_rep_bulk_span(ES, di, n, size, 1, &dst) : 0;
+				// a shorter destination run moves the lowest source byte when counting down
+				n = (n && m_DF) ? i386_rep_bulk_span(src_seg, si, n, size, 0, &src) : n;
+				if (!n || (dst < src + n * size && src < dst + n * size))
+					return count;
+				memcpy(dst, src, n * size);
+				break;
+
+			case 0xaa: case 0xab:
+				n = i386_rep_bulk_span(ES, di, limit, size, 1, &dst);
+				if (!n)
+					return count;
+				if (size == 1)
+				{
+					memset(dst, REG8(AL), n);
+				}
+				else
+				{
+					uint32_t v = (size == 2) ? REG16(AX) : REG32(EAX);
+					for (uint32_t i = 0; i < n; i++)
+						memcpy(dst + i * size, &v, size);
+				}
+				break;
+
+			case 0x6c: case 0x6d:
+				n = i386_rep_bulk_span(ES, di, limit, size, 1, &dst);
+				if (!n)
+					return count;
+				for (uint32_t i = 0; i < n; i++)
+				{
+					uint32_t v = (size == 1) ? READPORT8(REG16(DX)) : (size == 2) ? READPORT16(REG16(DX)) : READPORT32(REG16(DX));
+					memcpy(dst + (m_DF ? n - 1 - i : i) * size, &v, size);
+				}
+				break;
+
+			default:
+				n = i386_rep_bulk_span(src_seg, si, limit, size, 0, &src);
+				if (!n)
+					return count;
+				for (uint32_t i = 0; i < n; i++)
+				{
+					uint32_t v = 0;
+					memcpy(&v, src + (m_DF ? n - 1 - i : i) * size, size);
+					if (size == 1)
+						WRITEPORT8(REG16(DX), v);
+					else if (size == 2)
+						WRITEPORT16(REG16(DX), v);
+					else
+						WRITEPORT32(REG16(DX), v);
+				}
+				break;
+		}
+
+		if (opcode == 0xa4 || opcode == 0xa5 || opcode == 0x6e || opcode == 0x6f)
+			BUMP_SI(n * size);
+		if (opcode != 0x6e && opcode != 0x6f)
+			BUMP_DI(n * size);
+		count -= n;
+		if (m_address_size)
+			REG32(ECX) = count;
+		else
+			REG16(CX) = count;
+		CYCLES_NUM(n * cost);
+	}
+	return count;
+}
+
 void i386_device::i386_repeat(int invert_flag)
 {
 	uint32_t repeated_eip = m_eip;
@@ -1278,6 +1436,8 @@ void i386_device::i386_repeat(int invert_flag)
 			count = --REG32(ECX);
 		else
 			count = --REG16(CX);
+		if (count && !flag)
+			count = i386_rep_bulk(opcode, count, cycle_adjustment);
 		if (count && (m_cycles <= 0))
 			goto outofcycles;
 	}
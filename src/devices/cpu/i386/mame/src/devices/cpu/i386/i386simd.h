@@ -0,0 +1,218 @@
+// license:BSD-3-Clause
+// copyright-holders:Ville Linde, Barry Rodewald, Carl, Philip Bennett
+/***************************************************************************
+
+    i386simd.h
+
+    Packed integer helpers for the MMX and SSE2 opcode handlers. Every
+    helper takes the destination and source register (MMX_REG or XMM_REG)
+    and computes the guest result for all lanes at once. Hosts with SSE2
+    use the equivalent host instruction; everything else gets a plain
+    per-lane loop with identical results.
+
+***************************************************************************/
+
+#ifndef MAME_CPU_I386_I386SIMD_H
+#define MAME_CPU_I386_I386SIMD_H
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// use SSE2 on 64-bit implementations, where it can be assumed
+#if (!defined(MAME_DEBUG) || defined(__OPTIMIZE__)) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define I386_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+
+/***************************************************************************
+    LANE HELPERS
+***************************************************************************/
+
+#ifdef I386_SIMD_SSE2
+
+// MMX registers occupy the low 64 bits of a host register, the upper half is zero
+template <typename R> inline __m128i simd_load(const R &r)
+{
+	if (sizeof(R) == 8)
+		return _mm_loadl_epi64((const __m128i *)&r);
+	return _mm_loadu_si128((const __m128i *)&r);
+}
+
+template <typename R> inline void simd_store(R &r, __m128i v)
+{
+	if (sizeof(R) == 8)
+		_mm_storel_epi64((__m128i *)&r, v);
+	else
+		_mm_storeu_si128((__m128i *)&r, v);
+}
+
+// the pack instructions take their low half from the destination and their high half from the source
+#define I386_SIMD_PACK(name, intrin, lane, slane, expr) \
+	template <typename R> inline void simd_##name(R &d, const R &s) \
+	{ \
+		__m128i a = simd_load(d); \
+		__m128i b = simd_load(s); \
+		if (sizeof(R) == 8) \
+			a = b = _mm_unpacklo_epi64(a, b); \
+		simd_store(d, intrin(a, b)); \
+	}
+
+#define I386_SIMD_LANEWISE(name, intrin, lane, expr) \
+	template <typename R> inline void simd_##name(R &d, const R &s) \
+	{ \
+		simd_store(d, intrin(simd_load(d), simd_load(s))); \
+	}
+
+#else
+
+inline int8_t simd_sat_s8(int32_t v) { return v > 127 ? 127 : v < -128 ? -128 : v; }
+inline uint8_t simd_sat_u8(int32_t v) { return v > 255 ? 255 : v < 0 ? 0 : v; }
+inline int16_t simd_sat_s16(int32_t v) { return v > 32767 ? 32767 : v < -32768 ? -32768 : v; }
+
+#define I386_SIMD_PACK(name, intrin, lane, slane, expr) \
+	template <typename R> inline void simd_##name(R &d, const R &s) \
+	{ \
+		const int count = sizeof(R) / sizeof(d.slane[0]); \
+		R lo = d, hi = s; \
+		for (int n = 0; n < count; n++) \
+		{ \
+			const auto a = lo.slane[n]; \
+			d.lane[n] = expr; \
+		} \
+		for (int n = 0; n < count; n++) \
+		{ \
+			const auto a = hi.slane[n]; \
+			d.lane[n + count] = expr; \
+		} \
+	}
+
+#define I386_SIMD_LANEWISE(name, intrin, lane, expr) \
+	template <typename R> inline void simd_##name(R &d, const R &s) \
+	{ \
+		for (int n = 0; n < int(sizeof(R) / sizeof(d.lane[0])); n++) \
+		{ \
+			const auto a = d.lane[n]; \
+			const auto b = s.lane[n]; \
+			d.lane[n] = expr; \
+		} \
+	}
+
+#endif
+
+
+/***************************************************************************
+    OPERATIONS
+***************************************************************************/
+
+I386_SIMD_LANEWISE(paddb,   _mm_add_epi8,     b, a + b)
+I386_SIMD_LANEWISE(paddw,   _mm_add_epi16,    w, a + b)
+I386_SIMD_LANEWISE(paddd,   _mm_add_epi32,    d, a + b)
+I386_SIMD_LANEWISE(paddsb,  _mm_adds_epi8,    c, simd_sat_s8(a + b))
+I386_SIMD_LANEWISE(paddsw,  _mm_adds_epi16,   s, simd_sat_s16(a + b))
+I386_SIMD_LANEWISE(paddusb, _mm_adds_epu8,    b, simd_sat_u8(a + b))
+I386_SIMD_LANEWISE(paddusw, _mm_adds_epu16,   w, a > 0xffff - b ? 0xffff : a + b)
+I386_SIMD_LANEWISE(psubb,   _mm_sub_epi8,     b, a - b)
+I386_SIMD_LANEWISE(psubw,   _mm_sub_epi16,    w, a - b)
+I386_SIMD_LANEWISE(psubd,   _mm_sub_epi32,    d, a - b)
+I386_SIMD_LANEWISE(psubsb,  _mm_subs_epi8,    c, simd_sat_s8(a - b))
+I386_SIMD_LANEWISE(psubsw,  _mm_subs_epi16,   s, simd_sat_s16(a - b))
+I386_SIMD_LANEWISE(psubusb, _mm_subs_epu8,    b, a < b ? 0 : a - b)
+I386_SIMD_LANEWISE(psubusw, _mm_subs_epu16,   w, a < b ? 0 : a - b)
+I386_SIMD_LANEWISE(pmullw,  _mm_mullo_epi16,  w, uint32_t(a) * b)
+I386_SIMD_LANEWISE(pmulhw,  _mm_mulhi_epi16,  s, (int32_t(a) * b) >> 16)
+I386_SIMD_LANEWISE(pmulhuw, _mm_mulhi_epu16,  w, (uint32_t(a) * b) >> 16)
+I386_SIMD_LANEWISE(pcmpeqb, _mm_cmpeq_epi8,   b, a == b ? 0xff : 0)
+I386_SIMD_LANEWISE(pcmpeqw, _mm_cmpeq_epi16,  w, a == b ? 0xffff : 0)
+I386_SIMD_LANEWISE(pcmpeqd, _mm_cmpeq_epi32,  d, a == b ? 0xffffffff : 0)
+I386_SIMD_LANEWISE(pcmpgtb, _mm_cmpgt_epi8,   c, a > b ? -1 : 0)
+I386_SIMD_LANEWISE(pcmpgtw, _mm_cmpgt_epi16,  s, a > b ? -1 : 0)
+I386_SIMD_LANEWISE(pcmpgtd, _mm_cmpgt_epi32,  i, a > b ? -1 : 0)
+I386_SIMD_LANEWISE(pavgb,   _mm_avg_epu8,     b, (a + b + 1) >> 1)
+I386_SIMD_LANEWISE(pavgw,   _mm_avg_epu16,    w, (a + b + 1) >> 1)
+I386_SIMD_LANEWISE(pminub,  _mm_min_epu8,     b, a < b ? a : b)
+I386_SIMD_LANEWISE(pmaxub,  _mm_max_epu8,     b, a > b ? a : b)
+I386_SIMD_LANEWISE(pminsw,  _mm_min_epi16,    s, a < b ? a : b)
+I386_SIMD_LANEWISE(pmaxsw,  _mm_max_epi16,    s, a > b ? a : b)
+
+I386_SIMD_PACK(packsswb, _mm_packs_epi16,  c, s, simd_sat_s8(a))
+I386_SIMD_PACK(packuswb, _mm_packus_epi16, b, s, simd_sat_u8(a))
+I386_SIMD_PACK(packssdw, _mm_packs_epi32,  s, i, simd_sat_s16(a))
+
+#undef I386_SIMD_LANEWISE
+#undef I386_SIMD_PACK
+
+// the remaining operations have 64-bit lanes, which MMX_REG only exposes as a scalar
+
+template <typename R> inline void simd_paddq(R &d, const R &s)
+{
+#ifdef I386_SIMD_SSE2
+	simd_store(d, _mm_add_epi64(simd_load(d), simd_load(s)));
+#else
+	uint64_t a[sizeof(R) / 8], b[sizeof(R) / 8];
+	memcpy(a, &d, sizeof(R));
+	memcpy(b, &s, sizeof(R));
+	for (int n = 0; n < int(sizeof(R) / 8); n++)
+		a[n] += b[n];
+	memcpy(&d, a, sizeof(R));
+#endif
+}
+
+template <typename R> inline void simd_psubq(R &d, const R &s)
+{
+#ifdef I386_SIMD_SSE2
+	simd_store(d, _mm_sub_epi64(simd_load(d), simd_load(s)));
+#else
+	uint64_t a[sizeof(R) / 8], b[sizeof(R) / 8];
+	memcpy(a, &d, sizeof(R));
+	memcpy(b, &s, sizeof(R));
+	for (int n = 0; n < int(sizeof(R) / 8); n++)
+		a[n] -= b[n];
+	memcpy(&d, a, sizeof(R));
+#endif
+}
+
+template <typename R> inline void simd_pmuludq(R &d, const R &s)
+{
+#ifdef I386_SIMD_SSE2
+	simd_store(d, _mm_mul_epu32(simd_load(d), simd_load(s)));
+#else
+	uint64_t r[sizeof(R) / 8];
+	for (int n = 0; n < int(sizeof(R) / 8); n++)
+		r[n] = uint64_t(d.d[n * 2]) * s.d[n * 2];
+	memcpy(&d, r, sizeof(R));
+#endif
+}
+
+template <typename R> inline void simd_psadbw(R &d, const R &s)
+{
+#ifdef I386_SIMD_SSE2
+	simd_store(d, _mm_sad_epu8(simd_load(d), simd_load(s)));
+#else
+	uint64_t r[sizeof(R) / 8];
+	for (int n = 0; n < int(sizeof(R) / 8); n++)
+	{
+		r[n] = 0;
+		for (int i = n * 8; i < n * 8 + 8; i++)
+			r[n] += d.b[i] > s.b[i] ? d.b[i] - s.b[i] : s.b[i] - d.b[i];
+	}
+	memcpy(&d, r, sizeof(R));
+#endif
+}
+
+template <typename R> inline void simd_pmaddwd(R &d, const R &s)
+{
+#ifdef I386_SIMD_SSE2
+	simd_store(d, _mm_madd_epi16(simd_load(d), simd_load(s)));
+#else
+	// the sum wraps when all four words are -32768, as on hardware
+	R r;
+	for (int n = 0; n < int(sizeof(R) / 4); n++)
+		r.d[n] = uint32_t(int32_t(d.s[n * 2]) * s.s[n * 2]) + uint32_t(int32_t(d.s[n * 2 + 1]) * s.s[n * 2 + 1]);
+	d = r;
+#endif
+}
+
+#endif // MAME_CPU_I386_I386SIMD_H
@@ -1128,42 +1128,6 @@ void i386_device::pentium_tzcnt_r32_rm32()
 	// TODO: actually implement TZCNT
 }
 
-static inline int8_t SaturatedSignedWordToSignedByte(int16_t word)
-{
-	if (word > 127)
-		return 127;
-	if (word < -128)
-		return -128;
-	return (int8_t)word;
-}
-
-static inline uint8_t SaturatedSignedWordToUnsignedByte(int16_t word)
-{
-	if (word > 255)
-		return 255;
-	if (word < 0)
-		return 0;
-	return (uint8_t)word;
-}
-
-static inline int16_t SaturatedSignedDwordToSignedWord(int32_t dword)
-{
-	if (dword > 32767)
-		return 32767;
-	if (dword < -32768)
-		return -32768;
-	return (int16_t)dword;
-}
-
-static inline uint16_t SaturatedSignedDwordToUnsignedWord(int32_t dword)
-{
-	if (dword > 65535)
-		return 65535;
-	if (dword < 0)
-		return 0;
-	return (uint16_t)dword;
-}
-
 void i386_device::mmx_group_0f71()  // Opcode 0f 71
 {
 	uint8_t modm = FETCH();
@@ -1420,12 +1384,12 @@ void i386_device::mmx_paddq_r64_rm64()  // Opcode 0f d4
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX((modrm >> 3) & 0x7).q=MMX((modrm >> 3) & 0x7).q+MMX(modrm & 7).q;
+		simd_paddq(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
-		MMX_REG src;
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READMMX(ea, src);
-		MMX((modrm >> 3) & 0x7).q=MMX((modrm >> 3) & 0x7).q+src.q;
+		READMMX(ea, s);
+		simd_paddq(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -1435,54 +1399,42 @@ void i386_device::mmx_pmullw_r64_rm64()  // Opcode 0f d5
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX((modrm >> 3) & 0x7).w[0]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[0]*(int32_t)MMX(modrm & 7).s[0]) & 0xffff;
-		MMX((modrm >> 3) & 0x7).w[1]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[1]*(int32_t)MMX(modrm & 7).s[1]) & 0xffff;
-		MMX((modrm >> 3) & 0x7).w[2]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[2]*(int32_t)MMX(modrm & 7).s[2]) & 0xffff;
-		MMX((modrm >> 3) & 0x7).w[3]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[3]*(int32_t)MMX(modrm & 7).s[3]) & 0xffff;
+		simd_pmullw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
-		MMX_REG src;
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READMMX(ea, src);
-		MMX((modrm >> 3) & 0x7).w[0]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[0]*(int32_t)src.s[0]) & 0xffff;
-		MMX((modrm >> 3) & 0x7).w[1]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[1]*(int32_t)src.s[1]) & 0xffff;
-		MMX((modrm >> 3) & 0x7).w[2]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[2]*(int32_t)src.s[2]) & 0xffff;
-		MMX((modrm >> 3) & 0x7).w[3]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[3]*(int32_t)src.s[3]) & 0xffff;
+		READMMX(ea, s);
+		simd_pmullw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_psubusb_r64_rm64()  // Opcode 0f d8
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n]=MMX((modrm >> 3) & 0x7).b[n] < MMX(modrm & 7).b[n] ? 0 : MMX((modrm >> 3) & 0x7).b[n]-MMX(modrm & 7).b[n];
+		simd_psubusb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
-		MMX_REG src;
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READMMX(ea, src);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n]=MMX((modrm >> 3) & 0x7).b[n] < src.b[n] ? 0 : MMX((modrm >> 3) & 0x7).b[n]-src.b[n];
+		READMMX(ea, s);
+		simd_psubusb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_psubusw_r64_rm64()  // Opcode 0f d9
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n]=MMX((modrm >> 3) & 0x7).w[n] < MMX(modrm & 7).w[n] ? 0 : MMX((modrm >> 3) & 0x7).w[n]-MMX(modrm & 7).w[n];
+		simd_psubusw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
-		MMX_REG src;
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READMMX(ea, src);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n]=MMX((modrm >> 3) & 0x7).w[n] < src.w[n] ? 0 : MMX((modrm >> 3) & 0x7).w[n]-src.w[n];
+		READMMX(ea, s);
+		simd_psubusw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -1504,36 +1456,30 @@ void i386_device::mmx_pand_r64_rm64()  // Opcode 0f db
 
 void i386_device::mmx_paddusb_r64_rm64()  // Opcode 0f dc
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n]=MMX((modrm >> 3) & 0x7).b[n] > (0xff-MMX(modrm & 7).b[n]) ? 0xff : MMX((modrm >> 3) & 0x7).b[n]+MMX(modrm & 7).b[n];
+		simd_paddusb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
-		MMX_REG src;
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READMMX(ea, src);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n]=MMX((modrm >> 3) & 0x7).b[n] > (0xff-src.b[n]) ? 0xff : MMX((modrm >> 3) & 0x7).b[n]+src.b[n];
+		READMMX(ea, s);
+		simd_paddusb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_paddusw_r64_rm64()  // Opcode 0f dd
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n]=MMX((modrm >> 3) & 0x7).w[n] > (0xffff-MMX(modrm & 7).w[n]) ? 0xffff : MMX((modrm >> 3) & 0x7).w[n]+MMX(modrm & 7).w[n];
+		simd_paddusw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
-		MMX_REG src;
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READMMX(ea, src);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n]=MMX((modrm >> 3) & 0x7).w[n] > (0xffff-src.w[n]) ? 0xffff : MMX((modrm >> 3) & 0x7).w[n]+src.w[n];
+		READMMX(ea, s);
+		simd_paddusw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -1600,54 +1546,42 @@ void i386_device::mmx_pmulhw_r64_rm64()  // Opcode 0f e5
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX((modrm >> 3) & 0x7).w[0]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[0]*(int32_t)MMX(modrm & 7).s[0]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[1]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[1]*(int32_t)MMX(modrm & 7).s[1]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[2]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[2]*(int32_t)MMX(modrm & 7).s[2]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[3]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[3]*(int32_t)MMX(modrm & 7).s[3]) >> 16;
+		simd_pmulhw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
-		MMX_REG src;
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READMMX(ea, src);
-		MMX((modrm >> 3) & 0x7).w[0]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[0]*(int32_t)src.s[0]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[1]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[1]*(int32_t)src.s[1]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[2]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[2]*(int32_t)src.s[2]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[3]=(uint32_t)((int32_t)MMX((modrm >> 3) & 0x7).s[3]*(int32_t)src.s[3]) >> 16;
+		READMMX(ea, s);
+		simd_pmulhw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_psubsb_r64_rm64()  // Opcode 0f e8
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).c[n]=SaturatedSignedWordToSignedByte((int16_t)MMX((modrm >> 3) & 0x7).c[n] - (int16_t)MMX(modrm & 7).c[n]);
+		simd_psubsb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).c[n]=SaturatedSignedWordToSignedByte((int16_t)MMX((modrm >> 3) & 0x7).c[n] - (int16_t)s.c[n]);
+		simd_psubsb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_psubsw_r64_rm64()  // Opcode 0f e9
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).s[n]=SaturatedSignedDwordToSignedWord((int32_t)MMX((modrm >> 3) & 0x7).s[n] - (int32_t)MMX(modrm & 7).s[n]);
+		simd_psubsw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).s[n]=SaturatedSignedDwordToSignedWord((int32_t)MMX((modrm >> 3) & 0x7).s[n] - (int32_t)s.s[n]);
+		simd_psubsw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -1669,36 +1603,30 @@ void i386_device::mmx_por_r64_rm64()  // Opcode 0f eb
 
 void i386_device::mmx_paddsb_r64_rm64()  // Opcode 0f ec
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).c[n]=SaturatedSignedWordToSignedByte((int16_t)MMX((modrm >> 3) & 0x7).c[n] + (int16_t)MMX(modrm & 7).c[n]);
+		simd_paddsb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).c[n]=SaturatedSignedWordToSignedByte((int16_t)MMX((modrm >> 3) & 0x7).c[n] + (int16_t)s.c[n]);
+		simd_paddsb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_paddsw_r64_rm64()  // Opcode 0f ed
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).s[n]=SaturatedSignedDwordToSignedWord((int32_t)MMX((modrm >> 3) & 0x7).s[n] + (int32_t)MMX(modrm & 7).s[n]);
+		simd_paddsw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).s[n]=SaturatedSignedDwordToSignedWord((int32_t)MMX((modrm >> 3) & 0x7).s[n] + (int32_t)s.s[n]);
+		simd_paddsw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -1782,126 +1710,102 @@ void i386_device::mmx_pmaddwd_r64_rm64()  // Opcode 0f f5
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX((modrm >> 3) & 0x7).i[0]=(int32_t)MMX((modrm >> 3) & 0x7).s[0]*(int32_t)MMX(modrm & 7).s[0]+
-										(int32_t)MMX((modrm >> 3) & 0x7).s[1]*(int32_t)MMX(modrm & 7).s[1];
-		MMX((modrm >> 3) & 0x7).i[1]=(int32_t)MMX((modrm >> 3) & 0x7).s[2]*(int32_t)MMX(modrm & 7).s[2]+
-										(int32_t)MMX((modrm >> 3) & 0x7).s[3]*(int32_t)MMX(modrm & 7).s[3];
+		simd_pmaddwd(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		MMX((modrm >> 3) & 0x7).i[0]=(int32_t)MMX((modrm >> 3) & 0x7).s[0]*(int32_t)s.s[0]+
-										(int32_t)MMX((modrm >> 3) & 0x7).s[1]*(int32_t)s.s[1];
-		MMX((modrm >> 3) & 0x7).i[1]=(int32_t)MMX((modrm >> 3) & 0x7).s[2]*(int32_t)s.s[2]+
-										(int32_t)MMX((modrm >> 3) & 0x7).s[3]*(int32_t)s.s[3];
+		simd_pmaddwd(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_psubb_r64_rm64()  // Opcode 0f f8
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n]=MMX((modrm >> 3) & 0x7).b[n] - MMX(modrm & 7).b[n];
+		simd_psubb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n]=MMX((modrm >> 3) & 0x7).b[n] - s.b[n];
+		simd_psubb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_psubw_r64_rm64()  // Opcode 0f f9
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n]=MMX((modrm >> 3) & 0x7).w[n] - MMX(modrm & 7).w[n];
+		simd_psubw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n]=MMX((modrm >> 3) & 0x7).w[n] - s.w[n];
+		simd_psubw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_psubd_r64_rm64()  // Opcode 0f fa
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 2;n++)
-			MMX((modrm >> 3) & 0x7).d[n]=MMX((modrm >> 3) & 0x7).d[n] - MMX(modrm & 7).d[n];
+		simd_psubd(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 2;n++)
-			MMX((modrm >> 3) & 0x7).d[n]=MMX((modrm >> 3) & 0x7).d[n] - s.d[n];
+		simd_psubd(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_paddb_r64_rm64()  // Opcode 0f fc
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n]=MMX((modrm >> 3) & 0x7).b[n] + MMX(modrm & 7).b[n];
+		simd_paddb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n]=MMX((modrm >> 3) & 0x7).b[n] + s.b[n];
+		simd_paddb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_paddw_r64_rm64()  // Opcode 0f fd
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n]=MMX((modrm >> 3) & 0x7).w[n] + MMX(modrm & 7).w[n];
+		simd_paddw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n]=MMX((modrm >> 3) & 0x7).w[n] + s.w[n];
+		simd_paddw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_paddd_r64_rm64()  // Opcode 0f fe
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 2;n++)
-			MMX((modrm >> 3) & 0x7).d[n]=MMX((modrm >> 3) & 0x7).d[n] + MMX(modrm & 7).d[n];
+		simd_paddd(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 2;n++)
-			MMX((modrm >> 3) & 0x7).d[n]=MMX((modrm >> 3) & 0x7).d[n] + s.d[n];
+		simd_paddd(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -2252,22 +2156,15 @@ void i386_device::mmx_movq_rm64_r64() // Opcode 0f 7f
 
 void i386_device::mmx_pcmpeqb_r64_rm64() // Opcode 0f 74
 {
-	int c;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (c=0;c <= 7;c++)
-			MMX(d).b[c]=(MMX(d).b[c] == MMX(s).b[c]) ? 0xff : 0;
+		simd_pcmpeqb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (c=0;c <= 7;c++)
-			MMX(d).b[c]=(MMX(d).b[c] == s.b[c]) ? 0xff : 0;
+		simd_pcmpeqb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -2277,22 +2174,12 @@ void i386_device::mmx_pcmpeqw_r64_rm64() // Opcode 0f 75
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		MMX(d).w[0]=(MMX(d).w[0] == MMX(s).w[0]) ? 0xffff : 0;
-		MMX(d).w[1]=(MMX(d).w[1] == MMX(s).w[1]) ? 0xffff : 0;
-		MMX(d).w[2]=(MMX(d).w[2] == MMX(s).w[2]) ? 0xffff : 0;
-		MMX(d).w[3]=(MMX(d).w[3] == MMX(s).w[3]) ? 0xffff : 0;
+		simd_pcmpeqw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		MMX(d).w[0]=(MMX(d).w[0] == s.w[0]) ? 0xffff : 0;
-		MMX(d).w[1]=(MMX(d).w[1] == s.w[1]) ? 0xffff : 0;
-		MMX(d).w[2]=(MMX(d).w[2] == s.w[2]) ? 0xffff : 0;
-		MMX(d).w[3]=(MMX(d).w[3] == s.w[3]) ? 0xffff : 0;
+		simd_pcmpeqw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -2302,18 +2189,12 @@ void i386_device::mmx_pcmpeqd_r64_rm64() // Opcode 0f 76
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		MMX(d).d[0]=(MMX(d).d[0] == MMX(s).d[0]) ? 0xffffffff : 0;
-		MMX(d).d[1]=(MMX(d).d[1] == MMX(s).d[1]) ? 0xffffffff : 0;
+		simd_pcmpeqd(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		MMX(d).d[0]=(MMX(d).d[0] == s.d[0]) ? 0xffffffff : 0;
-		MMX(d).d[1]=(MMX(d).d[1] == s.d[1]) ? 0xffffffff : 0;
+		simd_pcmpeqd(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -2559,100 +2440,57 @@ void i386_device::mmx_packsswb_r64_rm64() // Opcode 0f 63
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX_REG ds, sd;
-		int s, d;
-		s = modrm & 0x7;
-		d = (modrm >> 3) & 0x7;
-		ds.q = MMX(d).q;
-		sd.q = MMX(s).q;
-		MMX(d).c[0] = SaturatedSignedWordToSignedByte(ds.s[0]);
-		MMX(d).c[1] = SaturatedSignedWordToSignedByte(ds.s[1]);
-		MMX(d).c[2] = SaturatedSignedWordToSignedByte(ds.s[2]);
-		MMX(d).c[3] = SaturatedSignedWordToSignedByte(ds.s[3]);
-		MMX(d).c[4] = SaturatedSignedWordToSignedByte(sd.s[0]);
-		MMX(d).c[5] = SaturatedSignedWordToSignedByte(sd.s[1]);
-		MMX(d).c[6] = SaturatedSignedWordToSignedByte(sd.s[2]);
-		MMX(d).c[7] = SaturatedSignedWordToSignedByte(sd.s[3]);
-	} else {
-		MMX_REG s, t;
-		int d = (modrm >> 3) & 0x7;
+		simd_packsswb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
+	} else {
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		t.q = MMX(d).q;
-		MMX(d).c[0] = SaturatedSignedWordToSignedByte(t.s[0]);
-		MMX(d).c[1] = SaturatedSignedWordToSignedByte(t.s[1]);
-		MMX(d).c[2] = SaturatedSignedWordToSignedByte(t.s[2]);
-		MMX(d).c[3] = SaturatedSignedWordToSignedByte(t.s[3]);
-		MMX(d).c[4] = SaturatedSignedWordToSignedByte(s.s[0]);
-		MMX(d).c[5] = SaturatedSignedWordToSignedByte(s.s[1]);
-		MMX(d).c[6] = SaturatedSignedWordToSignedByte(s.s[2]);
-		MMX(d).c[7] = SaturatedSignedWordToSignedByte(s.s[3]);
+		simd_packsswb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_pcmpgtb_r64_rm64() // Opcode 0f 64
 {
-	int c;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (c=0;c <= 7;c++)
-			MMX(d).b[c]=(MMX(d).c[c] > MMX(s).c[c]) ? 0xff : 0;
+		simd_pcmpgtb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (c=0;c <= 7;c++)
-			MMX(d).b[c]=(MMX(d).c[c] > s.c[c]) ? 0xff : 0;
+		simd_pcmpgtb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_pcmpgtw_r64_rm64() // Opcode 0f 65
 {
-	int c;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (c=0;c <= 3;c++)
-			MMX(d).w[c]=(MMX(d).s[c] > MMX(s).s[c]) ? 0xffff : 0;
+		simd_pcmpgtw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (c=0;c <= 3;c++)
-			MMX(d).w[c]=(MMX(d).s[c] > s.s[c]) ? 0xffff : 0;
+		simd_pcmpgtw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::mmx_pcmpgtd_r64_rm64() // Opcode 0f 66
 {
-	int c;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (c=0;c <= 1;c++)
-			MMX(d).d[c]=(MMX(d).i[c] > MMX(s).i[c]) ? 0xffffffff : 0;
+		simd_pcmpgtd(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (c=0;c <= 1;c++)
-			MMX(d).d[c]=(MMX(d).i[c] > s.i[c]) ? 0xffffffff : 0;
+		simd_pcmpgtd(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -2662,34 +2500,12 @@ void i386_device::mmx_packuswb_r64_rm64() // Opcode 0f 67
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX_REG ds, sd;
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		ds.q = MMX(d).q;
-		sd.q = MMX(s).q;
-		MMX(d).b[0]=SaturatedSignedWordToUnsignedByte(ds.s[0]);
-		MMX(d).b[1]=SaturatedSignedWordToUnsignedByte(ds.s[1]);
-		MMX(d).b[2]=SaturatedSignedWordToUnsignedByte(ds.s[2]);
-		MMX(d).b[3]=SaturatedSignedWordToUnsignedByte(ds.s[3]);
-		MMX(d).b[4]=SaturatedSignedWordToUnsignedByte(sd.s[0]);
-		MMX(d).b[5]=SaturatedSignedWordToUnsignedByte(sd.s[1]);
-		MMX(d).b[6]=SaturatedSignedWordToUnsignedByte(sd.s[2]);
-		MMX(d).b[7]=SaturatedSignedWordToUnsignedByte(sd.s[3]);
-	} else {
-		MMX_REG s,t;
-		int d=(modrm >> 3) & 0x7;
+		simd_packuswb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
+	} else {
+		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		t.q = MMX(d).q;
-		MMX(d).b[0]=SaturatedSignedWordToUnsignedByte(t.s[0]);
-		MMX(d).b[1]=SaturatedSignedWordToUnsignedByte(t.s[1]);
-		MMX(d).b[2]=SaturatedSignedWordToUnsignedByte(t.s[2]);
-		MMX(d).b[3]=SaturatedSignedWordToUnsignedByte(t.s[3]);
-		MMX(d).b[4]=SaturatedSignedWordToUnsignedByte(s.s[0]);
-		MMX(d).b[5]=SaturatedSignedWordToUnsignedByte(s.s[1]);
-		MMX(d).b[6]=SaturatedSignedWordToUnsignedByte(s.s[2]);
-		MMX(d).b[7]=SaturatedSignedWordToUnsignedByte(s.s[3]);
+		simd_packuswb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -2778,31 +2594,12 @@ void i386_device::mmx_packssdw_r64_rm64() // Opcode 0f 6b
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		int32_t t1, t2, t3, t4;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		t1 = MMX(d).i[0];
-		t2 = MMX(d).i[1];
-		t3 = MMX(s).i[0];
-		t4 = MMX(s).i[1];
-		MMX(d).s[0] = SaturatedSignedDwordToSignedWord(t1);
-		MMX(d).s[1] = SaturatedSignedDwordToSignedWord(t2);
-		MMX(d).s[2] = SaturatedSignedDwordToSignedWord(t3);
-		MMX(d).s[3] = SaturatedSignedDwordToSignedWord(t4);
-	}
-	else {
+		simd_packssdw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
+	} else {
 		MMX_REG s;
-		int32_t t1, t2;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		t1 = MMX(d).i[0];
-		t2 = MMX(d).i[1];
-		MMX(d).s[0] = SaturatedSignedDwordToSignedWord(t1);
-		MMX(d).s[1] = SaturatedSignedDwordToSignedWord(t2);
-		MMX(d).s[2] = SaturatedSignedDwordToSignedWord(s.i[0]);
-		MMX(d).s[3] = SaturatedSignedDwordToSignedWord(s.i[1]);
+		simd_packssdw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -4787,18 +4584,15 @@ void i386_device::sse_pextrw_reg_r128_i8() // Opcode 66 0f c5
 
 void i386_device::sse_pminub_r64_rm64() // Opcode 0f da
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n] = MMX((modrm >> 3) & 0x7).b[n] < MMX(modrm & 0x7).b[n] ? MMX((modrm >> 3) & 0x7).b[n] : MMX(modrm & 0x7).b[n];
+		simd_pminub(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n] = MMX((modrm >> 3) & 0x7).b[n] < s.b[n] ? MMX((modrm >> 3) & 0x7).b[n] : s.b[n];
+		simd_pminub(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -4808,68 +4602,57 @@ void i386_device::sse_pminub_r128_rm128() // Opcode 66 0f da
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n] = XMM((modrm >> 3) & 0x7).b[n] < XMM(modrm & 0x7).b[n] ? XMM((modrm >> 3) & 0x7).b[n] : XMM(modrm & 0x7).b[n];
+		simd_pminub(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n] = XMM((modrm >> 3) & 0x7).b[n] < s.b[n] ? XMM((modrm >> 3) & 0x7).b[n] : s.b[n];
+		simd_pminub(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::sse_pmaxub_r64_rm64() // Opcode 0f de
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n] = MMX((modrm >> 3) & 0x7).b[n] > MMX(modrm & 0x7).b[n] ? MMX((modrm >> 3) & 0x7).b[n] : MMX(modrm & 0x7).b[n];
+		simd_pmaxub(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n] = MMX((modrm >> 3) & 0x7).b[n] > s.b[n] ? MMX((modrm >> 3) & 0x7).b[n] : s.b[n];
+		simd_pmaxub(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::sse_pavgb_r64_rm64() // Opcode 0f e0
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n] = ((uint16_t)MMX((modrm >> 3) & 0x7).b[n] + (uint16_t)MMX(modrm & 0x7).b[n] + 1) >> 1;
+		simd_pavgb(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 8;n++)
-			MMX((modrm >> 3) & 0x7).b[n] = ((uint16_t)MMX((modrm >> 3) & 0x7).b[n] + (uint16_t)s.b[n] + 1) >> 1;
+		simd_pavgb(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::sse_pavgw_r64_rm64() // Opcode 0f e3
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n] = ((uint32_t)MMX((modrm >> 3) & 0x7).w[n] + (uint32_t)MMX(modrm & 0x7).w[n] + 1) >> 1;
+		simd_pavgw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).w[n] = ((uint32_t)MMX((modrm >> 3) & 0x7).w[n] + (uint32_t)s.w[n] + 1) >> 1;
+		simd_pavgw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -4879,54 +4662,42 @@ void i386_device::sse_pmulhuw_r64_rm64()  // Opcode 0f e4
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX((modrm >> 3) & 0x7).w[0]=((uint32_t)MMX((modrm >> 3) & 0x7).w[0]*(uint32_t)MMX(modrm & 7).w[0]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[1]=((uint32_t)MMX((modrm >> 3) & 0x7).w[1]*(uint32_t)MMX(modrm & 7).w[1]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[2]=((uint32_t)MMX((modrm >> 3) & 0x7).w[2]*(uint32_t)MMX(modrm & 7).w[2]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[3]=((uint32_t)MMX((modrm >> 3) & 0x7).w[3]*(uint32_t)MMX(modrm & 7).w[3]) >> 16;
+		simd_pmulhuw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		MMX((modrm >> 3) & 0x7).w[0]=((uint32_t)MMX((modrm >> 3) & 0x7).w[0]*(uint32_t)s.w[0]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[1]=((uint32_t)MMX((modrm >> 3) & 0x7).w[1]*(uint32_t)s.w[1]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[2]=((uint32_t)MMX((modrm >> 3) & 0x7).w[2]*(uint32_t)s.w[2]) >> 16;
-		MMX((modrm >> 3) & 0x7).w[3]=((uint32_t)MMX((modrm >> 3) & 0x7).w[3]*(uint32_t)s.w[3]) >> 16;
+		simd_pmulhuw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::sse_pminsw_r64_rm64() // Opcode 0f ea
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).s[n] = MMX((modrm >> 3) & 0x7).s[n] < MMX(modrm & 0x7).s[n] ? MMX((modrm >> 3) & 0x7).s[n] : MMX(modrm & 0x7).s[n];
+		simd_pminsw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).s[n] = MMX((modrm >> 3) & 0x7).s[n] < s.s[n] ? MMX((modrm >> 3) & 0x7).s[n] : s.s[n];
+		simd_pminsw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::sse_pmaxsw_r64_rm64() // Opcode 0f ee
 {
-	int n;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).s[n] = MMX((modrm >> 3) & 0x7).s[n] > MMX(modrm & 0x7).s[n] ? MMX((modrm >> 3) & 0x7).s[n] : MMX(modrm & 0x7).s[n];
+		simd_pmaxsw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		for (n=0;n < 4;n++)
-			MMX((modrm >> 3) & 0x7).s[n] = MMX((modrm >> 3) & 0x7).s[n] > s.s[n] ? MMX((modrm >> 3) & 0x7).s[n] : s.s[n];
+		simd_pmaxsw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -4936,12 +4707,12 @@ void i386_device::sse_pmuludq_r64_rm64() // Opcode 0f f4
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX((modrm >> 3) & 0x7).q = (uint64_t)MMX((modrm >> 3) & 0x7).d[0] * (uint64_t)MMX(modrm & 0x7).d[0];
+		simd_pmuludq(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		MMX((modrm >> 3) & 0x7).q = (uint64_t)MMX((modrm >> 3) & 0x7).d[0] * (uint64_t)s.d[0];
+		simd_pmuludq(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -4951,37 +4722,27 @@ void i386_device::sse_pmuludq_r128_rm128() // Opcode 66 0f f4
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		XMM((modrm >> 3) & 0x7).q[0] = (uint64_t)XMM((modrm >> 3) & 0x7).d[0] * (uint64_t)XMM(modrm & 0x7).d[0];
-		XMM((modrm >> 3) & 0x7).q[1] = (uint64_t)XMM((modrm >> 3) & 0x7).d[2] * (uint64_t)XMM(modrm & 0x7).d[2];
+		simd_pmuludq(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		XMM((modrm >> 3) & 0x7).q[0] = (uint64_t)XMM((modrm >> 3) & 0x7).d[0] * (uint64_t)s.d[0];
-		XMM((modrm >> 3) & 0x7).q[1] = (uint64_t)XMM((modrm >> 3) & 0x7).d[2] * (uint64_t)s.d[2];
+		simd_pmuludq(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::sse_psadbw_r64_rm64() // Opcode 0f f6
 {
-	int n;
-	int32_t temp;
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		temp=0;
-		for (n=0;n < 8;n++)
-			temp += abs((int32_t)MMX((modrm >> 3) & 0x7).b[n] - (int32_t)MMX(modrm & 0x7).b[n]);
-		MMX((modrm >> 3) & 0x7).l=(uint64_t)temp & 0xffff;
+		simd_psadbw(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		temp=0;
-		for (n=0;n < 8;n++)
-			temp += abs((int32_t)MMX((modrm >> 3) & 0x7).b[n] - (int32_t)s.b[n]);
-		MMX((modrm >> 3) & 0x7).l=(uint64_t)temp & 0xffff;
+		simd_psadbw(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -4991,12 +4752,12 @@ void i386_device::sse_psubq_r64_rm64()  // Opcode 0f fb
 	if(MMXPROLOG()) return;
 	uint8_t modrm = FETCH();
 	if( modrm >= 0xc0 ) {
-		MMX((modrm >> 3) & 0x7).q=MMX((modrm >> 3) & 0x7).q - MMX(modrm & 7).q;
+		simd_psubq(MMX((modrm >> 3) & 0x7), MMX(modrm & 7));
 	} else {
 		MMX_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READMMX(ea, s);
-		MMX((modrm >> 3) & 0x7).q=MMX((modrm >> 3) & 0x7).q - s.q;
+		simd_psubq(MMX((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5006,14 +4767,12 @@ void i386_device::sse_psubq_r128_rm128()  // Opcode 66 0f fb
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		XMM((modrm >> 3) & 0x7).q[0]=XMM((modrm >> 3) & 0x7).q[0] - XMM(modrm & 7).q[0];
-		XMM((modrm >> 3) & 0x7).q[1]=XMM((modrm >> 3) & 0x7).q[1] - XMM(modrm & 7).q[1];
+		simd_psubq(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		XMM((modrm >> 3) & 0x7).q[0]=XMM((modrm >> 3) & 0x7).q[0] - s.q[0];
-		XMM((modrm >> 3) & 0x7).q[1]=XMM((modrm >> 3) & 0x7).q[1] - s.q[1];
+		simd_psubq(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5114,27 +4873,13 @@ void i386_device::sse_packsswb_r128_rm128() // Opcode 66 0f 63
 {
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
-	if (modrm >= 0xc0) {
-		XMM_REG t;
-		int s, d;
-		s = modrm & 0x7;
-		d = (modrm >> 3) & 0x7;
-		t.q[0] = XMM(s).q[0];
-		t.q[1] = XMM(s).q[1];
-		for (int n = 0; n < 8; n++)
-			XMM(d).c[n] = SaturatedSignedWordToSignedByte(XMM(d).s[n]);
-		for (int n = 0; n < 8; n++)
-			XMM(d).c[n+8] = SaturatedSignedWordToSignedByte(t.s[n]);
-	}
-	else {
+	if( modrm >= 0xc0 ) {
+		simd_packsswb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
+	} else {
 		XMM_REG s;
-		int d = (modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n = 0; n < 8; n++)
-			XMM(d).c[n] = SaturatedSignedWordToSignedByte(XMM(d).s[n]);
-		for (int n = 0; n < 8; n++)
-			XMM(d).c[n + 8] = SaturatedSignedWordToSignedByte(s.s[n]);
+		simd_packsswb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5143,35 +4888,13 @@ void i386_device::sse_packssdw_r128_rm128() // Opcode 66 0f 6b
 {
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
-	if (modrm >= 0xc0) {
-		XMM_REG t;
-		int s, d;
-		s = modrm & 0x7;
-		d = (modrm >> 3) & 0x7;
-		t.q[0] = XMM(s).q[0];
-		t.q[1] = XMM(s).q[1];
-		XMM(d).s[0] = SaturatedSignedDwordToSignedWord(XMM(d).i[0]);
-		XMM(d).s[1] = SaturatedSignedDwordToSignedWord(XMM(d).i[1]);
-		XMM(d).s[2] = SaturatedSignedDwordToSignedWord(XMM(d).i[2]);
-		XMM(d).s[3] = SaturatedSignedDwordToSignedWord(XMM(d).i[3]);
-		XMM(d).s[4] = SaturatedSignedDwordToSignedWord(t.i[0]);
-		XMM(d).s[5] = SaturatedSignedDwordToSignedWord(t.i[1]);
-		XMM(d).s[6] = SaturatedSignedDwordToSignedWord(t.i[2]);
-		XMM(d).s[7] = SaturatedSignedDwordToSignedWord(t.i[3]);
-	}
-	else {
+	if( modrm >= 0xc0 ) {
+		simd_packssdw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
+	} else {
 		XMM_REG s;
-		int d = (modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		XMM(d).s[0] = SaturatedSignedDwordToSignedWord(XMM(d).i[0]);
-		XMM(d).s[1] = SaturatedSignedDwordToSignedWord(XMM(d).i[1]);
-		XMM(d).s[2] = SaturatedSignedDwordToSignedWord(XMM(d).i[2]);
-		XMM(d).s[3] = SaturatedSignedDwordToSignedWord(XMM(d).i[3]);
-		XMM(d).s[4] = SaturatedSignedDwordToSignedWord(s.i[0]);
-		XMM(d).s[5] = SaturatedSignedDwordToSignedWord(s.i[1]);
-		XMM(d).s[6] = SaturatedSignedDwordToSignedWord(s.i[2]);
-		XMM(d).s[7] = SaturatedSignedDwordToSignedWord(s.i[3]);
+		simd_packssdw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5181,18 +4904,12 @@ void i386_device::sse_pcmpgtb_r128_rm128() // Opcode 66 0f 64
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (int c=0;c <= 15;c++)
-			XMM(d).b[c]=(XMM(d).c[c] > XMM(s).c[c]) ? 0xff : 0;
+		simd_pcmpgtb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int c=0;c <= 15;c++)
-			XMM(d).b[c]=(XMM(d).c[c] > s.c[c]) ? 0xff : 0;
+		simd_pcmpgtb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5202,18 +4919,12 @@ void i386_device::sse_pcmpgtw_r128_rm128() // Opcode 66 0f 65
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (int c=0;c <= 7;c++)
-			XMM(d).w[c]=(XMM(d).s[c] > XMM(s).s[c]) ? 0xffff : 0;
+		simd_pcmpgtw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int c=0;c <= 7;c++)
-			XMM(d).w[c]=(XMM(d).s[c] > s.s[c]) ? 0xffff : 0;
+		simd_pcmpgtw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5223,18 +4934,12 @@ void i386_device::sse_pcmpgtd_r128_rm128() // Opcode 66 0f 66
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (int c=0;c <= 3;c++)
-			XMM(d).d[c]=(XMM(d).i[c] > XMM(s).i[c]) ? 0xffffffff : 0;
+		simd_pcmpgtd(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int c=0;c <= 3;c++)
-			XMM(d).d[c]=(XMM(d).i[c] > s.i[c]) ? 0xffffffff : 0;
+		simd_pcmpgtd(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5244,25 +4949,12 @@ void i386_device::sse_packuswb_r128_rm128() // Opcode 66 0f 67
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		XMM_REG t;
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		t.q[0] = XMM(s).q[0];
-		t.q[1] = XMM(s).q[1];
-		for (int n = 0; n < 8;n++)
-			XMM(d).b[n]=SaturatedSignedWordToUnsignedByte(XMM(d).s[n]);
-		for (int n = 0; n < 8;n++)
-			XMM(d).b[n+8]=SaturatedSignedWordToUnsignedByte(t.s[n]);
+		simd_packuswb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n = 0; n < 8;n++)
-			XMM(d).b[n]=SaturatedSignedWordToUnsignedByte(XMM(d).s[n]);
-		for (int n = 0; n < 8;n++)
-			XMM(d).b[n+8]=SaturatedSignedWordToUnsignedByte(s.s[n]);
+		simd_packuswb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5376,18 +5068,12 @@ void i386_device::sse_pcmpeqb_r128_rm128() // Opcode 66 0f 74
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (int c=0;c <= 15;c++)
-			XMM(d).b[c]=(XMM(d).c[c] == XMM(s).c[c]) ? 0xff : 0;
+		simd_pcmpeqb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int c=0;c <= 15;c++)
-			XMM(d).b[c]=(XMM(d).c[c] == s.c[c]) ? 0xff : 0;
+		simd_pcmpeqb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5397,18 +5083,12 @@ void i386_device::sse_pcmpeqw_r128_rm128() // Opcode 66 0f 75
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (int c=0;c <= 7;c++)
-			XMM(d).w[c]=(XMM(d).s[c] == XMM(s).s[c]) ? 0xffff : 0;
+		simd_pcmpeqw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int c=0;c <= 7;c++)
-			XMM(d).w[c]=(XMM(d).s[c] == s.s[c]) ? 0xffff : 0;
+		simd_pcmpeqw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5418,18 +5098,12 @@ void i386_device::sse_pcmpeqd_r128_rm128() // Opcode 66 0f 76
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (int c=0;c <= 3;c++)
-			XMM(d).d[c]=(XMM(d).i[c] == XMM(s).i[c]) ? 0xffffffff : 0;
+		simd_pcmpeqd(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
-		int d=(modrm >> 3) & 0x7;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int c=0;c <= 3;c++)
-			XMM(d).d[c]=(XMM(d).i[c] == s.i[c]) ? 0xffffffff : 0;
+		simd_pcmpeqd(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5439,18 +5113,12 @@ void i386_device::sse_paddq_r128_rm128()  // Opcode 66 0f d4
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		XMM(d).q[0]=XMM(d).q[0]+XMM(s).q[0];
-		XMM(d).q[1]=XMM(d).q[1]+XMM(s).q[1];
+		simd_paddq(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
-		XMM_REG src;
-		int d=(modrm >> 3) & 0x7;
+		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READXMM(ea, src);
-		XMM(d).q[0]=XMM(d).q[0]+src.q[0];
-		XMM(d).q[1]=XMM(d).q[1]+src.q[1];
+		READXMM(ea, s);
+		simd_paddq(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5460,19 +5128,12 @@ void i386_device::sse_pmullw_r128_rm128()  // Opcode 66 0f d5
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s,d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (int n = 0; n < 8;n++)
-			XMM(d).w[n]=(uint32_t)((int32_t)XMM(d).s[n]*(int32_t)XMM(s).s[n]) & 0xffff;
+		simd_pmullw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
-		XMM_REG src;
-		int d;
+		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READXMM(ea, src);
-		d=(modrm >> 3) & 0x7;
-		for (int n = 0; n < 8;n++)
-			XMM(d).w[n]=(uint32_t)((int32_t)XMM(d).s[n]*(int32_t)src.s[n]) & 0xffff;
+		READXMM(ea, s);
+		simd_pmullw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5482,14 +5143,12 @@ void i386_device::sse_paddb_r128_rm128()  // Opcode 66 0f fc
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n]=XMM((modrm >> 3) & 0x7).b[n] + XMM(modrm & 7).b[n];
+		simd_paddb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n]=XMM((modrm >> 3) & 0x7).b[n] + s.b[n];
+		simd_paddb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5499,14 +5158,12 @@ void i386_device::sse_paddw_r128_rm128()  // Opcode 66 0f fd
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=XMM((modrm >> 3) & 0x7).w[n] + XMM(modrm & 7).w[n];
+		simd_paddw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=XMM((modrm >> 3) & 0x7).w[n] + s.w[n];
+		simd_paddw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5516,14 +5173,12 @@ void i386_device::sse_paddd_r128_rm128()  // Opcode 66 0f fe
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 4;n++)
-			XMM((modrm >> 3) & 0x7).d[n]=XMM((modrm >> 3) & 0x7).d[n] + XMM(modrm & 7).d[n];
+		simd_paddd(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 4;n++)
-			XMM((modrm >> 3) & 0x7).d[n]=XMM((modrm >> 3) & 0x7).d[n] + s.d[n];
+		simd_paddd(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5533,14 +5188,12 @@ void i386_device::sse_psubusb_r128_rm128()  // Opcode 66 0f d8
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n]=XMM((modrm >> 3) & 0x7).b[n] < XMM(modrm & 7).b[n] ? 0 : XMM((modrm >> 3) & 0x7).b[n]-XMM(modrm & 7).b[n];
+		simd_psubusb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
-		XMM_REG src;
+		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READXMM(ea, src);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n]=XMM((modrm >> 3) & 0x7).b[n] < src.b[n] ? 0 : XMM((modrm >> 3) & 0x7).b[n]-src.b[n];
+		READXMM(ea, s);
+		simd_psubusb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5550,14 +5203,12 @@ void i386_device::sse_psubusw_r128_rm128()  // Opcode 66 0f d9
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=XMM((modrm >> 3) & 0x7).w[n] < XMM(modrm & 7).w[n] ? 0 : XMM((modrm >> 3) & 0x7).w[n]-XMM(modrm & 7).w[n];
+		simd_psubusw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
-		XMM_REG src;
+		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READXMM(ea, src);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=XMM((modrm >> 3) & 0x7).w[n] < src.w[n] ? 0 : XMM((modrm >> 3) & 0x7).w[n]-src.w[n];
+		READXMM(ea, s);
+		simd_psubusw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5601,14 +5252,12 @@ void i386_device::sse_paddusb_r128_rm128()  // Opcode 66 0f dc
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n]=XMM((modrm >> 3) & 0x7).b[n] > (0xff-XMM(modrm & 7).b[n]) ? 0xff : XMM((modrm >> 3) & 0x7).b[n]+XMM(modrm & 7).b[n];
+		simd_paddusb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
-		XMM_REG src;
+		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READXMM(ea, src);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n]=XMM((modrm >> 3) & 0x7).b[n] > (0xff-src.b[n]) ? 0xff : XMM((modrm >> 3) & 0x7).b[n]+src.b[n];
+		READXMM(ea, s);
+		simd_paddusb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5618,14 +5267,12 @@ void i386_device::sse_paddusw_r128_rm128()  // Opcode 66 0f dd
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=XMM((modrm >> 3) & 0x7).w[n] > (0xffff-XMM(modrm & 7).w[n]) ? 0xffff : XMM((modrm >> 3) & 0x7).w[n]+XMM(modrm & 7).w[n];
+		simd_paddusw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
-		XMM_REG src;
+		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READXMM(ea, src);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=XMM((modrm >> 3) & 0x7).w[n] > (0xffff-src.w[n]) ? 0xffff : XMM((modrm >> 3) & 0x7).w[n]+src.w[n];
+		READXMM(ea, s);
+		simd_paddusw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5635,14 +5282,12 @@ void i386_device::sse_pmaxub_r128_rm128() // Opcode 66 0f de
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n] = XMM((modrm >> 3) & 0x7).b[n] > XMM(modrm & 0x7).b[n] ? XMM((modrm >> 3) & 0x7).b[n] : XMM(modrm & 0x7).b[n];
+		simd_pmaxub(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n] = XMM((modrm >> 3) & 0x7).b[n] > s.b[n] ? XMM((modrm >> 3) & 0x7).b[n] : s.b[n];
+		simd_pmaxub(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5652,14 +5297,12 @@ void i386_device::sse_pmulhuw_r128_rm128()  // Opcode 66 0f e4
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=((uint32_t)XMM((modrm >> 3) & 0x7).w[n]*(uint32_t)XMM(modrm & 7).w[n]) >> 16;
+		simd_pmulhuw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=((uint32_t)XMM((modrm >> 3) & 0x7).w[n]*(uint32_t)s.w[n]) >> 16;
+		simd_pmulhuw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5669,14 +5312,12 @@ void i386_device::sse_pmulhw_r128_rm128()  // Opcode 66 0f e5
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=(uint32_t)((int32_t)XMM((modrm >> 3) & 0x7).s[n]*(int32_t)XMM(modrm & 7).s[n]) >> 16;
+		simd_pmulhw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
-		XMM_REG src;
+		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
-		READXMM(ea, src);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=(uint32_t)((int32_t)XMM((modrm >> 3) & 0x7).s[n]*(int32_t)src.s[n]) >> 16;
+		READXMM(ea, s);
+		simd_pmulhw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5686,14 +5327,12 @@ void i386_device::sse_psubsb_r128_rm128()  // Opcode 66 0f e8
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).c[n]=SaturatedSignedWordToSignedByte((int16_t)XMM((modrm >> 3) & 0x7).c[n] - (int16_t)XMM(modrm & 7).c[n]);
+		simd_psubsb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).c[n]=SaturatedSignedWordToSignedByte((int16_t)XMM((modrm >> 3) & 0x7).c[n] - (int16_t)s.c[n]);
+		simd_psubsb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5703,14 +5342,12 @@ void i386_device::sse_psubsw_r128_rm128()  // Opcode 66 0f e9
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).s[n]=SaturatedSignedDwordToSignedWord((int32_t)XMM((modrm >> 3) & 0x7).s[n] - (int32_t)XMM(modrm & 7).s[n]);
+		simd_psubsw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).s[n]=SaturatedSignedDwordToSignedWord((int32_t)XMM((modrm >> 3) & 0x7).s[n] - (int32_t)s.s[n]);
+		simd_psubsw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5720,14 +5357,12 @@ void i386_device::sse_pminsw_r128_rm128() // Opcode 66 0f ea
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).s[n] = XMM((modrm >> 3) & 0x7).s[n] < XMM(modrm & 0x7).s[n] ? XMM((modrm >> 3) & 0x7).s[n] : XMM(modrm & 0x7).s[n];
+		simd_pminsw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).s[n] = XMM((modrm >> 3) & 0x7).s[n] < s.s[n] ? XMM((modrm >> 3) & 0x7).s[n] : s.s[n];
+		simd_pminsw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5737,14 +5372,12 @@ void i386_device::sse_pmaxsw_r128_rm128() // Opcode 66 0f ee
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).s[n] = XMM((modrm >> 3) & 0x7).s[n] > XMM(modrm & 0x7).s[n] ? XMM((modrm >> 3) & 0x7).s[n] : XMM(modrm & 0x7).s[n];
+		simd_pmaxsw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).s[n] = XMM((modrm >> 3) & 0x7).s[n] > s.s[n] ? XMM((modrm >> 3) & 0x7).s[n] : s.s[n];
+		simd_pmaxsw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5754,14 +5387,12 @@ void i386_device::sse_paddsb_r128_rm128()  // Opcode 66 0f ec
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).c[n]=SaturatedSignedWordToSignedByte((int16_t)XMM((modrm >> 3) & 0x7).c[n] + (int16_t)XMM(modrm & 7).c[n]);
+		simd_paddsb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).c[n]=SaturatedSignedWordToSignedByte((int16_t)XMM((modrm >> 3) & 0x7).c[n] + (int16_t)s.c[n]);
+		simd_paddsb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5771,14 +5402,12 @@ void i386_device::sse_paddsw_r128_rm128()  // Opcode 66 0f ed
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).s[n]=SaturatedSignedDwordToSignedWord((int32_t)XMM((modrm >> 3) & 0x7).s[n] + (int32_t)XMM(modrm & 7).s[n]);
+		simd_paddsw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).s[n]=SaturatedSignedDwordToSignedWord((int32_t)XMM((modrm >> 3) & 0x7).s[n] + (int32_t)s.s[n]);
+		simd_paddsw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5822,18 +5451,12 @@ void i386_device::sse_pmaddwd_r128_rm128()  // Opcode 66 0f f5
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		int s, d;
-		s=modrm & 0x7;
-		d=(modrm >> 3) & 0x7;
-		for (int n=0;n < 4;n++)
-			XMM(d).i[n]=(int32_t)XMM(d).s[n << 1]*(int32_t)XMM(s).s[n << 1]+(int32_t)XMM(d).s[(n << 1) + 1]*(int32_t)XMM(s).s[(n << 1) + 1];
+		simd_pmaddwd(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
-		int d = (modrm >> 3) & 0x7;
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 4;n++)
-			XMM(d).i[n]=(int32_t)XMM(d).s[n << 1]*(int32_t)s.s[n << 1]+(int32_t)XMM(d).s[(n << 1) + 1]*(int32_t)s.s[(n << 1) + 1];
+		simd_pmaddwd(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5843,14 +5466,12 @@ void i386_device::sse_psubb_r128_rm128()  // Opcode 66 0f f8
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n]=XMM((modrm >> 3) & 0x7).b[n] - XMM(modrm & 7).b[n];
+		simd_psubb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n]=XMM((modrm >> 3) & 0x7).b[n] - s.b[n];
+		simd_psubb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5860,14 +5481,12 @@ void i386_device::sse_psubw_r128_rm128()  // Opcode 66 0f f9
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=XMM((modrm >> 3) & 0x7).w[n] - XMM(modrm & 7).w[n];
+		simd_psubw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n]=XMM((modrm >> 3) & 0x7).w[n] - s.w[n];
+		simd_psubw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5877,44 +5496,27 @@ void i386_device::sse_psubd_r128_rm128()  // Opcode 66 0f fa
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 4;n++)
-			XMM((modrm >> 3) & 0x7).d[n]=XMM((modrm >> 3) & 0x7).d[n] - XMM(modrm & 7).d[n];
+		simd_psubd(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 4;n++)
-			XMM((modrm >> 3) & 0x7).d[n]=XMM((modrm >> 3) & 0x7).d[n] - s.d[n];
+		simd_psubd(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
 
 void i386_device::sse_psadbw_r128_rm128() // Opcode 66 0f f6
 {
-	int32_t temp;
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		temp=0;
-		for (int n=0;n < 8;n++)
-			temp += abs((int32_t)XMM((modrm >> 3) & 0x7).b[n] - (int32_t)XMM(modrm & 0x7).b[n]);
-		XMM((modrm >> 3) & 0x7).l[0]=(uint64_t)temp & 0xffff;
-		temp=0;
-		for (int n=8;n < 16;n++)
-			temp += abs((int32_t)XMM((modrm >> 3) & 0x7).b[n] - (int32_t)XMM(modrm & 0x7).b[n]);
-		XMM((modrm >> 3) & 0x7).l[1]=(uint64_t)temp & 0xffff;
+		simd_psadbw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		temp=0;
-		for (int n=0;n < 8;n++)
-			temp += abs((int32_t)XMM((modrm >> 3) & 0x7).b[n] - (int32_t)s.b[n]);
-		XMM((modrm >> 3) & 0x7).l[0]=(uint64_t)temp & 0xffff;
-		temp=0;
-		for (int n=8;n < 16;n++)
-			temp += abs((int32_t)XMM((modrm >> 3) & 0x7).b[n] - (int32_t)s.b[n]);
-		XMM((modrm >> 3) & 0x7).l[1]=(uint64_t)temp & 0xffff;
+		simd_psadbw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5924,14 +5526,12 @@ void i386_device::sse_pavgb_r128_rm128() // Opcode 66 0f e0
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n] = ((uint16_t)XMM((modrm >> 3) & 0x7).b[n] + (uint16_t)XMM(modrm & 0x7).b[n] + 1) >> 1;
+		simd_pavgb(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 16;n++)
-			XMM((modrm >> 3) & 0x7).b[n] = ((uint16_t)XMM((modrm >> 3) & 0x7).b[n] + (uint16_t)s.b[n] + 1) >> 1;
+		simd_pavgb(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -5941,14 +5541,12 @@ void i386_device::sse_pavgw_r128_rm128() // Opcode 66 0f e3
 	uint8_t modrm = FETCH();
 	if(SSEPROLOG()) return;
 	if( modrm >= 0xc0 ) {
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n] = ((uint32_t)XMM((modrm >> 3) & 0x7).w[n] + (uint32_t)XMM(modrm & 0x7).w[n] + 1) >> 1;
+		simd_pavgw(XMM((modrm >> 3) & 0x7), XMM(modrm & 7));
 	} else {
 		XMM_REG s;
 		uint32_t ea = GetEA(modrm, 0);
 		READXMM(ea, s);
-		for (int n=0;n < 8;n++)
-			XMM((modrm >> 3) & 0x7).w[n] = ((uint32_t)XMM((modrm >> 3) & 0x7).w[n] + (uint32_t)s.w[n] + 1) >> 1;
+		simd_pavgw(XMM((modrm >> 3) & 0x7), s);
 	}
 	CYCLES(1);     // TODO: correct cycle count
 }
@@ -246,10 +246,50 @@ void i386_device::x87_reset()
  *
  *************************************/
 
+/*
+    Optional host-native fast path for FADD/FSUB/FMUL/FDIV/FSQRT, enabled
+    with set_x87_fast(). Only taken with round-to-nearest and double or
+    extended precision control, for normal operands and results; returns
+    false whenever the caller has to use the SoftFloat routines instead.
+*/
+bool i386_device::x87_fast_op(int op, floatx80 a, floatx80 b, floatx80 &result)
+{
+	uint64_t signif;
+	uint16_t sign_exp;
+	int prec;
+	int flags;
+
+	if (!m_x87_fast || float_rounding_mode != float_round_nearest_even)
+		return false;
+
+	// FSQRT ignores precision control in this core
+	if (op == X87_FAST_SQRT)
+		prec = X87_FAST_PREC_EXTENDED;
+	else if (((m_x87_cw >> X87_CW_PC_SHIFT) & X87_CW_PC_MASK) == X87_CW_PC_EXTEND)
+		prec = X87_FAST_PREC_EXTENDED;
+	else if (((m_x87_cw >> X87_CW_PC_SHIFT) & X87_CW_PC_MASK) == X87_CW_PC_DOUBLE)
+		prec = X87_FAST_PREC_DOUBLE;
+	else
+		return false;
+
+	if (!x87_fast_calc(op, prec, a.low, a.high, b.low, b.high, &signif, &sign_exp, &flags))
+		return false;
+
+	result.low = signif;
+	result.high = sign_exp;
+	if (flags & X87_FAST_INEXACT)
+		float_exception_flags |= float_flag_inexact;
+
+	return true;
+}
+
 floatx80 i386_device::x87_add(floatx80 a, floatx80 b)
 {
 	floatx80 result = { 0 };
 
+	if (x87_fast_op(X87_FAST_ADD, a, b, result))
+		return result;
+
 	switch ((m_x87_cw >> X87_CW_PC_SHIFT) & X87_CW_PC_MASK)
 	{
 		case X87_CW_PC_SINGLE:
@@ -280,6 +320,9 @@ floatx80 i386_device::x87_sub(floatx80 a, floatx80 b)
 {
 	floatx80 result = { 0 };
 
+	if (x87_fast_op(X87_FAST_SUB, a, b, result))
+		return result;
+
 	switch ((m_x87_cw >> X87_CW_PC_SHIFT) & X87_CW_PC_MASK)
 	{
 		case X87_CW_PC_SINGLE:
@@ -310,6 +353,9 @@ floatx80 i386_device::x87_mul(floatx80 a, floatx80 b)
 {
 	floatx80 val = { 0 };
 
+	if (x87_fast_op(X87_FAST_MUL, a, b, val))
+		return val;
+
 	switch ((m_x87_cw >> X87_CW_PC_SHIFT) & X87_CW_PC_MASK)
 	{
 		case X87_CW_PC_SINGLE:
@@ -341,6 +387,9 @@ floatx80 i386_device::x87_div(floatx80 a, floatx80 b)
 {
 	floatx80 val = { 0 };
 
+	if (x87_fast_op(X87_FAST_DIV, a, b, val))
+		return val;
+
 	switch ((m_x87_cw >> X87_CW_PC_SHIFT) & X87_CW_PC_MASK)
 	{
 		case X87_CW_PC_SINGLE:
@@ -2364,7 +2413,7 @@ void i386_device::x87_fsqrt(uint8_t modrm)
 			m_x87_sw |= X87_SW_IE;
 			result = fx80_inan;
 		}
-		else
+		else if (!x87_fast_op(X87_FAST_SQRT, value, value, result))
 		{
 			result = floatx80_sqrt(value);
 		}
@@ -19,6 +19,9 @@
 
 #include "x86_cpu.h"
 #include "x86_cpu_factory.h"
+#include "guest_profiler.h"
+#include "instruction_trace.h"
+#include <algorithm>
 #include <stdexcept>
 
 namespace x86emu {
@@ -27,6 +30,7 @@ X86CPU::X86CPU(const std::string& cpuModel, CPUBackendType backendType)
     : m_cpuModel(cpuModel)
     , m_backendType(backendType)
     , m_initialized(false)
+    , m_profiler(nullptr)
 {
     // Check if the requested backend is available
     if (!X86CPUFactory::IsBackendAvailable(backendType)) {
@@ -76,7 +80,25 @@ int X86CPU::Execute(int cycles)
         return 0;
     }
     
-    return m_cpu->Execute(cycles);
+    if (!m_profiler) {
+        return m_cpu->Execute(cycles);
+    }
+    
+    // Run in slices so the profiler can sample between them
+    int slice = m_profiler->getSliceCycles();
+    int executed = 0;
+    
+    while (executed < cycles) {
+        int ran = m_cpu->Execute(std::min(slice, cycles - executed));
+        if (ran <= 0) {
+            break;
+        }
+        
+        executed += ran;
+        m_profiler->onSlice(*this, ran);
+    }
+    
+    return executed;
 }
 
 void X86CPU::Stop()
@@ -100,6 +122,11 @@ void X86CPU::Resume()
     }
 }
 
+uint64_t X86CPU::GetInstructionCount()
+{
+    return m_initialized ? m_cpu->GetInstructionCount() : 0;
+}
+
 void X86CPU::SetIRQ(int irqLine, bool state)
 {
     if (m_initialized) {
@@ -121,6 +148,47 @@ void X86CPU::SetIRQCallback(void* callback)
     }
 }
 
+bool X86CPU::MapMMIO(uint32_t base, uint32_t size, MMIOReadHandler read, MMIOWriteHandler write)
+{
+    if (!m_initialized) {
+        return false;
+    }
+    
+    return m_cpu->MapMMIO(base, size, read, write);
+}
+
+bool X86CPU::SetInterruptAcknowledge(InterruptAcknowledgeHandler acknowledge)
+{
+    if (!m_initialized) {
+        return false;
+    }
+    
+    return m_cpu->SetInterruptAcknowledge(acknowledge);
+}
+
+void X86CPU::SetLocalInterrupt(bool pending)
+{
+    if (m_initialized) {
+        m_cpu->SetLocalInterrupt(pending);
+    }
+}
+
+bool X86CPU::SetCodeWriteHandler(CodeWriteHandler handler)
+{
+    if (!m_initialized) {
+        return false;
+    }
+    
+    return m_cpu->SetCodeWriteHandler(handler);
+}
+
+void X86CPU::WatchCodePage(uint32_t address, bool watch)
+{
+    if (m_initialized) {
+        m_cpu->WatchCodePage(address, watch);
+    }
+}
+
 uint8_t X86CPU::ReadByte(uint32_t address)
 {
     if (!m_initialized) {
@@ -207,7 +275,7 @@ std::string X86CPU::GetDisassembly()
         return "";
     }
     
-    uint32_t pc = m_cpu->GetRegister(0); // Assuming register 0 is the PC/EIP
+    uint32_t pc = m_cpu->GetRegister(I386_REG_EIP);
     return m_cpu->GetDisassembly(pc);
 }
 
@@ -220,9 +288,38 @@ std::string X86CPU::GetCPUType() const
     return m_cpu->GetCPUType();
 }
 
+void X86CPU::SetProfiler(GuestProfiler* profiler)
+{
+    m_profiler = profiler;
+}
+
+bool X86CPU::SetTracer(InstructionTracer* tracer)
+{
+    if (!m_initialized) {
+        return false;
+    }
+    
+    return m_cpu->SetTraceHooks(tracer ? tracer->getHooks() : nullptr);
+}
+
 CPUBackendType X86CPU::GetBackendType() const
 {
     return m_backendType;
 }
 
+bool X86CPU::SetFastFPU(bool enable)
+{
+    return m_cpu->SetFastFPU(enable);
+}
+
+bool X86CPU::SetCycleAccurate(bool enable)
+{
+    return m_cpu->SetCycleAccurate(enable);
+}
+
+bool X86CPU::SetCacheEmulation(bool enable)
+{
+    return m_cpu->SetCacheEmulation(enable);
+}
+
 } // namespace x86emu
\ No newline at end of file
@@ -27,6 +27,9 @@
 
 namespace x86emu {
 
+class GuestProfiler;
+class InstructionTracer;
+
 /**
  * @brief Main CPU class for the x86Emulator
  * 
@@ -83,6 +86,13 @@ public:
      */
     void Resume();
     
+    /**
+     * @brief Get the number of instructions retired so far
+     * 
+     * @return uint64_t Retired instruction count
+     */
+    uint64_t GetInstructionCount();
+    
     /**
      * @brief Set interrupt request line
      * 
@@ -105,6 +115,61 @@ public:
      */
     void SetIRQCallback(void* callback);
     
+    /**
+     * @brief Map a register window into the physical address space
+     * 
+     * Accesses from this CPU to the window go to the handlers instead of
+     * memory. Used for the local and I/O APIC register pages.
+     * 
+     * @param base Physical base address
+     * @param size Window size in bytes
+     * @param read Read handler
+     * @param write Write handler
+     * @return bool True if the backend mapped the window
+     */
+    bool MapMMIO(uint32_t base, uint32_t size, MMIOReadHandler read, MMIOWriteHandler write);
+    
+    /**
+     * @brief Install the interrupt acknowledge handler
+     * 
+     * The interrupt acknowledge cycle asks the handler for the vector
+     * first and falls back to the 8259 built into the backend, if any,
+     * when it returns -1. This puts a local APIC in front of the 8259, or
+     * supplies the 8259 of a backend that has none.
+     * 
+     * @param acknowledge Acknowledge handler, or nullptr to remove it
+     * @return bool True if the backend supports it
+     */
+    bool SetInterruptAcknowledge(InterruptAcknowledgeHandler acknowledge);
+    
+    /**
+     * @brief Set the interrupt line of the local interrupt controller
+     * 
+     * Must be called on the thread executing this CPU.
+     * 
+     * @param pending True while the controller has an interrupt to deliver
+     */
+    void SetLocalInterrupt(bool pending);
+    
+    /**
+     * @brief Set the handler of guest stores to watched code pages
+     * 
+     * For code caches outside the backend. The backend keeps guest RAM
+     * itself, so stores to translated code are only visible through it.
+     * 
+     * @param handler Handler, or nullptr to stop reporting stores
+     * @return bool True if the backend supports it
+     */
+    bool SetCodeWriteHandler(CodeWriteHandler handler);
+    
+    /**
+     * @brief Start or stop reporting stores to a page
+     * 
+     * @param address Any address within the 4 KB page
+     * @param watch True to report stores to the page
+     */
+    void WatchCodePage(uint32_t address, bool watch);
+    
     /**
      * @brief Read byte from memory
      * 
@@ -206,11 +271,78 @@ public:
      */
     CPUBackendType GetBackendType() const;
     
+    /**
+     * @brief Enable the host-native x87 fast path
+     * 
+     * FADD/FSUB/FMUL/FDIV/FSQRT use host double or long double arithmetic
+     * when the guest rounding and precision control match it, and fall
+     * back to the backend's softfloat code for everything else. Results
+     * and exception flags are unchanged; off by default.
+     * 
+     * @param enable True to enable the fast path
+     * @return bool True if the backend supports it
+     */
+    bool SetFastFPU(bool enable);
+    
+    /**
+     * @brief Enable per-model cycle timing
+     * 
+     * When off, the backend charges a flat cost per instruction instead
+     * of consulting its model-specific timing tables. Guest-visible
+     * timing changes; results do not. On by default.
+     * 
+     * @param enable True for model-accurate timing
+     * @return bool True if the backend supports switching it
+     */
+    bool SetCycleAccurate(bool enable);
+    
+    /**
+     * @brief Enable emulation of the on-chip cache contents
+     * 
+     * When off, every memory access bypasses the cache model. Only
+     * observable by guests that rely on cache-as-RAM or non-coherent
+     * cache behaviour. On by default.
+     * 
+     * @param enable True to model the cache
+     * @return bool True if the backend models a cache
+     */
+    bool SetCacheEmulation(bool enable);
+    
+    /**
+     * @brief Attach a guest profiler
+     * 
+     * While attached, Execute() runs in slices and the profiler samples
+     * the guest between them.
+     * 
+     * @param profiler Profiler, or nullptr to detach (not owned)
+     */
+    void SetProfiler(GuestProfiler* profiler);
+    
+    /**
+     * @brief Get the attached guest profiler
+     * 
+     * @return GuestProfiler* Profiler, or nullptr if none is attached
+     */
+    GuestProfiler* GetProfiler() const { return m_profiler; }
+    
+    /**
+     * @brief Attach an instruction tracer
+     * 
+     * The tracer must be open. Backends that translate guest code fall
+     * back to their interpreter while a tracer records memory accesses;
+     * 86Box keeps its recompiler when only registers are recorded.
+     * 
+     * @param tracer Tracer, or nullptr to detach (not owned)
+     * @return bool True if the backend supports tracing
+     */
+    bool SetTracer(InstructionTracer* tracer);
+    
 private:
     std::string m_cpuModel;
     CPUBackendType m_backendType;
     std::unique_ptr<I386CPUInterface> m_cpu;
     bool m_initialized;
+    GuestProfiler* m_profiler;
 };
 
 } // namespace x86emu
@@ -0,0 +1,477 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "x86_smp.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace x86emu {
+
+namespace {
+    // Index of the vCPU running on the current host thread
+    thread_local int t_currentCPU = 0;
+}
+
+X86SMPSystem::X86SMPSystem(const std::string& cpuModel, int cpuCount, int quantumCycles, CPUBackendType backendType)
+    : m_cpuModel(cpuModel)
+    , m_backendType(backendType)
+    , m_quantum(std::max(1, quantumCycles))
+    , m_initialized(false)
+    , m_paused(false)
+    , m_generation(0)
+    , m_quantumCycles(0)
+    , m_pendingCPUs(0)
+    , m_shutdown(false)
+{
+    cpuCount = std::min(std::max(cpuCount, 1), MAX_CPUS);
+
+    // The 86Box core keeps its CPU state in process globals (cpu_state),
+    // so it can only back a single vCPU.
+    if (cpuCount > 1 && m_backendType == CPUBackendType::BOX86) {
+        Logger::GetInstance()->warn("86Box CPU backend does not support SMP, using 1 vCPU instead of %d", cpuCount);
+        cpuCount = 1;
+    }
+
+    for (int i = 0; i < cpuCount; i++) {
+        auto vcpu = std::make_unique<VCPU>();
+        vcpu->cpu = std::make_unique<X86CPU>(m_cpuModel, m_backendType);
+        vcpu->apic = std::make_unique<LocalAPIC>(static_cast<uint8_t>(i));
+        vcpu->apic->setIPICallback([this](const LocalAPIC::IPIMessage& message) {
+            DeliverIPI(message);
+        });
+        vcpu->apic->setEOICallback([this](uint8_t vector) {
+            m_ioapic->endOfInterrupt(vector);
+        });
+        m_vcpus.push_back(std::move(vcpu));
+    }
+
+    // The I/O APIC takes the first ID after the processors
+    m_ioapic = std::make_unique<IOAPIC>(static_cast<uint8_t>(cpuCount));
+    m_ioapic->setDeliveryCallback([this](const LocalAPIC::IPIMessage& message) {
+        DeliverIPI(message);
+    });
+}
+
+X86SMPSystem::~X86SMPSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_startCondition.notify_all();
+
+    for (auto& vcpu : m_vcpus) {
+        if (vcpu->thread.joinable()) {
+            vcpu->thread.join();
+        }
+    }
+}
+
+bool X86SMPSystem::Initialize()
+{
+    if (m_initialized) {
+        return true;
+    }
+
+    for (size_t i = 0; i < m_vcpus.size(); i++) {
+        if (!m_vcpus[i]->cpu->Initialize()) {
+            Logger::GetInstance()->error("Failed to initialize vCPU %d", static_cast<int>(i));
+            return false;
+        }
+        if (!attachAPIC(static_cast<int>(i))) {
+            Logger::GetInstance()->error("The CPU backend cannot host the APICs of vCPU %d", static_cast<int>(i));
+            return false;
+        }
+    }
+
+    // Only the bootstrap processor runs after reset
+    m_vcpus[0]->running = true;
+
+    for (size_t i = 0; i < m_vcpus.size(); i++) {
+        m_vcpus[i]->thread = std::thread(&X86SMPSystem::vcpuThread, this, static_cast<int>(i));
+    }
+
+    m_initialized = true;
+
+    Logger::GetInstance()->info("SMP system initialized: %d vCPUs, quantum %d cycles",
+                                GetCPUCount(), m_quantum);
+    return true;
+}
+
+void X86SMPSystem::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t i = 0; i < m_vcpus.size(); i++) {
+        VCPU& vcpu = *m_vcpus[i];
+        vcpu.cpu->Reset();
+        vcpu.apic->reset();
+        vcpu.running = (i == 0);
+        vcpu.startupVector = -1;
+        vcpu.initPending = false;
+        vcpu.nmiPending = false;
+    }
+
+    m_ioapic->reset();
+}
+
+int X86SMPSystem::Execute(int cycles)
+{
+    if (!m_initialized || m_paused || cycles <= 0) {
+        return 0;
+    }
+
+    int executed = 0;
+
+    while (executed < cycles) {
+        int quantum = std::min(m_quantum, cycles - executed);
+
+        // Release all vCPU threads for one quantum and wait at the barrier
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_quantumCycles = quantum;
+            m_pendingCPUs = GetCPUCount();
+            m_generation++;
+            m_startCondition.notify_all();
+            m_doneCondition.wait(lock, [this] { return m_pendingCPUs == 0; });
+        }
+
+        // All vCPUs are parked: run the shared event scheduler
+        if (m_schedulerCallback) {
+            m_schedulerCallback(quantum);
+        }
+
+        executed += quantum;
+
+        if (m_paused) {
+            break;
+        }
+    }
+
+    return executed;
+}
+
+void X86SMPSystem::Stop()
+{
+    for (auto& vcpu : m_vcpus) {
+        vcpu->cpu->Stop();
+    }
+}
+
+void X86SMPSystem::Pause()
+{
+    m_paused = true;
+    for (auto& vcpu : m_vcpus) {
+        vcpu->cpu->Pause();
+    }
+}
+
+void X86SMPSystem::Resume()
+{
+    for (auto& vcpu : m_vcpus) {
+        vcpu->cpu->Resume();
+    }
+    m_paused = false;
+}
+
+void X86SMPSystem::SetSchedulerCallback(SchedulerCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_schedulerCallback = callback;
+}
+
+void X86SMPSystem::SetQuantum(int quantumCycles)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quantum = std::max(1, quantumCycles);
+}
+
+X86CPU* X86SMPSystem::GetCPU(int index)
+{
+    if (index < 0 || index >= GetCPUCount()) {
+        return nullptr;
+    }
+
+    return m_vcpus[index]->cpu.get();
+}
+
+LocalAPIC* X86SMPSystem::GetLocalAPIC(int index)
+{
+    if (index < 0 || index >= GetCPUCount()) {
+        return nullptr;
+    }
+
+    return m_vcpus[index]->apic.get();
+}
+
+int X86SMPSystem::GetCurrentCPUIndex()
+{
+    return t_currentCPU;
+}
+
+void X86SMPSystem::DeliverIPI(const LocalAPIC::IPIMessage& message)
+{
+    for (auto& vcpuPtr : m_vcpus) {
+        VCPU& vcpu = *vcpuPtr;
+
+        if (!vcpu.apic->matchesDestination(message)) {
+            continue;
+        }
+
+        vcpu.ipisReceived++;
+
+        switch (message.mode) {
+            case LocalAPIC::DeliveryMode::FIXED:
+            case LocalAPIC::DeliveryMode::LOWEST_PRIORITY:
+                vcpu.apic->acceptInterrupt(message.vector, message.triggerLevel);
+                break;
+
+            case LocalAPIC::DeliveryMode::NMI:
+                vcpu.nmiPending = true;
+                break;
+
+            case LocalAPIC::DeliveryMode::INIT:
+                // INIT level de-assert is only used for arbitration ID sync
+                if (message.level) {
+                    vcpu.initPending = true;
+                }
+                break;
+
+            case LocalAPIC::DeliveryMode::STARTUP:
+                vcpu.startupVector = message.vector;
+                break;
+
+            default:
+                Logger::GetInstance()->debug("Unsupported IPI delivery mode %d", static_cast<int>(message.mode));
+                break;
+        }
+
+        // Lowest priority delivery targets a single APIC
+        if (message.mode == LocalAPIC::DeliveryMode::LOWEST_PRIORITY) {
+            break;
+        }
+    }
+}
+
+void X86SMPSystem::DeliverMSI(uint32_t address, uint32_t data)
+{
+    if (!LocalAPIC::isMSIAddress(address)) {
+        Logger::GetInstance()->debug("MSI write outside the APIC window: 0x%08X", address);
+        return;
+    }
+
+    DeliverIPI(LocalAPIC::decodeMSI(address, data));
+}
+
+int X86SMPSystem::AcknowledgeInterrupt(int index)
+{
+    if (index < 0 || index >= GetCPUCount()) {
+        return -1;
+    }
+
+    VCPU& vcpu = *m_vcpus[index];
+    int vector = -1;
+    if (vcpu.apic->hasPendingInterrupt()) {
+        vector = vcpu.apic->acknowledgeInterrupt();
+    }
+
+    // Drop the line once nothing else is pending
+    updateInterruptLine(vcpu);
+    return vector;
+}
+
+std::vector<X86SMPSystem::VCPUStatistics> X86SMPSystem::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<VCPUStatistics> stats;
+    stats.reserve(m_vcpus.size());
+
+    for (size_t i = 0; i < m_vcpus.size(); i++) {
+        const VCPU& vcpu = *m_vcpus[i];
+
+        VCPUStatistics entry;
+        entry.index = static_cast<int>(i);
+        entry.running = vcpu.running;
+        entry.cycles = vcpu.cycles;
+        entry.instructions = vcpu.instructions;
+        entry.quanta = vcpu.quanta;
+        entry.ipisReceived = vcpu.ipisReceived;
+        entry.busySeconds = vcpu.busySeconds;
+        entry.mips = vcpu.busySeconds > 0.0 ? (vcpu.instructions / vcpu.busySeconds) / 1000000.0 : 0.0;
+        stats.push_back(entry);
+    }
+
+    return stats;
+}
+
+void X86SMPSystem::LogStatistics() const
+{
+    for (const auto& entry : GetStatistics()) {
+        Logger::GetInstance()->info("vCPU %d: %s, %llu instructions and %llu cycles in %.3f s, %.2f MIPS, %llu IPIs",
+                                    entry.index,
+                                    entry.running ? "running" : "waiting for SIPI",
+                                    static_cast<unsigned long long>(entry.instructions),
+                                    static_cast<unsigned long long>(entry.cycles),
+                                    entry.busySeconds,
+                                    entry.mips,
+                                    static_cast<unsigned long long>(entry.ipisReceived));
+    }
+}
+
+bool X86SMPSystem::attachAPIC(int index)
+{
+    VCPU& vcpu = *m_vcpus[index];
+    LocalAPIC* apic = vcpu.apic.get();
+
+    // The page is per vCPU: each backend instance maps its own APIC.
+    // Writes can retire or raise vectors, so the line follows them.
+    bool attached = vcpu.cpu->MapMMIO(LocalAPIC::DEFAULT_BASE, 0x1000,
+        [apic](uint32_t offset) {
+            return apic->readRegister(offset);
+        },
+        [this, apic, &vcpu](uint32_t offset, uint32_t value) {
+            apic->writeRegister(offset, value);
+            updateInterruptLine(vcpu);
+        });
+
+    // The I/O APIC is shared, but every vCPU has to reach it
+    IOAPIC* ioapic = m_ioapic.get();
+    attached = attached && vcpu.cpu->MapMMIO(IOAPIC::DEFAULT_BASE, 0x20,
+        [ioapic](uint32_t offset) {
+            return ioapic->readRegister(offset);
+        },
+        [ioapic](uint32_t offset, uint32_t value) {
+            ioapic->writeRegister(offset, value);
+        });
+
+    return attached && vcpu.cpu->SetInterruptAcknowledge([this, index] {
+        return AcknowledgeInterrupt(index);
+    });
+}
+
+void X86SMPSystem::vcpuThread(int index)
+{
+    t_currentCPU = index;
+    uint64_t seenGeneration = 0;
+
+    for (;;) {
+        int cycles;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCondition.wait(lock, [this, seenGeneration] {
+                return m_shutdown || m_generation != seenGeneration;
+            });
+
+            if (m_shutdown) {
+                return;
+            }
+
+            seenGeneration = m_generation;
+            cycles = m_quantumCycles;
+        }
+
+        double seconds = 0.0;
+        uint64_t instructions = 0;
+        int executed = runQuantum(index, cycles, seconds, instructions);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            VCPU& vcpu = *m_vcpus[index];
+            if (executed > 0) {
+                vcpu.cycles += static_cast<uint64_t>(executed);
+                vcpu.instructions += instructions;
+                vcpu.quanta++;
+                vcpu.busySeconds += seconds;
+            }
+
+            if (--m_pendingCPUs == 0) {
+                m_doneCondition.notify_one();
+            }
+        }
+    }
+}
+
+int X86SMPSystem::runQuantum(int index, int cycles, double& seconds, uint64_t& instructions)
+{
+    VCPU& vcpu = *m_vcpus[index];
+
+    // INIT puts the processor back into wait-for-SIPI
+    if (vcpu.initPending.exchange(false)) {
+        vcpu.cpu->Reset();
+        vcpu.apic->reset();
+        vcpu.running = (index == 0);
+    }
+
+    int vector = vcpu.startupVector.exchange(-1);
+    if (vector >= 0 && !vcpu.running) {
+        startApplicationProcessor(vcpu, vector);
+    }
+
+    // Timer runs on the bus clock even while the core is halted
+    vcpu.apic->tick(cycles);
+
+    if (!vcpu.running) {
+        return 0;
+    }
+
+    bool nmi = vcpu.nmiPending.exchange(false);
+    if (nmi) {
+        vcpu.cpu->SetNMI(true);
+    }
+
+    // Interrupts accepted between quanta (I/O APIC, IPIs, timer)
+    updateInterruptLine(vcpu);
+
+    uint64_t retired = vcpu.cpu->GetInstructionCount();
+    auto start = std::chrono::steady_clock::now();
+    int executed = vcpu.cpu->Execute(cycles);
+    auto end = std::chrono::steady_clock::now();
+    instructions = vcpu.cpu->GetInstructionCount() - retired;
+
+    // NMI is edge triggered
+    if (nmi) {
+        vcpu.cpu->SetNMI(false);
+    }
+
+    seconds = std::chrono::duration<double>(end - start).count();
+    return executed;
+}
+
+void X86SMPSystem::startApplicationProcessor(VCPU& vcpu, int vector)
+{
+    // SIPI starts execution in real mode at vector:0000
+    vcpu.cpu->Reset();
+    vcpu.cpu->SetRegister(I386_REG_CS, static_cast<uint32_t>(vector) << 8);
+    vcpu.cpu->SetRegister(I386_REG_EIP, 0);
+    vcpu.running = true;
+
+    Logger::GetInstance()->info("vCPU %d started at %04X:0000", static_cast<int>(vcpu.apic->getId()), vector << 8);
+}
+
+void X86SMPSystem::updateInterruptLine(VCPU& vcpu)
+{
+    vcpu.cpu->SetLocalInterrupt(vcpu.apic->hasPendingInterrupt());
+}
+
+} // namespace x86emu
@@ -0,0 +1,296 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X86EMULATOR_X86_SMP_H
+#define X86EMULATOR_X86_SMP_H
+
+#include "x86_cpu.h"
+#include "local_apic.h"
+#include "io_apic.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace x86emu {
+
+/**
+ * @brief Multiprocessor system of virtual CPUs
+ *
+ * Owns N X86CPU instances, each with its own local APIC and host thread.
+ * Execution proceeds in quanta: every vCPU runs one quantum of cycles,
+ * then all threads meet at a barrier and the shared event scheduler is
+ * run on the calling thread before the next quantum starts.
+ *
+ * The vCPUs of a quantum execute concurrently. Each backend instance keeps
+ * its own CPU state; a backend whose core lives in process globals (86Box)
+ * can only back one vCPU. Shared state the vCPUs reach during a quantum
+ * takes its own locks: the APICs, the memory manager, and the I/O manager,
+ * which serializes port accesses per device. Timers and device updates
+ * only run between quanta, while every vCPU is parked at the barrier.
+ *
+ * Each vCPU maps its local APIC page at LocalAPIC::DEFAULT_BASE and the
+ * I/O APIC window at IOAPIC::DEFAULT_BASE through its backend, and takes
+ * APIC interrupts through the backend's interrupt acknowledge hook.
+ * Backends that cannot host an APIC fail Initialize().
+ *
+ * vCPU 0 is the bootstrap processor. Application processors stay in the
+ * wait-for-SIPI state until the BSP sends INIT and STARTUP IPIs.
+ *
+ * The system also owns the I/O APIC. Its pins and message signalled
+ * interrupts (DeliverMSI, reached through the InterruptRouter) are
+ * delivered on the same APIC bus as IPIs, and EOIs of level-triggered
+ * vectors are broadcast back to it.
+ */
+class X86SMPSystem {
+public:
+    /**
+     * @brief Default quantum size in cycles
+     */
+    static constexpr int DEFAULT_QUANTUM = 10000;
+
+    /**
+     * @brief Maximum number of vCPUs (limited by 8-bit physical APIC IDs)
+     */
+    static constexpr int MAX_CPUS = 32;
+
+    /**
+     * @brief Callback run on the calling thread after each quantum
+     */
+    using SchedulerCallback = std::function<void(int cycles)>;
+
+    /**
+     * @brief Per-vCPU execution statistics
+     */
+    struct VCPUStatistics {
+        int index;              // vCPU index / APIC ID
+        bool running;           // false while waiting for SIPI
+        uint64_t cycles;        // Guest cycles executed
+        uint64_t instructions;  // Instructions retired
+        uint64_t quanta;        // Quanta executed
+        uint64_t ipisReceived;  // IPIs delivered to this vCPU
+        double busySeconds;     // Host time spent executing guest code
+        double mips;            // Retired instructions per busy microsecond
+    };
+
+    /**
+     * @brief Construct a new SMP system
+     *
+     * @param cpuModel CPU model (e.g., "i386", "i486", "pentium")
+     * @param cpuCount Number of vCPUs
+     * @param quantumCycles Cycles each vCPU runs between synchronization points
+     * @param backendType Backend implementation to use
+     */
+    X86SMPSystem(const std::string& cpuModel, int cpuCount, int quantumCycles = DEFAULT_QUANTUM,
+                 CPUBackendType backendType = X86CPUFactory::GetDefaultBackendType());
+
+    /**
+     * @brief Destructor
+     */
+    ~X86SMPSystem();
+
+    /**
+     * @brief Initialize all vCPUs and start their host threads
+     *
+     * @return bool True if initialization was successful
+     */
+    bool Initialize();
+
+    /**
+     * @brief Reset all vCPUs; application processors return to wait-for-SIPI
+     */
+    void Reset();
+
+    /**
+     * @brief Execute for the specified number of cycles on every vCPU
+     *
+     * @param cycles Number of cycles to execute
+     * @return int Number of cycles each vCPU advanced
+     */
+    int Execute(int cycles);
+
+    /**
+     * @brief Stop execution on all vCPUs
+     */
+    void Stop();
+
+    /**
+     * @brief Pause all vCPUs
+     */
+    void Pause();
+
+    /**
+     * @brief Resume all vCPUs
+     */
+    void Resume();
+
+    /**
+     * @brief Set the scheduler callback run between quanta
+     *
+     * @param callback Callback function
+     */
+    void SetSchedulerCallback(SchedulerCallback callback);
+
+    /**
+     * @brief Set the quantum size
+     *
+     * Smaller quanta reduce IPI and device latency, larger quanta reduce
+     * synchronization overhead.
+     *
+     * @param quantumCycles Cycles per quantum
+     */
+    void SetQuantum(int quantumCycles);
+
+    /**
+     * @brief Get the quantum size
+     *
+     * @return int Cycles per quantum
+     */
+    int GetQuantum() const { return m_quantum; }
+
+    /**
+     * @brief Get the number of vCPUs
+     *
+     * @return int vCPU count
+     */
+    int GetCPUCount() const { return static_cast<int>(m_vcpus.size()); }
+
+    /**
+     * @brief Get a vCPU
+     *
+     * @param index vCPU index
+     * @return X86CPU* CPU, or nullptr if the index is invalid
+     */
+    X86CPU* GetCPU(int index);
+
+    /**
+     * @brief Get the local APIC of a vCPU
+     *
+     * @param index vCPU index
+     * @return LocalAPIC* APIC, or nullptr if the index is invalid
+     */
+    LocalAPIC* GetLocalAPIC(int index);
+
+    /**
+     * @brief Get the I/O APIC
+     *
+     * @return IOAPIC* I/O APIC
+     */
+    IOAPIC* GetIOAPIC() { return m_ioapic.get(); }
+
+    /**
+     * @brief Get the index of the vCPU executing on the calling thread
+     *
+     * Used by the APIC MMIO handler to select the per-CPU register page.
+     *
+     * @return int vCPU index, or 0 when called from a non-vCPU thread
+     */
+    static int GetCurrentCPUIndex();
+
+    /**
+     * @brief Deliver an IPI on the APIC bus
+     *
+     * @param message IPI message
+     */
+    void DeliverIPI(const LocalAPIC::IPIMessage& message);
+
+    /**
+     * @brief Deliver a message signalled interrupt
+     *
+     * Target of PCIDevice MSI writes, installed as the MSI handler of the
+     * InterruptRouter. Writes outside the MSI address window are ignored.
+     *
+     * @param address MSI address
+     * @param data MSI data
+     */
+    void DeliverMSI(uint32_t address, uint32_t data);
+
+    /**
+     * @brief Acknowledge the pending interrupt on a vCPU
+     *
+     * Called from the backend's interrupt acknowledge cycle on the thread
+     * executing the vCPU.
+     *
+     * @param index vCPU index
+     * @return int Interrupt vector, or -1 if the local APIC has nothing
+     *             to deliver and the 8259 should be asked instead
+     */
+    int AcknowledgeInterrupt(int index);
+
+    /**
+     * @brief Get execution statistics for all vCPUs
+     *
+     * @return std::vector<VCPUStatistics> One entry per vCPU
+     */
+    std::vector<VCPUStatistics> GetStatistics() const;
+
+    /**
+     * @brief Log per-vCPU MIPS figures
+     */
+    void LogStatistics() const;
+
+private:
+    struct VCPU {
+        std::unique_ptr<X86CPU> cpu;
+        std::unique_ptr<LocalAPIC> apic;
+        std::thread thread;
+        std::atomic<bool> running{false};        // false while waiting for SIPI
+        std::atomic<int> startupVector{-1};      // Pending SIPI vector
+        std::atomic<bool> initPending{false};    // Pending INIT
+        std::atomic<bool> nmiPending{false};     // Pending NMI
+        std::atomic<uint64_t> ipisReceived{0};
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        uint64_t quanta = 0;
+        double busySeconds = 0.0;
+    };
+
+    bool attachAPIC(int index);
+    void vcpuThread(int index);
+    int runQuantum(int index, int cycles, double& seconds, uint64_t& instructions);
+    void startApplicationProcessor(VCPU& vcpu, int vector);
+    void updateInterruptLine(VCPU& vcpu);
+
+    std::string m_cpuModel;
+    CPUBackendType m_backendType;
+    int m_quantum;
+    std::vector<std::unique_ptr<VCPU>> m_vcpus;
+    std::unique_ptr<IOAPIC> m_ioapic;
+    SchedulerCallback m_schedulerCallback;
+    bool m_initialized;
+    std::atomic<bool> m_paused;
+
+    // Quantum barrier
+    mutable std::mutex m_mutex;
+    std::condition_variable m_startCondition;
+    std::condition_variable m_doneCondition;
+    uint64_t m_generation;
+    int m_quantumCycles;
+    int m_pendingCPUs;
+    bool m_shutdown;
+};
+
+} // namespace x86emu
+
+#endif // X86EMULATOR_X86_SMP_H
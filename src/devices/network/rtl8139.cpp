@@ -16,6 +16,7 @@ RTL8139::RTL8139(const std::string& name)
     , m_linkSpeed(100)  // Default to 100 Mbps
     , m_promiscuousMode(false)
     , m_irq(10)  // Default IRQ
+    , m_irqState(false)
     , m_packetCallback(nullptr)
     , m_callbackUserData(nullptr)
     , m_txConfig(0)
@@ -88,6 +89,7 @@ void RTL8139::Reset()
     m_rxConfig = 0;
     m_interruptMask = 0;
     m_interruptStatus = 0;
+    UpdateInterrupt();
     m_command = 0;
     m_capr = 0;
     m_cbr = 0;
@@ -519,11 +521,9 @@ void RTL8139::WriteRegister(uint16_t address, uint32_t value, int size)
             if (size == 2) {
                 m_interruptMask = static_cast<uint16_t>(value);
                 
-                // If any interrupts are now enabled that were previously triggered,
-                // re-trigger them
-                if (m_interruptStatus & m_interruptMask) {
-                    // Call the IRQ handler (PCI bus would handle this)
-                }
+                // Interrupts that were previously triggered and are now
+                // enabled raise the line
+                UpdateInterrupt();
             }
             break;
         
@@ -532,6 +532,7 @@ void RTL8139::WriteRegister(uint16_t address, uint32_t value, int size)
             if (size == 2) {
                 // Writing 1 to a bit clears that interrupt
                 m_interruptStatus &= ~(static_cast<uint16_t>(value));
+                UpdateInterrupt();
             }
             break;
         
@@ -612,15 +613,20 @@ void RTL8139::SetIRQ(int irq)
     m_irq = irq;
 }
 
+void RTL8139::SetIRQCallback(std::function<void(bool state)> callback)
+{
+    std::lock_guard<std::mutex> lock(m_accessMutex);
+    m_irqCallback = callback;
+}
+
 void RTL8139::TriggerInterrupt(uint16_t cause)
 {
     // Set the interrupt status bit
     m_interruptStatus |= cause;
     
-    // Check if this interrupt is enabled
+    // Raise the line if this interrupt is enabled
     if (IsInterruptEnabled(cause)) {
-        // Call the IRQ handler (PCI bus would handle this)
-        // In a real implementation, this would raise the IRQ line
+        UpdateInterrupt();
     }
 }
 
@@ -629,6 +635,17 @@ bool RTL8139::IsInterruptEnabled(uint16_t cause) const
     return (m_interruptMask & cause) != 0;
 }
 
+void RTL8139::UpdateInterrupt()
+{
+    bool state = (m_interruptStatus & m_interruptMask) != 0;
+    if (state != m_irqState) {
+        m_irqState = state;
+        if (m_irqCallback) {
+            m_irqCallback(state);
+        }
+    }
+}
+
 void RTL8139::ProcessReceivedPacket(const uint8_t* data, size_t size)
 {
     // Check if receiver is enabled
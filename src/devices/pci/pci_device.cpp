@@ -1,4 +1,5 @@
 #include "x86emulator/pci_device.h"
+#include "interrupt_router.h"
 #include <cassert>
 
 namespace x86emu {
@@ -8,6 +9,12 @@ PCIDevice::PCIDevice(const std::string& name, const std::string& description)
     , m_bus(0)
     , m_device(0)
     , m_function(0)
+    , m_interruptLevel(false)
+    , m_msiOffset(0)
+    , m_msiNext(0)
+    , m_msiControl(0)
+    , m_msiAddress(0)
+    , m_msiData(0)
 {
 }
 
@@ -36,4 +43,132 @@ void PCIDevice::SetPCIAddress(uint8_t bus, uint8_t device, uint8_t function)
     m_function = function;
 }
 
+void PCIDevice::SetInterruptCallback(InterruptCallback callback)
+{
+    m_interruptCallback = callback;
+}
+
+void PCIDevice::SetMSICallback(MSICallback callback)
+{
+    m_msiCallback = callback;
+}
+
+void PCIDevice::ConnectInterruptRouter(InterruptRouter* router, int pirq)
+{
+    assert(pirq >= 0 && pirq < InterruptRouter::LINE_COUNT - InterruptRouter::PCI_LINE_BASE);
+    
+    int line = InterruptRouter::PCI_LINE_BASE + pirq;
+    m_interruptCallback = [router, line](bool state) {
+        router->setIRQ(line, state);
+    };
+    m_msiCallback = [router](uint32_t address, uint32_t data) {
+        router->sendMSI(address, data);
+    };
+}
+
+bool PCIDevice::IsMSIEnabled() const
+{
+    return m_msiOffset != 0 && (m_msiControl & 0x0001) != 0;
+}
+
+void PCIDevice::EnableMSICapability(uint8_t offset, uint8_t next)
+{
+    assert(offset == 0 || (offset >= 0x40 && offset <= 0x100 - MSI_CAP_SIZE));  // Device-specific region
+    
+    m_msiOffset = offset;
+    m_msiNext = next;
+    m_msiControl = 0;
+    m_msiAddress = 0;
+    m_msiData = 0;
+}
+
+uint8_t PCIDevice::GetMSICapabilityOffset() const
+{
+    return m_msiOffset;
+}
+
+bool PCIDevice::ReadMSICapability(uint8_t reg, int size, uint32_t& value) const
+{
+    if (!m_msiOffset || reg < m_msiOffset || reg >= m_msiOffset + MSI_CAP_SIZE) {
+        return false;
+    }
+    
+    // ID, next pointer, message control, address, data, reserved
+    const uint8_t capability[MSI_CAP_SIZE] = {
+        MSI_CAP_ID, m_msiNext,
+        static_cast<uint8_t>(m_msiControl), static_cast<uint8_t>(m_msiControl >> 8),
+        static_cast<uint8_t>(m_msiAddress), static_cast<uint8_t>(m_msiAddress >> 8),
+        static_cast<uint8_t>(m_msiAddress >> 16), static_cast<uint8_t>(m_msiAddress >> 24),
+        static_cast<uint8_t>(m_msiData), static_cast<uint8_t>(m_msiData >> 8),
+        0, 0
+    };
+    
+    value = 0;
+    for (int i = 0; i < size && reg - m_msiOffset + i < MSI_CAP_SIZE; i++) {
+        value |= static_cast<uint32_t>(capability[reg - m_msiOffset + i]) << (i * 8);
+    }
+    return true;
+}
+
+bool PCIDevice::WriteMSICapability(uint8_t reg, uint32_t value, int size)
+{
+    if (!m_msiOffset || reg < m_msiOffset || reg >= m_msiOffset + MSI_CAP_SIZE) {
+        return false;
+    }
+    
+    bool wasEnabled = IsMSIEnabled();
+    
+    for (int i = 0; i < size && reg - m_msiOffset + i < MSI_CAP_SIZE; i++) {
+        uint8_t byte = static_cast<uint8_t>(value >> (i * 8));
+        int offset = reg - m_msiOffset + i;
+        
+        switch (offset) {
+            case 2:
+                // Only the enable bit is writable: one message, so the
+                // multiple message enable field stays zero
+                m_msiControl = (m_msiControl & ~0x0001) | (byte & 0x01);
+                break;
+            case 4: case 5: case 6: case 7: {
+                int shift = (offset - 4) * 8;
+                m_msiAddress = (m_msiAddress & ~(0xFFu << shift)) | (static_cast<uint32_t>(byte) << shift);
+                m_msiAddress &= ~0x3u;
+                break;
+            }
+            case 8: case 9: {
+                int shift = (offset - 8) * 8;
+                m_msiData = static_cast<uint16_t>((m_msiData & ~(0xFF << shift)) | (byte << shift));
+                break;
+            }
+            default:
+                // ID, next pointer and reserved bytes are read-only
+                break;
+        }
+    }
+    
+    // A device stops driving INTx once it signals with messages
+    if (!wasEnabled && IsMSIEnabled() && m_interruptLevel && m_interruptCallback) {
+        m_interruptCallback(false);
+    }
+    
+    return true;
+}
+
+void PCIDevice::SetInterruptLevel(bool state)
+{
+    bool risingEdge = state && !m_interruptLevel;
+    m_interruptLevel = state;
+    
+    if (IsMSIEnabled()) {
+        // Messages are edge events; there is nothing to deassert
+        if (risingEdge && m_msiCallback) {
+            m_msiCallback(m_msiAddress, m_msiData);
+        }
+        return;
+    }
+    
+    if (m_interruptCallback) {
+        m_interruptCallback(state);
+    }
+}
+
 } // namespace x86emu
\ No newline at end of file
@@ -11,6 +11,9 @@ const uint16_t RTL8139_DEVICE_ID = 0x8139;  // RTL8139
 // PCI Class Code for Ethernet Controller
 const uint8_t RTL8139_CLASS_CODE[3] = { 0x00, 0x00, 0x02 };  // Network, Ethernet
 
+// Configuration space offset of the MSI capability
+const uint8_t RTL8139_MSI_OFFSET = 0x50;
+
 RTL8139PCI::RTL8139PCI(const std::string& name)
     : PCIDevice(name, "Realtek RTL8139 Fast Ethernet PCI")
     , m_vendorID(RTL8139_VENDOR_ID)
@@ -35,6 +38,9 @@ RTL8139PCI::RTL8139PCI(const std::string& name)
     
     // Create the RTL8139 adapter
     m_adapter = std::make_unique<RTL8139>(name + "_adapter");
+    m_adapter->SetIRQCallback([this](bool state) {
+        SetInterruptLevel(state);
+    });
 }
 
 RTL8139PCI::~RTL8139PCI()
@@ -83,6 +89,10 @@ uint32_t RTL8139PCI::ReadConfig(uint8_t reg, int size)
 {
     uint32_t value = 0;
     
+    if (ReadMSICapability(reg, size, value)) {
+        return value;
+    }
+    
     switch (reg) {
         case 0x00:  // Vendor ID
             if (size >= 2) {
@@ -105,6 +115,9 @@ uint32_t RTL8139PCI::ReadConfig(uint8_t reg, int size)
         case 0x06:  // Status
             if (size >= 2) {
                 value = m_status;
+                if (GetMSICapabilityOffset()) {
+                    value |= STATUS_CAP_LIST;
+                }
             }
             break;
             
@@ -140,6 +153,12 @@ uint32_t RTL8139PCI::ReadConfig(uint8_t reg, int size)
             }
             break;
             
+        case 0x34:  // Capabilities Pointer
+            if (size >= 1) {
+                value = GetMSICapabilityOffset();
+            }
+            break;
+            
         case 0x3C:  // Interrupt Line
             if (size >= 1) {
                 value = m_interruptLine;
@@ -158,6 +177,10 @@ uint32_t RTL8139PCI::ReadConfig(uint8_t reg, int size)
 
 void RTL8139PCI::WriteConfig(uint8_t reg, uint32_t value, int size)
 {
+    if (WriteMSICapability(reg, value, size)) {
+        return;
+    }
+    
     switch (reg) {
         case 0x04:  // Command
             if (size >= 2) {
@@ -295,6 +318,15 @@ void RTL8139PCI::SetIRQ(int irq)
     m_adapter->SetIRQ(irq);
 }
 
+void RTL8139PCI::SetMSICapable(bool enable)
+{
+    if (enable) {
+        EnableMSICapability(RTL8139_MSI_OFFSET);
+    } else {
+        EnableMSICapability(0);
+    }
+}
+
 RTL8139* RTL8139PCI::GetAdapter() const
 {
     return m_adapter.get();
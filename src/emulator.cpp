@@ -22,6 +22,7 @@
 #include "memory_manager.h"
 #include "io_manager.h"
 #include "interrupt_controller.h"
+#include "interrupt_router.h"
 #include "device_manager.h"
 #include "timer_manager.h"
 #include "graphics_adapter.h"
@@ -31,16 +32,25 @@
 #include "hard_disk.h"
 #include "network_adapter.h"
 #include "logger.h"
+#include "accuracy_profile.h"
 #include "devices/cpu/i386/x86_cpu.h"
 #include "devices/cpu/i386/x86_cpu_factory.h"
+#include "devices/cpu/i386/x86_smp.h"
+#include "devices/cpu/i386/guest_profiler.h"
+#include "devices/cpu/i386/instruction_trace.h"
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
+#include <sstream>
 #include <stdexcept>
 
 // Default frame rate (60 Hz)
 constexpr int DEFAULT_FRAME_RATE = 60;
 
+// Interrupt lines raised off the CPU thread are delivered at this rate
+constexpr int INTERRUPT_POLL_RATE = 1000;
+
 // CPU cycles per frame (4.77 MHz CPU at 60 Hz = ~79500 cycles/frame)
 constexpr int DEFAULT_CYCLES_PER_FRAME = 79500;
 
@@ -81,10 +91,14 @@ Emulator::~Emulator()
     m_graphicsAdapter.reset();
     m_timerManager.reset();
     m_deviceManager.reset();
+    m_intRouter.reset();
     m_intController.reset();
     m_io.reset();
     m_memory.reset();
+    m_smp.reset();
     m_cpu.reset();
+    m_profiler.reset();
+    m_tracer.reset();
     
     // Save configuration
     if (m_configManager) {
@@ -192,6 +206,45 @@ bool Emulator::initializeCPU()
         // Get CPU backend from configuration
         x86emu::CPUBackendType backendType = x86emu::X86CPUFactory::GetDefaultBackendType();
         
+        // Multiprocessor configuration; a single CPU also goes through the
+        // SMP system when it needs local and I/O APICs
+        int cpuCount = m_configManager->getInt("cpu", "count", 1);
+        bool apic = m_configManager->getBool("cpu", "apic", false);
+        if (cpuCount > 1 || apic) {
+            int quantum = m_configManager->getInt("cpu", "quantum", x86emu::X86SMPSystem::DEFAULT_QUANTUM);
+            
+            m_cpu.reset();
+            m_smp = std::make_unique<x86emu::X86SMPSystem>(cpuModel, cpuCount, quantum, backendType);
+            
+            // Devices and timers advance between quanta while all vCPUs are parked
+            m_smp->SetSchedulerCallback([this](int cycles) {
+                if (m_timerManager) {
+                    m_timerManager->update(cycles);
+                }
+                if (m_deviceManager) {
+                    m_deviceManager->update(cycles);
+                }
+                if (m_intRouter) {
+                    m_intRouter->update();
+                }
+            });
+            
+            if (!m_smp->Initialize()) {
+                m_logger->error("SMP CPU initialization failed");
+                return false;
+            }
+            
+            m_logger->info("CPU initialized: %d x %s (using %s backend, quantum %d cycles)",
+                          m_smp->GetCPUCount(),
+                          cpuModel.c_str(),
+                          getCpuBackendType().c_str(),
+                          m_smp->GetQuantum());
+            
+            return configureFPU() && configureAccuracy() && initializeInterrupts() && configureCodeTracking() && initializeProfiler() && initializeTracer();
+        }
+        
+        m_smp.reset();
+        
         // Create CPU instance
         m_cpu = std::make_unique<x86emu::X86CPU>(cpuModel, backendType);
         
@@ -211,7 +264,7 @@ bool Emulator::initializeCPU()
                       cpuModel.c_str(),
                       getCpuBackendType().c_str());
         
-        return true;
+        return configureFPU() && configureAccuracy() && initializeInterrupts() && configureCodeTracking() && initializeProfiler() && initializeTracer();
         
     } catch (const std::exception& ex) {
         m_logger->error("Exception during CPU initialization: %s", ex.what());
@@ -219,6 +272,296 @@ bool Emulator::initializeCPU()
     }
 }
 
+bool Emulator::configureFPU()
+{
+    // "accurate" keeps the softfloat FPU; "fast" lets the backend use host
+    // floating point for common arithmetic where it gives identical results
+    std::string fpuMode = m_configManager->getString("cpu", "fpu", "accurate");
+    
+    if (fpuMode == "accurate") {
+        return true;
+    }
+    if (fpuMode != "fast") {
+        m_logger->error("Unknown FPU mode: %s", fpuMode.c_str());
+        return false;
+    }
+    
+    bool supported = true;
+    if (m_smp) {
+        for (int i = 0; i < m_smp->GetCPUCount(); i++) {
+            supported = m_smp->GetCPU(i)->SetFastFPU(true) && supported;
+        }
+    } else {
+        supported = m_cpu->SetFastFPU(true);
+    }
+    
+    if (supported) {
+        m_logger->info("Fast FPU mode enabled");
+    } else {
+        m_logger->warn("Fast FPU mode not supported by the %s backend", getCpuBackendType().c_str());
+    }
+    
+    return true;
+}
+
+bool Emulator::configureAccuracy()
+{
+    AccuracyProfile* profile = AccuracyProfile::GetInstance();
+    bool cycleTiming = profile->isEnabled(AccuracyProfile::Feature::CYCLE_TIMING);
+    bool cpuCache = profile->isEnabled(AccuracyProfile::Feature::CPU_CACHE);
+    
+    bool timingSupported = true;
+    bool cacheSupported = true;
+    if (m_smp) {
+        for (int i = 0; i < m_smp->GetCPUCount(); i++) {
+            timingSupported = m_smp->GetCPU(i)->SetCycleAccurate(cycleTiming) && timingSupported;
+            cacheSupported = m_smp->GetCPU(i)->SetCacheEmulation(cpuCache) && cacheSupported;
+        }
+    } else {
+        timingSupported = m_cpu->SetCycleAccurate(cycleTiming);
+        cacheSupported = m_cpu->SetCacheEmulation(cpuCache);
+    }
+    
+    // Backends without a model have nothing to turn off, so only an
+    // explicit request for the model is worth a warning
+    if (!timingSupported && cycleTiming) {
+        m_logger->warn("Cycle timing tables not modelled by the %s backend", getCpuBackendType().c_str());
+    }
+    if (!cacheSupported && cpuCache) {
+        m_logger->warn("CPU cache contents not modelled by the %s backend", getCpuBackendType().c_str());
+    }
+    
+    return true;
+}
+
+bool Emulator::initializeInterrupts()
+{
+    x86emu::X86CPU* cpu = m_smp ? m_smp->GetCPU(0) : m_cpu.get();
+    bool backendPIC = cpu->GetBackendType() == x86emu::CPUBackendType::BOX86;
+    
+    m_intRouter = std::make_unique<InterruptRouter>();
+    m_intRouter->setCPU(cpu, backendPIC);
+    
+    // Backends without their own 8259 pair use the InterruptController
+    if (!backendPIC) {
+        if (!m_intController) {
+            m_intController = std::make_unique<InterruptController>();
+            if (!m_intController->initialize()) {
+                return false;
+            }
+        }
+        m_intRouter->setController(m_intController.get());
+        
+        // With SMP the acknowledge cycle belongs to the local APICs
+        bool acknowledge = m_smp || cpu->SetInterruptAcknowledge([this]() {
+            return m_intRouter->acknowledge();
+        });
+        if (!acknowledge) {
+            m_logger->warn("The %s backend cannot acknowledge interrupts through the interrupt controller",
+                          getCpuBackendType().c_str());
+        }
+        
+        if (m_io) {
+            auto read = [this](uint16_t port) -> uint8_t {
+                return m_intController->readRegister(port);
+            };
+            auto write = [this](uint16_t port, uint8_t value) {
+                m_intController->writeRegister(port, value);
+                m_intRouter->update();
+            };
+            m_io->registerIOPortRange(0x20, 0x21, "PIC1", read, write);
+            m_io->registerIOPortRange(0xA0, 0xA1, "PIC2", read, write);
+        }
+    }
+    
+    if (m_smp) {
+        m_intRouter->setIOAPIC(m_smp->GetIOAPIC());
+        m_intRouter->setMSIHandler([this](uint32_t address, uint32_t data) {
+            m_smp->DeliverMSI(address, data);
+        });
+    }
+    
+    m_logger->info("Interrupt routing: ISA lines to %s%s",
+                  backendPIC ? "the backend PIC" : "the interrupt controller",
+                  m_smp ? ", all lines to the I/O APIC" : "");
+    return true;
+}
+
+bool Emulator::configureCodeTracking()
+{
+    if (!m_memory) {
+        return true;
+    }
+    
+    // vCPUs share the backend's RAM, so one of them carries the hook
+    x86emu::X86CPU* cpu = m_smp ? m_smp->GetCPU(0) : m_cpu.get();
+    MemoryManager* memory = m_memory.get();
+    
+    bool supported = cpu->SetCodeWriteHandler([memory](uint32_t address, uint32_t size) {
+        memory->notifyWrite(address, size);
+    });
+    if (!supported) {
+        m_logger->warn("The %s backend cannot report stores to translated code", getCpuBackendType().c_str());
+        memory->setCodePageWatcher(nullptr);
+        return true;
+    }
+    
+    memory->setCodePageWatcher([cpu](uint32_t address, bool watch) {
+        cpu->WatchCodePage(address, watch);
+    });
+    return true;
+}
+
+bool Emulator::initializeProfiler()
+{
+    m_profiler.reset();
+    
+    if (!m_configManager->getBool("profiler", "enabled", false)) {
+        return true;
+    }
+    
+    std::string modeName = m_configManager->getString("profiler", "mode", "cycles");
+    x86emu::GuestProfiler::Mode mode;
+    int interval;
+    
+    if (modeName == "cycles") {
+        mode = x86emu::GuestProfiler::Mode::CYCLES;
+        interval = m_configManager->getInt("profiler", "interval", 10000);
+    } else if (modeName == "time") {
+        mode = x86emu::GuestProfiler::Mode::HOST_TIME;
+        interval = m_configManager->getInt("profiler", "interval", 1000);  // microseconds
+    } else {
+        m_logger->error("Unknown profiler mode: %s", modeName.c_str());
+        return false;
+    }
+    
+    if (interval <= 0) {
+        m_logger->error("Invalid profiler interval: %d", interval);
+        return false;
+    }
+    
+    m_profiler = std::make_unique<x86emu::GuestProfiler>(mode, static_cast<uint32_t>(interval));
+    m_profiler->setBlockSize(static_cast<uint32_t>(m_configManager->getInt("profiler", "block_size", 64)));
+    
+    std::string symbols = m_configManager->getString("profiler", "symbols", "");
+    if (!symbols.empty()) {
+        m_profiler->loadSymbolMap(symbols);
+    }
+    
+    // vCPUs share one profiler so samples land in a single profile
+    if (m_smp) {
+        for (int i = 0; i < m_smp->GetCPUCount(); i++) {
+            m_smp->GetCPU(i)->SetProfiler(m_profiler.get());
+        }
+    } else if (m_cpu) {
+        m_cpu->SetProfiler(m_profiler.get());
+    }
+    
+    m_logger->info("Guest profiler enabled: sampling every %d %s",
+                  interval, mode == x86emu::GuestProfiler::Mode::CYCLES ? "cycles" : "us");
+    return true;
+}
+
+void Emulator::writeProfile()
+{
+    if (!m_profiler || m_profiler->getSampleCount() == 0) {
+        return;
+    }
+    
+    std::string folded = m_configManager->getString("profiler", "output", "guest_profile.folded");
+    std::string report = m_configManager->getString("profiler", "report", "guest_profile.txt");
+    
+    if (!folded.empty()) {
+        m_profiler->writeFoldedStacks(folded);
+    }
+    if (!report.empty()) {
+        m_profiler->writeReport(report);
+    }
+}
+
+bool Emulator::initializeTracer()
+{
+    closeTrace();
+    
+    if (!m_configManager->getBool("trace", "enabled", false)) {
+        return true;
+    }
+    
+    // Comma-separated register names, or "all"
+    static const char* const registerNames[I386_TRACE_REG_COUNT] = {
+        "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "eflags"
+    };
+    std::string registers = m_configManager->getString("trace", "registers", "all");
+    uint32_t registerMask = 0;
+    
+    if (registers == "all") {
+        registerMask = x86emu::InstructionTracer::ALL_REGISTERS;
+    } else {
+        std::istringstream list(registers);
+        std::string name;
+        while (std::getline(list, name, ',')) {
+            name.erase(0, name.find_first_not_of(" \t"));
+            name.erase(name.find_last_not_of(" \t") + 1);
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            if (name.empty()) {
+                continue;
+            }
+            
+            int index = 0;
+            while (index < I386_TRACE_REG_COUNT && name != registerNames[index]) {
+                index++;
+            }
+            if (index == I386_TRACE_REG_COUNT) {
+                m_logger->error("Unknown trace register: %s", name.c_str());
+                return false;
+            }
+            registerMask |= 1u << index;
+        }
+    }
+    
+    std::string output = m_configManager->getString("trace", "output", "guest_trace.bin");
+    bool memory = m_configManager->getBool("trace", "memory", true);
+    
+    m_tracer = std::make_unique<x86emu::InstructionTracer>();
+    if (!m_tracer->open(output, registerMask, memory)) {
+        m_tracer.reset();
+        return false;
+    }
+    
+    bool supported = true;
+    if (m_smp) {
+        for (int i = 0; i < m_smp->GetCPUCount(); i++) {
+            supported = m_smp->GetCPU(i)->SetTracer(m_tracer.get()) && supported;
+        }
+    } else if (m_cpu) {
+        supported = m_cpu->SetTracer(m_tracer.get());
+    }
+    
+    if (!supported) {
+        m_logger->warn("Instruction tracing not supported by the %s backend", getCpuBackendType().c_str());
+    }
+    
+    return true;
+}
+
+void Emulator::closeTrace()
+{
+    if (!m_tracer) {
+        return;
+    }
+    
+    // Detach first so no CPU records into a closed trace
+    if (m_smp) {
+        for (int i = 0; i < m_smp->GetCPUCount(); i++) {
+            m_smp->GetCPU(i)->SetTracer(nullptr);
+        }
+    } else if (m_cpu) {
+        m_cpu->SetTracer(nullptr);
+    }
+    
+    m_tracer.reset();
+}
+
 bool Emulator::initializeMemory()
 {
     m_logger->info("Initializing memory subsystem...");
@@ -380,7 +723,11 @@ bool Emulator::initializeBIOS()
         }
         
         // Reset CPU to start execution from BIOS entry point
-        m_cpu->Reset();
+        if (m_smp) {
+            m_smp->Reset();
+        } else {
+            m_cpu->Reset();
+        }
         
         m_logger->info("BIOS initialized");
         return true;
@@ -407,6 +754,30 @@ void Emulator::loadConfiguration()
         // Get frame rate
         m_framesPerSecond = m_configManager->getInt("timing", "framerate", DEFAULT_FRAME_RATE);
         
+        // Select the accuracy profile before any component queries it
+        AccuracyProfile* profile = AccuracyProfile::GetInstance();
+        std::string profileName = m_configManager->getString("machine", "profile", "accurate");
+        if (!profile->setProfile(profileName)) {
+            m_logger->warn("Unknown accuracy profile %s, using accurate", profileName.c_str());
+            profile->setProfile("accurate");
+        }
+        
+        std::ostringstream disabled;
+        for (int i = 0; i < static_cast<int>(AccuracyProfile::Feature::COUNT); i++) {
+            AccuracyProfile::Feature feature = static_cast<AccuracyProfile::Feature>(i);
+            const char* name = AccuracyProfile::getFeatureName(feature);
+            bool enabled = m_configManager->getBool("accuracy", name, profile->isEnabled(feature));
+            profile->setEnabled(feature, enabled);
+            if (!enabled) {
+                disabled << " " << name;
+            } else if (AccuracyProfile::isUnsafe(feature)) {
+                m_logger->warn("Accuracy feature %s is unsafe and may change guest-visible results", name);
+            }
+        }
+        
+        m_logger->info("Accuracy profile: %s (disabled:%s)", profile->getProfile().c_str(),
+                      disabled.str().empty() ? " none" : disabled.str().c_str());
+        
     } catch (const std::exception& ex) {
         m_logger->error("Exception during configuration loading: %s", ex.what());
     }
@@ -452,10 +823,16 @@ void Emulator::stop()
     m_logger->info("Stopping emulation...");
     
     // Stop CPU
-    if (m_cpu) {
+    if (m_smp) {
+        m_smp->Stop();
+        m_smp->LogStatistics();
+    } else if (m_cpu) {
         m_cpu->Stop();
     }
     
+    writeProfile();
+    closeTrace();
+    
     // Update state
     m_running = false;
     m_paused = false;
@@ -477,7 +854,9 @@ void Emulator::pause()
     m_logger->info("Pausing emulation...");
     
     // Pause CPU
-    if (m_cpu) {
+    if (m_smp) {
+        m_smp->Pause();
+    } else if (m_cpu) {
         m_cpu->Pause();
     }
     
@@ -506,7 +885,9 @@ void Emulator::resume()
     m_logger->info("Resuming emulation...");
     
     // Resume CPU
-    if (m_cpu) {
+    if (m_smp) {
+        m_smp->Resume();
+    } else if (m_cpu) {
         m_cpu->Resume();
     }
     
@@ -531,7 +912,9 @@ void Emulator::reset()
     m_logger->info("Resetting system...");
     
     // Reset CPU
-    if (m_cpu) {
+    if (m_smp) {
+        m_smp->Reset();
+    } else if (m_cpu) {
         m_cpu->Reset();
     }
     
@@ -544,6 +927,10 @@ void Emulator::reset()
         m_intController->reset();
     }
     
+    if (m_intRouter) {
+        m_intRouter->reset();
+    }
+    
     if (m_graphicsAdapter) {
         m_graphicsAdapter->reset();
     }
@@ -595,8 +982,30 @@ int Emulator::runFrame()
         // Calculate cycles for this frame
         int cyclesPerFrame = m_cyclesPerSecond / m_framesPerSecond;
         
-        // Run CPU for the calculated number of cycles
-        int executedCycles = m_cpu->Execute(cyclesPerFrame);
+        // SMP: timers and devices are updated by the scheduler callback
+        // at every quantum boundary
+        if (m_smp) {
+            return m_smp->Execute(cyclesPerFrame);
+        }
+        
+        // Run CPU for the calculated number of cycles, in slices so that
+        // interrupts raised by other threads wait at most one slice
+        int sliceCycles = std::max(1, m_cyclesPerSecond / INTERRUPT_POLL_RATE);
+        int executedCycles = 0;
+        {
+            InterruptRouter::ExecutionScope scope(m_intRouter.get());
+            while (executedCycles < cyclesPerFrame) {
+                int cycles = m_cpu->Execute(std::min(sliceCycles, cyclesPerFrame - executedCycles));
+                if (cycles <= 0) {
+                    break;
+                }
+                executedCycles += cycles;
+                
+                if (m_intRouter) {
+                    m_intRouter->update();
+                }
+            }
+        }
         
         // Update timers
         if (m_timerManager) {
@@ -608,6 +1017,11 @@ int Emulator::runFrame()
             m_deviceManager->update(executedCycles);
         }
         
+        // Deliver the interrupts raised by the device updates
+        if (m_intRouter) {
+            m_intRouter->update();
+        }
+        
         return executedCycles;
         
     } catch (const std::exception& ex) {
@@ -950,11 +1364,12 @@ bool Emulator::getNetworkActivity() const
 
 std::string Emulator::getCpuBackendType() const
 {
-    if (!m_cpu) {
+    x86emu::X86CPU* cpu = m_smp ? m_smp->GetCPU(0) : m_cpu.get();
+    if (!cpu) {
         return "Unknown";
     }
     
-    x86emu::CPUBackendType type = m_cpu->GetBackendType();
+    x86emu::CPUBackendType type = cpu->GetBackendType();
     switch (type) {
         case x86emu::CPUBackendType::MAME:
             return "MAME";
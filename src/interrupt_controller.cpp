@@ -20,9 +20,13 @@
 #include "interrupt_controller.h"
 #include "logger.h"
 
+#include <cstring>
+
 InterruptController::InterruptController()
     : m_irqLines(0),
-      m_irqRequests(0)
+      m_irqRequests(0),
+      m_irqRequestsSeen(0),
+      m_pending(false)
 {
     // Initialize PICs
     memset(&m_pic1, 0, sizeof(PIC));
@@ -35,8 +39,6 @@ InterruptController::~InterruptController()
 
 bool InterruptController::initialize()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
     try {
         // Reset PICs
         reset();
@@ -52,8 +54,6 @@ bool InterruptController::initialize()
 
 void InterruptController::reset()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
     // Reset master PIC
     m_pic1.irr = 0;
     m_pic1.isr = 0;
@@ -85,64 +85,51 @@ void InterruptController::reset()
     m_pic2.priority = 0;
     
     // Reset IRQ lines
-    m_irqLines = 0;
-    m_irqRequests = 0;
+    m_irqLines.store(0, std::memory_order_relaxed);
+    m_irqRequests.store(0, std::memory_order_relaxed);
+    m_irqRequestsSeen = 0;
+    m_pending = false;
     
     Logger::GetInstance()->info("Interrupt controller reset");
 }
 
 void InterruptController::setIRQ(int irq, bool state)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
     // Check if IRQ is valid
     if (irq < 0 || irq > 15) {
         Logger::GetInstance()->warn("Invalid IRQ number: %d", irq);
         return;
     }
     
-    // Update IRQ line state
-    uint16_t mask = 1 << irq;
-    bool oldState = (m_irqLines & mask) != 0;
+    // Update IRQ line state; only a rising edge latches a request, and
+    // the release pairs with the acquire in isPending()
+    uint16_t mask = static_cast<uint16_t>(1 << irq);
     
-    if (state != oldState) {
-        // State changed
-        if (state) {
-            m_irqLines |= mask;
-            m_irqRequests |= mask;
-            
-            Logger::GetInstance()->debug("IRQ %d asserted", irq);
-        } else {
-            m_irqLines &= ~mask;
-            
-            Logger::GetInstance()->debug("IRQ %d deasserted", irq);
+    if (state) {
+        uint16_t oldLines = m_irqLines.fetch_or(mask, std::memory_order_relaxed);
+        if (!(oldLines & mask)) {
+            m_irqRequests.fetch_or(mask, std::memory_order_release);
         }
-        
-        // Update PICs
-        updatePIC();
+    } else {
+        m_irqLines.fetch_and(static_cast<uint16_t>(~mask), std::memory_order_relaxed);
     }
 }
 
-bool InterruptController::isPending() const
+bool InterruptController::isPending()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    // Check if master PIC has a pending interrupt
-    if (picHasPendingInterrupt(m_pic1)) {
-        return true;
-    }
-    
-    // Check if slave PIC has a pending interrupt and is not masked by master
-    if (picHasPendingInterrupt(m_pic2) && !(m_pic1.imr & (1 << 2))) {
-        return true;
+    // Rerun the PICs only when a device has changed the request word
+    if (m_irqRequests.load(std::memory_order_acquire) != m_irqRequestsSeen) {
+        updatePIC();
     }
     
-    return false;
+    return m_pending;
 }
 
 int InterruptController::getNextInterruptVector()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_irqRequests.load(std::memory_order_acquire) != m_irqRequestsSeen) {
+        updatePIC();
+    }
     
     // Check if master PIC has a pending interrupt
     int masterIRQ = getHighestPriorityIRQ(m_pic1);
@@ -161,6 +148,7 @@ int InterruptController::getNextInterruptVector()
                 
                 // Clear request bit
                 m_pic2.irr &= ~(1 << slaveIRQ);
+                m_pending = checkPending();
                 
                 Logger::GetInstance()->debug("Interrupt vector 0x%02X (IRQ %d) from slave PIC", vector, slaveIRQ + 8);
                 return vector;
@@ -174,6 +162,7 @@ int InterruptController::getNextInterruptVector()
             
             // Clear request bit
             m_pic1.irr &= ~(1 << masterIRQ);
+            m_pending = checkPending();
             
             Logger::GetInstance()->debug("Interrupt vector 0x%02X (IRQ %d) from master PIC", vector, masterIRQ);
             return vector;
@@ -185,8 +174,6 @@ int InterruptController::getNextInterruptVector()
 
 void InterruptController::acknowledgeInterrupt(int irq)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
     // Check if IRQ is valid
     if (irq < 0 || irq > 15) {
         Logger::GetInstance()->warn("Invalid IRQ number: %d", irq);
@@ -204,22 +191,19 @@ void InterruptController::acknowledgeInterrupt(int irq)
         acknowledgeInterruptPIC(m_pic1, 2);
     }
     
-    // Clear IRQ request
-    m_irqRequests &= ~(1 << irq);
+    // Clear IRQ request; the PICs pick the change up on the next check
+    m_irqRequests.fetch_and(static_cast<uint16_t>(~(1 << irq)), std::memory_order_relaxed);
     
     Logger::GetInstance()->debug("IRQ %d acknowledged", irq);
 }
 
 void InterruptController::registerInterruptCallback(InterruptCallback callback)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
     m_interruptCallback = callback;
 }
 
 uint8_t InterruptController::readRegister(uint16_t port) const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
     // Determine which PIC and register to read
     if (port == PIC1_COMMAND) {
         // Master PIC command port
@@ -244,8 +228,6 @@ uint8_t InterruptController::readRegister(uint16_t port) const
 
 void InterruptController::writeRegister(uint16_t port, uint8_t value)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
     // Determine which PIC and register to write
     if (port == PIC1_COMMAND) {
         // Master PIC command port
@@ -411,12 +393,16 @@ void InterruptController::update()
 
 void InterruptController::updatePIC()
 {
+    // Snapshot the request word; later edges are seen on the next check
+    uint16_t requests = m_irqRequests.load(std::memory_order_acquire);
+    m_irqRequestsSeen = requests;
+    
     // Update master PIC IRR based on IRQ requests
-    uint8_t masterRequests = m_irqRequests & 0xFF;
+    uint8_t masterRequests = requests & 0xFF;
     m_pic1.irr = masterRequests & ~m_pic1.imr;
     
     // Update slave PIC IRR based on IRQ requests
-    uint8_t slaveRequests = (m_irqRequests >> 8) & 0xFF;
+    uint8_t slaveRequests = (requests >> 8) & 0xFF;
     m_pic2.irr = slaveRequests & ~m_pic2.imr;
     
     // If slave PIC has IRQs pending, assert IRQ2 on master
@@ -424,14 +410,31 @@ void InterruptController::updatePIC()
         m_pic1.irr |= (1 << 2) & ~m_pic1.imr;
     }
     
+    m_pending = checkPending();
+    
     // Check if we need to notify about a pending interrupt
-    if (isPending() && m_interruptCallback) {
+    if (m_pending && m_interruptCallback) {
         // Just notify that an interrupt is pending, the actual vector
         // will be determined when update() is called
         m_interruptCallback(-1);
     }
 }
 
+bool InterruptController::checkPending() const
+{
+    // Check if master PIC has a pending interrupt
+    if (picHasPendingInterrupt(m_pic1)) {
+        return true;
+    }
+    
+    // Check if slave PIC has a pending interrupt and is not masked by master
+    if (picHasPendingInterrupt(m_pic2) && !(m_pic1.imr & (1 << 2))) {
+        return true;
+    }
+    
+    return false;
+}
+
 bool InterruptController::picHasPendingInterrupt(const PIC& pic) const
 {
     // Check if any unmasked interrupt is pending
@@ -466,20 +469,3 @@ void InterruptController::acknowledgeInterruptPIC(PIC& pic, int irq)
         pic.irr &= ~(1 << irq);
     }
 }
-
-void InterruptController::setIRQLine(int irq, bool state)
-{
-    // Update IRQ line state
-    uint16_t mask = 1 << irq;
-    bool oldState = (m_irqLines & mask) != 0;
-    
-    if (state != oldState) {
-        // State changed
-        if (state) {
-            m_irqLines |= mask;
-            m_irqRequests |= mask;
-        } else {
-            m_irqLines &= ~mask;
-        }
-    }
-}
\ No newline at end of file
@@ -0,0 +1,242 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ * 
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "interrupt_router.h"
+#include "interrupt_controller.h"
+#include "logger.h"
+#include "devices/cpu/i386/x86_cpu.h"
+#include "devices/cpu/i386/io_apic.h"
+
+namespace {
+    // Router whose CPU is running guest code on this thread
+    thread_local InterruptRouter* t_executingRouter = nullptr;
+}
+
+InterruptRouter::ExecutionScope::ExecutionScope(InterruptRouter* router)
+    : m_previous(t_executingRouter)
+{
+    t_executingRouter = router;
+}
+
+InterruptRouter::ExecutionScope::~ExecutionScope()
+{
+    t_executingRouter = m_previous;
+}
+
+InterruptRouter::InterruptRouter()
+    : m_cpu(nullptr),
+      m_backendPIC(false),
+      m_controller(nullptr),
+      m_ioapic(nullptr),
+      m_lines(0),
+      m_edges(0),
+      m_changed(0),
+      m_delivered(0),
+      m_cpuIRQ(false)
+{
+    rebuildRoutes();
+}
+
+InterruptRouter::~InterruptRouter()
+{
+}
+
+void InterruptRouter::setCPU(x86emu::X86CPU* cpu, bool backendPIC)
+{
+    m_cpu = cpu;
+    m_backendPIC = backendPIC;
+    m_cpuIRQ = false;
+    rebuildRoutes();
+}
+
+void InterruptRouter::setController(InterruptController* controller)
+{
+    m_controller = controller;
+    rebuildRoutes();
+}
+
+void InterruptRouter::setIOAPIC(x86emu::IOAPIC* ioapic)
+{
+    m_ioapic = ioapic;
+    rebuildRoutes();
+}
+
+void InterruptRouter::setMSIHandler(MSIHandler handler)
+{
+    m_msiHandler = handler;
+}
+
+void InterruptRouter::sendMSI(uint32_t address, uint32_t data)
+{
+    if (!m_msiHandler) {
+        Logger::GetInstance()->debug("MSI 0x%08X/0x%08X dropped: no APIC bus", address, data);
+        return;
+    }
+    
+    m_msiHandler(address, data);
+}
+
+void InterruptRouter::setIRQ(int line, bool state)
+{
+    // Check if line is valid
+    if (line < 0 || line >= LINE_COUNT) {
+        Logger::GetInstance()->warn("Invalid interrupt line: %d", line);
+        return;
+    }
+    
+    uint32_t mask = 1u << line;
+    
+    if (state) {
+        uint32_t oldLines = m_lines.fetch_or(mask, std::memory_order_relaxed);
+        if (oldLines & mask) {
+            return;
+        }
+        m_edges.fetch_or(mask, std::memory_order_relaxed);
+    } else {
+        uint32_t oldLines = m_lines.fetch_and(~mask, std::memory_order_relaxed);
+        if (!(oldLines & mask)) {
+            return;
+        }
+    }
+    
+    // Publish after the state; pairs with the acquire in update()
+    m_changed.fetch_or(mask, std::memory_order_release);
+    
+    // Raised by a port or MMIO handler of the running CPU: no need to wait
+    if (t_executingRouter == this) {
+        update();
+    }
+}
+
+void InterruptRouter::update()
+{
+    uint32_t changed = m_changed.exchange(0, std::memory_order_acquire);
+    
+    if (changed) {
+        uint32_t edges = m_edges.exchange(0, std::memory_order_relaxed) & changed;
+        uint32_t lines = m_lines.load(std::memory_order_relaxed);
+        
+        for (int line = 0; line < LINE_COUNT; line++) {
+            uint32_t mask = 1u << line;
+            if (!(changed & mask)) {
+                continue;
+            }
+            
+            bool state = (lines & mask) != 0;
+            bool delivered = (m_delivered & mask) != 0;
+            
+            if (edges & mask) {
+                // Replay a rising edge that happened since the last update,
+                // even if the line has dropped again by now
+                if (delivered) {
+                    deliver(line, false);
+                }
+                deliver(line, true);
+                delivered = true;
+            }
+            if (state != delivered) {
+                deliver(line, state);
+            }
+            
+            if (state) {
+                m_delivered |= mask;
+            } else {
+                m_delivered &= ~mask;
+            }
+        }
+    }
+    
+    updateCPUIRQ();
+}
+
+int InterruptRouter::acknowledge()
+{
+    if (m_backendPIC || !m_controller) {
+        return -1;
+    }
+    
+    int vector = m_controller->getNextInterruptVector();
+    updateCPUIRQ();
+    return vector;
+}
+
+void InterruptRouter::reset()
+{
+    m_lines.store(0, std::memory_order_relaxed);
+    m_edges.store(0, std::memory_order_relaxed);
+    m_changed.store(0, std::memory_order_relaxed);
+    m_delivered = 0;
+    
+    if (m_cpuIRQ && m_cpu) {
+        m_cpu->SetIRQ(0, false);
+    }
+    m_cpuIRQ = false;
+}
+
+void InterruptRouter::rebuildRoutes()
+{
+    for (int line = 0; line < LINE_COUNT; line++) {
+        uint8_t route = 0;
+        
+        // ISA lines feed exactly one 8259 model
+        if (line < 16) {
+            if (m_cpu && m_backendPIC) {
+                route |= ROUTE_BACKEND;
+            } else if (m_controller) {
+                route |= ROUTE_CONTROLLER;
+            }
+        }
+        
+        // Every line is wired to the I/O APIC pin of the same number
+        if (m_ioapic && line < x86emu::IOAPIC::PIN_COUNT) {
+            route |= ROUTE_IOAPIC;
+        }
+        
+        m_routes[line] = route;
+    }
+}
+
+void InterruptRouter::deliver(int line, bool state)
+{
+    uint8_t route = m_routes[line];
+    
+    if (route & ROUTE_BACKEND) {
+        m_cpu->SetIRQ(line, state);
+    }
+    if (route & ROUTE_CONTROLLER) {
+        m_controller->setIRQ(line, state);
+    }
+    if (route & ROUTE_IOAPIC) {
+        m_ioapic->setIRQ(line, state);
+    }
+}
+
+void InterruptRouter::updateCPUIRQ()
+{
+    // The backend PIC drives the core itself; otherwise INTR follows the controller
+    if (!m_cpu || m_backendPIC || !m_controller) {
+        return;
+    }
+    
+    bool pending = m_controller->isPending();
+    if (pending != m_cpuIRQ) {
+        m_cpuIRQ = pending;
+        m_cpu->SetIRQ(0, pending);
+    }
+}
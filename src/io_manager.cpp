@@ -49,12 +49,22 @@ bool IOManager::initialize()
 
 uint8_t IOManager::readByte(uint16_t port) const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    IOReadCallback callback;
+    std::shared_ptr<std::recursive_mutex> deviceLock;
     
     // Find port handler
-    const IOPortRange* range = getIOPortRange(port);
-    if (range && range->readCallback) {
-        return range->readCallback(port);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const IOPortRange* range = getIOPortRange(port);
+        if (range && range->readCallback) {
+            callback = range->readCallback;
+            deviceLock = range->deviceLock;
+        }
+    }
+    
+    if (callback) {
+        std::lock_guard<std::recursive_mutex> lock(*deviceLock);
+        return callback(port);
     }
     
     // Use default handler
@@ -83,12 +93,22 @@ uint32_t IOManager::readDword(uint16_t port) const
 
 void IOManager::writeByte(uint16_t port, uint8_t value) const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    IOWriteCallback callback;
+    std::shared_ptr<std::recursive_mutex> deviceLock;
     
     // Find port handler
-    const IOPortRange* range = getIOPortRange(port);
-    if (range && range->writeCallback) {
-        range->writeCallback(port, value);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const IOPortRange* range = getIOPortRange(port);
+        if (range && range->writeCallback) {
+            callback = range->writeCallback;
+            deviceLock = range->deviceLock;
+        }
+    }
+    
+    if (callback) {
+        std::lock_guard<std::recursive_mutex> lock(*deviceLock);
+        callback(port, value);
         return;
     }
     
@@ -138,6 +158,17 @@ bool IOManager::registerIOPortRange(uint16_t startPort, uint16_t endPort, const
     range.readCallback = readCallback;
     range.writeCallback = writeCallback;
     
+    // One lock per device, whatever the number of ranges it registers
+    for (const auto& other : m_portRanges) {
+        if (other.device == device) {
+            range.deviceLock = other.deviceLock;
+            break;
+        }
+    }
+    if (!range.deviceLock) {
+        range.deviceLock = std::make_shared<std::recursive_mutex>();
+    }
+    
     // Add to ranges vector
     m_portRanges.push_back(range);
     
@@ -69,6 +69,8 @@ bool MemoryManager::initialize(int memorySize)
         
         // Allocate memory
         m_memory.resize(m_totalSize, 0);
+        m_codeChunks.assign(m_totalSize >> 12, 0);
+        m_writeWatches.assign(m_totalSize >> 12, 0);
         
         // Clear memory
         reset();
@@ -171,7 +173,7 @@ uint32_t MemoryManager::readDword(uint32_t address) const
 
 void MemoryManager::writeByte(uint32_t address, uint8_t value)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_lock<std::mutex> lock(m_mutex);
     
     // Check if address is valid
     if (address >= m_totalSize) {
@@ -187,16 +189,21 @@ void MemoryManager::writeByte(uint32_t address, uint8_t value)
         return;
     }
     
+    // Write memory value
+    m_memory[address] = value;
+    
     // Notify callbacks
     notifyCallbacks(address, 1, AccessType::WRITE);
     
-    // Write memory value
-    m_memory[address] = value;
+    // Invalidate translated code at this address
+    std::vector<CodeInvalidationCallback> callbacks = checkCodeWrite(address, 1);
+    lock.unlock();
+    runCodeCallbacks(callbacks, address, 1);
 }
 
 void MemoryManager::writeWord(uint32_t address, uint16_t value)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_lock<std::mutex> lock(m_mutex);
     
     // Check if address is valid
     if (address + 1 >= m_totalSize) {
@@ -212,16 +219,21 @@ void MemoryManager::writeWord(uint32_t address, uint16_t value)
         return;
     }
     
+    // Write memory value
+    *reinterpret_cast<uint16_t*>(&m_memory[address]) = value;
+    
     // Notify callbacks
     notifyCallbacks(address, 2, AccessType::WRITE);
     
-    // Write memory value
-    *reinterpret_cast<uint16_t*>(&m_memory[address]) = value;
+    // Invalidate translated code at this address
+    std::vector<CodeInvalidationCallback> callbacks = checkCodeWrite(address, 2);
+    lock.unlock();
+    runCodeCallbacks(callbacks, address, 2);
 }
 
 void MemoryManager::writeDword(uint32_t address, uint32_t value)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_lock<std::mutex> lock(m_mutex);
     
     // Check if address is valid
     if (address + 3 >= m_totalSize) {
@@ -237,11 +249,191 @@ void MemoryManager::writeDword(uint32_t address, uint32_t value)
         return;
     }
     
+    // Write memory value
+    *reinterpret_cast<uint32_t*>(&m_memory[address]) = value;
+    
     // Notify callbacks
     notifyCallbacks(address, 4, AccessType::WRITE);
     
-    // Write memory value
-    *reinterpret_cast<uint32_t*>(&m_memory[address]) = value;
+    // Invalidate translated code at this address
+    std::vector<CodeInvalidationCallback> callbacks = checkCodeWrite(address, 4);
+    lock.unlock();
+    runCodeCallbacks(callbacks, address, 4);
+}
+
+bool MemoryManager::writeBlock(uint32_t address, const uint8_t* data, uint32_t size)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    // Check if address range is valid
+    if (size == 0 || static_cast<uint64_t>(address) + size > m_totalSize) {
+        Logger::GetInstance()->warn("Invalid DMA write at 0x%08X (%u bytes)", address, size);
+        return false;
+    }
+    
+    // Check memory access
+    if (!checkAccess(address, size, AccessType::WRITE)) {
+        Logger::GetInstance()->warn("DMA write violation at 0x%08X (%u bytes)", address, size);
+        return false;
+    }
+    
+    // Write memory block
+    std::memcpy(&m_memory[address], data, size);
+    
+    // Notify callbacks
+    notifyCallbacks(address, size, AccessType::WRITE);
+    
+    // Invalidate translated code in the destination
+    std::vector<CodeInvalidationCallback> callbacks = checkCodeWrite(address, size);
+    lock.unlock();
+    runCodeCallbacks(callbacks, address, size);
+    return true;
+}
+
+void MemoryManager::notifyWrite(uint32_t address, uint32_t size)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    if (size == 0 || address >= m_totalSize) {
+        return;
+    }
+    
+    size = std::min(size, m_totalSize - address);
+    notifyCallbacks(address, size, AccessType::WRITE);
+    
+    std::vector<CodeInvalidationCallback> callbacks = checkCodeWrite(address, size);
+    lock.unlock();
+    runCodeCallbacks(callbacks, address, size);
+}
+
+void MemoryManager::markCode(uint32_t address, uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    uint64_t end = std::min<uint64_t>(static_cast<uint64_t>(address) + size, m_totalSize);
+    
+    for (uint64_t start = address; start < end; start = (start | 0xFFF) + 1) {
+        uint32_t length = static_cast<uint32_t>(std::min(end, (start | 0xFFF) + 1) - start);
+        uint32_t page = static_cast<uint32_t>(start >> 12);
+        
+        if (!pageWatched(page) && m_codePageWatcher) {
+            m_codePageWatcher(static_cast<uint32_t>(start & ~0xFFFULL), true);
+        }
+        m_codeChunks[page] |= codeChunkMask(start & 0xFFF, length);
+    }
+}
+
+void MemoryManager::unmarkCode(uint32_t address, uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    uint64_t end = std::min<uint64_t>(static_cast<uint64_t>(address) + size, m_totalSize);
+    
+    for (uint64_t start = address; start < end; start = (start | 0xFFF) + 1) {
+        uint32_t length = static_cast<uint32_t>(std::min(end, (start | 0xFFF) + 1) - start);
+        uint32_t page = static_cast<uint32_t>(start >> 12);
+        
+        m_codeChunks[page] &= ~codeChunkMask(start & 0xFFF, length);
+        if (!pageWatched(page) && m_codePageWatcher) {
+            m_codePageWatcher(static_cast<uint32_t>(start & ~0xFFFULL), false);
+        }
+    }
+}
+
+bool MemoryManager::pageContainsCode(uint32_t address) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    uint32_t page = address >> 12;
+    return page < m_codeChunks.size() && m_codeChunks[page] != 0;
+}
+
+uint32_t MemoryManager::registerCodeInvalidationCallback(CodeInvalidationCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    if (!callback) {
+        return 0;
+    }
+    
+    CodeCallbackInfo info;
+    info.id = m_nextCallbackId++;
+    info.callback = callback;
+    m_codeCallbacks.push_back(info);
+    
+    return info.id;
+}
+
+bool MemoryManager::unregisterCodeInvalidationCallback(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    for (auto it = m_codeCallbacks.begin(); it != m_codeCallbacks.end(); ++it) {
+        if (it->id == id) {
+            m_codeCallbacks.erase(it);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void MemoryManager::setCodePageWatcher(CodePageWatcher watcher)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    m_codePageWatcher = watcher;
+    
+    // Pages marked or watched before the watcher arrived
+    if (m_codePageWatcher) {
+        for (uint32_t page = 0; page < m_codeChunks.size(); page++) {
+            if (pageWatched(page)) {
+                m_codePageWatcher(page << 12, true);
+            }
+        }
+    }
+}
+
+bool MemoryManager::hasCodePageWatcher() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    return static_cast<bool>(m_codePageWatcher);
+}
+
+void MemoryManager::watchWrites(uint32_t address, uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    uint64_t end = std::min<uint64_t>(static_cast<uint64_t>(address) + size, m_totalSize);
+    
+    for (uint64_t start = address; start < end; start = (start | 0xFFF) + 1) {
+        uint32_t page = static_cast<uint32_t>(start >> 12);
+        
+        if (!pageWatched(page) && m_codePageWatcher) {
+            m_codePageWatcher(page << 12, true);
+        }
+        m_writeWatches[page]++;
+    }
+}
+
+void MemoryManager::unwatchWrites(uint32_t address, uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    uint64_t end = std::min<uint64_t>(static_cast<uint64_t>(address) + size, m_totalSize);
+    
+    for (uint64_t start = address; start < end; start = (start | 0xFFF) + 1) {
+        uint32_t page = static_cast<uint32_t>(start >> 12);
+        
+        if (!m_writeWatches[page]) {
+            continue;
+        }
+        m_writeWatches[page]--;
+        if (!pageWatched(page) && m_codePageWatcher) {
+            m_codePageWatcher(page << 12, false);
+        }
+    }
 }
 
 bool MemoryManager::registerMemoryRegion(uint32_t start, uint32_t size, RegionType type, const std::string& name, bool readable, bool writable, bool executable)
@@ -427,6 +619,7 @@ bool MemoryManager::loadBIOS(const std::string& biosPath)
         
         // Read BIOS into memory
         file.read(reinterpret_cast<char*>(&m_memory[BIOS_BASE_ADDRESS]), size);
+        checkCodeWrite(BIOS_BASE_ADDRESS, static_cast<uint32_t>(size));
         
         Logger::GetInstance()->info("Loaded BIOS from %s (%d bytes)", biosPath.c_str(), size);
         return true;
@@ -446,6 +639,7 @@ void MemoryManager::reset()
         if (region.type == RegionType::RAM) {
             // Clear RAM region
             std::memset(region.data, 0, region.size);
+            checkCodeWrite(region.start, region.size);
         }
     }
     
@@ -488,8 +682,8 @@ void MemoryManager::notifyCallbacks(uint32_t address, uint32_t size, AccessType
     for (const auto& callback : m_callbacks) {
         // Check if callback applies to this access
         if (callback.type == type && 
-            address >= callback.address && 
-            address + size <= callback.address + callback.size) {
+            static_cast<uint64_t>(address) + size > callback.address && 
+            address < static_cast<uint64_t>(callback.address) + callback.size) {
             // Call the callback
             callback.callback(address, size);
         }
@@ -523,4 +717,74 @@ bool MemoryManager::checkAccess(uint32_t address, uint32_t size, AccessType type
     }
     
     return true;
-}
\ No newline at end of file
+}
+
+std::vector<MemoryManager::CodeInvalidationCallback> MemoryManager::checkCodeWrite(uint32_t address, uint32_t size)
+{
+    if (m_codeChunks.empty() || size == 0) {
+        return {};
+    }
+    
+    // Fast path: only pages holding translated code need a closer look
+    uint64_t last = static_cast<uint64_t>(address) + size - 1;
+    uint32_t lastPage = static_cast<uint32_t>(std::min<uint64_t>(last >> 12, m_codeChunks.size() - 1));
+    
+    for (uint32_t page = address >> 12; page <= lastPage; ++page) {
+        if (m_codeChunks[page]) {
+            return invalidateCode(address, size);
+        }
+    }
+    
+    return {};
+}
+
+std::vector<MemoryManager::CodeInvalidationCallback> MemoryManager::invalidateCode(uint32_t address, uint32_t size)
+{
+    uint64_t end = std::min<uint64_t>(static_cast<uint64_t>(address) + size, m_totalSize);
+    bool hit = false;
+    
+    // Clear the marks of the written chunks; writes that only touch data
+    // sharing a page with code do not invalidate anything
+    for (uint64_t start = address; start < end; start = (start | 0xFFF) + 1) {
+        uint32_t length = static_cast<uint32_t>(std::min(end, (start | 0xFFF) + 1) - start);
+        uint64_t mask = codeChunkMask(start & 0xFFF, length);
+        uint64_t& chunks = m_codeChunks[start >> 12];
+        
+        if (chunks & mask) {
+            chunks &= ~mask;
+            hit = true;
+            
+            // The page no longer holds code: let its stores take the fast path again
+            if (!pageWatched(static_cast<uint32_t>(start >> 12)) && m_codePageWatcher) {
+                m_codePageWatcher(static_cast<uint32_t>(start & ~0xFFFULL), false);
+            }
+        }
+    }
+    
+    if (!hit) {
+        return {};
+    }
+    
+    std::vector<CodeInvalidationCallback> callbacks;
+    callbacks.reserve(m_codeCallbacks.size());
+    for (const auto& info : m_codeCallbacks) {
+        callbacks.push_back(info.callback);
+    }
+    return callbacks;
+}
+
+void MemoryManager::runCodeCallbacks(const std::vector<CodeInvalidationCallback>& callbacks, uint32_t address, uint32_t size)
+{
+    for (const auto& callback : callbacks) {
+        callback(address, size);
+    }
+}
+
+uint64_t MemoryManager::codeChunkMask(uint32_t offset, uint32_t size)
+{
+    // Bits for the 64-byte chunks covering [offset, offset + size) within a page
+    uint32_t first = offset >> CODE_CHUNK_SHIFT;
+    uint32_t last = (offset + size - 1) >> CODE_CHUNK_SHIFT;
+    
+    return (~0ULL >> (63 - last)) & (~0ULL << first);
+}
@@ -3,10 +3,20 @@
 
 #include "geforce3.h"
 #include "logger.h"
+#include "accuracy_profile.h"
+#include "geforce3_spans.h"
+#include "geforce3_dxt.h"
+#include "memory_manager.h"
 #include <cmath>
 #include <algorithm>
 #include <limits>
 
+namespace {
+    // Set while this thread reports a GPU write, which an attached
+    // MemoryManager hands straight back to NotifyMemoryWrite()
+    thread_local bool t_reportingGpuWrite = false;
+}
+
 GeForce3::GeForce3()
 {
     // Initialize PCI device identity
@@ -94,6 +104,7 @@ GeForce3::GeForce3()
         m_texture[n].addrModeT = 1;
         m_texture[n].addrModeR = 1;
         m_texture[n].buffer = nullptr;
+        m_texture[n].decoded = nullptr;
     }
     
     m_trianglesBfCulled = 0;
@@ -116,6 +127,7 @@ GeForce3::GeForce3()
     
     m_vertexInput = nullptr;
     m_vertexOutput = nullptr;
+    m_vertexProgramDirty = true;
     
     // Initialize rendering state
     m_vertexPipeline = 4;  // Default to transformation matrix pipeline
@@ -159,11 +171,51 @@ GeForce3::GeForce3()
     memset(&m_combiner, 0, sizeof(m_combiner));
     
     m_pullerWaiting = 0;
+    m_methodsExecuted = 0;
+    m_bulkMethodsExecuted = 0;
+    m_pullerStopping = false;
+    m_gpuLockWaiters = 0;
+    m_postedIRQ = -1;
+    m_publishedMMIOBase = 0;
+    for (int channel = 0; channel < 32; channel++)
+        PublishChannel(channel);
+    // Running commands as soon as DMAPUT is written keeps the guest in lockstep with the GPU
+    m_asyncPuller = !AccuracyProfile::GetInstance()->isEnabled(AccuracyProfile::Feature::SYNC_PULLER);
     
     m_enableWaitVblank = true;
-    m_enableClippingW = false;
+    // Near-plane clipping costs a polygon split per triangle crossing w=0
+    m_enableClippingW = AccuracyProfile::GetInstance()->isEnabled(AccuracyProfile::Feature::W_CLIPPING);
+    // Lazy clears leave memory stale until the GPU itself touches it
+    m_lazyClears = AccuracyProfile::GetInstance()->isEnabled(AccuracyProfile::Feature::LAZY_CLEARS);
     
+    m_renderMethod = nullptr;
     m_rasterizer = new Rasterizer();
+    m_pixelPipeline = nullptr;
+    m_combinerContext = nullptr;
+    m_pixelPipelineLookups = 0;
+    m_pixelPipelineHits = 0;
+    
+    m_ramBase = nullptr;
+    m_ramSize = 0;
+    m_memory = nullptr;
+    m_memoryAddress = 0;
+    m_memoryCallbackId = 0;
+    m_textureCacheBytes = 0;
+    m_textureEpoch = 0;
+    m_ramWrites = 0;
+    m_cpuWritesPending = false;
+    m_cpuWritesReported = false;
+    m_hiZ.tilesX = 0;
+    m_hiZ.tilesY = 0;
+    m_hiZ.buffer = nullptr;
+    m_hiZ.pitch = 0;
+    m_hiZ.size = 0;
+    m_hiZ.format = DepthFormat::Z24S8;
+    m_hiZ.valid = false;
+    m_hiZ.epoch = 0;
+    m_hiZ.checkedWrites = 0;
+    for (PendingClear& pending : m_pendingClears)
+        pending.active = false;
     
     // Initialize dilate tables
     for (int b = 0; b < 16; b++) {
@@ -178,10 +230,16 @@ GeForce3::GeForce3()
             m_dilateChose[(b << 4) + a] = (a < b ? a : b);
         }
     }
+    
+    if (m_asyncPuller)
+        m_pullerThread = std::thread(&GeForce3::PullerLoop, this);
 }
 
 GeForce3::~GeForce3()
 {
+    StopPuller();
+    DetachMemoryManager();
+    
     if (m_rasterizer) {
         delete m_rasterizer;
         m_rasterizer = nullptr;
@@ -253,6 +311,13 @@ bool GeForce3::Initialize()
 
 void GeForce3::Reset()
 {
+    std::unique_lock<std::mutex> lock = LockGPU();
+    if (m_trace)
+        m_trace->Reset();
+    
+    // Finish queued rendering before the state it reads is reset
+    m_rasterizer->Wait();
+    
     // Reset PCI configuration
     m_pciCommand = 0x0007;  // I/O, memory space, bus mastering enabled
     m_pciStatus = 0x02B0;   // Fast Back-to-Back, DEVSEL medium timing, 66MHz capable
@@ -260,6 +325,7 @@ void GeForce3::Reset()
     // Reset memory bases
     m_fbMemBase = 0;
     m_mmioMemBase = 0;
+    PublishConfig();
     
     // Reset all registers but preserve critical ones
     memset(m_pfifo, 0, sizeof(m_pfifo));
@@ -301,6 +367,7 @@ void GeForce3::Reset()
     
     // Reset vertex program state
     memset(&m_vertexProgram, 0, sizeof(m_vertexProgram));
+    m_vertexProgramDirty = true;
     
     // Reset render states
     m_alphaTestEnabled = false;
@@ -312,9 +379,26 @@ void GeForce3::Reset()
     
     // Reset combiner state
     memset(&m_combiner, 0, sizeof(m_combiner));
+    
+    // Drop decoded textures
+    for (int n = 0; n < 4; n++)
+        m_texture[n].decoded = nullptr;
+    ClearTextureCache();
+    m_hiZ.valid = false;
+    for (PendingClear& pending : m_pendingClears)
+        pending.active = false;
+    
+    SelectPixelPipeline();
 }
 
 uint32_t GeForce3::ReadConfig(uint8_t reg, int size)
+{
+    std::unique_lock<std::mutex> lock = LockGPU();
+    return ReadConfigRegister(reg, size);
+}
+
+// ReadConfig() for callers that hold the GPU lock
+uint32_t GeForce3::ReadConfigRegister(uint8_t reg, int size)
 {
     uint32_t value = 0;
     
@@ -393,6 +477,10 @@ uint32_t GeForce3::ReadConfig(uint8_t reg, int size)
 
 void GeForce3::WriteConfig(uint8_t reg, uint32_t value, int size)
 {
+    std::unique_lock<std::mutex> lock = LockGPU();
+    if (m_trace)
+        m_trace->ConfigWrite(reg, value, size);
+    
     switch (reg) {
         case 0x04:  // Command register
             if (size >= 2) {
@@ -433,6 +521,8 @@ void GeForce3::WriteConfig(uint8_t reg, uint32_t value, int size)
             PCIDevice::WriteConfig(reg, value, size);
             break;
     }
+    
+    PublishConfig();
 }
 
 void GeForce3::UpdateRmaFramebufferConfig()
@@ -489,6 +579,24 @@ void GeForce3::UpdateRmaFramebufferConfig()
 
 uint32_t GeForce3::ReadMemory(uint32_t address, int size)
 {
+    IRQScope irqScope{ *this };
+    
+    // DMAGET and reference counter polls don't wait for the packet being run
+    uint32_t mmioBase = m_publishedMMIOBase.load(std::memory_order_acquire);
+    if (mmioBase != 0 && size == 4 && address - mmioBase - 0x00800000 < 0x00100000) {
+        uint32_t suboffset = (address - mmioBase - 0x00800000) / 4;
+        uint32_t channel = (suboffset >> (16 - 2)) & 31;
+        uint32_t subchannel = (suboffset >> (13 - 2)) & 7;
+        suboffset = suboffset & 0x7ff;
+        
+        if (subchannel == 0 && suboffset == 0x44 / 4)
+            return m_publishedDMAGet[channel].load(std::memory_order_acquire);
+        if (subchannel == 0 && suboffset == 0x48 / 4)
+            return m_publishedReference[channel].load(std::memory_order_acquire);
+    }
+    
+    std::unique_lock<std::mutex> lock = LockGPU();
+    
     // Check if memory space is enabled
     if (!(m_pciCommand & 0x0002)) {
         return 0xFFFFFFFF;
@@ -497,6 +605,8 @@ uint32_t GeForce3::ReadMemory(uint32_t address, int size)
     // Handle framebuffer access
     if (address >= m_fbMemBase && address < m_fbMemBase + (256 * 1024 * 1024)) {
         uint32_t offset = address - m_fbMemBase;
+        m_rasterizer->Wait();
+        ResolveClears();
         // Read from framebuffer memory
         if (m_ramBase) {
             if (offset + size <= m_ramSize) {
@@ -548,17 +658,27 @@ uint32_t GeForce3::ReadMemory(uint32_t address, int size)
 
 void GeForce3::WriteMemory(uint32_t address, uint32_t value, int size)
 {
+    IRQScope irqScope{ *this };
+    std::unique_lock<std::mutex> lock = LockGPU();
+    
     // Check if memory space is enabled
     if (!(m_pciCommand & 0x0002)) {
         return;
     }
     
+    TraceScope traceScope{ *this };
+    if (m_trace)
+        m_trace->RegisterWrite(address, value, size);
+    
     // Handle framebuffer access
     if (address >= m_fbMemBase && address < m_fbMemBase + (256 * 1024 * 1024)) {
         uint32_t offset = address - m_fbMemBase;
+        m_rasterizer->Wait();
+        ResolveClears();
         // Write to framebuffer memory
         if (m_ramBase) {
             if (offset + size <= m_ramSize) {
+                MemoryWritten(offset, size);
                 if (size == 4)
                     *reinterpret_cast<uint32_t*>(m_ramBase + offset) = value;
                 else if (size == 2)
@@ -752,7 +872,7 @@ void GeForce3::WriteRegister(uint32_t address, uint32_t value)
             if (offset == 0x720 / 4) {
                 if ((value & 1) && (m_pullerWaiting == 2)) {
                     m_pullerWaiting = 0;
-                    ProcessGPUCommands();
+                    WakePuller();
                 }
             }
             
@@ -791,6 +911,7 @@ void GeForce3::WriteRegister(uint32_t address, uint32_t value)
                     for (int ch = 0; ch < 32; ch++) {
                         // zero dma_get in all the channels
                         m_channelState.channel[ch][0].regs[0x44 / 4] = 0;
+                        PublishChannel(ch);
                     }
                 }
             }
@@ -807,6 +928,8 @@ void GeForce3::WriteRegister(uint32_t address, uint32_t value)
         
         if (suboffset >= 0x80 / 4)
             return;
+        if (subchannel == 0)
+            PublishChannel(channel);
             
         if ((suboffset == 0x40 / 4) || (suboffset == 0x44 / 4)) {
             uint32_t* dmaput = &m_channelState.channel[channel][0].regs[0x40 / 4];
@@ -815,58 +938,291 @@ void GeForce3::WriteRegister(uint32_t address, uint32_t value)
             if (*dmaget != *dmaput) {
                 if (m_pullerWaiting == 0) {
                     m_pullerWaiting = 0;
-                    ProcessGPUCommands();
+                    WakePuller();
                 }
             }
         }
     }
     
-    if (updateInt) {
-        if (UpdateInterrupts()) {
-            if (m_irqCallback) {
-                m_irqCallback(1);  // Signal IRQ active
+    if (updateInt)
+        PostIRQ(UpdateInterrupts());
+}
+
+// Execute a run of count methods whose parameters follow each other in the
+// pushbuffer at address. An increasing run steps the method with every
+// parameter, a non-increasing run sends all of them to the same method.
+void GeForce3::ExecuteMethods(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t address,
+                              uint32_t count, bool increasing)
+{
+    auto& object = m_channelState.channel[channelID].object[subchannelID];
+    const MethodTable* table = GetMethodTable(object.objclass);
+    
+    // Resolve the parameters to host memory once for the whole run
+    const uint32_t* parameters = nullptr;
+    if (static_cast<uint64_t>(address) + static_cast<uint64_t>(count) * 4 <= m_ramSize) {
+        parameters = reinterpret_cast<const uint32_t*>(m_ramBase + address);
+        TraceConsume(address, count * 4);
+    }
+    
+    while (count > 0 && method / 4 < METHOD_COUNT) {
+        const MethodEntry* entry = table ? &table->entries[method / 4] : nullptr;
+        
+        // Only vertex submission may run ahead of the rasterizer; everything
+        // else can change state the render callbacks read or touch their memory
+        if (!entry || !entry->runsAhead) {
+            m_rasterizer->Wait();
+        }
+        
+        uint32_t run = 1;
+        if (entry && entry->bulk && parameters) {
+            // Hand the handler every parameter that goes to its methods
+            run = increasing ? std::min<uint32_t>(count, entry->bulkLast - method / 4 + 1) : count;
+            
+            // Store the method data in the channel's object
+            if (increasing) {
+                memcpy(&object.method[method / 4], parameters, run * sizeof(uint32_t));
+            } else {
+                object.method[method / 4] = parameters[run - 1];
             }
+            
+            (this->*entry->bulk)(channelID, subchannelID, method, address, parameters, run);
+            m_bulkMethodsExecuted += run;
         } else {
-            if (m_irqCallback) {
-                m_irqCallback(0);  // Signal IRQ inactive
+            uint32_t parameter = parameters ? *parameters : ReadDWORD(address);
+            object.method[method / 4] = parameter;
+            
+            if (!table) {
+                LOG("Unhandled object class: 0x%02X, method: 0x%04X, param: 0x%08X\n", 
+                    object.objclass, method, parameter);
+            } else if (entry->handler) {
+                (this->*entry->handler)(channelID, subchannelID, method, parameter);
             }
         }
+        
+        m_methodsExecuted += run;
+        count -= run;
+        address += run * 4;
+        if (parameters) {
+            parameters += run;
+        }
+        if (increasing) {
+            method += run * 4;
+        }
     }
 }
 
-void GeForce3::ExecuteMethod(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
+const GeForce3::MethodTable* GeForce3::GetMethodTable(uint32_t objClass)
 {
-    // Store the method data in the channel's object
-    if (method / 4 < sizeof(m_channelState.channel[channelID].object[subchannelID].method) / sizeof(uint32_t)) {
-        m_channelState.channel[channelID].object[subchannelID].method[method / 4] = parameter;
-    }
-    
-    // Execute the method based on the object class
-    uint32_t objClass = m_channelState.channel[channelID].object[subchannelID].objclass;
+    static const std::unique_ptr<MethodTable> graphics = BuildMethodTable(0x97);
+    static const std::unique_ptr<MethodTable> m2mf = BuildMethodTable(0x39);
+    static const std::unique_ptr<MethodTable> surf2d = BuildMethodTable(0x62);
+    static const std::unique_ptr<MethodTable> blit = BuildMethodTable(0x9F);
     
     switch (objClass) {
         case 0x97:  // 3D graphics context
-            ExecuteMethodGraphics(channelID, subchannelID, method, parameter);
-            break;
+            return graphics.get();
             
         case 0x39:  // Memory to Memory Format (M2MF)
-            ExecuteMethodM2MF(channelID, subchannelID, method, parameter);
-            break;
+            return m2mf.get();
             
         case 0x62:  // 2D Surface
-            ExecuteMethodSurf2D(channelID, subchannelID, method, parameter);
-            break;
+            return surf2d.get();
             
         case 0x9F:  // Blit
-            ExecuteMethodBlit(channelID, subchannelID, method, parameter);
-            break;
+            return blit.get();
             
         // Other object classes
         default:
-            LOG("Unhandled object class: 0x%02X, method: 0x%04X, param: 0x%08X\n", 
-                objClass, method, parameter);
+            return nullptr;
+    }
+}
+
+std::unique_ptr<GeForce3::MethodTable> GeForce3::BuildMethodTable(uint32_t objClass)
+{
+    // Methods without a handler of their own go through the class switch
+    MethodHandler classHandler = nullptr;
+    switch (objClass) {
+        case 0x97:
+            classHandler = &GeForce3::ExecuteMethodGraphics;
+            break;
+        case 0x39:
+            classHandler = &GeForce3::ExecuteMethodM2MF;
+            break;
+        case 0x62:
+            classHandler = &GeForce3::ExecuteMethodSurf2D;
+            break;
+        case 0x9F:
+            classHandler = &GeForce3::ExecuteMethodBlit;
             break;
     }
+    
+    auto table = std::make_unique<MethodTable>();
+    for (int n = 0; n < METHOD_COUNT; n++) {
+        MethodEntry& entry = table->entries[n];
+        entry.handler = classHandler;
+        entry.bulk = nullptr;
+        entry.bulkLast = static_cast<uint16_t>(n);
+        entry.runsAhead = objClass == 0x97 && IsVertexSubmissionMethod(n * 4);
+    }
+    
+    if (objClass != 0x97)
+        return table;
+    
+    auto set = [&table](uint32_t first, uint32_t last, MethodHandler handler, BulkMethodHandler bulk) {
+        for (uint32_t method = first; method <= last; method += 4) {
+            MethodEntry& entry = table->entries[method / 4];
+            entry.handler = handler;
+            entry.bulk = bulk;
+            entry.bulkLast = static_cast<uint16_t>(last / 4);
+        }
+    };
+    
+    set(0x0440, 0x04BC, &GeForce3::MethodMatrix, nullptr);                 // Projection and modelview matrices
+    set(0x0580, 0x05BC, &GeForce3::MethodMatrix, nullptr);                 // Inverse modelview matrix
+    set(0x0680, 0x06BC, &GeForce3::MethodMatrix, nullptr);                 // Composite matrix
+    set(0x0B00, 0x0B7C, &GeForce3::MethodVertexProgramUpload, &GeForce3::BulkVertexProgramUpload);
+    set(0x0B80, 0x0BFC, &GeForce3::MethodVertexConstantUpload, &GeForce3::BulkVertexConstantUpload);
+    set(0x1518, 0x1524, &GeForce3::MethodPersistentVertexAttribute, nullptr);
+    set(0x1800, 0x1800, &GeForce3::MethodDrawIndices, &GeForce3::BulkDrawIndices);
+    set(0x1808, 0x1808, &GeForce3::MethodDrawIndices, &GeForce3::BulkDrawIndices);
+    set(0x1818, 0x1818, nullptr, &GeForce3::BulkDrawRawVertices);          // Inline vertices need the run's address
+    set(0x1880, 0x1AFC, &GeForce3::MethodPersistentVertexAttribute, nullptr);
+    return table;
+}
+
+GeForce3::MethodStats GeForce3::GetMethodStats()
+{
+    std::unique_lock<std::mutex> lock = LockGPU();
+    MethodStats stats;
+    stats.methods = m_methodsExecuted;
+    stats.bulkMethods = m_bulkMethodsExecuted;
+    return stats;
+}
+
+bool GeForce3::StartTrace(const std::string& path)
+{
+    {
+        std::unique_lock<std::mutex> lock = LockGPU();
+        if (m_trace || !m_ramBase)
+            return false;
+    }
+    
+    auto trace = std::make_unique<GeForce3TraceWriter>();
+    if (!trace->Open(path)) {
+        LOG("Cannot create GPU trace %s\n", path.c_str());
+        return false;
+    }
+    
+    // A replay copies memory in with the record that consumed it, so
+    // commands have to run inside the register write that started them
+    StopPuller();
+    
+    std::unique_lock<std::mutex> lock = LockGPU();
+    m_asyncPuller = false;
+    ProcessGPUCommands();
+    m_rasterizer->Wait();
+    ResolveClears();
+    
+    trace->Ram(m_ramSize);
+    
+    // BARs may have been mapped before the trace started
+    trace->ConfigWrite(0x04, ReadConfigRegister(0x04, 2), 2);
+    for (uint8_t reg = 0x10; reg <= 0x24; reg += 4)
+        trace->ConfigWrite(reg, ReadConfigRegister(reg, 4), 4);
+    
+    m_trace = std::move(trace);
+    LOG("GPU trace started: %s\n", path.c_str());
+    return true;
+}
+
+void GeForce3::StopTrace()
+{
+    std::unique_lock<std::mutex> lock = LockGPU();
+    if (!m_trace)
+        return;
+    
+    if (!m_trace->Close())
+        LOG("GPU trace is incomplete, writing it failed\n");
+    LOG("GPU trace stopped, %llu bytes\n", static_cast<unsigned long long>(m_trace->GetBytesWritten()));
+    m_trace.reset();
+    
+    m_asyncPuller = !AccuracyProfile::GetInstance()->isEnabled(AccuracyProfile::Feature::SYNC_PULLER);
+    if (m_asyncPuller) {
+        m_pullerThread = std::thread(&GeForce3::PullerLoop, this);
+        m_pullerWake.notify_one();
+    }
+}
+
+// Record RAM the GPU is about to read
+void GeForce3::TraceConsume(uint32_t offset, uint32_t size)
+{
+    if (!m_trace)
+        return;
+    
+    // What the GPU wrote there itself is not recorded
+    if (m_trace->WritesOverlap(offset, size))
+        SyncTraceWrites();
+    m_trace->Consume(m_ramBase, offset, size);
+}
+
+void GeForce3::TraceWritten(uint32_t offset, uint32_t size)
+{
+    if (m_trace)
+        m_trace->Written(offset, size);
+}
+
+// Record the vertex buffer data of count vertices starting at index
+void GeForce3::TraceVertexFetch(uint32_t index, int count)
+{
+    if (!m_trace)
+        return;
+    
+    for (int n = 0; n < 16; n++) {
+        if (!(m_vertexBufferState.enabled & (1 << n)))
+            continue;
+        
+        uint32_t stride = m_vertexBufferState.stride[n];
+        TraceConsume(m_vertexBufferState.address[n] + index * stride,
+                     (count - 1) * stride + m_vertexBufferState.words[n] * 4);
+    }
+}
+
+// Copy what GPU writes left in memory into the trace's view of it
+void GeForce3::SyncTraceWrites()
+{
+    if (!m_trace->HasWrites())
+        return;
+    
+    m_rasterizer->Wait();
+    ResolveClears();
+    m_trace->SyncWrites(m_ramBase);
+}
+
+bool GeForce3::IsVertexSubmissionMethod(uint32_t method)
+{
+    switch (method) {
+        case 0x0440 ... 0x04BC: // Projection and modelview matrices
+        case 0x0580 ... 0x05BC: // Inverse modelview matrix
+        case 0x0680 ... 0x06BC: // Composite matrix
+        case 0x0A20 ... 0x0A2C: // Viewport translate
+        case 0x0AF0 ... 0x0AFC: // Viewport scale
+        case 0x0B00 ... 0x0BFC: // Vertex program and constant upload
+        case 0x1518 ... 0x1524: // Persistent vertex position
+        case 0x1720 ... 0x179C: // Vertex buffer addresses and formats
+        case 0x17FC:            // BEGIN_END
+        case 0x1800:            // Draw vertices (word indices)
+        case 0x1808:            // Draw vertices (dword indices)
+        case 0x1810:            // Draw vertices with offset
+        case 0x1818:            // Draw raw vertices
+        case 0x1880 ... 0x1AFC: // Immediate vertex attributes
+        case 0x1E94:            // VP_UPLOAD_FROM_ID
+        case 0x1EA0:            // VP_START_FROM_ID
+        case 0x1EA4:            // VP_UPLOAD_CONST_ID
+            return true;
+            
+        default:
+            return false;
+    }
 }
 
 void GeForce3::ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
@@ -881,6 +1237,7 @@ void GeForce3::ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID,
         case 0x1EA0: // VP_START_FROM_ID
             m_vertexProgram.instructions = m_vertexProgram.uploadInstructionIndex;
             m_vertexProgram.startInstruction = parameter;
+            m_vertexProgramDirty = true;
             break;
             
         case 0x1EA4: // VP_UPLOAD_CONST_ID
@@ -888,102 +1245,20 @@ void GeForce3::ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID,
             m_vertexProgram.uploadParameterComponent = 0;
             break;
             
-        // Vertex shader instructions upload (0x0B00-0x0B7C)
-        case 0x0B00 ... 0x0B7C: {
-            int index = (method - 0x0B00) / 4;
-            if (m_vertexProgram.uploadInstructionIndex < 256) {
-                m_vertexProgram.instructions[m_vertexProgram.uploadInstructionIndex].data[m_vertexProgram.uploadInstructionComponent] = parameter;
-                m_vertexProgram.instructions[m_vertexProgram.uploadInstructionIndex].modified |= (1 << m_vertexProgram.uploadInstructionComponent);
-            }
-            
-            if (m_vertexProgram.instructions[m_vertexProgram.uploadInstructionIndex].modified == 15) {
-                m_vertexProgram.instructions[m_vertexProgram.uploadInstructionIndex].modified = 0;
-                DecodeVertexInstruction(m_vertexProgram.uploadInstructionIndex);
-            }
-            
-            m_vertexProgram.uploadInstructionComponent++;
-            if (m_vertexProgram.uploadInstructionComponent >= 4) {
-                m_vertexProgram.uploadInstructionComponent = 0;
-                m_vertexProgram.uploadInstructionIndex++;
-            }
-            break;
-        }
-            
-        // Vertex shader constants upload (0x0B80-0x0BFC)
-        case 0x0B80 ... 0x0BFC: {
-            int index = (method - 0x0B80) / 4;
-            if (m_vertexProgram.uploadParameterIndex < 192) {
-                m_vertexProgram.constants[m_vertexProgram.uploadParameterIndex].SetComponent(m_vertexProgram.uploadParameterComponent, parameter);
-            }
-            
-            m_vertexProgram.uploadParameterComponent++;
-            if (m_vertexProgram.uploadParameterComponent >= 4) {
-                m_vertexProgram.uploadParameterComponent = 0;
-                m_vertexProgram.uploadParameterIndex++;
-            }
-            break;
-        }
-        
         // Drawing methods
         case 0x17FC: // BEGIN_END
             HandleDrawCommand(parameter);
             break;
             
-        case 0x1800:  // Draw vertices (word indices)
-        case 0x1808:  // Draw vertices (dword indices)
-            HandleDrawIndices(method == 0x1800 ? 2 : 1, parameter);
-            break;
-            
         case 0x1810:  // Draw vertices with offset
             HandleDrawVerticesWithOffset(parameter);
             break;
             
-        case 0x1818:  // Draw raw vertices
-            HandleDrawRawVertices(parameter);
-            break;
-            
         // Texture methods
         case 0x1B00 ... 0x1BFC:
             HandleTextureMethod(method, parameter);
             break;
             
-        // Matrix methods
-        case 0x0440 ... 0x047C: // Projection matrix
-            {
-                int matrixIndex = (method - 0x0440) / 4;
-                int row = matrixIndex / 4;
-                int col = matrixIndex % 4;
-                m_matrices.projection[row][col] = *(float*)&parameter;
-            }
-            break;
-            
-        case 0x0480 ... 0x04BC: // Modelview matrix
-            {
-                int matrixIndex = (method - 0x0480) / 4;
-                int row = matrixIndex / 4;
-                int col = matrixIndex % 4;
-                m_matrices.modelview[row][col] = *(float*)&parameter;
-            }
-            break;
-            
-        case 0x0580 ... 0x05BC: // Inverse modelview matrix
-            {
-                int matrixIndex = (method - 0x0580) / 4;
-                int row = matrixIndex / 4;
-                int col = matrixIndex % 4;
-                m_matrices.modelviewInverse[row][col] = *(float*)&parameter;
-            }
-            break;
-            
-        case 0x0680 ... 0x06BC: // Composite matrix
-            {
-                int matrixIndex = (method - 0x0680) / 4;
-                int row = matrixIndex / 4;
-                int col = matrixIndex % 4;
-                m_matrices.composite[row][col] = *(float*)&parameter;
-            }
-            break;
-            
         // Viewport/Transform methods
         case 0x0A20 ... 0x0A2C: // Viewport translate
             {
@@ -1059,6 +1334,7 @@ void GeForce3::ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID,
                                m_channelState.channel[channelID].object[subchannelID].method[0x1D90 / 4]);
             clear_depth_buffer(parameter & 3, 
                               m_channelState.channel[channelID].object[subchannelID].method[0x1D8C / 4]);
+            MarkRenderTargetDirty();
             break;
             
         case 0x1D98: // Set clear rect X
@@ -1285,96 +1561,6 @@ void GeForce3::ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID,
             }
             break;
             
-        // Persistent vertex attributes
-        case 0x1880 ... 0x18FC: {
-            int v = method - 0x1880; // 16 couples, 2 float per couple
-            int attr = v >> 3;
-            int comp = (v >> 2) & 1;
-            
-            m_persistentVertexAttr.attribute[attr].iv[comp] = parameter;
-            if (comp == 1) {
-                m_persistentVertexAttr.attribute[attr].fv[2] = 0;
-                m_persistentVertexAttr.attribute[attr].fv[3] = 1;
-                
-                if (attr == 0)
-                    ProcessPersistentVertex();
-            }
-            break;
-        }
-            
-        case 0x1900 ... 0x193C: {
-            int v = method - 0x1900; // 16 dwords, 2 values per dword
-            int attr = v >> 2;
-            uint16_t d1 = parameter & 0xFFFF;
-            uint16_t d2 = parameter >> 16;
-            
-            m_persistentVertexAttr.attribute[attr].fv[0] = static_cast<float>(static_cast<int16_t>(d1));
-            m_persistentVertexAttr.attribute[attr].fv[1] = static_cast<float>(static_cast<int16_t>(d2));
-            m_persistentVertexAttr.attribute[attr].fv[2] = 0;
-            m_persistentVertexAttr.attribute[attr].fv[3] = 1;
-            
-            if (attr == 0)
-                ProcessPersistentVertex();
-            break;
-        }
-            
-        case 0x1940 ... 0x197C: {
-            int v = method - 0x1940; // 16 dwords, 4 values per dword
-            int attr = v >> 2;
-            uint8_t d1 = parameter & 0xFF;
-            uint8_t d2 = (parameter >> 8) & 0xFF;
-            uint8_t d3 = (parameter >> 16) & 0xFF;
-            uint8_t d4 = parameter >> 24;
-            
-            // Color is ARGB
-            m_persistentVertexAttr.attribute[attr].fv[0] = static_cast<float>(d1) / 255.0f;
-            m_persistentVertexAttr.attribute[attr].fv[1] = static_cast<float>(d2) / 255.0f;
-            m_persistentVertexAttr.attribute[attr].fv[2] = static_cast<float>(d3) / 255.0f;
-            m_persistentVertexAttr.attribute[attr].fv[3] = static_cast<float>(d4) / 255.0f;
-            
-            if (attr == 0)
-                ProcessPersistentVertex();
-            break;
-        }
-            
-        case 0x1980 ... 0x19FC: {
-            int v = method - 0x1980; // 16 couples, 4 values per couple
-            int attr = v >> 3;
-            int comp = (v >> 1) & 3;
-            uint16_t d1 = parameter & 0xFFFF;
-            uint16_t d2 = parameter >> 16;
-            
-            m_persistentVertexAttr.attribute[attr].fv[comp] = static_cast<float>(static_cast<int16_t>(d1));
-            m_persistentVertexAttr.attribute[attr].fv[comp+1] = static_cast<float>(static_cast<int16_t>(d2));
-            
-            if (comp == 2 && attr == 0)
-                ProcessPersistentVertex();
-            break;
-        }
-            
-        case 0x1A00 ... 0x1AFC: {
-            int v = method - 0x1A00; // 16 groups, 4 float per group
-            int attr = v >> 4;
-            int comp = (v >> 2) & 3;
-            
-            m_persistentVertexAttr.attribute[attr].iv[comp] = parameter;
-            
-            if (comp == 3 && attr == 0)
-                ProcessPersistentVertex();
-            break;
-        }
-            
-        case 0x1518 ... 0x1524: {
-            int v = method - 0x1518;
-            int comp = v >> 2;
-            
-            m_persistentVertexAttr.attribute[static_cast<int>(VertexAttr::POS)].iv[comp] = parameter;
-            
-            if (comp == 3)
-                ProcessPersistentVertex();
-            break;
-        }
-            
         // DMA source/destination methods
         case 0x0180: // DMA notify
             ReadDMAObject(parameter, m_dmaOffset[0], m_dmaSize[0]);
@@ -1447,16 +1633,7 @@ void GeForce3::ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID,
                 m_pgraph[0x708 / 4] = parameter;
                 m_pgraph[0x100 / 4] |= 1;
                 m_pgraph[0x108 / 4] |= 1;
-                
-                if (UpdateInterrupts()) {
-                    if (m_irqCallback) {
-                        m_irqCallback(1); // Signal IRQ active
-                    }
-                } else {
-                    if (m_irqCallback) {
-                        m_irqCallback(0); // Signal IRQ inactive
-                    }
-                }
+                PostIRQ(UpdateInterrupts());
                 
                 return;
             }
@@ -1561,7 +1738,9 @@ void GeForce3::ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID,
                 // Write the value to memory
                 uint32_t* dest = reinterpret_cast<uint32_t*>(DirectAccessPtr(dmaOffset + offset));
                 if (dest) {
+                    ResolveClears();
                     *dest = parameter;
+                    MemoryWritten(dmaOffset + offset, 4);
                 }
                 
                 // Software expects to find the parameter at PGRAPH offset b10
@@ -1576,20 +1755,228 @@ void GeForce3::ExecuteMethodGraphics(uint32_t channelID, uint32_t subchannelID,
     }
 }
 
-void GeForce3::ExecuteMethodM2MF(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
+void GeForce3::MethodVertexProgramUpload(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
 {
-    switch (method) {
-        case 0x0180: // Notify
-            ReadDMAObject(parameter, m_dmaOffset[10], m_dmaSize[10]);
-            break;
-            
-        default:
-            //LOG("Unhandled M2MF method: 0x%04X = 0x%08X\n", method, parameter);
-            break;
+    // Vertex shader instructions upload (0x0B00-0x0B7C)
+    if (m_vertexProgram.uploadInstructionIndex < 256) {
+        m_vertexProgram.instructions[m_vertexProgram.uploadInstructionIndex].data[m_vertexProgram.uploadInstructionComponent] = parameter;
+        m_vertexProgram.instructions[m_vertexProgram.uploadInstructionIndex].modified |= (1 << m_vertexProgram.uploadInstructionComponent);
+    }
+    
+    if (m_vertexProgram.instructions[m_vertexProgram.uploadInstructionIndex].modified == 15) {
+        m_vertexProgram.instructions[m_vertexProgram.uploadInstructionIndex].modified = 0;
+        DecodeVertexInstruction(m_vertexProgram.uploadInstructionIndex);
+        m_vertexProgramDirty = true;
+    }
+    
+    m_vertexProgram.uploadInstructionComponent++;
+    if (m_vertexProgram.uploadInstructionComponent >= 4) {
+        m_vertexProgram.uploadInstructionComponent = 0;
+        m_vertexProgram.uploadInstructionIndex++;
     }
 }
 
-void GeForce3::ExecuteMethodSurf2D(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
+void GeForce3::MethodVertexConstantUpload(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
+{
+    // Vertex shader constants upload (0x0B80-0x0BFC)
+    if (m_vertexProgram.uploadParameterIndex < 192) {
+        m_vertexProgram.constants[m_vertexProgram.uploadParameterIndex].SetComponent(m_vertexProgram.uploadParameterComponent, parameter);
+    }
+    
+    m_vertexProgram.uploadParameterComponent++;
+    if (m_vertexProgram.uploadParameterComponent >= 4) {
+        m_vertexProgram.uploadParameterComponent = 0;
+        m_vertexProgram.uploadParameterIndex++;
+    }
+}
+
+void GeForce3::MethodMatrix(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
+{
+    float (*matrix)[4];
+    uint32_t base;
+    if (method >= 0x0680) {         // Composite matrix
+        matrix = m_matrices.composite;
+        base = 0x0680;
+    } else if (method >= 0x0580) {  // Inverse modelview matrix
+        matrix = m_matrices.modelviewInverse;
+        base = 0x0580;
+    } else if (method >= 0x0480) {  // Modelview matrix
+        matrix = m_matrices.modelview;
+        base = 0x0480;
+    } else {                        // Projection matrix
+        matrix = m_matrices.projection;
+        base = 0x0440;
+    }
+    
+    int matrixIndex = (method - base) / 4;
+    int row = matrixIndex / 4;
+    int col = matrixIndex % 4;
+    matrix[row][col] = *(float*)&parameter;
+}
+
+void GeForce3::MethodDrawIndices(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
+{
+    // 0x1800 sends word indices, 0x1808 dword indices
+    HandleDrawIndices(method == 0x1800 ? 2 : 1, parameter);
+}
+
+void GeForce3::MethodPersistentVertexAttribute(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
+{
+    switch (method) {
+        case 0x1880 ... 0x18FC: {
+            int v = method - 0x1880; // 16 couples, 2 float per couple
+            int attr = v >> 3;
+            int comp = (v >> 2) & 1;
+            
+            m_persistentVertexAttr.attribute[attr].iv[comp] = parameter;
+            if (comp == 1) {
+                m_persistentVertexAttr.attribute[attr].fv[2] = 0;
+                m_persistentVertexAttr.attribute[attr].fv[3] = 1;
+                
+                if (attr == 0)
+                    ProcessPersistentVertex();
+            }
+            break;
+        }
+            
+        case 0x1900 ... 0x193C: {
+            int v = method - 0x1900; // 16 dwords, 2 values per dword
+            int attr = v >> 2;
+            uint16_t d1 = parameter & 0xFFFF;
+            uint16_t d2 = parameter >> 16;
+            
+            m_persistentVertexAttr.attribute[attr].fv[0] = static_cast<float>(static_cast<int16_t>(d1));
+            m_persistentVertexAttr.attribute[attr].fv[1] = static_cast<float>(static_cast<int16_t>(d2));
+            m_persistentVertexAttr.attribute[attr].fv[2] = 0;
+            m_persistentVertexAttr.attribute[attr].fv[3] = 1;
+            
+            if (attr == 0)
+                ProcessPersistentVertex();
+            break;
+        }
+            
+        case 0x1940 ... 0x197C: {
+            int v = method - 0x1940; // 16 dwords, 4 values per dword
+            int attr = v >> 2;
+            uint8_t d1 = parameter & 0xFF;
+            uint8_t d2 = (parameter >> 8) & 0xFF;
+            uint8_t d3 = (parameter >> 16) & 0xFF;
+            uint8_t d4 = parameter >> 24;
+            
+            // Color is ARGB
+            m_persistentVertexAttr.attribute[attr].fv[0] = static_cast<float>(d1) / 255.0f;
+            m_persistentVertexAttr.attribute[attr].fv[1] = static_cast<float>(d2) / 255.0f;
+            m_persistentVertexAttr.attribute[attr].fv[2] = static_cast<float>(d3) / 255.0f;
+            m_persistentVertexAttr.attribute[attr].fv[3] = static_cast<float>(d4) / 255.0f;
+            
+            if (attr == 0)
+                ProcessPersistentVertex();
+            break;
+        }
+            
+        case 0x1980 ... 0x19FC: {
+            int v = method - 0x1980; // 16 couples, 4 values per couple
+            int attr = v >> 3;
+            int comp = (v >> 1) & 3;
+            uint16_t d1 = parameter & 0xFFFF;
+            uint16_t d2 = parameter >> 16;
+            
+            m_persistentVertexAttr.attribute[attr].fv[comp] = static_cast<float>(static_cast<int16_t>(d1));
+            m_persistentVertexAttr.attribute[attr].fv[comp+1] = static_cast<float>(static_cast<int16_t>(d2));
+            
+            if (comp == 2 && attr == 0)
+                ProcessPersistentVertex();
+            break;
+        }
+            
+        case 0x1A00 ... 0x1AFC: {
+            int v = method - 0x1A00; // 16 groups, 4 float per group
+            int attr = v >> 4;
+            int comp = (v >> 2) & 3;
+            
+            m_persistentVertexAttr.attribute[attr].iv[comp] = parameter;
+            
+            if (comp == 3 && attr == 0)
+                ProcessPersistentVertex();
+            break;
+        }
+            
+        case 0x1518 ... 0x1524: {
+            int v = method - 0x1518;
+            int comp = v >> 2;
+            
+            m_persistentVertexAttr.attribute[static_cast<int>(VertexAttr::POS)].iv[comp] = parameter;
+            
+            if (comp == 3)
+                ProcessPersistentVertex();
+            break;
+        }
+    }
+}
+
+void GeForce3::BulkVertexProgramUpload(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                                       uint32_t address, const uint32_t* parameters, uint32_t count)
+{
+    for (uint32_t n = 0; n < count; n++) {
+        MethodVertexProgramUpload(channelID, subchannelID, method, parameters[n]);
+    }
+}
+
+void GeForce3::BulkVertexConstantUpload(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                                        uint32_t address, const uint32_t* parameters, uint32_t count)
+{
+    uint32_t n = 0;
+    while (n < count) {
+        // Whole constants are copied in one go
+        if (m_vertexProgram.uploadParameterComponent == 0 && count - n >= 4 &&
+            m_vertexProgram.uploadParameterIndex < 192) {
+            memcpy(m_vertexProgram.constants[m_vertexProgram.uploadParameterIndex].fv, parameters + n, 4 * sizeof(uint32_t));
+            m_vertexProgram.uploadParameterIndex++;
+            n += 4;
+        } else {
+            MethodVertexConstantUpload(channelID, subchannelID, method, parameters[n]);
+            n++;
+        }
+    }
+}
+
+void GeForce3::BulkDrawIndices(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                               uint32_t address, const uint32_t* parameters, uint32_t count)
+{
+    int multiply = method == 0x1800 ? 2 : 1;
+    for (uint32_t n = 0; n < count; n++) {
+        HandleDrawIndices(multiply, parameters[n]);
+    }
+}
+
+void GeForce3::BulkDrawRawVertices(uint32_t channelID, uint32_t subchannelID, uint32_t method,
+                                   uint32_t address, const uint32_t* parameters, uint32_t count)
+{
+    // Inline vertex data: each vertex takes as many words as the enabled
+    // attributes need, so read them straight out of the pushbuffer
+    uint32_t end = address + count * 4;
+    while (address < end) {
+        int words = HandleDrawRawVertices(address);
+        if (words <= 0)
+            break;
+        address += words * 4;
+    }
+}
+
+void GeForce3::ExecuteMethodM2MF(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
+{
+    switch (method) {
+        case 0x0180: // Notify
+            ReadDMAObject(parameter, m_dmaOffset[10], m_dmaSize[10]);
+            break;
+            
+        default:
+            //LOG("Unhandled M2MF method: 0x%04X = 0x%08X\n", method, parameter);
+            break;
+    }
+}
+
+void GeForce3::ExecuteMethodSurf2D(uint32_t channelID, uint32_t subchannelID, uint32_t method, uint32_t parameter)
 {
     switch (method) {
         case 0x0184: // Source
@@ -1759,15 +2146,32 @@ void GeForce3::HandleDrawCommand(uint32_t parameter)
     
     if (parameter == 0) { // End primitive
         m_primitivesBatchCount++;
+        MarkRenderTargetDirty();
     } else {
         // Select the appropriate render callback
+        RenderMethod method;
         if (m_combinerEnabled) {
-            m_renderCallback = &GeForce3::RenderRegisterCombiners;
+            method = &GeForce3::RenderRegisterCombiners;
         } else if (m_texture[0].enabled) {
-            m_renderCallback = &GeForce3::RenderTextureSimple;
+            method = &GeForce3::RenderTextureSimple;
         } else {
-            m_renderCallback = &GeForce3::RenderColor;
+            method = &GeForce3::RenderColor;
+        }
+        
+        // Queued triangles still reference the current callback
+        if (method != m_renderMethod) {
+            m_rasterizer->Wait();
+            m_renderMethod = method;
+            m_renderCallback = [this, method](int32_t scanline, const RasterizerExtent_t& extent, void* objectData, int threadId) {
+                (this->*method)(scanline, extent, objectData, threadId);
+            };
         }
+        
+        SelectPixelPipeline();
+        SyncHierarchicalZ();
+        if (m_combinerEnabled)
+            SelectCombinerProgram();
+        BindTextures();
     }
 }
 
@@ -1781,10 +2185,13 @@ void GeForce3::HandleDrawIndices(int multiply, uint32_t parameter)
         m_vertexIndices[n & 1023] = parameter & 0xFFFF;
         m_vertexIndices[(n + 1) & 1023] = (parameter >> 16) & 0xFFFF;
         m_indexesLeftCount += 2;
+        TraceVertexFetch(parameter & 0xFFFF, 1);
+        TraceVertexFetch((parameter >> 16) & 0xFFFF, 1);
     } else {
         // 32-bit indices (one per DWORD)
         m_vertexIndices[n & 1023] = parameter;
         m_indexesLeftCount += 1;
+        TraceVertexFetch(parameter, 1);
     }
     
     // Read vertices based on indices
@@ -1798,6 +2205,7 @@ void GeForce3::HandleDrawVerticesWithOffset(uint32_t parameter)
     int offset = parameter & 0xFFFFFF;
     int count = (parameter >> 24) & 0xFF;
     
+    TraceVertexFetch(offset, count + 1);
     ReadVerticesWithOffset(m_vertexFirst, offset, count + 1);
     AssemblePrimitive(m_vertexFirst, count + 1);
     m_vertexFirst = (m_vertexFirst + count + 1) & 1023;
@@ -1935,6 +2343,38 @@ void GeForce3::HandleCombinerStageRGBInput(int stage, uint32_t parameter)
     m_combiner.setup.stage[stage].mapinRGB.aMapping = static_cast<CombinerMapFunction>((parameter >> 29) & 7);
 }
 
+namespace {
+    // Pixel bits of a surface with the given bytes per pixel
+    uint32_t SurfacePixelMask(int bytesPerPixel)
+    {
+        return bytesPerPixel >= 4 ? 0xFFFFFFFF : (1u << (bytesPerPixel * 8)) - 1;
+    }
+    
+    // Replace the bits in mask of count pixels
+    template<typename T>
+    void FillPixels(T* dest, size_t count, uint32_t value, uint32_t mask)
+    {
+        T pixel = static_cast<T>(value);
+        if (mask == SurfacePixelMask(sizeof(T))) {
+            bool sameBytes = true;
+            for (size_t n = 1; n < sizeof(T); n++)
+                sameBytes = sameBytes && ((value >> (n * 8)) & 0xFF) == (value & 0xFF);
+            
+            if (sameBytes)
+                memset(dest, value & 0xFF, count * sizeof(T));
+            else
+                std::fill_n(dest, count, pixel);
+            return;
+        }
+        
+        T keep = static_cast<T>(~mask);
+        T set = static_cast<T>(value & mask);
+        for (size_t n = 0; n < count; n++)
+            dest[n] = static_cast<T>((dest[n] & keep) | set);
+    }
+}
+
+// Clear channels of the color buffer; what holds the R, G, B and A enables in bits 0-3
 void GeForce3::clear_render_target(int what, uint32_t value)
 {
     // Don't do anything if nothing to clear
@@ -1943,26 +2383,37 @@ void GeForce3::clear_render_target(int what, uint32_t value)
     
     if (!m_renderTarget)
         return;
-        
-    int width = m_renderTargetLimits.right() - m_renderTargetLimits.left() + 1;
-    int height = m_renderTargetLimits.bottom() - m_renderTargetLimits.top() + 1;
-    
-    // Clear RGB channels?
-    if (what & (1 << 4)) {
-        // For each scanline
-        for (int y = m_clearRect.top(); y <= m_clearRect.bottom(); y++) {
-            uint32_t* dest = m_renderTarget + y * (m_renderTargetPitch / 4) + m_clearRect.left();
-            
-            // For each pixel
-            for (int x = 0; x < (m_clearRect.right() - m_clearRect.left() + 1); x++) {
-                *dest++ = value;
-            }
-        }
+    
+    SurfaceClear clear;
+    clear.buffer = reinterpret_cast<uint8_t*>(m_renderTarget);
+    clear.pitch = m_renderTargetPitch;
+    clear.bytesPerPixel = m_bytesPerPixel;
+    clear.mask = 0;
+    
+    if (m_bytesPerPixel == 2) {
+        // Same conversion the pixel writer uses
+        clear.value = ((value >> 8) & 0xF800) | ((value >> 5) & 0x07E0) | ((value >> 3) & 0x001F);
+        if (what & 1) clear.mask |= 0xF800;
+        if (what & 2) clear.mask |= 0x07E0;
+        if (what & 4) clear.mask |= 0x001F;
+    } else if (m_bytesPerPixel == 1) {
+        clear.value = value & 0xFF;
+        if (what & 4) clear.mask |= 0xFF;
+    } else {
+        clear.value = value;
+        if (what & 1) clear.mask |= 0x00FF0000;
+        if (what & 2) clear.mask |= 0x0000FF00;
+        if (what & 4) clear.mask |= 0x000000FF;
+        if (what & 8) clear.mask |= 0xFF000000;
     }
     
+    if (clear.mask != 0 && ClipClear(clear, m_renderTargetSize))
+        ClearSurface(m_pendingClears[0], clear);
+    
     LOG("Clear color buffer: %08X\n", value);
 }
 
+// Clear the depth buffer; what holds the depth and stencil enables in bits 0-1
 void GeForce3::clear_depth_buffer(int what, uint32_t value)
 {
     // Don't do anything if nothing to clear
@@ -1971,35 +2422,157 @@ void GeForce3::clear_depth_buffer(int what, uint32_t value)
     
     if (!m_depthBuffer)
         return;
-        
-    // For each scanline
-    for (int y = m_clearRect.top(); y <= m_clearRect.bottom(); y++) {
-        if (m_depthFormat == DepthFormat::Z24S8) {
-            uint32_t* dest = m_depthBuffer + y * (m_depthBufferPitch / 4) + m_clearRect.left();
-            
-            // For each pixel
-            for (int x = 0; x < (m_clearRect.right() - m_clearRect.left() + 1); x++) {
-                *dest++ = value;
-            }
-        } else {
-            uint16_t* dest = reinterpret_cast<uint16_t*>(m_depthBuffer) + y * (m_depthBufferPitch / 2) + m_clearRect.left();
-            uint16_t depth16 = static_cast<uint16_t>(value >> 8);
-            
-            // For each pixel
-            for (int x = 0; x < (m_clearRect.right() - m_clearRect.left() + 1); x++) {
-                *dest++ = depth16;
-            }
-        }
+    
+    SurfaceClear clear;
+    clear.buffer = reinterpret_cast<uint8_t*>(m_depthBuffer);
+    clear.pitch = m_depthBufferPitch;
+    clear.mask = 0;
+    
+    if (m_depthFormat == DepthFormat::Z24S8) {
+        clear.bytesPerPixel = 4;
+        clear.value = value;
+        if (what & 1) clear.mask |= 0xFFFFFF00;
+        if (what & 2) clear.mask |= 0x000000FF;
+    } else {
+        clear.bytesPerPixel = 2;
+        clear.value = (value >> 8) & 0xFFFF;
+        if (what & 1) clear.mask |= 0xFFFF;
+    }
+    
+    if (clear.mask != 0 && ClipClear(clear, m_depthBufferSize))
+        ClearSurface(m_pendingClears[1], clear);
+    
+    if (what & 1) {
+        if (m_depthFormat == DepthFormat::Z24S8)
+            ClearHierarchicalZ(value >> 8);
+        else
+            ClearHierarchicalZ(((value >> 8) & 0xFFFF) << 8 | 0xFF);
     }
     
     LOG("Clear depth buffer: %08X\n", value);
 }
 
+// Clip the clear rect to a surface of surfaceSize bytes; false if nothing is left
+bool GeForce3::ClipClear(SurfaceClear& clear, uint32_t surfaceSize)
+{
+    if (clear.pitch == 0 || clear.pitch % clear.bytesPerPixel != 0)
+        return false;
+    
+    // The surface may also run past the end of memory
+    uint64_t offset = static_cast<uint64_t>(clear.buffer - m_ramBase);
+    uint64_t available = offset < m_ramSize ? std::min<uint64_t>(surfaceSize, m_ramSize - offset) : 0;
+    
+    clear.left = std::max(m_clearRect.left(), 0);
+    clear.top = std::max(m_clearRect.top(), 0);
+    clear.right = std::min<int>(m_clearRect.right(), clear.pitch / clear.bytesPerPixel - 1);
+    clear.bottom = static_cast<int>(std::min<int64_t>(m_clearRect.bottom(), static_cast<int64_t>(available / clear.pitch) - 1));
+    
+    return clear.left <= clear.right && clear.top <= clear.bottom;
+}
+
+// Fill a clipped clear now, or record it for the render threads to fill
+void GeForce3::ClearSurface(PendingClear& pending, const SurfaceClear& clear)
+{
+    if (!m_lazyClears) {
+        FillSurface(clear, clear.top, clear.bottom);
+        return;
+    }
+    
+    // A full clear of the same surface makes an older pending one moot
+    if (pending.active) {
+        const SurfaceClear& old = pending.clear;
+        bool covers = clear.mask == SurfacePixelMask(clear.bytesPerPixel) &&
+                      clear.buffer == old.buffer && clear.pitch == old.pitch &&
+                      clear.bytesPerPixel == old.bytesPerPixel &&
+                      clear.left <= old.left && clear.right >= old.right &&
+                      clear.top <= old.top && clear.bottom >= old.bottom;
+        if (!covers)
+            ResolveClears();
+    }
+    
+    pending.clear = clear;
+    pending.active = true;
+    pending.tiles.assign(clear.bottom / Rasterizer::TILE_HEIGHT + 1, 0);
+    std::fill(pending.tiles.begin() + clear.top / Rasterizer::TILE_HEIGHT, pending.tiles.end(), 1);
+}
+
+// Fill rows top..bottom of a clear
+void GeForce3::FillSurface(const SurfaceClear& clear, int top, int bottom)
+{
+    uint8_t* row = clear.buffer + static_cast<size_t>(top) * clear.pitch + static_cast<size_t>(clear.left) * clear.bytesPerPixel;
+    size_t width = clear.right - clear.left + 1;
+    int rows = bottom - top + 1;
+    
+    // Whole rows are one contiguous run
+    if (clear.left == 0 && width * clear.bytesPerPixel == clear.pitch) {
+        width *= rows;
+        rows = 1;
+    }
+    
+    for (int y = 0; y < rows; y++, row += clear.pitch) {
+        if (clear.bytesPerPixel == 4)
+            FillPixels(reinterpret_cast<uint32_t*>(row), width, clear.value, clear.mask);
+        else if (clear.bytesPerPixel == 2)
+            FillPixels(reinterpret_cast<uint16_t*>(row), width, clear.value, clear.mask);
+        else
+            FillPixels(row, width, clear.value, clear.mask);
+    }
+}
+
+// Fill the rasterizer tile holding scanline y of every pending clear
+//
+// Runs on the render threads; the tile is theirs alone while they render it.
+void GeForce3::ResolveClearTile(int y)
+{
+    if (y < 0)
+        return;
+    
+    size_t tile = y / Rasterizer::TILE_HEIGHT;
+    for (PendingClear& pending : m_pendingClears) {
+        if (!pending.active || tile >= pending.tiles.size() || !pending.tiles[tile])
+            continue;
+        
+        const SurfaceClear& clear = pending.clear;
+        int top = std::max<int>(clear.top, tile * Rasterizer::TILE_HEIGHT);
+        int bottom = std::min<int>(clear.bottom, (tile + 1) * Rasterizer::TILE_HEIGHT - 1);
+        FillSurface(clear, top, bottom);
+        pending.tiles[tile] = 0;
+    }
+}
+
+// Fill everything the pending clears still owe memory
+void GeForce3::ResolveClears()
+{
+    if (!m_pendingClears[0].active && !m_pendingClears[1].active)
+        return;
+    
+    // Queued triangles may still be filling tiles
+    m_rasterizer->Wait();
+    
+    for (PendingClear& pending : m_pendingClears) {
+        if (!pending.active)
+            continue;
+        
+        for (size_t tile = 0; tile < pending.tiles.size(); tile++) {
+            if (pending.tiles[tile])
+                ResolveClearTile(static_cast<int>(tile * Rasterizer::TILE_HEIGHT));
+        }
+        pending.active = false;
+        pending.tiles.clear();
+    }
+}
+
 void GeForce3::ProcessPersistentVertex()
 {
     // Transform coordinates and render a single point
     NV2AVertex_t v;
     
+    // The point is written directly, behind any queued triangles
+    m_rasterizer->Wait();
+    SelectPixelPipeline();
+    BindTextures();
+    MarkRenderTargetDirty();
+    
     // Use position from persistent vertex attribute 0
     ConvertVertices(&m_persistentVertexAttr, &v);
     
@@ -2071,244 +2644,365 @@ void GeForce3::DecodeVertexInstruction(int address)
     decoded.EndOfProgram = ins.data[3] & 1;
 }
 
-void GeForce3::ExecuteVertexProgram()
-{
-    // Initialize the vertex program
-    m_vertexProgram.ip = m_vertexProgram.startInstruction;
-    m_vertexProgram.a0x = 0;
-    
-    // Execute instructions until we reach the end of the program
-    bool endOfProgram = false;
-    while (!endOfProgram) {
-        endOfProgram = ExecuteVertexInstruction();
-        m_vertexProgram.ip++;
-    }
-}
-
-bool GeForce3::ExecuteVertexInstruction()
+void GeForce3::CompileVertexProgram()
 {
-    auto& ins = m_vertexProgram.instructions[m_vertexProgram.ip].decoded;
-    
-    // Prepare inputs 
-    float inputA[4] = {0, 0, 0, 0};
-    float inputB[4] = {0, 0, 0, 0};
-    float inputC[4] = {0, 0, 0, 0};
-    float outputVec[4] = {0, 0, 0, 0};
-    float outputSca[4] = {0, 0, 0, 0};
-    
-    // Generate inputs
-    GenerateInput(inputA, ins.NegateA, ins.ParameterTypeA, ins.TempIndexA, ins.SwizzleA);
-    GenerateInput(inputB, ins.NegateB, ins.ParameterTypeB, ins.TempIndexB, ins.SwizzleB);
-    GenerateInput(inputC, ins.NegateC, ins.ParameterTypeC, ins.TempIndexC, ins.SwizzleC);
-    
-    // Execute vector operation
-    ComputeVectorOperation(outputVec, ins.VecOperation, inputA, inputB, inputC);
-    
-    // Execute scalar operation
-    ComputeScalarOperation(outputSca, ins.ScaOperation, inputA, inputB, inputC);
-    
-    // Assign destinations
-    if (ins.VecOperation != VectorOp::NOP) {
-        if (ins.VecOperation == VectorOp::ARL) {
-            // Address register load
-            m_vertexProgram.a0x = static_cast<int>(outputVec[0]);
-        } else {
-            // Assign to temporary register
-            if (ins.VecTempWriteMask != 0) {
-                AssignToRegister(ins.VecTempIndex, outputVec, ins.VecTempWriteMask);
+    CompiledVertexProgram& program = m_vertexProgramCode;
+    program.ops.clear();
+    program.batched = true;
+    
+    // Components each temporary and output holds at this point of the program
+    int tempWritten[VERTEX_PROGRAM_TEMPS] = {};
+    int outputWritten = 0;
+    
+    for (int ip = m_vertexProgram.startInstruction; ip >= 0 && ip < 256; ip++) {
+        const auto& ins = m_vertexProgram.instructions[ip].decoded;
+        VertexProgramOp op;
+        memset(&op, 0, sizeof(op));
+        op.vecOperation = ins.VecOperation;
+        op.scaOperation = ins.ScaOperation;
+        
+        const int* swizzles[3] = { ins.SwizzleA, ins.SwizzleB, ins.SwizzleC };
+        const int types[3] = { ins.ParameterTypeA, ins.ParameterTypeB, ins.ParameterTypeC };
+        const int temps[3] = { ins.TempIndexA, ins.TempIndexB, ins.TempIndexC };
+        const int negates[3] = { ins.NegateA, ins.NegateB, ins.NegateC };
+        for (int n = 0; n < 3; n++) {
+            VertexProgramOperand& operand = op.operands[n];
+            operand.type = types[n];
+            operand.negate = negates[n] != 0;
+            for (int i = 0; i < 4; i++)
+                operand.swizzle[i] = swizzles[n][i];
+            
+            switch (operand.type) {
+                case 1:
+                    operand.index = temps[n];
+                    // A temporary read before it is written sees the previous vertex
+                    for (int i = 0; i < 4; i++) {
+                        if (!(tempWritten[operand.index] & (8 >> operand.swizzle[i])))
+                            program.batched = false;
+                    }
+                    break;
+                case 2:
+                    operand.index = ins.InputIndex;
+                    break;
+                case 3:
+                    operand.index = ins.SourceConstantIndex;
+                    operand.relative = ins.Usea0x != 0;
+                    break;
+                default:
+                    break;
             }
+        }
+        
+        bool positionWritten = false;
+        
+        if (ins.VecOperation != VectorOp::NOP && ins.VecOperation != VectorOp::ARL) {
+            op.vecTempIndex = ins.VecTempIndex;
+            op.vecTempMask = ins.VecTempWriteMask;
             
-            // Assign to output register
             if (ins.OutputWriteMask != 0 && ins.MultiplexerControl == 0) {
                 if (ins.OutputSelect != 0) {
-                    // Assign to vertex output
-                    AssignToOutput(ins.OutputIndex, outputVec, ins.OutputWriteMask);
-                    
-                    // If this is the position output, also update r12
-                    if (ins.OutputIndex == 0) {
-                        for (int i = 0; i < 4; i++) {
-                            m_vertexProgram.registers[12].fv[i] = m_vertexOutput->attribute[ins.OutputIndex].fv[i];
-                        }
+                    if (ins.OutputIndex < 16) {
+                        op.vecOutputIndex = ins.OutputIndex;
+                        op.vecOutputMask = ins.OutputWriteMask;
                     }
-                } else {
-                    // Assign to constant register
-                    AssignToConstant(ins.OutputIndex, outputVec, ins.OutputWriteMask);
+                } else if (ins.OutputIndex < 192) {
+                    // Later vertices read what earlier ones wrote
+                    op.vecConstantIndex = ins.OutputIndex;
+                    op.vecConstantMask = ins.OutputWriteMask;
+                    program.batched = false;
                 }
             }
         }
-    }
-    
-    if (ins.ScaOperation != ScalarOp::NOP) {
-        // Assign to temporary register
-        if (ins.ScaTempWriteMask != 0) {
-            int regIndex = (ins.VecOperation != VectorOp::NOP) ? 1 : ins.VecTempIndex;
-            AssignToRegister(regIndex, outputSca, ins.ScaTempWriteMask);
-        }
         
-        // Assign to output register
-        if (ins.OutputWriteMask != 0 && ins.MultiplexerControl != 0) {
-            AssignToOutput(ins.OutputIndex, outputSca, ins.OutputWriteMask);
+        if (ins.ScaOperation != ScalarOp::NOP) {
+            op.scaTempIndex = (ins.VecOperation != VectorOp::NOP) ? 1 : ins.VecTempIndex;
+            op.scaTempMask = ins.ScaTempWriteMask;
             
-            // If this is the position output, also update r12
-            if (ins.OutputIndex == 0) {
-                for (int i = 0; i < 4; i++) {
-                    m_vertexProgram.registers[12].fv[i] = m_vertexOutput->attribute[ins.OutputIndex].fv[i];
-                }
+            if (ins.OutputWriteMask != 0 && ins.MultiplexerControl != 0 && ins.OutputIndex < 16) {
+                op.scaOutputIndex = ins.OutputIndex;
+                op.scaOutputMask = ins.OutputWriteMask;
             }
         }
+        
+        tempWritten[op.vecTempIndex] |= op.vecTempMask;
+        tempWritten[op.scaTempIndex] |= op.scaTempMask;
+        if (op.vecOutputMask && op.vecOutputIndex == 0) {
+            outputWritten |= op.vecOutputMask;
+            positionWritten = true;
+        }
+        if (op.scaOutputMask && op.scaOutputIndex == 0) {
+            outputWritten |= op.scaOutputMask;
+            positionWritten = true;
+        }
+        
+        // Writing the position also copies all of it to r12
+        if (positionWritten) {
+            if (outputWritten != 15)
+                program.batched = false;
+            tempWritten[12] = 15;
+        }
+        
+        program.ops.push_back(op);
+        
+        if (ins.EndOfProgram)
+            break;
     }
     
-    return ins.EndOfProgram != 0;
+    m_vertexProgramDirty = false;
+    LOG("Vertex program at %d: %zu instructions, %s\n", m_vertexProgram.startInstruction, program.ops.size(),
+        program.batched ? "batched" : "serial");
 }
 
-void GeForce3::GenerateInput(float* output, bool negate, int type, int tempIndex, const int* swizzle)
+void GeForce3::ExecuteVertexProgram(const VertexNV* const* inputs, VertexNV* outputs, int count)
 {
-    // Select source based on type
-    float* source = nullptr;
-    switch (type) {
-        case 1: // Register (Rn)
-            source = m_vertexProgram.registers[tempIndex].fv;
+    if (m_vertexProgramDirty)
+        CompileVertexProgram();
+    
+    int width = m_vertexProgramCode.batched ? VERTEX_PROGRAM_LANES : 1;
+    for (int first = 0; first < count; first += width)
+        RunVertexProgramBatch(inputs + first, outputs + first, std::min(count - first, width));
+}
+
+void GeForce3::RunVertexProgramBatch(const VertexNV* const* inputs, VertexNV* outputs, int count)
+{
+    VertexProgramBatch batch;
+    
+    // Unused lanes repeat the last vertex
+    const VertexNV* lanes[VERTEX_PROGRAM_LANES];
+    for (int l = 0; l < VERTEX_PROGRAM_LANES; l++)
+        lanes[l] = inputs[std::min(l, count - 1)];
+    
+    // Registers and outputs start from what the previous vertex left
+    for (int t = 0; t < VERTEX_PROGRAM_TEMPS; t++) {
+        for (int i = 0; i < 4; i++)
+            std::fill_n(batch.temps[t][i], VERTEX_PROGRAM_LANES, m_vertexProgram.registers[t].fv[i]);
+    }
+    for (int a = 0; a < 16; a++) {
+        for (int i = 0; i < 4; i++)
+            std::fill_n(batch.outputs[a][i], VERTEX_PROGRAM_LANES, m_vertexTemp.attribute[a].fv[i]);
+    }
+    std::fill_n(batch.a0x, VERTEX_PROGRAM_LANES, 0);
+    
+    for (const VertexProgramOp& op : m_vertexProgramCode.ops) {
+        float inputA[4][VERTEX_PROGRAM_LANES];
+        float inputB[4][VERTEX_PROGRAM_LANES];
+        float inputC[4][VERTEX_PROGRAM_LANES];
+        float outputVec[4][VERTEX_PROGRAM_LANES];
+        float outputSca[4][VERTEX_PROGRAM_LANES];
+        
+        // Generate inputs
+        GenerateInputs(batch, op.operands[0], lanes, inputA);
+        GenerateInputs(batch, op.operands[1], lanes, inputB);
+        GenerateInputs(batch, op.operands[2], lanes, inputC);
+        
+        // Execute vector operation
+        if (op.vecOperation == VectorOp::ARL) {
+            // Address register load
+            for (int l = 0; l < VERTEX_PROGRAM_LANES; l++)
+                batch.a0x[l] = static_cast<int>(floor(inputA[0][l]));
+        } else if (op.vecOperation != VectorOp::NOP) {
+            ComputeVectorOperation(outputVec, op.vecOperation, inputA, inputB, inputC);
+        }
+        
+        // Execute scalar operation, one lane at a time
+        if (op.scaOperation != ScalarOp::NOP) {
+            for (int l = 0; l < VERTEX_PROGRAM_LANES; l++) {
+                float a[4], b[4], c[4], result[4] = { 0, 0, 0, 0 };
+                for (int i = 0; i < 4; i++) {
+                    a[i] = inputA[i][l];
+                    b[i] = inputB[i][l];
+                    c[i] = inputC[i][l];
+                }
+                ComputeScalarOperation(result, op.scaOperation, a, b, c);
+                for (int i = 0; i < 4; i++)
+                    outputSca[i][l] = result[i];
+            }
+        }
+        
+        // Assign destinations
+        if (op.vecTempMask)
+            AssignToLanes(batch.temps[op.vecTempIndex], outputVec, op.vecTempMask);
+        if (op.vecOutputMask) {
+            AssignToLanes(batch.outputs[op.vecOutputIndex], outputVec, op.vecOutputMask);
+            // If this is the position output, also update r12
+            if (op.vecOutputIndex == 0)
+                memcpy(batch.temps[12], batch.outputs[0], sizeof(batch.temps[12]));
+        }
+        if (op.vecConstantMask) {
+            // Only compiled into programs that run one vertex at a time
+            for (int i = 0; i < 4; i++) {
+                if (op.vecConstantMask & (8 >> i))
+                    m_vertexProgram.constants[op.vecConstantIndex].fv[i] = outputVec[i][0];
+            }
+        }
+        
+        if (op.scaTempMask)
+            AssignToLanes(batch.temps[op.scaTempIndex], outputSca, op.scaTempMask);
+        if (op.scaOutputMask) {
+            AssignToLanes(batch.outputs[op.scaOutputIndex], outputSca, op.scaOutputMask);
+            if (op.scaOutputIndex == 0)
+                memcpy(batch.temps[12], batch.outputs[0], sizeof(batch.temps[12]));
+        }
+    }
+    
+    for (int l = 0; l < count; l++) {
+        for (int a = 0; a < 16; a++) {
+            for (int i = 0; i < 4; i++)
+                outputs[l].attribute[a].fv[i] = batch.outputs[a][i][l];
+        }
+    }
+    
+    // The last vertex leaves its state for the next one
+    int last = count - 1;
+    for (int t = 0; t < VERTEX_PROGRAM_TEMPS; t++) {
+        for (int i = 0; i < 4; i++)
+            m_vertexProgram.registers[t].fv[i] = batch.temps[t][i][last];
+    }
+    m_vertexTemp = outputs[last];
+}
+
+void GeForce3::GenerateInputs(VertexProgramBatch& batch, const VertexProgramOperand& operand,
+                              const VertexNV* const inputs[VERTEX_PROGRAM_LANES], float output[4][VERTEX_PROGRAM_LANES])
+{
+    // Select source based on type, applying swizzling
+    switch (operand.type) {
+        case 1: // Register (Rn)
+            for (int i = 0; i < 4; i++)
+                memcpy(output[i], batch.temps[operand.index][operand.swizzle[i]], sizeof(output[i]));
             break;
             
         case 2: // Vertex input (Vn)
-            source = m_vertexInput->attribute[m_vertexProgram.instructions[m_vertexProgram.ip].decoded.InputIndex].fv;
+            for (int i = 0; i < 4; i++) {
+                for (int l = 0; l < VERTEX_PROGRAM_LANES; l++)
+                    output[i][l] = inputs[l]->attribute[operand.index].fv[operand.swizzle[i]];
+            }
             break;
             
         case 3: // Constant (Cn)
-            {
-                int sourceConstantIndex = m_vertexProgram.instructions[m_vertexProgram.ip].decoded.SourceConstantIndex;
-                if (m_vertexProgram.instructions[m_vertexProgram.ip].decoded.Usea0x) {
-                    sourceConstantIndex += m_vertexProgram.a0x;
-                }
-                source = m_vertexProgram.constants[sourceConstantIndex].fv;
+            for (int l = 0; l < VERTEX_PROGRAM_LANES; l++) {
+                int index = operand.index;
+                if (operand.relative)
+                    index = std::clamp(index + batch.a0x[l], 0, 191);
+                for (int i = 0; i < 4; i++)
+                    output[i][l] = m_vertexProgram.constants[index].fv[operand.swizzle[i]];
             }
             break;
             
         default:
             // Zero
-            output[0] = output[1] = output[2] = output[3] = 0.0f;
+            memset(output, 0, sizeof(float) * 4 * VERTEX_PROGRAM_LANES);
             return;
     }
     
-    // Apply swizzling
-    for (int i = 0; i < 4; i++) {
-        output[i] = source[swizzle[i]];
-    }
-    
     // Apply negation if requested
-    if (negate) {
+    if (operand.negate) {
         for (int i = 0; i < 4; i++) {
-            output[i] = -output[i];
+            for (int l = 0; l < VERTEX_PROGRAM_LANES; l++)
+                output[i][l] = -output[i][l];
         }
     }
 }
 
-void GeForce3::ComputeVectorOperation(float* output, VectorOp op, const float* a, const float* b, const float* c)
+void GeForce3::ComputeVectorOperation(float output[4][VERTEX_PROGRAM_LANES], VectorOp op,
+                                      const float a[4][VERTEX_PROGRAM_LANES], const float b[4][VERTEX_PROGRAM_LANES],
+                                      const float c[4][VERTEX_PROGRAM_LANES])
 {
+    const int lanes = VERTEX_PROGRAM_LANES;
+    
     switch (op) {
         case VectorOp::NOP:
-            // No operation
+        case VectorOp::ARL:
+            // Handled by the caller
             break;
             
         case VectorOp::MOV:
             // Move
-            output[0] = a[0];
-            output[1] = a[1];
-            output[2] = a[2];
-            output[3] = a[3];
+            for (int i = 0; i < 4; i++)
+                for (int l = 0; l < lanes; l++)
+                    output[i][l] = a[i][l];
             break;
             
         case VectorOp::MUL:
             // Multiply
-            output[0] = a[0] * b[0];
-            output[1] = a[1] * b[1];
-            output[2] = a[2] * b[2];
-            output[3] = a[3] * b[3];
+            for (int i = 0; i < 4; i++)
+                for (int l = 0; l < lanes; l++)
+                    output[i][l] = a[i][l] * b[i][l];
             break;
             
         case VectorOp::ADD:
             // Add
-            output[0] = a[0] + c[0];
-            output[1] = a[1] + c[1];
-            output[2] = a[2] + c[2];
-            output[3] = a[3] + c[3];
+            for (int i = 0; i < 4; i++)
+                for (int l = 0; l < lanes; l++)
+                    output[i][l] = a[i][l] + c[i][l];
             break;
             
         case VectorOp::MAD:
             // Multiply and Add
-            output[0] = a[0] * b[0] + c[0];
-            output[1] = a[1] * b[1] + c[1];
-            output[2] = a[2] * b[2] + c[2];
-            output[3] = a[3] * b[3] + c[3];
+            for (int i = 0; i < 4; i++)
+                for (int l = 0; l < lanes; l++)
+                    output[i][l] = a[i][l] * b[i][l] + c[i][l];
             break;
             
         case VectorOp::DP3:
             // 3-component Dot Product
-            {
-                float dp = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
-                output[0] = output[1] = output[2] = output[3] = dp;
+            for (int l = 0; l < lanes; l++) {
+                float dp = a[0][l] * b[0][l] + a[1][l] * b[1][l] + a[2][l] * b[2][l];
+                output[0][l] = output[1][l] = output[2][l] = output[3][l] = dp;
             }
             break;
             
         case VectorOp::DPH:
             // Homogeneous Dot Product
-            {
-                float dp = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + b[3];
-                output[0] = output[1] = output[2] = output[3] = dp;
+            for (int l = 0; l < lanes; l++) {
+                float dp = a[0][l] * b[0][l] + a[1][l] * b[1][l] + a[2][l] * b[2][l] + b[3][l];
+                output[0][l] = output[1][l] = output[2][l] = output[3][l] = dp;
             }
             break;
             
         case VectorOp::DP4:
             // 4-component Dot Product
-            {
-                float dp = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
-                output[0] = output[1] = output[2] = output[3] = dp;
+            for (int l = 0; l < lanes; l++) {
+                float dp = a[0][l] * b[0][l] + a[1][l] * b[1][l] + a[2][l] * b[2][l] + a[3][l] * b[3][l];
+                output[0][l] = output[1][l] = output[2][l] = output[3][l] = dp;
             }
             break;
             
         case VectorOp::DST:
             // Distance Vector
-            output[0] = 1.0f;
-            output[1] = a[1] * b[1];
-            output[2] = a[2];
-            output[3] = b[3];
+            for (int l = 0; l < lanes; l++) {
+                output[0][l] = 1.0f;
+                output[1][l] = a[1][l] * b[1][l];
+                output[2][l] = a[2][l];
+                output[3][l] = b[3][l];
+            }
             break;
             
         case VectorOp::MIN:
             // Minimum
-            output[0] = std::min(a[0], b[0]);
-            output[1] = std::min(a[1], b[1]);
-            output[2] = std::min(a[2], b[2]);
-            output[3] = std::min(a[3], b[3]);
+            for (int i = 0; i < 4; i++)
+                for (int l = 0; l < lanes; l++)
+                    output[i][l] = std::min(a[i][l], b[i][l]);
             break;
             
         case VectorOp::MAX:
             // Maximum
-            output[0] = std::max(a[0], b[0]);
-            output[1] = std::max(a[1], b[1]);
-            output[2] = std::max(a[2], b[2]);
-            output[3] = std::max(a[3], b[3]);
+            for (int i = 0; i < 4; i++)
+                for (int l = 0; l < lanes; l++)
+                    output[i][l] = std::max(a[i][l], b[i][l]);
             break;
             
         case VectorOp::SLT:
             // Set Less Than
-            output[0] = (a[0] < b[0]) ? 1.0f : 0.0f;
-            output[1] = (a[1] < b[1]) ? 1.0f : 0.0f;
-            output[2] = (a[2] < b[2]) ? 1.0f : 0.0f;
-            output[3] = (a[3] < b[3]) ? 1.0f : 0.0f;
+            for (int i = 0; i < 4; i++)
+                for (int l = 0; l < lanes; l++)
+                    output[i][l] = (a[i][l] < b[i][l]) ? 1.0f : 0.0f;
             break;
             
         case VectorOp::SGE:
             // Set Greater or Equal
-            output[0] = (a[0] >= b[0]) ? 1.0f : 0.0f;
-            output[1] = (a[1] >= b[1]) ? 1.0f : 0.0f;
-            output[2] = (a[2] >= b[2]) ? 1.0f : 0.0f;
-            output[3] = (a[3] >= b[3]) ? 1.0f : 0.0f;
-            break;
-            
-        case VectorOp::ARL:
-            // Address Register Load
-            output[0] = floor(a[0]);
+            for (int i = 0; i < 4; i++)
+                for (int l = 0; l < lanes; l++)
+                    output[i][l] = (a[i][l] >= b[i][l]) ? 1.0f : 0.0f;
             break;
     }
 }
@@ -2403,30 +3097,11 @@ void GeForce3::ComputeScalarOperation(float* output, ScalarOp op, const float* a
     }
 }
 
-void GeForce3::AssignToRegister(int index, const float* value, int mask)
-{
-    for (int i = 0; i < 4; i++) {
-        if (mask & (8 >> i)) {
-            m_vertexProgram.registers[index].fv[i] = value[i];
-        }
-    }
-}
-
-void GeForce3::AssignToOutput(int index, const float* value, int mask)
-{
-    for (int i = 0; i < 4; i++) {
-        if (mask & (8 >> i)) {
-            m_vertexOutput->attribute[index].fv[i] = value[i];
-        }
-    }
-}
-
-void GeForce3::AssignToConstant(int index, const float* value, int mask)
+void GeForce3::AssignToLanes(float destination[4][VERTEX_PROGRAM_LANES], const float value[4][VERTEX_PROGRAM_LANES], int mask)
 {
     for (int i = 0; i < 4; i++) {
-        if (mask & (8 >> i)) {
-            m_vertexProgram.constants[index].fv[i] = value[i];
-        }
+        if (mask & (8 >> i))
+            memcpy(destination[i], value[i], sizeof(destination[i]));
     }
 }
 
@@ -2439,6 +3114,8 @@ void GeForce3::PerformBlit()
         return;
     }
     
+    ResolveClears();
+    
     // Get pointers to source and destination
     uint32_t* srcRow = (uint32_t*)DirectAccessPtr(m_bitBlit.sourceAddress + 
                                                  m_bitBlit.sourcePitch * m_bitBlit.sourceY + 
@@ -2447,6 +3124,13 @@ void GeForce3::PerformBlit()
                                                   m_bitBlit.destinationPitch * m_bitBlit.destY + 
                                                   m_bitBlit.destX * 4);
     
+    if (m_bitBlit.width > 0 && m_bitBlit.height > 0) {
+        TraceConsume(m_bitBlit.sourceAddress + m_bitBlit.sourcePitch * m_bitBlit.sourceY + m_bitBlit.sourceX * 4,
+                     m_bitBlit.sourcePitch * (m_bitBlit.height - 1) + m_bitBlit.width * 4);
+        MemoryWritten(m_bitBlit.destinationAddress + m_bitBlit.destinationPitch * m_bitBlit.destY + m_bitBlit.destX * 4,
+                      m_bitBlit.destinationPitch * (m_bitBlit.height - 1) + m_bitBlit.width * 4);
+    }
+    
     // Perform the blit operation
     for (int y = 0; y < m_bitBlit.height; y++) {
         uint32_t* src = srcRow;
@@ -2468,11 +3152,21 @@ void GeForce3::AssemblePrimitive(int source, int count)
 {
     uint32_t primitivesCount = m_primitivesCount;
     
-    for (; count > 0; count--) {
-        VertexNV* v = &m_vertexSoftware[source];
+    // Run the vertex program over all new vertices at once
+    bool transformed = false;
+    if (m_vertexPipeline != 4 && count > 1 && count <= 256) {
+        const VertexNV* inputs[256];
+        for (int n = 0; n < count; n++)
+            inputs[n] = &m_vertexSoftware[(source + n) & 1023];
+        ExecuteVertexProgram(inputs, m_vertexBatchOutput, count);
+        transformed = true;
+    }
+    
+    for (int n = 0; count > 0; count--, n++) {
+        VertexNV* v = transformed ? &m_vertexBatchOutput[n] : &m_vertexSoftware[source];
         
         if (m_primitiveType == PrimitiveType::QUADS) {
-            ConvertVertices(v, m_vertexXY + ((m_vertexCount + m_vertexAccumulated) & 1023));
+            ConvertVertices(v, m_vertexXY + ((m_vertexCount + m_vertexAccumulated) & 1023), transformed);
             m_vertexAccumulated++;
             
             if (m_vertexAccumulated == 4) {
@@ -2490,11 +3184,10 @@ void GeForce3::AssemblePrimitive(int source, int count)
                                      m_vertexXY[m_vertexCount + 3]);
                                      
                 m_vertexCount = (m_vertexCount + 4) & 1023;
-                m_rasterizer->Wait();
             }
         }
         else if (m_primitiveType == PrimitiveType::TRIANGLES) {
-            ConvertVertices(v, m_vertexXY + ((m_vertexCount + m_vertexAccumulated) & 1023));
+            ConvertVertices(v, m_vertexXY + ((m_vertexCount + m_vertexAccumulated) & 1023), transformed);
             m_vertexAccumulated++;
             
             if (m_vertexAccumulated == 3) {
@@ -2507,22 +3200,21 @@ void GeForce3::AssemblePrimitive(int source, int count)
                                      m_vertexXY[(m_vertexCount + 2) & 1023]);
                                      
                 m_vertexCount = (m_vertexCount + 3) & 1023;
-                m_rasterizer->Wait();
             }
         }
         else if (m_primitiveType == PrimitiveType::TRIANGLE_FAN) {
             if (m_vertexAccumulated == 0) {
-                ConvertVertices(v, m_vertexXY + 1024);
+                ConvertVertices(v, m_vertexXY + 1024, transformed);
                 m_vertexAccumulated = 1;
             }
             else if (m_vertexAccumulated == 1) {
-                ConvertVertices(v, m_vertexXY);
+                ConvertVertices(v, m_vertexXY, transformed);
                 m_vertexAccumulated = 2;
                 m_vertexCount = 1;
             }
             else {
                 m_primitivesCount++;
-                ConvertVertices(v, m_vertexXY + m_vertexCount);
+                ConvertVertices(v, m_vertexXY + m_vertexCount, transformed);
                 
                 RenderTriangleClipping(m_renderTargetLimits,
                                      m_vertexXY[1024],
@@ -2530,22 +3222,21 @@ void GeForce3::AssemblePrimitive(int source, int count)
                                      m_vertexXY[m_vertexCount]);
                                      
                 m_vertexCount = (m_vertexCount + 1) & 1023;
-                m_rasterizer->Wait();
             }
         }
         else if (m_primitiveType == PrimitiveType::TRIANGLE_STRIP) {
             if (m_vertexAccumulated == 0) {
-                ConvertVertices(v, m_vertexXY);
+                ConvertVertices(v, m_vertexXY, transformed);
                 m_vertexAccumulated = 1;
             }
             else if (m_vertexAccumulated == 1) {
-                ConvertVertices(v, m_vertexXY + 1);
+                ConvertVertices(v, m_vertexXY + 1, transformed);
                 m_vertexAccumulated = 2;
                 m_vertexCount = 2;
             }
             else {
                 m_primitivesCount++;
-                ConvertVertices(v, m_vertexXY + m_vertexCount);
+                ConvertVertices(v, m_vertexXY + m_vertexCount, transformed);
                 
                 if ((m_vertexCount & 1) == 0) {
                     RenderTriangleClipping(m_renderTargetLimits,
@@ -2561,21 +3252,20 @@ void GeForce3::AssemblePrimitive(int source, int count)
                 }
                 
                 m_vertexCount = (m_vertexCount + 1) & 1023;
-                m_rasterizer->Wait();
             }
         }
         else if (m_primitiveType == PrimitiveType::QUAD_STRIP) {
             if (m_vertexAccumulated == 0) {
-                ConvertVertices(v, m_vertexXY);
+                ConvertVertices(v, m_vertexXY, transformed);
                 m_vertexAccumulated = 1;
             }
             else if (m_vertexAccumulated == 1) {
-                ConvertVertices(v, m_vertexXY + 1);
+                ConvertVertices(v, m_vertexXY + 1, transformed);
                 m_vertexAccumulated = 2;
                 m_vertexCount = 0;
             }
             else {
-                ConvertVertices(v, m_vertexXY + ((m_vertexCount + m_vertexAccumulated) & 1023));
+                ConvertVertices(v, m_vertexXY + ((m_vertexCount + m_vertexAccumulated) & 1023), transformed);
                 m_vertexAccumulated++;
                 
                 if (m_vertexAccumulated == 4) {
@@ -2593,7 +3283,6 @@ void GeForce3::AssemblePrimitive(int source, int count)
                                          
                     m_vertexAccumulated = 2;
                     m_vertexCount = (m_vertexCount + 2) & 1023;
-                    m_rasterizer->Wait();
                 }
             }
         }
@@ -2604,7 +3293,7 @@ void GeForce3::AssemblePrimitive(int source, int count)
     m_primitivesBatchCount += m_primitivesCount - primitivesCount;
 }
 
-void GeForce3::ConvertVertices(VertexNV* source, NV2AVertex_t* destination)
+void GeForce3::ConvertVertices(VertexNV* source, NV2AVertex_t* destination, bool transformed)
 {
     if (m_vertexPipeline == 4) {
         // Transformation matrices pipeline
@@ -2650,12 +3339,14 @@ void GeForce3::ConvertVertices(VertexNV* source, NV2AVertex_t* destination)
     }
     else {
         // Vertex program pipeline
-        // Set input and output vertex data
-        m_vertexInput = source;
-        m_vertexOutput = &m_vertexTemp;
-        
-        // Execute the vertex program
-        ExecuteVertexProgram();
+        if (transformed) {
+            // The vertex program already ran for this vertex
+            m_vertexOutput = source;
+        } else {
+            const VertexNV* input = source;
+            ExecuteVertexProgram(&input, &m_vertexTemp, 1);
+            m_vertexOutput = &m_vertexTemp;
+        }
         
         // Copy data for rendering
         destination->w = m_vertexOutput->attribute[0].fv[3];
@@ -2721,25 +3412,12 @@ void GeForce3::ReadDMAObject(uint32_t handle, uint32_t& offset, uint32_t& size)
 
 uint32_t GeForce3::GetTexel(int texUnit, int x, int y)
 {
-    uint32_t offset;
-    uint32_t color;
-    uint16_t a4r4g4b4, a1r5g5b5, r5g6b5;
-    int blockX, blockY;
-    int color0, color1, color0m2, color1m2, alpha0, alpha1;
-    uint32_t codes;
-    uint64_t alphas;
-    int cr, cg, cb;
-    int sizeU, sizeV;
+    const DecodedTexture* texture = m_texture[texUnit].decoded;
+    if (!texture)
+        return 0xFF00FF00; // Magenta as "not implemented"
     
-    // Get texture dimensions
-    if (!m_texture[texUnit].rectangular) {
-        sizeU = m_texture[texUnit].sizeS;
-        sizeV = m_texture[texUnit].sizeT;
-    }
-    else {
-        sizeU = m_texture[texUnit].rectWidth;
-        sizeV = m_texture[texUnit].rectHeight;
-    }
+    int sizeU = texture->width;
+    int sizeV = texture->height;
     
     // Apply texture addressing modes
     switch (m_texture[texUnit].addrModeS) {
@@ -2774,96 +3452,378 @@ uint32_t GeForce3::GetTexel(int texUnit, int x, int y)
             break;
     }
     
+    return texture->texels[y * sizeU + x];
+}
+
+// Decode texel (x, y) of a texture straight from guest memory
+uint32_t GeForce3::DecodeTexel(const TextureState& texture, int x, int y)
+{
+    uint32_t offset;
+    uint32_t color;
+    uint16_t a4r4g4b4, a1r5g5b5, r5g6b5;
+    
     // Sample texture based on format
-    switch (m_texture[texUnit].format) {
+    switch (texture.format) {
         case TexFormat::A8R8G8B8:
-            offset = Dilate0(x, m_texture[texUnit].dilate) + 
-                     Dilate1(y, m_texture[texUnit].dilate);
-            return *((uint32_t*)m_texture[texUnit].buffer + offset);
+            offset = Dilate0(x, texture.dilate) + 
+                     Dilate1(y, texture.dilate);
+            return *((uint32_t*)texture.buffer + offset);
             
         case TexFormat::X8R8G8B8:
-            offset = Dilate0(x, m_texture[texUnit].dilate) + 
-                     Dilate1(y, m_texture[texUnit].dilate);
-            return 0xFF000000 | (*((uint32_t*)m_texture[texUnit].buffer + offset) & 0xFFFFFF);
-            
-        case TexFormat::DXT1:
-            blockX = x >> 2;
-            blockY = y >> 2;
-            x = x & 3;
-            y = y & 3;
-            offset = blockX + blockY * (sizeU >> 2);
-            
-            color0 = *((uint16_t*)(((uint64_t*)m_texture[texUnit].buffer) + offset) + 0);
-            color1 = *((uint16_t*)(((uint64_t*)m_texture[texUnit].buffer) + offset) + 1);
-            codes = *((uint32_t*)(((uint64_t*)m_texture[texUnit].buffer) + offset) + 1);
-            
-            int s = (y << 3) + (x << 1);
-            int c = (codes >> s) & 3;
-            c = c + (color0 > color1 ? 0 : 4);
-            color0m2 = color0 << 1;
-            color1m2 = color1 << 1;
-            
-            switch (c) {
-                case 0:
-                    return 0xFF000000 + ConvertR5G6B5ToRGB8(color0);
-                case 1:
-                    return 0xFF000000 + ConvertR5G6B5ToRGB8(color1);
-                case 2:
-                    cb = Pal5bit(((color0m2 & 0x003E) + (color1 & 0x001F)) / 3);
-                    cg = Pal6bit(((color0m2 & 0x0FC0) + (color1 & 0x07E0)) / 3 >> 5);
-                    cr = Pal5bit(((color0m2 & 0x1F000) + color1) / 3 >> 11);
-                    return 0xFF000000 | (cr << 16) | (cg << 8) | cb;
-                case 3:
-                    cb = Pal5bit(((color1m2 & 0x003E) + (color0 & 0x001F)) / 3);
-                    cg = Pal6bit(((color1m2 & 0x0FC0) + (color0 & 0x07E0)) / 3 >> 5);
-                    cr = Pal5bit(((color1m2 & 0x1F000) + color0) / 3 >> 11);
-                    return 0xFF000000 | (cr << 16) | (cg << 8) | cb;
-                case 4:
-                    return 0xFF000000 + ConvertR5G6B5ToRGB8(color0);
-                case 5:
-                    return 0xFF000000 + ConvertR5G6B5ToRGB8(color1);
-                case 6:
-                    cb = Pal5bit(((color0 & 0x001F) + (color1 & 0x001F)) / 2);
-                    cg = Pal6bit(((color0 & 0x07E0) + (color1 & 0x07E0)) / 2 >> 5);
-                    cr = Pal5bit(((color0 & 0xF800) + (color1 & 0xF800)) / 2 >> 11);
-                    return 0xFF000000 | (cr << 16) | (cg << 8) | cb;
-                default:
-                    return 0xFF000000;
-            }
+            offset = Dilate0(x, texture.dilate) + 
+                     Dilate1(y, texture.dilate);
+            return 0xFF000000 | (*((uint32_t*)texture.buffer + offset) & 0xFFFFFF);
             
         case TexFormat::A4R4G4B4:
-            offset = Dilate0(x, m_texture[texUnit].dilate) + 
-                     Dilate1(y, m_texture[texUnit].dilate);
-            a4r4g4b4 = *(((uint16_t*)m_texture[texUnit].buffer) + offset);
+            offset = Dilate0(x, texture.dilate) + 
+                     Dilate1(y, texture.dilate);
+            a4r4g4b4 = *(((uint16_t*)texture.buffer) + offset);
             return ConvertA4R4G4B4ToARGB8(a4r4g4b4);
             
         case TexFormat::A8:
-            offset = Dilate0(x, m_texture[texUnit].dilate) + 
-                     Dilate1(y, m_texture[texUnit].dilate);
-            color = *(((uint8_t*)m_texture[texUnit].buffer) + offset);
+            offset = Dilate0(x, texture.dilate) + 
+                     Dilate1(y, texture.dilate);
+            color = *(((uint8_t*)texture.buffer) + offset);
             return color << 24;
             
         case TexFormat::A1R5G5B5:
-            offset = Dilate0(x, m_texture[texUnit].dilate) + 
-                     Dilate1(y, m_texture[texUnit].dilate);
-            a1r5g5b5 = *(((uint16_t*)m_texture[texUnit].buffer) + offset);
+            offset = Dilate0(x, texture.dilate) + 
+                     Dilate1(y, texture.dilate);
+            a1r5g5b5 = *(((uint16_t*)texture.buffer) + offset);
             return ConvertA1R5G5B5ToARGB8(a1r5g5b5);
             
         case TexFormat::R5G6B5:
-            offset = Dilate0(x, m_texture[texUnit].dilate) + 
-                     Dilate1(y, m_texture[texUnit].dilate);
-            r5g6b5 = *(((uint16_t*)m_texture[texUnit].buffer) + offset);
+            offset = Dilate0(x, texture.dilate) + 
+                     Dilate1(y, texture.dilate);
+            r5g6b5 = *(((uint16_t*)texture.buffer) + offset);
             return 0xFF000000 + ConvertR5G6B5ToRGB8(r5g6b5);
             
         case TexFormat::A8R8G8B8_RECT:
-            offset = m_texture[texUnit].rectanglePitch * y + (x << 2);
-            return *((uint32_t*)(((uint8_t*)m_texture[texUnit].buffer) + offset));
+            offset = texture.rectanglePitch * y + (x << 2);
+            return *((uint32_t*)(((uint8_t*)texture.buffer) + offset));
             
         default:
             return 0xFF00FF00; // Magenta as "not implemented"
     }
 }
 
+size_t GeForce3::TextureCacheKeyHash::operator()(const TextureCacheKey& key) const
+{
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(&key);
+    size_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(key) / sizeof(uint32_t); i++) {
+        hash = (hash ^ words[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Bytes of guest memory the decode of a texture reads, 0 if it reads none
+uint32_t GeForce3::TextureBytes(const TextureCacheKey& key)
+{
+    uint32_t texels = static_cast<uint32_t>(key.width) * key.height;
+    
+    switch (key.format) {
+        case TexFormat::A8R8G8B8:
+        case TexFormat::X8R8G8B8:
+            return texels * 4;
+            
+        case TexFormat::DXT1:
+            return GeForce3Dxt::ImageBytes(GeForce3Dxt::Format::DXT1, key.width, key.height);
+            
+        case TexFormat::DXT3:
+            return GeForce3Dxt::ImageBytes(GeForce3Dxt::Format::DXT3, key.width, key.height);
+            
+        case TexFormat::DXT5:
+            return GeForce3Dxt::ImageBytes(GeForce3Dxt::Format::DXT5, key.width, key.height);
+            
+        case TexFormat::A4R4G4B4:
+        case TexFormat::A1R5G5B5:
+        case TexFormat::R5G6B5:
+            return texels * 2;
+            
+        case TexFormat::A8:
+            return texels;
+            
+        case TexFormat::A8R8G8B8_RECT:
+            return static_cast<uint32_t>(key.pitch) * (key.height - 1) + key.width * 4;
+            
+        default:
+            return 0;
+    }
+}
+
+// Bind the decoded textures the current render callback samples
+void GeForce3::BindTextures()
+{
+    const DecodedTexture* decoded[4];
+    
+    // Queued triangles may still sample the textures about to be dropped
+    if (m_textureCacheBytes > TEXTURE_CACHE_LIMIT) {
+        m_rasterizer->Wait();
+        for (int n = 0; n < 4; n++)
+            m_texture[n].decoded = nullptr;
+        ClearTextureCache();
+    }
+    
+    for (int n = 0; n < 4; n++) {
+        bool used = m_combinerEnabled ? m_texture[n].mode == 1 : (n == 0 && m_texture[0].enabled);
+        decoded[n] = used ? LookupTexture(m_texture[n]) : nullptr;
+    }
+    
+    for (int n = 0; n < 4; n++) {
+        if (m_texture[n].decoded != decoded[n]) {
+            m_rasterizer->Wait();
+            m_texture[n].decoded = decoded[n];
+        }
+    }
+}
+
+// Find or decode a texture, decoding it again if guest memory under it changed
+const GeForce3::DecodedTexture* GeForce3::LookupTexture(const TextureState& texture)
+{
+    TextureCacheKey key;
+    memset(&key, 0, sizeof(key));
+    
+    if (!texture.buffer || !m_ramBase)
+        return nullptr;
+    
+    key.address = static_cast<uint32_t>(static_cast<const uint8_t*>(texture.buffer) - m_ramBase);
+    key.format = texture.format;
+    key.dilate = texture.dilate;
+    if (!texture.rectangular) {
+        key.width = texture.sizeS;
+        key.height = texture.sizeT;
+    } else {
+        key.width = texture.rectWidth;
+        key.height = texture.rectHeight;
+        key.pitch = texture.rectanglePitch;
+    }
+    
+    if (key.width <= 0 || key.height <= 0)
+        return nullptr;
+    
+    CollectCpuWrites();
+    bool checksummed = !CpuWritesReported();
+    
+    auto it = m_textureCache.find(key);
+    if (it == m_textureCache.end()) {
+        it = m_textureCache.emplace(key, DecodedTexture()).first;
+        DecodedTexture& decoded = it->second;
+        uint32_t bytes = TextureBytes(key);
+        decoded.firstPage = key.address >> RAM_PAGE_SHIFT;
+        decoded.lastPage = (key.address + std::max<uint32_t>(bytes, 1) - 1) >> RAM_PAGE_SHIFT;
+        if (m_memory)
+            m_memory->watchWrites(m_memoryAddress + (decoded.firstPage << RAM_PAGE_SHIFT),
+                                  (decoded.lastPage - decoded.firstPage + 1) << RAM_PAGE_SHIFT);
+        TraceConsume(key.address, bytes);
+        DecodeTexture(texture, decoded);
+        decoded.checksum = checksummed ? TextureChecksum(key) : 0;
+        m_textureCacheBytes += decoded.texels.size() * sizeof(uint32_t);
+        LOG("Texture cache %zu: %dx%d format %02X at %08X\n", m_textureCache.size(), key.width, key.height,
+            static_cast<int>(key.format), key.address);
+        return &decoded;
+    }
+    
+    // Pages written since the texture was decoded; skip the scan if
+    // nothing was written since the last check
+    DecodedTexture& decoded = it->second;
+    bool stale = false;
+    if (decoded.checkedWrites != m_ramWrites) {
+        for (uint32_t page = decoded.firstPage; page <= decoded.lastPage && page < m_ramPageEpoch.size(); page++) {
+            if (m_ramPageEpoch[page] >= decoded.epoch) {
+                stale = true;
+                break;
+            }
+        }
+    }
+    
+    // Writes nobody reported only show in the data itself
+    if (!stale && checksummed)
+        stale = TextureChecksum(key) != decoded.checksum;
+    
+    if (stale) {
+        TraceConsume(key.address, TextureBytes(key));
+        DecodeTexture(texture, decoded);
+        decoded.checksum = checksummed ? TextureChecksum(key) : 0;
+        return &decoded;
+    }
+    
+    decoded.checkedWrites = m_ramWrites;
+    return &decoded;
+}
+
+// Hash of the guest memory a texture is decoded from
+uint64_t GeForce3::TextureChecksum(const TextureCacheKey& key) const
+{
+    uint32_t bytes = std::min(TextureBytes(key), m_ramSize - std::min(key.address, m_ramSize));
+    const uint8_t* data = m_ramBase + key.address;
+    uint64_t hash = 14695981039346656037ull;
+    uint32_t i = 0;
+    
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (; i < bytes; i++)
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    return hash;
+}
+
+// Drop every decoded texture and the write watches they hold
+void GeForce3::ClearTextureCache()
+{
+    if (m_memory) {
+        for (const auto& entry : m_textureCache) {
+            const DecodedTexture& decoded = entry.second;
+            m_memory->unwatchWrites(m_memoryAddress + (decoded.firstPage << RAM_PAGE_SHIFT),
+                                    (decoded.lastPage - decoded.firstPage + 1) << RAM_PAGE_SHIFT);
+        }
+    }
+    m_textureCache.clear();
+    m_textureCacheBytes = 0;
+}
+
+void GeForce3::DecodeTexture(const TextureState& texture, DecodedTexture& decoded)
+{
+    // Triangles queued earlier may still be rendering into the source
+    m_rasterizer->Wait();
+    ResolveClears();
+    
+    int sizeU = texture.rectangular ? texture.rectWidth : texture.sizeS;
+    int sizeV = texture.rectangular ? texture.rectHeight : texture.sizeT;
+    
+    decoded.width = sizeU;
+    decoded.height = sizeV;
+    decoded.texels.resize(static_cast<size_t>(sizeU) * sizeV);
+    
+    const uint8_t* source = static_cast<const uint8_t*>(texture.buffer);
+    uint32_t* texel = decoded.texels.data();
+    switch (texture.format) {
+        // Compressed textures are expanded a block at a time
+        case TexFormat::DXT1:
+            GeForce3Dxt::DecodeImage(GeForce3Dxt::Format::DXT1, source, sizeU, sizeV, texel);
+            break;
+            
+        case TexFormat::DXT3:
+            GeForce3Dxt::DecodeImage(GeForce3Dxt::Format::DXT3, source, sizeU, sizeV, texel);
+            break;
+            
+        case TexFormat::DXT5:
+            GeForce3Dxt::DecodeImage(GeForce3Dxt::Format::DXT5, source, sizeU, sizeV, texel);
+            break;
+            
+        default:
+            for (int y = 0; y < sizeV; y++) {
+                for (int x = 0; x < sizeU; x++)
+                    *texel++ = DecodeTexel(texture, x, y);
+            }
+            break;
+    }
+    
+    // Writes from now on land in a later epoch than the decode
+    decoded.epoch = ++m_textureEpoch;
+    decoded.checkedWrites = m_ramWrites;
+}
+
+void GeForce3::NotifyMemoryWrite(uint32_t offset, uint32_t size)
+{
+    // No GPU lock: callers may hold the MemoryManager lock, which the GPU
+    // takes after its own. The pages are folded in by CollectCpuWrites()
+    if (size == 0 || offset >= m_ramSize || !m_cpuDirtyPages || t_reportingGpuWrite)
+        return;
+    
+    uint32_t first = offset >> RAM_PAGE_SHIFT;
+    uint32_t last = static_cast<uint32_t>((std::min<uint64_t>(static_cast<uint64_t>(offset) + size, m_ramSize) - 1)
+                                          >> RAM_PAGE_SHIFT);
+    for (uint32_t page = first; page <= last; page++)
+        m_cpuDirtyPages[page].store(1, std::memory_order_relaxed);
+    m_cpuWritesPending.store(true, std::memory_order_release);
+}
+
+void GeForce3::SetCpuWritesReported(bool reported)
+{
+    std::unique_lock<std::mutex> lock = LockGPU();
+    m_cpuWritesReported = reported;
+}
+
+// True if CPU writes to the RAM reach NotifyMemoryWrite()
+bool GeForce3::CpuWritesReported() const
+{
+    return m_cpuWritesReported || (m_memory && m_memory->hasCodePageWatcher());
+}
+
+// Move pages NotifyMemoryWrite() flagged into the write epochs
+void GeForce3::CollectCpuWrites()
+{
+    if (!m_cpuWritesPending.exchange(false, std::memory_order_acquire))
+        return;
+    
+    for (size_t page = 0; page < m_ramPageEpoch.size(); page++) {
+        if (m_cpuDirtyPages[page].load(std::memory_order_relaxed) &&
+            m_cpuDirtyPages[page].exchange(0, std::memory_order_relaxed))
+            m_ramPageEpoch[page] = m_textureEpoch;
+    }
+    m_ramWrites++;
+}
+
+void GeForce3::MarkMemoryDirty(uint32_t offset, uint32_t size)
+{
+    if (size == 0 || offset >= m_ramSize)
+        return;
+    
+    uint32_t first = offset >> RAM_PAGE_SHIFT;
+    uint32_t last = static_cast<uint32_t>((std::min<uint64_t>(static_cast<uint64_t>(offset) + size, m_ramSize) - 1)
+                                          >> RAM_PAGE_SHIFT);
+    for (uint32_t page = first; page <= last; page++)
+        m_ramPageEpoch[page] = m_textureEpoch;
+    m_ramWrites++;
+}
+
+// Record a write of the GPU itself to RAM
+void GeForce3::MemoryWritten(uint32_t offset, uint32_t size)
+{
+    MarkMemoryDirty(offset, size);
+    TraceWritten(offset, size);
+    
+    if (m_ramWriteCallback && size != 0 && offset < m_ramSize) {
+        t_reportingGpuWrite = true;
+        m_ramWriteCallback(offset, std::min(size, m_ramSize - offset));
+        t_reportingGpuWrite = false;
+    }
+}
+
+// Record that queued or finished rendering writes the color and depth buffers
+void GeForce3::MarkRenderTargetDirty()
+{
+    // Depth written by rendering is already in the hierarchical Z tiles;
+    // other writes and color buffers overlapping the depth buffer are not
+    bool keepHiZ = m_hiZ.valid && HierarchicalZMatches() && !HierarchicalZWritten();
+    if (keepHiZ && m_renderTarget && m_hiZ.buffer) {
+        const uint8_t* color = reinterpret_cast<const uint8_t*>(m_renderTarget);
+        const uint8_t* depth = reinterpret_cast<const uint8_t*>(m_hiZ.buffer);
+        keepHiZ = color + m_renderTargetSize <= depth || depth + m_hiZ.size <= color;
+    }
+    
+    if (m_renderTarget) {
+        uint32_t offset = static_cast<uint32_t>(reinterpret_cast<uint8_t*>(m_renderTarget) - m_ramBase);
+        MemoryWritten(offset, m_renderTargetSize);
+    }
+    if (m_depthBuffer) {
+        uint32_t offset = static_cast<uint32_t>(reinterpret_cast<uint8_t*>(m_depthBuffer) - m_ramBase);
+        MemoryWritten(offset, m_depthBufferSize);
+    }
+    
+    if (keepHiZ) {
+        m_hiZ.epoch = ++m_textureEpoch;
+        m_hiZ.checkedWrites = m_ramWrites;
+    } else if (m_hiZ.valid) {
+        // Queued triangles may still be widening the tiles
+        m_rasterizer->Wait();
+        m_hiZ.valid = false;
+    }
+}
+
 uint32_t GeForce3::ConvertA4R4G4B4ToARGB8(uint32_t a4r4g4b4)
 {
     uint32_t a8r8g8b8;
@@ -3146,7 +4106,7 @@ uint32_t GeForce3::RenderTriangleCulling(const Rectangle& cliprect, NV2AVertex_t
     if (!m_backfaceCullingEnabled)
         return m_rasterizer->RenderTriangle<(int)VertexParameter::ALL>(cliprect, 
                                                                      m_renderCallback, 
-                                                                     static_cast<void*>(this),
+                                                                     static_cast<void*>(m_combinerContext),
                                                                      v1, v2, v3);
     
     // If culling front and back, discard the triangle
@@ -3176,7 +4136,7 @@ uint32_t GeForce3::RenderTriangleCulling(const Rectangle& cliprect, NV2AVertex_t
         (face == CullingFace::BACK && m_backfaceCullingFace == CullingFace::FRONT)) {
         return m_rasterizer->RenderTriangle<(int)VertexParameter::ALL>(cliprect, 
                                                                      m_renderCallback, 
-                                                                     static_cast<void*>(this), 
+                                                                     static_cast<void*>(m_combinerContext), 
                                                                      v1, v2, v3);
     }
     
@@ -3187,9 +4147,7 @@ uint32_t GeForce3::RenderTriangleCulling(const Rectangle& cliprect, NV2AVertex_t
 
 void GeForce3::RenderColor(int32_t scanline, const RasterizerExtent_t& extent, void* objectData, int threadId)
 {
-    int x, lastX;
-    
-    lastX = m_renderTargetLimits.right();
+    int lastX = m_renderTargetLimits.right();
     int startX = extent.startx;
     int stopX = extent.stopx;
     
@@ -3203,53 +4161,30 @@ void GeForce3::RenderColor(int32_t scanline, const RasterizerExtent_t& extent, v
     if (stopX > lastX)
         numPixels = numPixels - (stopX - lastX - 1);
     
-    numPixels--;
-    x = numPixels;
+    // Depth, 1/W and perspective-correct color interpolants
+    GeForce3Spans::ColorSpan span;
+    span.zStart = extent.param[(int)VertexParameter::PARAM_Z].start;
+    span.zStep = extent.param[(int)VertexParameter::PARAM_Z].dpdx;
+    span.wStart = extent.param[(int)VertexParameter::PARAM_1W].start;
+    span.wStep = extent.param[(int)VertexParameter::PARAM_1W].dpdx;
+    for (int c = 0; c < 4; c++) {
+        span.colorStart[c] = extent.param[(int)VertexParameter::PARAM_COLOR_B + c].start;
+        span.colorStep[c] = extent.param[(int)VertexParameter::PARAM_COLOR_B + c].dpdx;
+    }
     
-    while (x >= 0) {
-        double zBuffer;
-        uint32_t a8r8g8b8;
-        int z;
-        int ca, cr, cg, cb;
-        int xPos = startX + x; // X coordinate of current pixel
-        
-        // Calculate depth value
-        z = static_cast<int>(extent.param[(int)VertexParameter::PARAM_Z].start + 
-                            (double)x * extent.param[(int)VertexParameter::PARAM_Z].dpdx);
-        
-        // Calculate 1/W value for perspective-correct interpolation
-        double wFactor = extent.param[(int)VertexParameter::PARAM_1W].start + 
-                        (double)x * extent.param[(int)VertexParameter::PARAM_1W].dpdx;
-        wFactor = 1.0f / wFactor;
-        
-        // Calculate color components with perspective correction
-        cb = std::clamp<int>(
-            (extent.param[(int)VertexParameter::PARAM_COLOR_B].start + 
-             (double)x * extent.param[(int)VertexParameter::PARAM_COLOR_B].dpdx) * wFactor * 255.0f,
-            0, 255);
-            
-        cg = std::clamp<int>(
-            (extent.param[(int)VertexParameter::PARAM_COLOR_G].start + 
-             (double)x * extent.param[(int)VertexParameter::PARAM_COLOR_G].dpdx) * wFactor * 255.0f,
-            0, 255);
-            
-        cr = std::clamp<int>(
-            (extent.param[(int)VertexParameter::PARAM_COLOR_R].start + 
-             (double)x * extent.param[(int)VertexParameter::PARAM_COLOR_R].dpdx) * wFactor * 255.0f,
-            0, 255);
-            
-        ca = std::clamp<int>(
-            (extent.param[(int)VertexParameter::PARAM_COLOR_A].start + 
-             (double)x * extent.param[(int)VertexParameter::PARAM_COLOR_A].dpdx) * wFactor * 255.0f,
-            0, 255);
-        
-        // Create final pixel color
-        a8r8g8b8 = (ca << 24) | (cr << 16) | (cg << 8) | cb;
+    uint32_t a8r8g8b8[GeForce3Spans::BLOCK_SIZE];
+    int32_t z[GeForce3Spans::BLOCK_SIZE];
+    
+    for (int first = 0; first < numPixels; first += GeForce3Spans::BLOCK_SIZE) {
+        int count = std::min(numPixels - first, GeForce3Spans::BLOCK_SIZE);
+        GeForce3Spans::ComputeColorSpan(span, first, count, a8r8g8b8, z);
         
-        // Write the pixel
-        WritePixel(xPos, scanline, a8r8g8b8, z);
+        // Gouraud colors cost less than a per-pixel depth test, so only
+        // hidden tiles are dropped here
+        if (!EarlyDepthTest(startX + first, scanline, count, z, nullptr))
+            continue;
         
-        x--;
+        WriteSpan(startX + first, scanline, count, a8r8g8b8, z);
     }
 }
 
@@ -3257,7 +4192,6 @@ void GeForce3::RenderTextureSimple(int32_t scanline, const RasterizerExtent_t& e
 {
     int sizeX, limitX;
     double mx, my;
-    uint32_t a8r8g8b8;
     
     // If texture is disabled, return
     if (!m_texture[0].enabled) {
@@ -3278,71 +4212,73 @@ void GeForce3::RenderTextureSimple(int32_t scanline, const RasterizerExtent_t& e
         my = m_texture[0].sizeT * 256;
     }
     
-    double zDepth = extent.param[(int)VertexParameter::PARAM_Z].start;
-    double wFactor = extent.param[(int)VertexParameter::PARAM_1W].start;
-    double sCoord = extent.param[(int)VertexParameter::PARAM_TEXTURE0_S].start;
-    double tCoord = extent.param[(int)VertexParameter::PARAM_TEXTURE0_T].start;
-    
-    for (int pos = 0; pos < sizeX; pos++) {
-        int xPos = extent.startx + pos; // X coordinate of current pixel
-        double w = 1.0f / wFactor;
-        
-        // Calculate texture coordinates with perspective correction
-        double s = sCoord * w;
-        double t = tCoord * w;
+    GeForce3Spans::TextureSpan span;
+    span.z = extent.param[(int)VertexParameter::PARAM_Z].start;
+    span.zStep = extent.param[(int)VertexParameter::PARAM_Z].dpdx;
+    span.w = extent.param[(int)VertexParameter::PARAM_1W].start;
+    span.wStep = extent.param[(int)VertexParameter::PARAM_1W].dpdx;
+    span.s = extent.param[(int)VertexParameter::PARAM_TEXTURE0_S].start;
+    span.sStep = extent.param[(int)VertexParameter::PARAM_TEXTURE0_S].dpdx;
+    span.t = extent.param[(int)VertexParameter::PARAM_TEXTURE0_T].start;
+    span.tStep = extent.param[(int)VertexParameter::PARAM_TEXTURE0_T].dpdx;
+    span.scaleS = mx;
+    span.scaleT = my;
+    
+    int32_t z[GeForce3Spans::BLOCK_SIZE];
+    int32_t s[GeForce3Spans::BLOCK_SIZE];
+    int32_t t[GeForce3Spans::BLOCK_SIZE];
+    uint32_t a8r8g8b8[GeForce3Spans::BLOCK_SIZE];
+    uint8_t pass[GeForce3Spans::BLOCK_SIZE];
+    
+    for (int first = 0; first < sizeX; first += GeForce3Spans::BLOCK_SIZE) {
+        int count = std::min(sizeX - first, GeForce3Spans::BLOCK_SIZE);
         
-        // Scale texture coordinates to texture space
-        s = s * mx;
-        t = t * my;
+        // Perspective-correct texel coordinates in 24.8 fixed point
+        GeForce3Spans::ComputeTextureSpan(span, count, z, s, t);
         
-        // Get Z value
-        int z = zDepth;
+        if (!EarlyDepthTest(extent.startx + first, scanline, count, z, pass))
+            continue;
         
-        // Calculate texel coordinates
-        int pixelX = static_cast<int>(s);
-        int pixelY = static_cast<int>(t);
-        int pixelXFrac = pixelX & 255;
-        int pixelYFrac = pixelY & 255;
-        pixelX >>= 8;
-        pixelY >>= 8;
-        
-        // Sample texture with or without bilinear filtering
-        if (m_bilinearFilter) {
-            uint32_t c00 = GetTexel(0, pixelX + 0, pixelY + 0);
-            uint32_t c01 = GetTexel(0, pixelX + 0, pixelY + 1);
-            uint32_t c10 = GetTexel(0, pixelX + 1, pixelY + 0);
-            uint32_t c11 = GetTexel(0, pixelX + 1, pixelY + 1);
-            
-            // Perform bilinear filtering
-            a8r8g8b8 = BilinearFilter(c00, c10, c01, c11, pixelXFrac, pixelYFrac);
-        } else {
-            a8r8g8b8 = GetTexel(0, pixelX, pixelY);
+        for (int i = 0; i < count; i++) {
+            // Hidden pixels are not sampled
+            if (!pass[i]) {
+                a8r8g8b8[i] = 0;
+                continue;
+            }
+            
+            int pixelX = s[i];
+            int pixelY = t[i];
+            int pixelXFrac = pixelX & 255;
+            int pixelYFrac = pixelY & 255;
+            pixelX >>= 8;
+            pixelY >>= 8;
+            
+            // Sample texture with or without bilinear filtering
+            if (m_bilinearFilter) {
+                uint32_t c00 = GetTexel(0, pixelX + 0, pixelY + 0);
+                uint32_t c01 = GetTexel(0, pixelX + 0, pixelY + 1);
+                uint32_t c10 = GetTexel(0, pixelX + 1, pixelY + 0);
+                uint32_t c11 = GetTexel(0, pixelX + 1, pixelY + 1);
+                
+                // Perform bilinear filtering
+                a8r8g8b8[i] = BilinearFilter(c00, c10, c01, c11, pixelXFrac, pixelYFrac);
+            } else {
+                a8r8g8b8[i] = GetTexel(0, pixelX, pixelY);
+            }
         }
         
-        // Write the pixel
-        WritePixel(xPos, scanline, a8r8g8b8, z);
-        
-        // Step for the next pixel
-        zDepth += extent.param[(int)VertexParameter::PARAM_Z].dpdx;
-        wFactor += extent.param[(int)VertexParameter::PARAM_1W].dpdx;
-        sCoord += extent.param[(int)VertexParameter::PARAM_TEXTURE0_S].dpdx;
-        tCoord += extent.param[(int)VertexParameter::PARAM_TEXTURE0_T].dpdx;
+        // Write the pixels
+        WriteSpan(extent.startx + first, scanline, count, a8r8g8b8, z);
     }
 }
 
 void GeForce3::RenderRegisterCombiners(int32_t scanline, const RasterizerExtent_t& extent, void* objectData, int threadId)
 {
     int sizeX, limitX;
-    float colorF[7][4];
     double mx[4], my[4];
     double sCoord[4], tCoord[4], rCoord[4], qCoord[4];
-    uint32_t colors[6];
     uint32_t finalColor;
     
-    // Initialize colors array
-    for (int i = 0; i < 6; i++)
-        colors[i] = 0;
-    
     // Calculate rendering limits
     limitX = m_renderTargetLimits.right();
     sizeX = extent.stopx - extent.startx;
@@ -3383,123 +4319,127 @@ void GeForce3::RenderRegisterCombiners(int32_t scanline, const RasterizerExtent_
     double zDepth = extent.param[(int)VertexParameter::PARAM_Z].start;
     double wFactor = extent.param[(int)VertexParameter::PARAM_1W].start;
     
-    // Process each pixel in the span
-    for (int pos = 0; pos < sizeX; pos++) {
-        int xPos = extent.startx + pos;
-        int z = zDepth;
-        double w = 1.0f / wFactor;
-        
-        // 1: Fetch data
-        // 1.1: Interpolated color from vertices
-        colorF[0][0] = c00 * w;
-        colorF[0][1] = c01 * w;
-        colorF[0][2] = c02 * w;
-        colorF[0][3] = c03 * w;
-        
-        colorF[1][0] = c10 * w;
-        colorF[1][1] = c11 * w;
-        colorF[1][2] = c12 * w;
-        colorF[1][3] = c13 * w;
+    const int primary = static_cast<int>(CombinerInputRegister::PRIMARY_COLOR);
+    const int secondary = static_cast<int>(CombinerInputRegister::SECONDARY_COLOR);
+    const int texture0 = static_cast<int>(CombinerInputRegister::TEXTURE0_COLOR);
+    const int spare0 = static_cast<int>(CombinerInputRegister::SPARE0);
+    
+    const CombinerContext& context = *static_cast<const CombinerContext*>(objectData);
+    CombinerBlock block;
+    int32_t z[GeForce3Spans::BLOCK_SIZE];
+    uint32_t a8r8g8b8[GeForce3Spans::BLOCK_SIZE];
+    uint8_t pass[GeForce3Spans::BLOCK_SIZE];
+    
+    for (int first = 0; first < sizeX; first += GeForce3Spans::BLOCK_SIZE) {
+        int count = std::min(sizeX - first, GeForce3Spans::BLOCK_SIZE);
         
-        // 1.2: Coordinates for each of the 4 possible textures
-        for (int n = 0; n < 4; n++) {
-            colorF[n + 2][0] = sCoord[n] * w;
-            colorF[n + 2][1] = tCoord[n] * w;
-            colorF[n + 2][2] = rCoord[n] * w;
-            colorF[n + 2][3] = qCoord[n] * w;
+        // 0: Depth of the block, for the early depth test
+        for (int i = 0; i < count; i++) {
+            z[i] = zDepth;
+            zDepth += extent.param[(int)VertexParameter::PARAM_Z].dpdx;
         }
+        bool visible = EarlyDepthTest(extent.startx + first, scanline, count, z, pass);
         
-        // 1.3: Fog
-        ConvertARGB8ToFloat(m_fogColor, colorF[6]);
-        colorF[6][3] = 1.0f; // Should it be from the vertex shader?
+        // Spare registers, EF and the color sum start at zero for every pixel
+        memset(block.registers[spare0], 0, sizeof(block.registers[0]) * (COMBINER_REGISTERS - spare0));
         
-        // 1.4: Colors from textures
-        for (int n = 0; n < 4; n++) {
-            if (m_texture[n].mode == 1) {
-                // Calculate texture coordinates
-                double s = colorF[n + 2][0] * mx[n];
-                double t = colorF[n + 2][1] * my[n];
-                int px = static_cast<int>(s);
-                int py = static_cast<int>(t);
-                int pxFrac = px & 255;
-                int pyFrac = py & 255;
-                px >>= 8;
-                py >>= 8;
+        // 1: Fetch data
+        for (int i = 0; i < count; i++) {
+            double w = 1.0f / wFactor;
+            
+            // 1.1: Interpolated color from vertices
+            block.registers[primary][0][i] = c00 * w;
+            block.registers[primary][1][i] = c01 * w;
+            block.registers[primary][2][i] = c02 * w;
+            block.registers[primary][3][i] = c03 * w;
+            
+            block.registers[secondary][0][i] = c10 * w;
+            block.registers[secondary][1][i] = c11 * w;
+            block.registers[secondary][2][i] = c12 * w;
+            block.registers[secondary][3][i] = c13 * w;
+            
+            // 1.2: Colors from textures
+            for (int n = 0; n < 4; n++) {
+                float colorF[4];
+                colorF[0] = sCoord[n] * w;
+                colorF[1] = tCoord[n] * w;
+                colorF[2] = rCoord[n] * w;
+                colorF[3] = qCoord[n] * w;
                 
-                // Sample the texture
-                if (m_bilinearFilter) {
-                    uint32_t c00 = GetTexel(n, px + 0, py + 0);
-                    uint32_t c01 = GetTexel(n, px + 0, py + 1);
-                    uint32_t c10 = GetTexel(n, px + 1, py + 0);
-                    uint32_t c11 = GetTexel(n, px + 1, py + 1);
+                if (m_texture[n].mode == 1 && pass[i]) {
+                    // Calculate texture coordinates
+                    double s = colorF[0] * mx[n];
+                    double t = colorF[1] * my[n];
+                    int px = static_cast<int>(s);
+                    int py = static_cast<int>(t);
+                    int pxFrac = px & 255;
+                    int pyFrac = py & 255;
+                    px >>= 8;
+                    py >>= 8;
+                    
+                    // Sample the texture
+                    if (m_bilinearFilter) {
+                        uint32_t c00 = GetTexel(n, px + 0, py + 0);
+                        uint32_t c01 = GetTexel(n, px + 0, py + 1);
+                        uint32_t c10 = GetTexel(n, px + 1, py + 0);
+                        uint32_t c11 = GetTexel(n, px + 1, py + 1);
+                        
+                        // Apply bilinear filtering
+                        finalColor = BilinearFilter(c00, c10, c01, c11, pxFrac, pyFrac);
+                    } else {
+                        finalColor = GetTexel(n, px, py);
+                    }
                     
-                    // Apply bilinear filtering
-                    finalColor = BilinearFilter(c00, c10, c01, c11, pxFrac, pyFrac);
+                    ConvertARGB8ToFloat(finalColor, colorF);
+                } else if (m_texture[n].mode == 4) {
+                    // Special handling for texture mode 4
+                    // Do nothing for now
                 } else {
-                    finalColor = GetTexel(n, px, py);
+                    // Default to black with alpha
+                    ConvertARGB8ToFloat(0xFF000000, colorF);
                 }
                 
-                ConvertARGB8ToFloat(finalColor, colorF[n + 2]);
-            } else if (m_texture[n].mode == 4) {
-                // Special handling for texture mode 4
-                // Do nothing for now
-            } else {
-                // Default to black with alpha
-                ConvertARGB8ToFloat(0xFF000000, colorF[n + 2]);
+                for (int c = 0; c < 4; c++)
+                    block.registers[texture0 + n][c][i] = colorF[c];
             }
-        }
-        
-        // 2: Compute
-        // 2.1: Initialize combiner registers
-        InitializeCombinerRegisters(threadId, colorF);
-        
-        // 2.2: Process general combiner stages
-        for (int n = 0; n < m_combiner.setup.stages; n++) {
-            // Initialize stage
-            InitializeCombinerStage(threadId, n);
             
-            // Map inputs
-            MapCombinerStageInput(threadId, n);
+            // Alpha of spare0 must be the alpha of the pixel from texture0
+            block.registers[spare0][3][i] = block.registers[texture0][3][i];
+            
+            // Step for the next pixel
+            wFactor += extent.param[(int)VertexParameter::PARAM_1W].dpdx;
             
-            // Compute outputs
-            ComputeRGBOutputs(threadId, n);
-            ComputeAlphaOutputs(threadId, n);
+            for (int n = 0; n < 4; n++) {
+                sCoord[n] += extent.param[(int)VertexParameter::PARAM_TEXTURE0_S + n * 4].dpdx;
+                tCoord[n] += extent.param[(int)VertexParameter::PARAM_TEXTURE0_T + n * 4].dpdx;
+                rCoord[n] += extent.param[(int)VertexParameter::PARAM_TEXTURE0_R + n * 4].dpdx;
+                qCoord[n] += extent.param[(int)VertexParameter::PARAM_TEXTURE0_Q + n * 4].dpdx;
+            }
+            
+            c00 += extent.param[(int)VertexParameter::PARAM_COLOR_R].dpdx;
+            c01 += extent.param[(int)VertexParameter::PARAM_COLOR_G].dpdx;
+            c02 += extent.param[(int)VertexParameter::PARAM_COLOR_B].dpdx;
+            c03 += extent.param[(int)VertexParameter::PARAM_COLOR_A].dpdx;
             
-            // Map outputs to registers
-            MapCombinerStageOutput(threadId, n);
+            c10 += extent.param[(int)VertexParameter::PARAM_SECONDARY_COLOR_R].dpdx;
+            c11 += extent.param[(int)VertexParameter::PARAM_SECONDARY_COLOR_G].dpdx;
+            c12 += extent.param[(int)VertexParameter::PARAM_SECONDARY_COLOR_B].dpdx;
+            c13 += extent.param[(int)VertexParameter::PARAM_SECONDARY_COLOR_A].dpdx;
         }
         
-        // 2.3: Process final combiner stage
-        InitializeFinalCombiner(threadId);
-        MapFinalCombinerInput(threadId);
-        FinalCombinerOutput(threadId);
-        
-        // Get the final color
-        finalColor = ConvertFloatToARGB8(m_combiner.work[threadId].output);
-        
-        // 3: Write pixel
-        WritePixel(xPos, scanline, finalColor, z);
+        // The interpolants are stepped past the block even if it is hidden
+        if (!visible)
+            continue;
         
-        // Step for the next pixel
-        zDepth += extent.param[(int)VertexParameter::PARAM_Z].dpdx;
-        wFactor += extent.param[(int)VertexParameter::PARAM_1W].dpdx;
+        // 2: Compute
+        RunCombinerProgram(context, block, count);
         
-        for (int n = 0; n < 4; n++) {
-            sCoord[n] += extent.param[(int)VertexParameter::PARAM_TEXTURE0_S + n * 4].dpdx;
-            tCoord[n] += extent.param[(int)VertexParameter::PARAM_TEXTURE0_T + n * 4].dpdx;
-            rCoord[n] += extent.param[(int)VertexParameter::PARAM_TEXTURE0_R + n * 4].dpdx;
-            qCoord[n] += extent.param[(int)VertexParameter::PARAM_TEXTURE0_Q + n * 4].dpdx;
+        // 3: Write pixels
+        for (int i = 0; i < count; i++) {
+            float output[4] = { block.output[0][i], block.output[1][i], block.output[2][i], block.output[3][i] };
+            a8r8g8b8[i] = ConvertFloatToARGB8(output);
         }
-        
-        c00 += extent.param[(int)VertexParameter::PARAM_COLOR_R].dpdx;
-        c01 += extent.param[(int)VertexParameter::PARAM_COLOR_G].dpdx;
-        c02 += extent.param[(int)VertexParameter::PARAM_COLOR_B].dpdx;
-        c03 += extent.param[(int)VertexParameter::PARAM_COLOR_A].dpdx;
-        
-        c10 += extent.param[(int)VertexParameter::PARAM_SECONDARY_COLOR_R].dpdx;
-        c11 += extent.param[(int)VertexParameter::PARAM_SECONDARY_COLOR_G].dpdx;
-        c12 += extent.param[(int)VertexParameter::PARAM_SECONDARY_COLOR_B].dpdx;
-        c13 += extent.param[(int)VertexParameter::PARAM_SECONDARY_COLOR_A].dpdx;
+        WriteSpan(extent.startx + first, scanline, count, a8r8g8b8, z);
     }
 }
 
@@ -3534,1456 +4474,1302 @@ float GeForce3::CombinerMapInputFunction(CombinerMapFunction code, float value)
     }
 }
 
-void GeForce3::CombinerMapInputFunctionArray(CombinerMapFunction code, float* data)
+void GeForce3::CombinerMapInputSpan(CombinerMapFunction code, float* data, int count)
 {
     switch (code) {
         case CombinerMapFunction::UNSIGNED_IDENTITY:
-            data[0] = std::max(0.0f, data[0]);
-            data[1] = std::max(0.0f, data[1]);
-            data[2] = std::max(0.0f, data[2]);
+            for (int i = 0; i < count; i++)
+                data[i] = std::max(0.0f, data[i]);
             break;
             
         case CombinerMapFunction::UNSIGNED_INVERT:
-            data[0] = 1.0f - std::clamp(data[0], 0.0f, 1.0f);
-            data[1] = 1.0f - std::clamp(data[1], 0.0f, 1.0f);
-            data[2] = 1.0f - std::clamp(data[2], 0.0f, 1.0f);
+            for (int i = 0; i < count; i++)
+                data[i] = 1.0f - std::clamp(data[i], 0.0f, 1.0f);
             break;
             
         case CombinerMapFunction::EXPAND_NORMAL:
-            data[0] = 2.0f * std::max(0.0f, data[0]) - 1.0f;
-            data[1] = 2.0f * std::max(0.0f, data[1]) - 1.0f;
-            data[2] = 2.0f * std::max(0.0f, data[2]) - 1.0f;
+            for (int i = 0; i < count; i++)
+                data[i] = 2.0f * std::max(0.0f, data[i]) - 1.0f;
             break;
             
         case CombinerMapFunction::EXPAND_NEGATE:
-            data[0] = -2.0f * std::max(0.0f, data[0]) + 1.0f;
-            data[1] = -2.0f * std::max(0.0f, data[1]) + 1.0f;
-            data[2] = -2.0f * std::max(0.0f, data[2]) + 1.0f;
+            for (int i = 0; i < count; i++)
+                data[i] = -2.0f * std::max(0.0f, data[i]) + 1.0f;
             break;
             
         case CombinerMapFunction::HALF_BIAS_NORMAL:
-            data[0] = std::max(0.0f, data[0]) - 0.5f;
-            data[1] = std::max(0.0f, data[1]) - 0.5f;
-            data[2] = std::max(0.0f, data[2]) - 0.5f;
+            for (int i = 0; i < count; i++)
+                data[i] = std::max(0.0f, data[i]) - 0.5f;
             break;
             
         case CombinerMapFunction::HALF_BIAS_NEGATE:
-            data[0] = -std::max(0.0f, data[0]) + 0.5f;
-            data[1] = -std::max(0.0f, data[1]) + 0.5f;
-            data[2] = -std::max(0.0f, data[2]) + 0.5f;
+            for (int i = 0; i < count; i++)
+                data[i] = -std::max(0.0f, data[i]) + 0.5f;
             break;
             
         case CombinerMapFunction::SIGNED_IDENTITY:
-            return;
+            break;
             
         case CombinerMapFunction::SIGNED_NEGATE:
         default:
-            data[0] = -data[0];
-            data[1] = -data[1];
-            data[2] = -data[2];
+            for (int i = 0; i < count; i++)
+                data[i] = -data[i];
             break;
     }
 }
 
-void GeForce3::InitializeCombinerRegisters(int threadId, float rgba[7][4])
+size_t GeForce3::CombinerProgramKeyHash::operator()(const CombinerProgramKey& key) const
 {
-    for (int n = 0; n < 4; n++) {
-        // Initialize main color registers
-        m_combiner.work[threadId].registers.primaryColor[n] = rgba[0][n];
-        m_combiner.work[threadId].registers.secondaryColor[n] = rgba[1][n];
-        m_combiner.work[threadId].registers.texture0Color[n] = rgba[2][n];
-        m_combiner.work[threadId].registers.texture1Color[n] = rgba[3][n];
-        m_combiner.work[threadId].registers.texture2Color[n] = rgba[4][n];
-        m_combiner.work[threadId].registers.texture3Color[n] = rgba[5][n];
-        m_combiner.work[threadId].registers.fogColor[n] = rgba[6][n];
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(&key);
+    size_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(key) / sizeof(uint32_t); i++) {
+        hash = (hash ^ words[i]) * 1099511628211ull;
     }
-    
-    // Alpha of spare0 must be the alpha of the pixel from texture0
-    m_combiner.work[threadId].registers.spare0[3] = m_combiner.work[threadId].registers.texture0Color[3];
-    
-    // Zero register
-    m_combiner.work[threadId].registers.zero[0] = 0.0f;
-    m_combiner.work[threadId].registers.zero[1] = 0.0f;
-    m_combiner.work[threadId].registers.zero[2] = 0.0f;
-    m_combiner.work[threadId].registers.zero[3] = 0.0f;
+    return hash;
 }
 
-void GeForce3::InitializeCombinerStage(int threadId, int stageNumber)
+void GeForce3::SelectCombinerProgram()
 {
-    int n = stageNumber;
-    
-    // Copy constant colors to color registers
-    for (int i = 0; i < 4; i++) {
-        m_combiner.work[threadId].registers.color0[i] = m_combiner.setup.stage[n].constantColor0[i];
-        m_combiner.work[threadId].registers.color1[i] = m_combiner.setup.stage[n].constantColor1[i];
+    CombinerProgramKey key;
+    memset(&key, 0, sizeof(key));
+    
+    // The stage count register has room for 15, the hardware has 8 stages.
+    // Constant colors are left out: they reach the program through the context
+    key.setup.stages = std::clamp(m_combiner.setup.stages, 0, 8);
+    for (int n = 0; n < key.setup.stages; n++) {
+        CombinerStage& stage = key.setup.stage[n];
+        stage.mapinAlpha = m_combiner.setup.stage[n].mapinAlpha;
+        stage.mapinRGB = m_combiner.setup.stage[n].mapinRGB;
+        stage.mapoutAlpha = m_combiner.setup.stage[n].mapoutAlpha;
+        stage.mapoutRGB = m_combiner.setup.stage[n].mapoutRGB;
+    }
+    key.setup.final.colorSumClamp = m_combiner.setup.final.colorSumClamp;
+    key.setup.final.mapinAlpha = m_combiner.setup.final.mapinAlpha;
+    key.setup.final.mapinRGB = m_combiner.setup.final.mapinRGB;
+    
+    auto it = m_combinerPrograms.find(key);
+    if (it == m_combinerPrograms.end()) {
+        // Flush a full cache; queued triangles may still run its programs
+        if (m_combinerPrograms.size() >= MAX_COMBINER_PROGRAMS) {
+            m_rasterizer->Wait();
+            m_combinerPrograms.clear();
+            m_combinerContexts.clear();
+            m_combinerContext = nullptr;
+        }
+        
+        CombinerProgram program;
+        CompileCombinerProgram(key, program);
+        it = m_combinerPrograms.emplace(key, std::move(program)).first;
+        LOG("Combiner program %zu: %d stages, %zu ops\n", m_combinerPrograms.size(), key.setup.stages,
+            it->second.ops.size());
     }
+    
+    UpdateCombinerContext(&it->second);
 }
 
-void GeForce3::InitializeFinalCombiner(int threadId)
+void GeForce3::UpdateCombinerContext(const CombinerProgram* program)
 {
-    // Copy constant colors to color registers
-    for (int i = 0; i < 4; i++) {
-        m_combiner.work[threadId].registers.color0[i] = m_combiner.setup.final.constantColor0[i];
-        m_combiner.work[threadId].registers.color1[i] = m_combiner.setup.final.constantColor1[i];
+    CombinerContext context;
+    memset(&context, 0, sizeof(context));
+    context.program = program;
+    
+    ConvertARGB8ToFloat(m_fogColor, context.constants[COMBINER_CONSTANT_FOG]);
+    context.constants[COMBINER_CONSTANT_FOG][3] = 1.0f; // Should it be from the vertex shader?
+    for (int n = 0; n < 8; n++) {
+        memcpy(context.constants[COMBINER_CONSTANT_STAGE + n * 2], m_combiner.setup.stage[n].constantColor0, sizeof(float) * 4);
+        memcpy(context.constants[COMBINER_CONSTANT_STAGE + n * 2 + 1], m_combiner.setup.stage[n].constantColor1, sizeof(float) * 4);
     }
-}
-
-float GeForce3::CombinerMapInputSelect(int threadId, CombinerInputRegister code, int index)
-{
-    float* reg = nullptr;
+    memcpy(context.constants[COMBINER_CONSTANT_FINAL], m_combiner.setup.final.constantColor0, sizeof(float) * 4);
+    memcpy(context.constants[COMBINER_CONSTANT_FINAL + 1], m_combiner.setup.final.constantColor1, sizeof(float) * 4);
     
-    switch (code) {
-        case CombinerInputRegister::ZERO:
-        default:
-            reg = m_combiner.work[threadId].registers.zero;
-            break;
-        case CombinerInputRegister::COLOR0:
-            reg = m_combiner.work[threadId].registers.color0;
-            break;
-        case CombinerInputRegister::COLOR1:
-            reg = m_combiner.work[threadId].registers.color1;
-            break;
-        case CombinerInputRegister::FOG_COLOR:
-            reg = m_combiner.work[threadId].registers.fogColor;
-            break;
-        case CombinerInputRegister::PRIMARY_COLOR:
-            reg = m_combiner.work[threadId].registers.primaryColor;
-            break;
-        case CombinerInputRegister::SECONDARY_COLOR:
-            reg = m_combiner.work[threadId].registers.secondaryColor;
-            break;
-        case CombinerInputRegister::TEXTURE0_COLOR:
-            reg = m_combiner.work[threadId].registers.texture0Color;
-            break;
-        case CombinerInputRegister::TEXTURE1_COLOR:
-            reg = m_combiner.work[threadId].registers.texture1Color;
-            break;
-        case CombinerInputRegister::TEXTURE2_COLOR:
-            reg = m_combiner.work[threadId].registers.texture2Color;
-            break;
-        case CombinerInputRegister::TEXTURE3_COLOR:
-            reg = m_combiner.work[threadId].registers.texture3Color;
-            break;
-        case CombinerInputRegister::SPARE0:
-            reg = m_combiner.work[threadId].registers.spare0;
-            break;
-        case CombinerInputRegister::SPARE1:
-            reg = m_combiner.work[threadId].registers.spare1;
-            break;
-        case CombinerInputRegister::SUM_CLAMP:
-            reg = m_combiner.work[threadId].variables.sumClamp;
-            break;
-        case CombinerInputRegister::EF:
-            reg = m_combiner.work[threadId].variables.EF;
-            break;
-    }
+    // Draws with the same program and constants share a context
+    if (m_combinerContext && memcmp(m_combinerContext, &context, sizeof(context)) == 0)
+        return;
     
-    return reg ? reg[index] : 0.0f;
+    // Older contexts are only referenced by queued triangles
+    if (m_combinerContexts.size() >= MAX_COMBINER_CONTEXTS) {
+        m_rasterizer->Wait();
+        m_combinerContexts.clear();
+    }
+    m_combinerContexts.push_back(context);
+    m_combinerContext = &m_combinerContexts.back();
 }
 
-float* GeForce3::CombinerMapInputSelectArray(int threadId, CombinerInputRegister code)
+void GeForce3::CompileCombinerProgram(const CombinerProgramKey& key, CombinerProgram& program)
 {
-    switch (code) {
-        case CombinerInputRegister::ZERO:
-        default:
-            return m_combiner.work[threadId].registers.zero;
+    const CombinerSetup& setup = key.setup;
+    CombinerOp op;
+    
+    // Context slots of the registers that hold the same value for every pixel
+    int constants[COMBINER_REGISTERS];
+    std::fill(constants, constants + COMBINER_REGISTERS, -1);
+    constants[static_cast<int>(CombinerInputRegister::ZERO)] = COMBINER_CONSTANT_ZERO;
+    constants[static_cast<int>(CombinerInputRegister::FOG_COLOR)] = COMBINER_CONSTANT_FOG;
+    
+    // General combiner stages
+    for (int n = 0; n < setup.stages; n++) {
+        const CombinerStage& stage = setup.stage[n];
+        constants[static_cast<int>(CombinerInputRegister::COLOR0)] = COMBINER_CONSTANT_STAGE + n * 2;
+        constants[static_cast<int>(CombinerInputRegister::COLOR1)] = COMBINER_CONSTANT_STAGE + n * 2 + 1;
+        
+        CompileCombinerInput(program, constants, COMBINER_A, false, stage.mapinRGB.aInput, stage.mapinRGB.aComponent, stage.mapinRGB.aMapping);
+        CompileCombinerInput(program, constants, COMBINER_B, false, stage.mapinRGB.bInput, stage.mapinRGB.bComponent, stage.mapinRGB.bMapping);
+        CompileCombinerInput(program, constants, COMBINER_C, false, stage.mapinRGB.cInput, stage.mapinRGB.cComponent, stage.mapinRGB.cMapping);
+        CompileCombinerInput(program, constants, COMBINER_D, false, stage.mapinRGB.dInput, stage.mapinRGB.dComponent, stage.mapinRGB.dMapping);
+        CompileCombinerInput(program, constants, COMBINER_A, true, stage.mapinAlpha.aInput, stage.mapinAlpha.aComponent, stage.mapinAlpha.aMapping);
+        CompileCombinerInput(program, constants, COMBINER_B, true, stage.mapinAlpha.bInput, stage.mapinAlpha.bComponent, stage.mapinAlpha.bMapping);
+        CompileCombinerInput(program, constants, COMBINER_C, true, stage.mapinAlpha.cInput, stage.mapinAlpha.cComponent, stage.mapinAlpha.cMapping);
+        CompileCombinerInput(program, constants, COMBINER_D, true, stage.mapinAlpha.dInput, stage.mapinAlpha.dComponent, stage.mapinAlpha.dMapping);
+        
+        memset(&op, 0, sizeof(op));
+        op.code = CombinerOpCode::STAGE;
+        op.rgb = CompileCombinerStageOutput(stage.mapoutRGB);
+        op.alpha = CompileCombinerStageOutput(stage.mapoutAlpha);
+        
+        // A dot product replaces the RGB sum, alpha has no dot products
+        if (op.rgb.dotAB || op.rgb.dotCD)
+            op.rgb.sumOutput = -1;
+        op.alpha.dotAB = op.alpha.dotCD = false;
+        program.ops.push_back(op);
+    }
+    
+    // Final combiner
+    const CombinerFinal& final = setup.final;
+    constants[static_cast<int>(CombinerInputRegister::COLOR0)] = COMBINER_CONSTANT_FINAL;
+    constants[static_cast<int>(CombinerInputRegister::COLOR1)] = COMBINER_CONSTANT_FINAL + 1;
+    
+    CompileCombinerInput(program, constants, COMBINER_E, false, final.mapinRGB.eInput, final.mapinRGB.eComponent, final.mapinRGB.eMapping);
+    CompileCombinerInput(program, constants, COMBINER_F, false, final.mapinRGB.fInput, final.mapinRGB.fComponent, final.mapinRGB.fMapping);
+    
+    memset(&op, 0, sizeof(op));
+    op.code = CombinerOpCode::FINAL_SUMS;
+    op.sumClamp = final.colorSumClamp != 0;
+    program.ops.push_back(op);
+    
+    CompileCombinerInput(program, constants, COMBINER_A, false, final.mapinRGB.aInput, final.mapinRGB.aComponent, final.mapinRGB.aMapping);
+    CompileCombinerInput(program, constants, COMBINER_B, false, final.mapinRGB.bInput, final.mapinRGB.bComponent, final.mapinRGB.bMapping);
+    CompileCombinerInput(program, constants, COMBINER_C, false, final.mapinRGB.cInput, final.mapinRGB.cComponent, final.mapinRGB.cMapping);
+    CompileCombinerInput(program, constants, COMBINER_D, false, final.mapinRGB.dInput, final.mapinRGB.dComponent, final.mapinRGB.dMapping);
+    CompileCombinerInput(program, constants, COMBINER_G, true, final.mapinAlpha.gInput, final.mapinAlpha.gComponent, final.mapinAlpha.gMapping);
+    
+    memset(&op, 0, sizeof(op));
+    op.code = CombinerOpCode::FINAL_OUTPUT;
+    program.ops.push_back(op);
+}
+
+void GeForce3::CompileCombinerInput(CombinerProgram& program, const int constants[COMBINER_REGISTERS],
+                                    int variable, bool alpha, CombinerInputRegister input, int component,
+                                    CombinerMapFunction mapping)
+{
+    int source;
+    switch (input) {
         case CombinerInputRegister::COLOR0:
-            return m_combiner.work[threadId].registers.color0;
         case CombinerInputRegister::COLOR1:
-            return m_combiner.work[threadId].registers.color1;
         case CombinerInputRegister::FOG_COLOR:
-            return m_combiner.work[threadId].registers.fogColor;
         case CombinerInputRegister::PRIMARY_COLOR:
-            return m_combiner.work[threadId].registers.primaryColor;
         case CombinerInputRegister::SECONDARY_COLOR:
-            return m_combiner.work[threadId].registers.secondaryColor;
         case CombinerInputRegister::TEXTURE0_COLOR:
-            return m_combiner.work[threadId].registers.texture0Color;
         case CombinerInputRegister::TEXTURE1_COLOR:
-            return m_combiner.work[threadId].registers.texture1Color;
         case CombinerInputRegister::TEXTURE2_COLOR:
-            return m_combiner.work[threadId].registers.texture2Color;
         case CombinerInputRegister::TEXTURE3_COLOR:
-            return m_combiner.work[threadId].registers.texture3Color;
         case CombinerInputRegister::SPARE0:
-            return m_combiner.work[threadId].registers.spare0;
         case CombinerInputRegister::SPARE1:
-            return m_combiner.work[threadId].registers.spare1;
         case CombinerInputRegister::SUM_CLAMP:
-            return m_combiner.work[threadId].variables.sumClamp;
         case CombinerInputRegister::EF:
-            return m_combiner.work[threadId].variables.EF;
-    }
-}
-
-float* GeForce3::CombinerMapOutputSelectArray(int threadId, CombinerInputRegister code)
-{
-    switch (code) {
-        case CombinerInputRegister::PRIMARY_COLOR:
-            return m_combiner.work[threadId].registers.primaryColor;
-        case CombinerInputRegister::SECONDARY_COLOR:
-            return m_combiner.work[threadId].registers.secondaryColor;
-        case CombinerInputRegister::TEXTURE0_COLOR:
-            return m_combiner.work[threadId].registers.texture0Color;
-        case CombinerInputRegister::TEXTURE1_COLOR:
-            return m_combiner.work[threadId].registers.texture1Color;
-        case CombinerInputRegister::TEXTURE2_COLOR:
-            return m_combiner.work[threadId].registers.texture2Color;
-        case CombinerInputRegister::TEXTURE3_COLOR:
-            return m_combiner.work[threadId].registers.texture3Color;
-        case CombinerInputRegister::SPARE0:
-            return m_combiner.work[threadId].registers.spare0;
-        case CombinerInputRegister::SPARE1:
-            return m_combiner.work[threadId].registers.spare1;
+            source = static_cast<int>(input);
+            break;
         case CombinerInputRegister::ZERO:
-        case CombinerInputRegister::COLOR0:
-        case CombinerInputRegister::COLOR1:
-        case CombinerInputRegister::FOG_COLOR:
-        case CombinerInputRegister::SUM_CLAMP:
-        case CombinerInputRegister::EF:
         default:
-            return nullptr;
-    }
-}
-
-void GeForce3::MapCombinerStageInput(int threadId, int stageNumber)
-{
-    int n = stageNumber;
-    int c, d, i;
-    float* pv;
-    
-    // RGB portion
-    // A
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.stage[n].mapinRGB.aInput);
-    c = m_combiner.setup.stage[n].mapinRGB.aComponent * 3;
-    i = m_combiner.setup.stage[n].mapinRGB.aComponent ^ 1;
-    
-    // Copy components to A
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.A[d] = pv[c];
-        c += i;
+            source = static_cast<int>(CombinerInputRegister::ZERO);
+            break;
     }
     
-    // Apply mapping function
-    CombinerMapInputFunctionArray(m_combiner.setup.stage[n].mapinRGB.aMapping, 
-                               m_combiner.work[threadId].variables.A);
-                               
-    // B
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.stage[n].mapinRGB.bInput);
-    c = m_combiner.setup.stage[n].mapinRGB.bComponent * 3;
-    i = m_combiner.setup.stage[n].mapinRGB.bComponent ^ 1;
+    CombinerOp op;
+    memset(&op, 0, sizeof(op));
+    op.variable = variable;
+    op.mapping = mapping;
     
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.B[d] = pv[c];
-        c += i;
+    // Constant inputs come from the context and are mapped once per block
+    if (constants[source] >= 0) {
+        op.code = alpha ? CombinerOpCode::CONSTANT_ALPHA : CombinerOpCode::CONSTANT_RGB;
+        op.source = constants[source];
+    } else {
+        op.code = alpha ? CombinerOpCode::LOAD_ALPHA : CombinerOpCode::LOAD_RGB;
+        op.source = source;
     }
     
-    CombinerMapInputFunctionArray(m_combiner.setup.stage[n].mapinRGB.bMapping, 
-                               m_combiner.work[threadId].variables.B);
-                               
-    // C
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.stage[n].mapinRGB.cInput);
-    c = m_combiner.setup.stage[n].mapinRGB.cComponent * 3;
-    i = m_combiner.setup.stage[n].mapinRGB.cComponent ^ 1;
+    // RGB inputs read red, green and blue or replicate alpha, alpha inputs read blue or alpha
+    if (alpha)
+        op.channel = 2 + component;
+    else
+        op.channel = component ? 3 : -1;
     
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.C[d] = pv[c];
-        c += i;
-    }
+    program.ops.push_back(op);
+}
+
+GeForce3::CombinerStageOutput GeForce3::CompileCombinerStageOutput(const CombinerMapOut& mapout)
+{
+    CombinerStageOutput output;
     
-    CombinerMapInputFunctionArray(m_combiner.setup.stage[n].mapinRGB.cMapping, 
-                               m_combiner.work[threadId].variables.C);
-                               
-    // D
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.stage[n].mapinRGB.dInput);
-    c = m_combiner.setup.stage[n].mapinRGB.dComponent * 3;
-    i = m_combiner.setup.stage[n].mapinRGB.dComponent ^ 1;
+    output.dotAB = mapout.abDotProduct != 0;
+    output.dotCD = mapout.cdDotProduct != 0;
+    output.mux = mapout.muxsum != 0;
+    output.bias = mapout.bias ? -0.5f : 0.0f;
     
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.D[d] = pv[c];
-        c += i;
+    switch (mapout.scale) {
+        case 0:
+        default:
+            output.scale = 1.0f;
+            break;
+        case 1:
+            output.scale = 2.0f;
+            break;
+        case 2:
+            output.scale = 4.0f;
+            break;
+        case 3:
+            output.scale = 0.5f;
+            break;
+    }
+    
+    // Only the color registers, textures and spares can be written
+    CombinerInputRegister targets[3] = { mapout.abOutput, mapout.cdOutput, mapout.sumOutput };
+    int* outputs[3] = { &output.abOutput, &output.cdOutput, &output.sumOutput };
+    for (int n = 0; n < 3; n++) {
+        switch (targets[n]) {
+            case CombinerInputRegister::PRIMARY_COLOR:
+            case CombinerInputRegister::SECONDARY_COLOR:
+            case CombinerInputRegister::TEXTURE0_COLOR:
+            case CombinerInputRegister::TEXTURE1_COLOR:
+            case CombinerInputRegister::TEXTURE2_COLOR:
+            case CombinerInputRegister::TEXTURE3_COLOR:
+            case CombinerInputRegister::SPARE0:
+            case CombinerInputRegister::SPARE1:
+                *outputs[n] = static_cast<int>(targets[n]);
+                break;
+            default:
+                *outputs[n] = -1;
+                break;
+        }
     }
     
-    CombinerMapInputFunctionArray(m_combiner.setup.stage[n].mapinRGB.dMapping, 
-                               m_combiner.work[threadId].variables.D);
-    
-    // Alpha portion
-    // A
-    float v = CombinerMapInputSelect(threadId, 
-                                  m_combiner.setup.stage[n].mapinAlpha.aInput, 
-                                  2 + m_combiner.setup.stage[n].mapinAlpha.aComponent);
-                                  
-    m_combiner.work[threadId].variables.A[3] = CombinerMapInputFunction(
-        m_combiner.setup.stage[n].mapinAlpha.aMapping, v);
-        
-    // B
-    v = CombinerMapInputSelect(threadId, 
-                            m_combiner.setup.stage[n].mapinAlpha.bInput, 
-                            2 + m_combiner.setup.stage[n].mapinAlpha.bComponent);
-                            
-    m_combiner.work[threadId].variables.B[3] = CombinerMapInputFunction(
-        m_combiner.setup.stage[n].mapinAlpha.bMapping, v);
-        
-    // C
-    v = CombinerMapInputSelect(threadId, 
-                            m_combiner.setup.stage[n].mapinAlpha.cInput, 
-                            2 + m_combiner.setup.stage[n].mapinAlpha.cComponent);
-                            
-    m_combiner.work[threadId].variables.C[3] = CombinerMapInputFunction(
-        m_combiner.setup.stage[n].mapinAlpha.cMapping, v);
-        
-    // D
-    v = CombinerMapInputSelect(threadId, 
-                            m_combiner.setup.stage[n].mapinAlpha.dInput, 
-                            2 + m_combiner.setup.stage[n].mapinAlpha.dComponent);
-                            
-    m_combiner.work[threadId].variables.D[3] = CombinerMapInputFunction(
-        m_combiner.setup.stage[n].mapinAlpha.dMapping, v);
+    return output;
 }
 
-void GeForce3::MapCombinerStageOutput(int threadId, int stageNumber)
+void GeForce3::RunCombinerProgram(const CombinerContext& context, CombinerBlock& block, int count)
 {
-    int n = stageNumber;
-    float* f;
+    const int secondary = static_cast<int>(CombinerInputRegister::SECONDARY_COLOR);
+    const int spare0 = static_cast<int>(CombinerInputRegister::SPARE0);
+    const int sumClamp = static_cast<int>(CombinerInputRegister::SUM_CLAMP);
+    const int ef = static_cast<int>(CombinerInputRegister::EF);
     
-    // RGB
-    f = CombinerMapOutputSelectArray(threadId, m_combiner.setup.stage[n].mapoutRGB.abOutput);
-    if (f) {
-        f[0] = m_combiner.work[threadId].functions.RGBop1[0];
-        f[1] = m_combiner.work[threadId].functions.RGBop1[1];
-        f[2] = m_combiner.work[threadId].functions.RGBop1[2];
-    }
-    
-    f = CombinerMapOutputSelectArray(threadId, m_combiner.setup.stage[n].mapoutRGB.cdOutput);
-    if (f) {
-        f[0] = m_combiner.work[threadId].functions.RGBop2[0];
-        f[1] = m_combiner.work[threadId].functions.RGBop2[1];
-        f[2] = m_combiner.work[threadId].functions.RGBop2[2];
-    }
-    
-    if ((m_combiner.setup.stage[n].mapoutRGB.abDotProduct | m_combiner.setup.stage[n].mapoutRGB.cdDotProduct) == 0) {
-        f = CombinerMapOutputSelectArray(threadId, m_combiner.setup.stage[n].mapoutRGB.sumOutput);
-        if (f) {
-            f[0] = m_combiner.work[threadId].functions.RGBop3[0];
-            f[1] = m_combiner.work[threadId].functions.RGBop3[1];
-            f[2] = m_combiner.work[threadId].functions.RGBop3[2];
+    for (const CombinerOp& op : context.program->ops) {
+        float (*variable)[GeForce3Spans::BLOCK_SIZE] = block.variables[op.variable];
+        
+        switch (op.code) {
+            case CombinerOpCode::LOAD_RGB:
+                for (int d = 0; d < 3; d++) {
+                    const float* source = block.registers[op.source][op.channel < 0 ? d : op.channel];
+                    std::copy(source, source + count, variable[d]);
+                    CombinerMapInputSpan(op.mapping, variable[d], count);
+                }
+                break;
+                
+            case CombinerOpCode::LOAD_ALPHA: {
+                const float* source = block.registers[op.source][op.channel];
+                std::copy(source, source + count, variable[3]);
+                CombinerMapInputSpan(op.mapping, variable[3], count);
+                break;
+            }
+                
+            case CombinerOpCode::CONSTANT_RGB: {
+                const float* value = context.constants[op.source];
+                for (int d = 0; d < 3; d++) {
+                    float mapped = CombinerMapInputFunction(op.mapping, value[op.channel < 0 ? d : op.channel]);
+                    std::fill(variable[d], variable[d] + count, mapped);
+                }
+                break;
+            }
+                
+            case CombinerOpCode::CONSTANT_ALPHA: {
+                float mapped = CombinerMapInputFunction(op.mapping, context.constants[op.source][op.channel]);
+                std::fill(variable[3], variable[3] + count, mapped);
+                break;
+            }
+                
+            case CombinerOpCode::STAGE:
+                RunCombinerStage(op, block, count);
+                break;
+                
+            case CombinerOpCode::FINAL_SUMS: {
+                const float (*e)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_E];
+                const float (*f)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_F];
+                
+                // EF = E * F, SumClamp = clamp(spare0 + secondary_color)
+                for (int d = 0; d < 3; d++) {
+                    for (int i = 0; i < count; i++) {
+                        block.registers[ef][d][i] = e[d][i] * f[d][i];
+                        block.registers[sumClamp][d][i] = std::max(0.0f, block.registers[spare0][d][i]) +
+                                                          std::max(0.0f, block.registers[secondary][d][i]);
+                    }
+                    if (op.sumClamp) {
+                        for (int i = 0; i < count; i++)
+                            block.registers[sumClamp][d][i] = std::min(block.registers[sumClamp][d][i], 1.0f);
+                    }
+                }
+                break;
+            }
+                
+            case CombinerOpCode::FINAL_OUTPUT: {
+                const float (*a)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_A];
+                const float (*b)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_B];
+                const float (*c)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_C];
+                const float (*d)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_D];
+                
+                // RGB = A * B + (1-A) * C + D, A = G
+                for (int n = 0; n < 3; n++) {
+                    for (int i = 0; i < count; i++)
+                        block.output[n][i] = std::min(a[n][i] * b[n][i] + (1.0f - a[n][i]) * c[n][i] + d[n][i], 2.0f);
+                }
+                std::copy(block.variables[COMBINER_G][3], block.variables[COMBINER_G][3] + count, block.output[3]);
+                break;
+            }
         }
     }
-    
-    // Alpha
-    f = CombinerMapOutputSelectArray(threadId, m_combiner.setup.stage[n].mapoutAlpha.abOutput);
-    if (f) {
-        f[3] = m_combiner.work[threadId].functions.Aop1;
-    }
-    
-    f = CombinerMapOutputSelectArray(threadId, m_combiner.setup.stage[n].mapoutAlpha.cdOutput);
-    if (f) {
-        f[3] = m_combiner.work[threadId].functions.Aop2;
-    }
-    
-    f = CombinerMapOutputSelectArray(threadId, m_combiner.setup.stage[n].mapoutAlpha.sumOutput);
-    if (f) {
-        f[3] = m_combiner.work[threadId].functions.Aop3;
-    }
 }
 
-void GeForce3::MapFinalCombinerInput(int threadId)
+void GeForce3::RunCombinerStage(const CombinerOp& op, CombinerBlock& block, int count)
 {
-    int c, d, i;
-    float* pv;
-    
-    // E
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.final.mapinRGB.eInput);
-    c = m_combiner.setup.final.mapinRGB.eComponent * 3;
-    i = m_combiner.setup.final.mapinRGB.eComponent ^ 1;
+    const float (*a)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_A];
+    const float (*b)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_B];
+    const float (*c)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_C];
+    const float (*d)[GeForce3Spans::BLOCK_SIZE] = block.variables[COMBINER_D];
+    const float* spare0Alpha = block.registers[static_cast<int>(CombinerInputRegister::SPARE0)][3];
     
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.E[d] = pv[c];
-        c += i;
-    }
-    
-    CombinerMapInputFunctionArray(m_combiner.setup.final.mapinRGB.eMapping, 
-                               m_combiner.work[threadId].variables.E);
+    // AB, CD and sum results; all outputs are computed before any is written
+    float rgb[3][3][GeForce3Spans::BLOCK_SIZE];
+    float alpha[3][GeForce3Spans::BLOCK_SIZE];
     
-    // F
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.final.mapinRGB.fInput);
-    c = m_combiner.setup.final.mapinRGB.fComponent * 3;
-    i = m_combiner.setup.final.mapinRGB.fComponent ^ 1;
+    const CombinerStageOutput& rgbOut = op.rgb;
+    const CombinerStageOutput& alphaOut = op.alpha;
     
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.F[d] = pv[c];
-        c += i;
+    // RGB
+    if (rgbOut.dotAB) {
+        for (int i = 0; i < count; i++) {
+            float dot = a[0][i] * b[0][i] + a[1][i] * b[1][i] + a[2][i] * b[2][i];
+            dot = std::clamp((dot + rgbOut.bias) * rgbOut.scale, -1.0f, 1.0f);
+            rgb[0][0][i] = rgb[0][1][i] = rgb[0][2][i] = dot;
+        }
+    } else {
+        for (int n = 0; n < 3; n++) {
+            for (int i = 0; i < count; i++)
+                rgb[0][n][i] = std::clamp((a[n][i] * b[n][i] + rgbOut.bias) * rgbOut.scale, -1.0f, 1.0f);
+        }
     }
     
-    CombinerMapInputFunctionArray(m_combiner.setup.final.mapinRGB.fMapping, 
-                               m_combiner.work[threadId].variables.F);
-    
-    // EF = E * F
-    m_combiner.work[threadId].variables.EF[0] = m_combiner.work[threadId].variables.E[0] * 
-                                             m_combiner.work[threadId].variables.F[0];
-    m_combiner.work[threadId].variables.EF[1] = m_combiner.work[threadId].variables.E[1] * 
-                                             m_combiner.work[threadId].variables.F[1];
-    m_combiner.work[threadId].variables.EF[2] = m_combiner.work[threadId].variables.E[2] * 
-                                             m_combiner.work[threadId].variables.F[2];
-    
-    // SumClamp = clamp(spare0 + secondary_color)
-    m_combiner.work[threadId].variables.sumClamp[0] = std::max(0.0f, m_combiner.work[threadId].registers.spare0[0]) + 
-                                                  std::max(0.0f, m_combiner.work[threadId].registers.secondaryColor[0]);
-    m_combiner.work[threadId].variables.sumClamp[1] = std::max(0.0f, m_combiner.work[threadId].registers.spare0[1]) + 
-                                                  std::max(0.0f, m_combiner.work[threadId].registers.secondaryColor[1]);
-    m_combiner.work[threadId].variables.sumClamp[2] = std::max(0.0f, m_combiner.work[threadId].registers.spare0[2]) + 
-                                                  std::max(0.0f, m_combiner.work[threadId].registers.secondaryColor[2]);
-    
-    if (m_combiner.setup.final.colorSumClamp) {
-        m_combiner.work[threadId].variables.sumClamp[0] = std::min(m_combiner.work[threadId].variables.sumClamp[0], 1.0f);
-        m_combiner.work[threadId].variables.sumClamp[1] = std::min(m_combiner.work[threadId].variables.sumClamp[1], 1.0f);
-        m_combiner.work[threadId].variables.sumClamp[2] = std::min(m_combiner.work[threadId].variables.sumClamp[2], 1.0f);
+    if (rgbOut.dotCD) {
+        for (int i = 0; i < count; i++) {
+            float dot = c[0][i] * d[0][i] + c[1][i] * d[1][i] + c[2][i] * d[2][i];
+            dot = std::clamp((dot + rgbOut.bias) * rgbOut.scale, -1.0f, 1.0f);
+            rgb[1][0][i] = rgb[1][1][i] = rgb[1][2][i] = dot;
+        }
+    } else {
+        for (int n = 0; n < 3; n++) {
+            for (int i = 0; i < count; i++)
+                rgb[1][n][i] = std::clamp((c[n][i] * d[n][i] + rgbOut.bias) * rgbOut.scale, -1.0f, 1.0f);
+        }
     }
     
-    // A
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.final.mapinRGB.aInput);
-    c = m_combiner.setup.final.mapinRGB.aComponent * 3;
-    i = m_combiner.setup.final.mapinRGB.aComponent ^ 1;
-    
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.A[d] = pv[c];
-        c += i;
+    if (rgbOut.sumOutput >= 0) {
+        for (int n = 0; n < 3; n++) {
+            if (rgbOut.mux) {
+                for (int i = 0; i < count; i++) {
+                    float value = spare0Alpha[i] >= 0.5f ? a[n][i] * b[n][i] : c[n][i] * d[n][i];
+                    rgb[2][n][i] = std::clamp((value + rgbOut.bias) * rgbOut.scale, -1.0f, 1.0f);
+                }
+            } else {
+                for (int i = 0; i < count; i++) {
+                    float value = a[n][i] * b[n][i] + c[n][i] * d[n][i];
+                    rgb[2][n][i] = std::clamp((value + rgbOut.bias) * rgbOut.scale, -1.0f, 1.0f);
+                }
+            }
+        }
     }
     
-    CombinerMapInputFunctionArray(m_combiner.setup.final.mapinRGB.aMapping, 
-                               m_combiner.work[threadId].variables.A);
-    
-    // B
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.final.mapinRGB.bInput);
-    c = m_combiner.setup.final.mapinRGB.bComponent * 3;
-    i = m_combiner.setup.final.mapinRGB.bComponent ^ 1;
-    
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.B[d] = pv[c];
-        c += i;
+    // Alpha
+    for (int i = 0; i < count; i++) {
+        float ab = a[3][i] * b[3][i];
+        float cd = c[3][i] * d[3][i];
+        float sum;
+        if (alphaOut.mux)
+            sum = spare0Alpha[i] >= 0.5f ? ab : cd;
+        else
+            sum = ab + cd;
+        
+        alpha[0][i] = std::clamp((ab + alphaOut.bias) * alphaOut.scale, -1.0f, 1.0f);
+        alpha[1][i] = std::clamp((cd + alphaOut.bias) * alphaOut.scale, -1.0f, 1.0f);
+        alpha[2][i] = std::clamp((sum + alphaOut.bias) * alphaOut.scale, -1.0f, 1.0f);
     }
     
-    CombinerMapInputFunctionArray(m_combiner.setup.final.mapinRGB.bMapping, 
-                               m_combiner.work[threadId].variables.B);
-    
-    // C
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.final.mapinRGB.cInput);
-    c = m_combiner.setup.final.mapinRGB.cComponent * 3;
-    i = m_combiner.setup.final.mapinRGB.cComponent ^ 1;
-    
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.C[d] = pv[c];
-        c += i;
+    // Map outputs to registers
+    int rgbTargets[3] = { rgbOut.abOutput, rgbOut.cdOutput, rgbOut.sumOutput };
+    for (int m = 0; m < 3; m++) {
+        if (rgbTargets[m] < 0)
+            continue;
+        for (int n = 0; n < 3; n++)
+            std::copy(rgb[m][n], rgb[m][n] + count, block.registers[rgbTargets[m]][n]);
     }
     
-    CombinerMapInputFunctionArray(m_combiner.setup.final.mapinRGB.cMapping, 
-                               m_combiner.work[threadId].variables.C);
+    int alphaTargets[3] = { alphaOut.abOutput, alphaOut.cdOutput, alphaOut.sumOutput };
+    for (int m = 0; m < 3; m++) {
+        if (alphaTargets[m] >= 0)
+            std::copy(alpha[m], alpha[m] + count, block.registers[alphaTargets[m]][3]);
+    }
+}
+
+// Pixel pipeline selection
+size_t GeForce3::PixelStateKeyHash::operator()(const PixelStateKey& key) const
+{
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(&key);
+    size_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(key) / sizeof(uint32_t); i++) {
+        hash = (hash ^ words[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+GeForce3::PixelStateKey GeForce3::ComputePixelStateKey() const
+{
+    PixelStateKey key;
+    memset(&key, 0, sizeof(key));
     
-    // D
-    pv = CombinerMapInputSelectArray(threadId, m_combiner.setup.final.mapinRGB.dInput);
-    c = m_combiner.setup.final.mapinRGB.dComponent * 3;
-    i = m_combiner.setup.final.mapinRGB.dComponent ^ 1;
+    PixelDepth depth = PixelDepth::NONE;
+    if (m_depthFormat == DepthFormat::Z24S8)
+        depth = PixelDepth::Z24S8;
+    else if (m_depthFormat == DepthFormat::Z16)
+        depth = PixelDepth::Z16;
     
-    for (d = 0; d < 3; d++) {
-        m_combiner.work[threadId].variables.D[d] = pv[c];
-        c += i;
+    // Color path
+    int colorPath = 0;
+    if (m_colorMask != 0) {
+        PixelFormat format;
+        switch (m_colorFormat) {
+            case ColorFormat::R5G6B5:
+                format = PixelFormat::RGB565;
+                break;
+            case ColorFormat::X8R8G8B8_Z8R8G8B8:
+            case ColorFormat::X8R8G8B8_X8R8G8B8:
+                format = PixelFormat::XRGB32;
+                break;
+            case ColorFormat::A8R8G8B8:
+                format = PixelFormat::ARGB32;
+                break;
+            case ColorFormat::B8:
+                format = PixelFormat::B8;
+                break;
+            default:
+                format = PixelFormat::COUNT;
+                break;
+        }
+        
+        if (format == PixelFormat::COUNT) {
+            colorPath = 1;
+        } else {
+            PixelColorMode mode = PixelColorMode::WRITE;
+            if (m_colorMask != 0xFFFFFFFF || m_logicalOpEnabled)
+                mode = PixelColorMode::GENERAL;
+            else if (m_blendingEnabled)
+                mode = PixelColorMode::BLEND;
+            colorPath = 2 + static_cast<int>(mode) * static_cast<int>(PixelFormat::COUNT) + static_cast<int>(format);
+            
+            if (m_blendingEnabled) {
+                key.blendEquation = static_cast<uint32_t>(m_blendEquation);
+                key.blendSource = static_cast<uint32_t>(m_blendFuncSource);
+                key.blendDest = static_cast<uint32_t>(m_blendFuncDest);
+            }
+            if (m_logicalOpEnabled)
+                key.logicalOp = static_cast<uint32_t>(m_logicalOp) | 0x80000000;
+        }
     }
     
-    CombinerMapInputFunctionArray(m_combiner.setup.final.mapinRGB.dMapping, 
-                               m_combiner.work[threadId].variables.D);
+    key.writer = (((static_cast<int>(depth) * 2 + m_stencilTestEnabled) * 2 + m_depthTestEnabled) * 2 +
+                  m_alphaTestEnabled) * PIXEL_COLOR_PATHS + colorPath;
+    key.depthWrite = m_depthWriteEnabled;
     
-    // G (alpha)
-    m_combiner.work[threadId].variables.G = CombinerMapInputSelect(
-        threadId, 
-        m_combiner.setup.final.mapinAlpha.gInput, 
-        2 + m_combiner.setup.final.mapinAlpha.gComponent
-    );
+    if (m_alphaTestEnabled)
+        key.alphaFunc = static_cast<uint32_t>(m_alphaFunc);
+    if (m_stencilTestEnabled) {
+        key.stencilFunc = static_cast<uint32_t>(m_stencilFunc);
+        key.stencilOpFail = static_cast<uint32_t>(m_stencilOpFail);
+    }
+    // The depth stencil operations apply with or without the stencil test
+    if (m_depthTestEnabled) {
+        key.depthFunc = static_cast<uint32_t>(m_depthFunction);
+        key.stencilOpZFail = static_cast<uint32_t>(m_stencilOpZFail);
+        key.stencilOpZPass = static_cast<uint32_t>(m_stencilOpZPass);
+    }
     
-    m_combiner.work[threadId].variables.G = CombinerMapInputFunction(
-        m_combiner.setup.final.mapinAlpha.gMapping,
-        m_combiner.work[threadId].variables.G
-    );
+    return key;
 }
 
-void GeForce3::FinalCombinerOutput(int threadId)
+void GeForce3::SelectPixelPipeline()
 {
-    // Final combiner formula:
-    // RGB = A * B + (1-A) * C + D
-    // A = G
+    static const std::array<SpanWriter, SPAN_WRITER_COUNT> spanWriters =
+        MakeSpanWriters(std::make_index_sequence<SPAN_WRITER_COUNT>());
     
-    // RGB calculation
-    m_combiner.work[threadId].output[0] = m_combiner.work[threadId].variables.A[0] * 
-                                       m_combiner.work[threadId].variables.B[0] + 
-                                       (1.0f - m_combiner.work[threadId].variables.A[0]) * 
-                                       m_combiner.work[threadId].variables.C[0] + 
-                                       m_combiner.work[threadId].variables.D[0];
-                                       
-    m_combiner.work[threadId].output[1] = m_combiner.work[threadId].variables.A[1] * 
-                                       m_combiner.work[threadId].variables.B[1] + 
-                                       (1.0f - m_combiner.work[threadId].variables.A[1]) * 
-                                       m_combiner.work[threadId].variables.C[1] + 
-                                       m_combiner.work[threadId].variables.D[1];
-                                       
-    m_combiner.work[threadId].output[2] = m_combiner.work[threadId].variables.A[2] * 
-                                       m_combiner.work[threadId].variables.B[2] + 
-                                       (1.0f - m_combiner.work[threadId].variables.A[2]) * 
-                                       m_combiner.work[threadId].variables.C[2] + 
-                                       m_combiner.work[threadId].variables.D[2];
+    PixelStateKey key = ComputePixelStateKey();
+    m_pixelPipelineLookups++;
     
-    // Clamp output
-    m_combiner.work[threadId].output[0] = std::min(m_combiner.work[threadId].output[0], 2.0f);
-    m_combiner.work[threadId].output[1] = std::min(m_combiner.work[threadId].output[1], 2.0f);
-    m_combiner.work[threadId].output[2] = std::min(m_combiner.work[threadId].output[2], 2.0f);
+    auto it = m_pixelPipelines.find(key);
+    if (it != m_pixelPipelines.end()) {
+        m_pixelPipelineHits++;
+    } else {
+        PixelPipeline pipeline;
+        pipeline.writer = spanWriters[key.writer];
+        pipeline.depthWrite = key.depthWrite != 0;
+        pipeline.alphaFunc = static_cast<ComparisonOp>(key.alphaFunc);
+        pipeline.stencilFunc = static_cast<ComparisonOp>(key.stencilFunc);
+        pipeline.depthFunc = static_cast<ComparisonOp>(key.depthFunc);
+        pipeline.stencilOpFail = static_cast<StencilOp>(key.stencilOpFail);
+        pipeline.stencilOpZFail = static_cast<StencilOp>(key.stencilOpZFail);
+        pipeline.stencilOpZPass = static_cast<StencilOp>(key.stencilOpZPass);
+        pipeline.blendingEnabled = m_blendingEnabled;
+        pipeline.blendEquation = static_cast<BlendEquation>(key.blendEquation);
+        pipeline.blendSource = static_cast<BlendFactor>(key.blendSource);
+        pipeline.blendDest = static_cast<BlendFactor>(key.blendDest);
+        pipeline.logicalOpEnabled = key.logicalOp != 0;
+        pipeline.logicalOp = static_cast<LogicalOp>(key.logicalOp & 0x7FFFFFFF);
+        
+        // Depth only comes from interpolation, so without an alpha test
+        // shading cannot change the outcome of the depth test
+        int tests = key.writer / PIXEL_COLOR_PATHS;
+        bool alphaTest = tests & 1;
+        bool depthTest = (tests >> 1) & 1;
+        bool stencilTest = (tests >> 2) & 1;
+        PixelDepth depth = static_cast<PixelDepth>(tests >> 3);
+        pipeline.earlyDepth = depthTest && !alphaTest && depth != PixelDepth::NONE;
+        pipeline.silentDepthReject = depth == PixelDepth::Z16 ||
+            (pipeline.stencilOpZFail == StencilOp::KEEP && (!stencilTest || pipeline.stencilOpFail == StencilOp::KEEP));
+        
+        // Factors a blend stage does not implement fall back to ONE (source) and ZERO (destination)
+        switch (pipeline.blendSource) {
+            case BlendFactor::SRC_COLOR:
+            case BlendFactor::ONE_MINUS_SRC_COLOR:
+                pipeline.blendSource = BlendFactor::ONE;
+                break;
+            default:
+                break;
+        }
+        switch (pipeline.blendDest) {
+            case BlendFactor::DST_COLOR:
+            case BlendFactor::ONE_MINUS_DST_COLOR:
+            case BlendFactor::SRC_ALPHA_SATURATE:
+                pipeline.blendDest = BlendFactor::ZERO;
+                break;
+            default:
+                break;
+        }
+        
+        it = m_pixelPipelines.emplace(key, pipeline).first;
+        LOG("Pixel pipeline %zu: writer %u\n", m_pixelPipelines.size(), key.writer);
+    }
     
-    // Alpha comes directly from G
-    m_combiner.work[threadId].output[3] = m_combiner.work[threadId].variables.G;
-}
-
-void GeForce3::CombinerFunction_AB(int threadId, float result[4])
-{
-    result[0] = m_combiner.work[threadId].variables.A[0] * m_combiner.work[threadId].variables.B[0];
-    result[1] = m_combiner.work[threadId].variables.A[1] * m_combiner.work[threadId].variables.B[1];
-    result[2] = m_combiner.work[threadId].variables.A[2] * m_combiner.work[threadId].variables.B[2];
-    result[3] = m_combiner.work[threadId].variables.A[3] * m_combiner.work[threadId].variables.B[3];
-}
-
-void GeForce3::CombinerFunction_AdotB(int threadId, float result[4])
-{
-    // Dot product of A and B
-    result[0] = m_combiner.work[threadId].variables.A[0] * m_combiner.work[threadId].variables.B[0] + 
-               m_combiner.work[threadId].variables.A[1] * m_combiner.work[threadId].variables.B[1] + 
-               m_combiner.work[threadId].variables.A[2] * m_combiner.work[threadId].variables.B[2];
-               
-    result[1] = result[2] = result[0];
-    result[3] = m_combiner.work[threadId].variables.A[3] * m_combiner.work[threadId].variables.B[3];
+    if (m_pixelPipeline != &it->second) {
+        // Queued triangles may still be writing through the current pipeline
+        m_rasterizer->Wait();
+        m_pixelPipeline = &it->second;
+    }
 }
 
-void GeForce3::CombinerFunction_CD(int threadId, float result[4])
+GeForce3::PixelPipelineStats GeForce3::GetPixelPipelineStats()
 {
-    result[0] = m_combiner.work[threadId].variables.C[0] * m_combiner.work[threadId].variables.D[0];
-    result[1] = m_combiner.work[threadId].variables.C[1] * m_combiner.work[threadId].variables.D[1];
-    result[2] = m_combiner.work[threadId].variables.C[2] * m_combiner.work[threadId].variables.D[2];
-    result[3] = m_combiner.work[threadId].variables.C[3] * m_combiner.work[threadId].variables.D[3];
+    std::unique_lock<std::mutex> lock = LockGPU();
+    PixelPipelineStats stats;
+    stats.lookups = m_pixelPipelineLookups;
+    stats.hits = m_pixelPipelineHits;
+    stats.states = m_pixelPipelines.size();
+    return stats;
 }
 
-void GeForce3::CombinerFunction_CdotD(int threadId, float result[4])
+template<size_t... Index>
+std::array<GeForce3::SpanWriter, sizeof...(Index)> GeForce3::MakeSpanWriters(std::index_sequence<Index...>)
 {
-    // Dot product of C and D
-    result[0] = m_combiner.work[threadId].variables.C[0] * m_combiner.work[threadId].variables.D[0] + 
-               m_combiner.work[threadId].variables.C[1] * m_combiner.work[threadId].variables.D[1] + 
-               m_combiner.work[threadId].variables.C[2] * m_combiner.work[threadId].variables.D[2];
-               
-    result[1] = result[2] = result[0];
-    result[3] = m_combiner.work[threadId].variables.C[3] * m_combiner.work[threadId].variables.D[3];
+    return { { &GeForce3::WriteSpanIndexed<static_cast<int>(Index)>... } };
 }
 
-void GeForce3::CombinerFunction_ABmuxCD(int threadId, float result[4])
+// Pixel pipeline stages
+template<typename T>
+bool GeForce3::ComparePixelValue(ComparisonOp op, T value, T reference)
 {
-    if (m_combiner.work[threadId].registers.spare0[3] >= 0.5f) {
-        CombinerFunction_AB(threadId, result);
-    }
-    else {
-        CombinerFunction_CD(threadId, result);
+    switch (op) {
+        case ComparisonOp::NEVER:
+            return false;
+        case ComparisonOp::LESS:
+            return value < reference;
+        case ComparisonOp::EQUAL:
+            return value == reference;
+        case ComparisonOp::LEQUAL:
+            return value <= reference;
+        case ComparisonOp::GREATER:
+            return value > reference;
+        case ComparisonOp::NOTEQUAL:
+            return value != reference;
+        case ComparisonOp::GEQUAL:
+            return value >= reference;
+        case ComparisonOp::ALWAYS:
+        default:
+            return true;
     }
 }
 
-void GeForce3::CombinerFunction_ABsumCD(int threadId, float result[4])
+uint32_t GeForce3::ApplyStencilOp(StencilOp op, uint32_t stencil, uint32_t reference)
 {
-    result[0] = m_combiner.work[threadId].variables.A[0] * m_combiner.work[threadId].variables.B[0] + 
-               m_combiner.work[threadId].variables.C[0] * m_combiner.work[threadId].variables.D[0];
-               
-    result[1] = m_combiner.work[threadId].variables.A[1] * m_combiner.work[threadId].variables.B[1] + 
-               m_combiner.work[threadId].variables.C[1] * m_combiner.work[threadId].variables.D[1];
-               
-    result[2] = m_combiner.work[threadId].variables.A[2] * m_combiner.work[threadId].variables.B[2] + 
-               m_combiner.work[threadId].variables.C[2] * m_combiner.work[threadId].variables.D[2];
-               
-    result[3] = m_combiner.work[threadId].variables.A[3] * m_combiner.work[threadId].variables.B[3] + 
-               m_combiner.work[threadId].variables.C[3] * m_combiner.work[threadId].variables.D[3];
+    switch (op) {
+        case StencilOp::ZEROOP:
+            return 0;
+            
+        case StencilOp::INVERTOP:
+            return stencil ^ 0xFF;
+            
+        case StencilOp::KEEP:
+        default:
+            return stencil;
+            
+        case StencilOp::REPLACE:
+            return reference;
+            
+        case StencilOp::INCR:
+            return stencil < 0xFF ? stencil + 1 : stencil;
+            
+        case StencilOp::DECR:
+            return stencil > 0 ? stencil - 1 : stencil;
+            
+        case StencilOp::INCR_WRAP:
+            return stencil < 0xFF ? stencil + 1 : 0;
+            
+        case StencilOp::DECR_WRAP:
+            return stencil > 0 ? stencil - 1 : 0xFF;
+    }
 }
 
-void GeForce3::ComputeRGBOutputs(int threadId, int stageNumber)
+void GeForce3::BlendFactorValues(BlendFactor factor, const int32_t source[4], const int32_t frameBuffer[4],
+                                 const int32_t blendColor[4], int32_t result[4])
 {
-    int n = stageNumber;
-    int m;
-    float bias, scale;
-    
-    // Select bias and scale
-    if (m_combiner.setup.stage[n].mapoutRGB.bias)
-        bias = -0.5f;
-    else
-        bias = 0.0f;
-        
-    switch (m_combiner.setup.stage[n].mapoutRGB.scale) {
-        case 0:
+    switch (factor) {
+        case BlendFactor::ZERO:
         default:
-            scale = 1.0f;
+            result[3] = result[2] = result[1] = result[0] = 0;
             break;
-        case 1:
-            scale = 2.0f;
+            
+        case BlendFactor::ONE:
+            result[3] = result[2] = result[1] = result[0] = 0xFF;
             break;
-        case 2:
-            scale = 4.0f;
+            
+        case BlendFactor::SRC_COLOR:
+            for (int i = 0; i < 4; i++)
+                result[i] = source[i];
             break;
-        case 3:
-            scale = 0.5f;
+            
+        case BlendFactor::ONE_MINUS_SRC_COLOR:
+            for (int i = 0; i < 4; i++)
+                result[i] = source[i] ^ 0xFF;
             break;
-    }
-    
-    // First
-    if (m_combiner.setup.stage[n].mapoutRGB.abDotProduct) {
-        m = 1;
-        CombinerFunction_AdotB(threadId, m_combiner.work[threadId].functions.RGBop1);
-    }
-    else {
-        m = 0;
-        CombinerFunction_AB(threadId, m_combiner.work[threadId].functions.RGBop1);
-    }
-    
-    m_combiner.work[threadId].functions.RGBop1[0] = std::clamp((m_combiner.work[threadId].functions.RGBop1[0] + bias) * scale, -1.0f, 1.0f);
-    m_combiner.work[threadId].functions.RGBop1[1] = std::clamp((m_combiner.work[threadId].functions.RGBop1[1] + bias) * scale, -1.0f, 1.0f);
-    m_combiner.work[threadId].functions.RGBop1[2] = std::clamp((m_combiner.work[threadId].functions.RGBop1[2] + bias) * scale, -1.0f, 1.0f);
-    
-    // Second
-    if (m_combiner.setup.stage[n].mapoutRGB.cdDotProduct) {
-        m = m | 1;
-        CombinerFunction_CdotD(threadId, m_combiner.work[threadId].functions.RGBop2);
-    }
-    else
-        CombinerFunction_CD(threadId, m_combiner.work[threadId].functions.RGBop2);
-        
-    m_combiner.work[threadId].functions.RGBop2[0] = std::clamp((m_combiner.work[threadId].functions.RGBop2[0] + bias) * scale, -1.0f, 1.0f);
-    m_combiner.work[threadId].functions.RGBop2[1] = std::clamp((m_combiner.work[threadId].functions.RGBop2[1] + bias) * scale, -1.0f, 1.0f);
-    m_combiner.work[threadId].functions.RGBop2[2] = std::clamp((m_combiner.work[threadId].functions.RGBop2[2] + bias) * scale, -1.0f, 1.0f);
-    
-    // Third
-    if (m == 0) {
-        if (m_combiner.setup.stage[n].mapoutRGB.muxsum)
-            CombinerFunction_ABmuxCD(threadId, m_combiner.work[threadId].functions.RGBop3);
-        else
-            CombinerFunction_ABsumCD(threadId, m_combiner.work[threadId].functions.RGBop3);
             
-        m_combiner.work[threadId].functions.RGBop3[0] = std::clamp((m_combiner.work[threadId].functions.RGBop3[0] + bias) * scale, -1.0f, 1.0f);
-        m_combiner.work[threadId].functions.RGBop3[1] = std::clamp((m_combiner.work[threadId].functions.RGBop3[1] + bias) * scale, -1.0f, 1.0f);
-        m_combiner.work[threadId].functions.RGBop3[2] = std::clamp((m_combiner.work[threadId].functions.RGBop3[2] + bias) * scale, -1.0f, 1.0f);
-    }
-}
-
-void GeForce3::ComputeAlphaOutputs(int threadId, int stageNumber)
-{
-    int n = stageNumber;
-    float bias, scale;
-    
-    // Select bias and scale
-    if (m_combiner.setup.stage[n].mapoutAlpha.bias)
-        bias = -0.5f;
-    else
-        bias = 0.0f;
-        
-    switch (m_combiner.setup.stage[n].mapoutAlpha.scale) {
-        case 0:
-        default:
-            scale = 1.0f;
+        case BlendFactor::DST_COLOR:
+            for (int i = 0; i < 4; i++)
+                result[i] = frameBuffer[i];
             break;
-        case 1:
-            scale = 2.0f;
+            
+        case BlendFactor::ONE_MINUS_DST_COLOR:
+            for (int i = 0; i < 4; i++)
+                result[i] = frameBuffer[i] ^ 0xFF;
             break;
-        case 2:
-            scale = 4.0f;
+            
+        case BlendFactor::SRC_ALPHA:
+            result[3] = result[2] = result[1] = result[0] = source[3];
             break;
-        case 3:
-            scale = 0.5f;
-            break;
-    }
-    
-    // First
-    m_combiner.work[threadId].functions.Aop1 = m_combiner.work[threadId].variables.A[3] * 
-                                            m_combiner.work[threadId].variables.B[3];
-                                            
-    m_combiner.work[threadId].functions.Aop1 = std::clamp((m_combiner.work[threadId].functions.Aop1 + bias) * scale, 
-                                                      -1.0f, 1.0f);
-    
-    // Second
-    m_combiner.work[threadId].functions.Aop2 = m_combiner.work[threadId].variables.C[3] * 
-                                            m_combiner.work[threadId].variables.D[3];
-                                            
-    m_combiner.work[threadId].functions.Aop2 = std::clamp((m_combiner.work[threadId].functions.Aop2 + bias) * scale, 
-                                                      -1.0f, 1.0f);
-    
-    // Third
-    if (m_combiner.setup.stage[n].mapoutAlpha.muxsum) {
-        // Multiplex between AB and CD based on spare0 alpha
-        if (m_combiner.work[threadId].registers.spare0[3] >= 0.5f)
-            m_combiner.work[threadId].functions.Aop3 = m_combiner.work[threadId].variables.A[3] * 
-                                                    m_combiner.work[threadId].variables.B[3];
-        else
-            m_combiner.work[threadId].functions.Aop3 = m_combiner.work[threadId].variables.C[3] * 
-                                                    m_combiner.work[threadId].variables.D[3];
-    }
-    else {
-        // Sum AB + CD
-        m_combiner.work[threadId].functions.Aop3 = m_combiner.work[threadId].variables.A[3] * 
-                                                m_combiner.work[threadId].variables.B[3] + 
-                                                m_combiner.work[threadId].variables.C[3] * 
-                                                m_combiner.work[threadId].variables.D[3];
-    }
-    
-    m_combiner.work[threadId].functions.Aop3 = std::clamp((m_combiner.work[threadId].functions.Aop3 + bias) * scale, 
-                                                      -1.0f, 1.0f);
-}
-
-void GeForce3::WritePixel(int x, int y, uint32_t color, int z)
-{
-    uint8_t* addr;
-    uint32_t* dest32;
-    uint16_t* dest16;
-    uint32_t depthAndStencil;
-    int32_t frameBuffer[4], sourceBuffer[4], destBuffer[4];
-    uint32_t depth, stencil, stencilValue, stencilRef;
-    uint32_t depthValue;
-    bool stencilPassed;
-    bool depthPassed;
-    
-    // Range check
-    if ((z > 0xFFFFFF) || (z < 0) || (x < 0))
-        return;
-    
-    depthValue = static_cast<uint32_t>(z);
-    frameBuffer[3] = frameBuffer[2] = frameBuffer[1] = frameBuffer[0] = 0;
-    addr = nullptr;
-    
-    // Read current pixel if color mask is not fully set
-    if (m_colorMask != 0xFFFFFFFF)
-        addr = ReadPixel(x, y, frameBuffer);
-    
-    // Fetch current depth and stencil values
-    if (m_depthFormat == DepthFormat::Z24S8) {
-        if (((m_depthBufferPitch / 4) * y + x) >= m_depthBufferSize) {
-            LOG("Bad depth buffer offset in WritePixel!\n");
-            return;
-        }
-        
-        dest32 = m_depthBuffer + (m_depthBufferPitch / 4) * y + x;
-        depthAndStencil = *dest32;
-        depth = depthAndStencil >> 8;
-        stencil = depthAndStencil & 0xFF;
-        dest16 = nullptr;
-    }
-    else if (m_depthFormat == DepthFormat::Z16) {
-        if (((m_depthBufferPitch / 2) * y + x) >= m_depthBufferSize) {
-            LOG("Bad depth buffer offset in WritePixel!\n");
-            return;
-        }
-        
-        dest16 = reinterpret_cast<uint16_t*>(m_depthBuffer) + (m_depthBufferPitch / 2) * y + x;
-        depthAndStencil = *dest16;
-        depth = (depthAndStencil << 8) | 0xFF;
-        stencil = 0;
-        dest32 = nullptr;
-    }
-    else {
-        dest32 = nullptr;
-        dest16 = nullptr;
-        depth = 0xFFFFFF;
-        stencil = 0;
-    }
-    
-    // Extract color components
-    sourceBuffer[3] = color >> 24;
-    sourceBuffer[2] = (color >> 16) & 0xFF;
-    sourceBuffer[1] = (color >> 8) & 0xFF;
-    sourceBuffer[0] = color & 0xFF;
-    
-    // Prepare for combiner
-    destBuffer[3] = destBuffer[2] = destBuffer[1] = destBuffer[0] = 0xFF;
-    
-    // Alpha test
-    if (m_alphaTestEnabled) {
-        switch (m_alphaFunc) {
-            case ComparisonOp::NEVER:
-                return;
-                
-            case ComparisonOp::ALWAYS:
-            default:
-                break;
-                
-            case ComparisonOp::LESS:
-                if (sourceBuffer[3] >= m_alphaReference)
-                    return;
-                break;
-                
-            case ComparisonOp::LEQUAL:
-                if (sourceBuffer[3] > m_alphaReference)
-                    return;
-                break;
-                
-            case ComparisonOp::EQUAL:
-                if (sourceBuffer[3] != m_alphaReference)
-                    return;
-                break;
-                
-            case ComparisonOp::GEQUAL:
-                if (sourceBuffer[3] < m_alphaReference)
-                    return;
-                break;
-                
-            case ComparisonOp::GREATER:
-                if (sourceBuffer[3] <= m_alphaReference)
-                    return;
-                break;
-                
-            case ComparisonOp::NOTEQUAL:
-                if (sourceBuffer[3] == m_alphaReference)
-                    return;
-                break;
-        }
-    }
-    
-    // Stencil test
-    stencilPassed = true;
-    if (m_stencilTestEnabled) {
-        stencilRef = m_stencilMask & m_stencilRef;
-        stencilValue = m_stencilMask & stencil;
-        
-        switch (m_stencilFunc) {
-            case ComparisonOp::NEVER:
-                stencilPassed = false;
-                break;
-                
-            case ComparisonOp::LESS:
-                if (stencilRef >= stencilValue)
-                    stencilPassed = false;
-                break;
-                
-            case ComparisonOp::EQUAL:
-                if (stencilRef != stencilValue)
-                    stencilPassed = false;
-                break;
-                
-            case ComparisonOp::LEQUAL:
-                if (stencilRef > stencilValue)
-                    stencilPassed = false;
-                break;
-                
-            case ComparisonOp::GREATER:
-                if (stencilRef <= stencilValue)
-                    stencilPassed = false;
-                break;
-                
-            case ComparisonOp::NOTEQUAL:
-                if (stencilRef == stencilValue)
-                    stencilPassed = false;
-                break;
-                
-            case ComparisonOp::GEQUAL:
-                if (stencilRef < stencilValue)
-                    stencilPassed = false;
-                break;
-                
-            case ComparisonOp::ALWAYS:
-            default:
-                break;
-        }
-        
-        // Apply stencil operation if stencil test failed
-        if (!stencilPassed) {
-            switch (m_stencilOpFail) {
-                case StencilOp::ZEROOP:
-                    stencil = 0;
-                    break;
-                    
-                case StencilOp::INVERTOP:
-                    stencil = stencil ^ 0xFF;
-                    break;
-                    
-                case StencilOp::KEEP:
-                default:
-                    break;
-                    
-                case StencilOp::REPLACE:
-                    stencil = m_stencilRef;
-                    break;
-                    
-                case StencilOp::INCR:
-                    if (stencil < 0xFF)
-                        stencil++;
-                    break;
-                    
-                case StencilOp::DECR:
-                    if (stencil > 0)
-                        stencil--;
-                    break;
-                    
-                case StencilOp::INCR_WRAP:
-                    if (stencil < 0xFF)
-                        stencil++;
-                    else
-                        stencil = 0;
-                    break;
-                    
-                case StencilOp::DECR_WRAP:
-                    if (stencil > 0)
-                        stencil--;
-                    else
-                        stencil = 0xFF;
-                    break;
-            }
             
-            // Update stencil in depth buffer
-            if (m_depthFormat == DepthFormat::Z24S8) {
-                depthAndStencil = (depth << 8) | stencil;
-                *dest32 = depthAndStencil;
-            }
-            else if (m_depthFormat == DepthFormat::Z16) {
-                depthAndStencil = depth >> 8;
-                *dest16 = static_cast<uint16_t>(depthAndStencil);
-            }
+        case BlendFactor::ONE_MINUS_SRC_ALPHA:
+            result[3] = result[2] = result[1] = result[0] = source[3] ^ 0xFF;
+            break;
             
-            return;
-        }
-    }
-    
-    // Depth test
-    depthPassed = true;
-    if (m_depthTestEnabled) {
-        switch (m_depthFunction) {
-            case ComparisonOp::NEVER:
-                depthPassed = false;
-                break;
-                
-            case ComparisonOp::LESS:
-                if (depthValue >= depth)
-                    depthPassed = false;
-                break;
-                
-            case ComparisonOp::EQUAL:
-                if (depthValue != depth)
-                    depthPassed = false;
-                break;
-                
-            case ComparisonOp::LEQUAL:
-                if (depthValue > depth)
-                    depthPassed = false;
-                break;
-                
-            case ComparisonOp::GREATER:
-                if (depthValue <= depth)
-                    depthPassed = false;
-                break;
-                
-            case ComparisonOp::NOTEQUAL:
-                if (depthValue == depth)
-                    depthPassed = false;
-                break;
-                
-            case ComparisonOp::GEQUAL:
-                if (depthValue < depth)
-                    depthPassed = false;
-                break;
-                
-            case ComparisonOp::ALWAYS:
-            default:
-                break;
-        }
-        
-        // Apply stencil operation if depth test failed
-        if (!depthPassed) {
-            switch (m_stencilOpZFail) {
-                case StencilOp::ZEROOP:
-                    stencil = 0;
-                    break;
-                    
-                case StencilOp::INVERTOP:
-                    stencil = stencil ^ 0xFF;
-                    break;
-                    
-                case StencilOp::KEEP:
-                default:
-                    break;
-                    
-                case StencilOp::REPLACE:
-                    stencil = m_stencilRef;
-                    break;
-                    
-                case StencilOp::INCR:
-                    if (stencil < 0xFF)
-                        stencil++;
-                    break;
-                    
-                case StencilOp::DECR:
-                    if (stencil > 0)
-                        stencil--;
-                    break;
-                    
-                case StencilOp::INCR_WRAP:
-                    if (stencil < 0xFF)
-                        stencil++;
-                    else
-                        stencil = 0;
-                    break;
-                    
-                case StencilOp::DECR_WRAP:
-                    if (stencil > 0)
-                        stencil--;
-                    else
-                        stencil = 0xFF;
-                    break;
-            }
+        case BlendFactor::DST_ALPHA:
+            result[3] = result[2] = result[1] = result[0] = frameBuffer[3];
+            break;
             
-            // Update stencil in depth buffer
-            if (m_depthFormat == DepthFormat::Z24S8) {
-                depthAndStencil = (depth << 8) | stencil;
-                *dest32 = depthAndStencil;
-            }
-            else if (m_depthFormat == DepthFormat::Z16) {
-                depthAndStencil = depth >> 8;
-                *dest16 = static_cast<uint16_t>(depthAndStencil);
-            }
+        case BlendFactor::ONE_MINUS_DST_ALPHA:
+            result[3] = result[2] = result[1] = result[0] = frameBuffer[3] ^ 0xFF;
+            break;
             
-            return;
-        }
-        
-        // Apply stencil operation if depth test passed
-        switch (m_stencilOpZPass) {
-            case StencilOp::ZEROOP:
-                stencil = 0;
-                break;
-                
-            case StencilOp::INVERTOP:
-                stencil = stencil ^ 0xFF;
-                break;
-                
-            case StencilOp::KEEP:
-            default:
-                break;
-                
-            case StencilOp::REPLACE:
-                stencil = m_stencilRef;
-                break;
-                
-            case StencilOp::INCR:
-                if (stencil < 0xFF)
-                    stencil++;
-                break;
-                
-            case StencilOp::DECR:
-                if (stencil > 0)
-                    stencil--;
-                break;
-                
-            case StencilOp::INCR_WRAP:
-                if (stencil < 0xFF)
-                    stencil++;
-                else
-                    stencil = 0;
-                break;
-                
-            case StencilOp::DECR_WRAP:
-                if (stencil > 0)
-                    stencil--;
-                else
-                    stencil = 0xFF;
-                break;
-        }
+        case BlendFactor::CONSTANT_COLOR:
+            for (int i = 0; i < 4; i++)
+                result[i] = blendColor[i];
+            break;
+            
+        case BlendFactor::ONE_MINUS_CONSTANT_COLOR:
+            for (int i = 0; i < 4; i++)
+                result[i] = blendColor[i] ^ 0xFF;
+            break;
+            
+        case BlendFactor::CONSTANT_ALPHA:
+            result[3] = result[2] = result[1] = result[0] = blendColor[3];
+            break;
+            
+        case BlendFactor::ONE_MINUS_CONSTANT_ALPHA:
+            result[3] = result[2] = result[1] = result[0] = blendColor[3] ^ 0xFF;
+            break;
+            
+        case BlendFactor::SRC_ALPHA_SATURATE:
+            result[3] = 0xFF;
+            if (source[3] < (frameBuffer[3] ^ 0xFF))
+                result[2] = source[3];
+            else
+                result[2] = frameBuffer[3];
+            result[1] = result[0] = result[2];
+            break;
     }
-    
-    // Apply blending
-    if (m_blendingEnabled && addr != nullptr) {
-        int s[4], d[4];
-        int blendColor[4];
-        
-        blendColor[3] = m_blendColor >> 24;
-        blendColor[2] = (m_blendColor >> 16) & 0xFF;
-        blendColor[1] = (m_blendColor >> 8) & 0xFF;
-        blendColor[0] = m_blendColor & 0xFF;
-        
-        // Source blending factor
-        switch (m_blendFuncSource) {
-            case BlendFactor::ZERO:
-                s[3] = s[2] = s[1] = s[0] = 0;
-                break;
-                
-            case BlendFactor::ONE:
-            default:
-                s[3] = s[2] = s[1] = s[0] = 0xFF;
-                break;
-                
-            case BlendFactor::DST_COLOR:
-                s[3] = frameBuffer[3];
-                s[2] = frameBuffer[2];
-                s[1] = frameBuffer[1];
-                s[0] = frameBuffer[0];
-                break;
-                
-            case BlendFactor::ONE_MINUS_DST_COLOR:
-                s[3] = frameBuffer[3] ^ 0xFF;
-                s[2] = frameBuffer[2] ^ 0xFF;
-                s[1] = frameBuffer[1] ^ 0xFF;
-                s[0] = frameBuffer[0] ^ 0xFF;
-                break;
-                
-            case BlendFactor::SRC_ALPHA:
-                s[3] = s[2] = s[1] = s[0] = sourceBuffer[3];
-                break;
-                
-            case BlendFactor::ONE_MINUS_SRC_ALPHA:
-                s[3] = s[2] = s[1] = s[0] = sourceBuffer[3] ^ 0xFF;
-                break;
-                
-            case BlendFactor::DST_ALPHA:
-                s[3] = s[2] = s[1] = s[0] = frameBuffer[3];
-                break;
-                
-            case BlendFactor::ONE_MINUS_DST_ALPHA:
-                s[3] = s[2] = s[1] = s[0] = frameBuffer[3] ^ 0xFF;
-                break;
-                
-            case BlendFactor::CONSTANT_COLOR:
-                s[3] = blendColor[3];
-                s[2] = blendColor[2];
-                s[1] = blendColor[1];
-                s[0] = blendColor[0];
-                break;
-                
-            case BlendFactor::ONE_MINUS_CONSTANT_COLOR:
-                s[3] = blendColor[3] ^ 0xFF;
-                s[2] = blendColor[2] ^ 0xFF;
-                s[1] = blendColor[1] ^ 0xFF;
-                s[0] = blendColor[0] ^ 0xFF;
-                break;
-                
-            case BlendFactor::CONSTANT_ALPHA:
-                s[3] = s[2] = s[1] = s[0] = blendColor[3];
-                break;
-                
-            case BlendFactor::ONE_MINUS_CONSTANT_ALPHA:
-                s[3] = s[2] = s[1] = s[0] = blendColor[3] ^ 0xFF;
-                break;
-                
-            case BlendFactor::SRC_ALPHA_SATURATE:
-                s[3] = 0xFF;
-                if (sourceBuffer[3] < (frameBuffer[3] ^ 0xFF))
-                    s[2] = sourceBuffer[3];
-                else
-                    s[2] = frameBuffer[3];
-                s[1] = s[0] = s[2];
-                break;
-        }
-        
-        // Destination blending factor
-        switch (m_blendFuncDest) {
-            case BlendFactor::ZERO:
-            default:
-                d[3] = d[2] = d[1] = d[0] = 0;
-                break;
-                
-            case BlendFactor::ONE:
-                d[3] = d[2] = d[1] = d[0] = 0xFF;
-                break;
-                
-            case BlendFactor::SRC_COLOR:
-                d[3] = sourceBuffer[3];
-                d[2] = sourceBuffer[2];
-                d[1] = sourceBuffer[1];
-                d[0] = sourceBuffer[0];
-                break;
-                
-            case BlendFactor::ONE_MINUS_SRC_COLOR:
-                d[3] = sourceBuffer[3] ^ 0xFF;
-                d[2] = sourceBuffer[2] ^ 0xFF;
-                d[1] = sourceBuffer[1] ^ 0xFF;
-                d[0] = sourceBuffer[0] ^ 0xFF;
-                break;
-                
-            case BlendFactor::SRC_ALPHA:
-                d[3] = d[2] = d[1] = d[0] = sourceBuffer[3];
-                break;
-                
-            case BlendFactor::ONE_MINUS_SRC_ALPHA:
-                d[3] = d[2] = d[1] = d[0] = sourceBuffer[3] ^ 0xFF;
-                break;
-                
-            case BlendFactor::DST_ALPHA:
-                d[3] = d[2] = d[1] = d[0] = frameBuffer[3];
-                break;
-                
-            case BlendFactor::ONE_MINUS_DST_ALPHA:
-                d[3] = d[2] = d[1] = d[0] = frameBuffer[3] ^ 0xFF;
-                break;
-                
-            case BlendFactor::CONSTANT_COLOR:
-                d[3] = blendColor[3];
-                d[2] = blendColor[2];
-                d[1] = blendColor[1];
-                d[0] = blendColor[0];
-                break;
-                
-            case BlendFactor::ONE_MINUS_CONSTANT_COLOR:
-                d[3] = blendColor[3] ^ 0xFF;
-                d[2] = blendColor[2] ^ 0xFF;
-                d[1] = blendColor[1] ^ 0xFF;
-                d[0] = blendColor[0] ^ 0xFF;
-                break;
-                
-            case BlendFactor::CONSTANT_ALPHA:
-                d[3] = d[2] = d[1] = d[0] = blendColor[3];
-                break;
-                
-            case BlendFactor::ONE_MINUS_CONSTANT_ALPHA:
-                d[3] = d[2] = d[1] = d[0] = blendColor[3] ^ 0xFF;
-                break;
-        }
-        
-        // Apply blend operation
-        switch (m_blendEquation) {
-            case BlendEquation::FUNC_ADD:
-                sourceBuffer[3] = (sourceBuffer[3] * s[3] + frameBuffer[3] * d[3]) / 0xFF;
-                if (sourceBuffer[3] > 0xFF)
-                    sourceBuffer[3] = 0xFF;
-                    
-                sourceBuffer[2] = (sourceBuffer[2] * s[2] + frameBuffer[2] * d[2]) / 0xFF;
-                if (sourceBuffer[2] > 0xFF)
-                    sourceBuffer[2] = 0xFF;
-                    
-                sourceBuffer[1] = (sourceBuffer[1] * s[1] + frameBuffer[1] * d[1]) / 0xFF;
-                if (sourceBuffer[1] > 0xFF)
-                    sourceBuffer[1] = 0xFF;
-                    
-                sourceBuffer[0] = (sourceBuffer[0] * s[0] + frameBuffer[0] * d[0]) / 0xFF;
-                if (sourceBuffer[0] > 0xFF)
-                    sourceBuffer[0] = 0xFF;
-                break;
-                
-            case BlendEquation::FUNC_SUBTRACT:
-                sourceBuffer[3] = (sourceBuffer[3] * s[3] - frameBuffer[3] * d[3]) / 0xFF;
-                if (sourceBuffer[3] < 0)
-                    sourceBuffer[3] = 0;
-                    
-                sourceBuffer[2] = (sourceBuffer[2] * s[2] - frameBuffer[2] * d[2]) / 0xFF;
-                if (sourceBuffer[2] < 0)
-                    sourceBuffer[2] = 0;
-                    
-                sourceBuffer[1] = (sourceBuffer[1] * s[1] - frameBuffer[1] * d[1]) / 0xFF;
-                if (sourceBuffer[1] < 0)
-                    sourceBuffer[1] = 0;
-                    
-                sourceBuffer[0] = (sourceBuffer[0] * s[0] - frameBuffer[0] * d[0]) / 0xFF;
-                if (sourceBuffer[0] < 0)
-                    sourceBuffer[0] = 0;
-                break;
-                
-            case BlendEquation::FUNC_REVERSE_SUBTRACT:
-                sourceBuffer[3] = (frameBuffer[3] * d[3] - sourceBuffer[3] * s[3]) / 0xFF;
-                if (sourceBuffer[3] < 0)
-                    sourceBuffer[3] = 0;
-                    
-                sourceBuffer[2] = (frameBuffer[2] * d[2] - sourceBuffer[2] * s[2]) / 0xFF;
-                if (sourceBuffer[2] < 0)
-                    sourceBuffer[2] = 0;
-                    
-                sourceBuffer[1] = (frameBuffer[1] * d[1] - sourceBuffer[1] * s[1]) / 0xFF;
-                if (sourceBuffer[1] < 0)
-                    sourceBuffer[1] = 0;
-                    
-                sourceBuffer[0] = (frameBuffer[0] * d[0] - sourceBuffer[0] * s[0]) / 0xFF;
-                if (sourceBuffer[0] < 0)
-                    sourceBuffer[0] = 0;
-                break;
-                
-            case BlendEquation::MIN:
-                sourceBuffer[3] = std::min(sourceBuffer[3], frameBuffer[3]);
-                sourceBuffer[2] = std::min(sourceBuffer[2], frameBuffer[2]);
-                sourceBuffer[1] = std::min(sourceBuffer[1], frameBuffer[1]);
-                sourceBuffer[0] = std::min(sourceBuffer[0], frameBuffer[0]);
-                break;
-                
-            case BlendEquation::MAX:
-                sourceBuffer[3] = std::max(sourceBuffer[3], frameBuffer[3]);
-                sourceBuffer[2] = std::max(sourceBuffer[2], frameBuffer[2]);
-                sourceBuffer[1] = std::max(sourceBuffer[1], frameBuffer[1]);
-                sourceBuffer[0] = std::max(sourceBuffer[0], frameBuffer[0]);
-                break;
-        }
+}
+
+void GeForce3::BlendPixel(const PixelPipeline& pipeline, int32_t source[4], const int32_t frameBuffer[4])
+{
+    int32_t s[4], d[4];
+    int32_t blendColor[4];
+    
+    blendColor[3] = m_blendColor >> 24;
+    blendColor[2] = (m_blendColor >> 16) & 0xFF;
+    blendColor[1] = (m_blendColor >> 8) & 0xFF;
+    blendColor[0] = m_blendColor & 0xFF;
+    
+    BlendFactorValues(pipeline.blendSource, source, frameBuffer, blendColor, s);
+    BlendFactorValues(pipeline.blendDest, source, frameBuffer, blendColor, d);
+    
+    switch (pipeline.blendEquation) {
+        case BlendEquation::FUNC_ADD:
+            for (int i = 3; i >= 0; i--) {
+                source[i] = (source[i] * s[i] + frameBuffer[i] * d[i]) / 0xFF;
+                if (source[i] > 0xFF)
+                    source[i] = 0xFF;
+            }
+            break;
+            
+        case BlendEquation::FUNC_SUBTRACT:
+            for (int i = 3; i >= 0; i--) {
+                source[i] = (source[i] * s[i] - frameBuffer[i] * d[i]) / 0xFF;
+                if (source[i] < 0)
+                    source[i] = 0;
+            }
+            break;
+            
+        case BlendEquation::FUNC_REVERSE_SUBTRACT:
+            for (int i = 3; i >= 0; i--) {
+                source[i] = (frameBuffer[i] * d[i] - source[i] * s[i]) / 0xFF;
+                if (source[i] < 0)
+                    source[i] = 0;
+            }
+            break;
+            
+        case BlendEquation::MIN:
+            for (int i = 0; i < 4; i++)
+                source[i] = std::min(source[i], frameBuffer[i]);
+            break;
+            
+        case BlendEquation::MAX:
+            for (int i = 0; i < 4; i++)
+                source[i] = std::max(source[i], frameBuffer[i]);
+            break;
     }
-    
-    // Apply logical operation
-    if (m_logicalOpEnabled && addr != nullptr) {
-        switch (m_logicalOp) {
+}
+
+void GeForce3::LogicalOpPixel(LogicalOp op, int32_t source[4], const int32_t frameBuffer[4])
+{
+    for (int i = 0; i < 4; i++) {
+        int32_t s = source[i];
+        int32_t d = frameBuffer[i];
+        
+        switch (op) {
             case LogicalOp::CLEAR:
-                sourceBuffer[3] = 0;
-                sourceBuffer[2] = 0;
-                sourceBuffer[1] = 0;
-                sourceBuffer[0] = 0;
+                s = 0;
                 break;
-                
             case LogicalOp::AND:
-                sourceBuffer[3] = sourceBuffer[3] & frameBuffer[3];
-                sourceBuffer[2] = sourceBuffer[2] & frameBuffer[2];
-                sourceBuffer[1] = sourceBuffer[1] & frameBuffer[1];
-                sourceBuffer[0] = sourceBuffer[0] & frameBuffer[0];
+                s = s & d;
                 break;
-                
             case LogicalOp::AND_REVERSE:
-                sourceBuffer[3] = sourceBuffer[3] & (frameBuffer[3] ^ 0xFF);
-                sourceBuffer[2] = sourceBuffer[2] & (frameBuffer[2] ^ 0xFF);
-                sourceBuffer[1] = sourceBuffer[1] & (frameBuffer[1] ^ 0xFF);
-                sourceBuffer[0] = sourceBuffer[0] & (frameBuffer[0] ^ 0xFF);
+                s = s & (d ^ 0xFF);
                 break;
-                
             case LogicalOp::COPY:
             default:
                 break;
-                
             case LogicalOp::AND_INVERTED:
-                sourceBuffer[3] = (sourceBuffer[3] ^ 0xFF) & frameBuffer[3];
-                sourceBuffer[2] = (sourceBuffer[2] ^ 0xFF) & frameBuffer[2];
-                sourceBuffer[1] = (sourceBuffer[1] ^ 0xFF) & frameBuffer[1];
-                sourceBuffer[0] = (sourceBuffer[0] ^ 0xFF) & frameBuffer[0];
+                s = (s ^ 0xFF) & d;
                 break;
-                
             case LogicalOp::NOOP:
-                sourceBuffer[3] = frameBuffer[3];
-                sourceBuffer[2] = frameBuffer[2];
-                sourceBuffer[1] = frameBuffer[1];
-                sourceBuffer[0] = frameBuffer[0];
+                s = d;
                 break;
-                
             case LogicalOp::XOR:
-                sourceBuffer[3] = sourceBuffer[3] ^ frameBuffer[3];
-                sourceBuffer[2] = sourceBuffer[2] ^ frameBuffer[2];
-                sourceBuffer[1] = sourceBuffer[1] ^ frameBuffer[1];
-                sourceBuffer[0] = sourceBuffer[0] ^ frameBuffer[0];
+                s = s ^ d;
                 break;
-                
             case LogicalOp::OR:
-                sourceBuffer[3] = sourceBuffer[3] | frameBuffer[3];
-                sourceBuffer[2] = sourceBuffer[2] | frameBuffer[2];
-                sourceBuffer[1] = sourceBuffer[1] | frameBuffer[1];
-                sourceBuffer[0] = sourceBuffer[0] | frameBuffer[0];
+                s = s | d;
                 break;
-                
             case LogicalOp::NOR:
-                sourceBuffer[3] = (sourceBuffer[3] | frameBuffer[3]) ^ 0xFF;
-                sourceBuffer[2] = (sourceBuffer[2] | frameBuffer[2]) ^ 0xFF;
-                sourceBuffer[1] = (sourceBuffer[1] | frameBuffer[1]) ^ 0xFF;
-                sourceBuffer[0] = (sourceBuffer[0] | frameBuffer[0]) ^ 0xFF;
+                s = (s | d) ^ 0xFF;
                 break;
-                
             case LogicalOp::EQUIV:
-                sourceBuffer[3] = (sourceBuffer[3] ^ frameBuffer[3]) ^ 0xFF;
-                sourceBuffer[2] = (sourceBuffer[2] ^ frameBuffer[2]) ^ 0xFF;
-                sourceBuffer[1] = (sourceBuffer[1] ^ frameBuffer[1]) ^ 0xFF;
-                sourceBuffer[0] = (sourceBuffer[0] ^ frameBuffer[0]) ^ 0xFF;
+                s = (s ^ d) ^ 0xFF;
                 break;
-                
             case LogicalOp::INVERT:
-                sourceBuffer[3] = frameBuffer[3] ^ 0xFF;
-                sourceBuffer[2] = frameBuffer[2] ^ 0xFF;
-                sourceBuffer[1] = frameBuffer[1] ^ 0xFF;
-                sourceBuffer[0] = frameBuffer[0] ^ 0xFF;
+                s = d ^ 0xFF;
                 break;
-                
             case LogicalOp::OR_REVERSE:
-                sourceBuffer[3] = sourceBuffer[3] | (frameBuffer[3] ^ 0xFF);
-                sourceBuffer[2] = sourceBuffer[2] | (frameBuffer[2] ^ 0xFF);
-                sourceBuffer[1] = sourceBuffer[1] | (frameBuffer[1] ^ 0xFF);
-                sourceBuffer[0] = sourceBuffer[0] | (frameBuffer[0] ^ 0xFF);
+                s = s | (d ^ 0xFF);
                 break;
-                
             case LogicalOp::COPY_INVERTED:
-                sourceBuffer[3] = sourceBuffer[3] ^ 0xFF;
-                sourceBuffer[2] = sourceBuffer[2] ^ 0xFF;
-                sourceBuffer[1] = sourceBuffer[1] ^ 0xFF;
-                sourceBuffer[0] = sourceBuffer[0] ^ 0xFF;
+                s = s ^ 0xFF;
                 break;
-                
             case LogicalOp::OR_INVERTED:
-                sourceBuffer[3] = (sourceBuffer[3] ^ 0xFF) | frameBuffer[3];
-                sourceBuffer[2] = (sourceBuffer[2] ^ 0xFF) | frameBuffer[2];
-                sourceBuffer[1] = (sourceBuffer[1] ^ 0xFF) | frameBuffer[1];
-                sourceBuffer[0] = (sourceBuffer[0] ^ 0xFF) | frameBuffer[0];
+                s = (s ^ 0xFF) | d;
                 break;
-                
             case LogicalOp::NAND:
-                sourceBuffer[3] = (sourceBuffer[3] & frameBuffer[3]) ^ 0xFF;
-                sourceBuffer[2] = (sourceBuffer[2] & frameBuffer[2]) ^ 0xFF;
-                sourceBuffer[1] = (sourceBuffer[1] & frameBuffer[1]) ^ 0xFF;
-                sourceBuffer[0] = (sourceBuffer[0] & frameBuffer[0]) ^ 0xFF;
+                s = (s & d) ^ 0xFF;
                 break;
-                
             case LogicalOp::SET:
-                sourceBuffer[3] = 0xFF;
-                sourceBuffer[2] = 0xFF;
-                sourceBuffer[1] = 0xFF;
-                sourceBuffer[0] = 0xFF;
+                s = 0xFF;
                 break;
         }
+        
+        source[i] = s;
+    }
+}
+
+template<GeForce3::PixelFormat Format>
+uint8_t* GeForce3::ReadPixelAs(int x, int y, int32_t color[4])
+{
+    uint8_t* addr = PixelAddress(x, y);
+    
+    if constexpr (Format == PixelFormat::RGB565) {
+        uint32_t pixelColor = *reinterpret_cast<uint16_t*>(addr);
+        color[3] = 0xFF;
+        color[2] = Pal5bit((pixelColor & 0xF800) >> 11);
+        color[1] = Pal6bit((pixelColor & 0x07E0) >> 5);
+        color[0] = Pal5bit(pixelColor & 0x001F);
+    } else if constexpr (Format == PixelFormat::XRGB32 || Format == PixelFormat::ARGB32) {
+        uint32_t pixelColor = *reinterpret_cast<uint32_t*>(addr);
+        color[3] = (Format == PixelFormat::ARGB32) ? (pixelColor >> 24) : 0xFF;
+        color[2] = (pixelColor >> 16) & 0xFF;
+        color[1] = (pixelColor >> 8) & 0xFF;
+        color[0] = pixelColor & 0xFF;
+    } else {
+        color[0] = *addr;
+        color[1] = color[2] = 0;
+        color[3] = 0xFF;
     }
     
-    // Apply color mask and write to framebuffer
-    if (m_colorMask != 0) {
-        uint32_t currentColor, finalColor;
+    return addr;
+}
+
+template<int Index>
+void GeForce3::WriteSpanIndexed(const PixelPipeline& pipeline, int x, int y, int count, const uint32_t* color, const int32_t* z)
+{
+    // Decode the specialization from the writer index
+    constexpr int colorPath = Index % PIXEL_COLOR_PATHS;
+    constexpr bool alphaTest = (Index / PIXEL_COLOR_PATHS) & 1;
+    constexpr bool depthTest = (Index / PIXEL_COLOR_PATHS / 2) & 1;
+    constexpr bool stencilTest = (Index / PIXEL_COLOR_PATHS / 4) & 1;
+    constexpr PixelDepth depthFormat = static_cast<PixelDepth>(Index / PIXEL_COLOR_PATHS / 8);
+    constexpr bool writeColor = colorPath != 0;
+    constexpr bool badFormat = colorPath == 1;
+    constexpr PixelColorMode mode = static_cast<PixelColorMode>(colorPath < 2 ? 0 : (colorPath - 2) / static_cast<int>(PixelFormat::COUNT));
+    constexpr PixelFormat format = static_cast<PixelFormat>(colorPath < 2 ? 0 : (colorPath - 2) % static_cast<int>(PixelFormat::COUNT));
+    
+    uint32_t* depthRow32 = nullptr;
+    uint16_t* depthRow16 = nullptr;
+    uint32_t depthRowStart = 0;
+    if constexpr (depthFormat == PixelDepth::Z24S8) {
+        depthRowStart = (m_depthBufferPitch / 4) * y;
+        depthRow32 = m_depthBuffer + depthRowStart;
+    } else if constexpr (depthFormat == PixelDepth::Z16) {
+        depthRowStart = (m_depthBufferPitch / 2) * y;
+        depthRow16 = reinterpret_cast<uint16_t*>(m_depthBuffer) + depthRowStart;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        int px = x + i;
+        uint32_t depth, stencil;
+        uint32_t* dest32 = nullptr;
+        uint16_t* dest16 = nullptr;
         
-        // Reconstruct current and new pixel colors
-        currentColor = (frameBuffer[3] << 24) | (frameBuffer[2] << 16) | (frameBuffer[1] << 8) | frameBuffer[0];
-        finalColor = (sourceBuffer[3] << 24) | (sourceBuffer[2] << 16) | (sourceBuffer[1] << 8) | sourceBuffer[0];
+        // Range check
+        if ((z[i] > 0xFFFFFF) || (z[i] < 0) || (px < 0))
+            continue;
         
-        // Apply color mask
-        finalColor = (currentColor & ~m_colorMask) | (finalColor & m_colorMask);
+        uint32_t depthValue = static_cast<uint32_t>(z[i]);
         
-        // Write back to frame buffer
-        switch (m_colorFormat) {
-            case ColorFormat::R5G6B5:
-                {
-                    uint16_t r5g6b5 = ((finalColor >> 8) & 0xF800) | 
-                                      ((finalColor >> 5) & 0x07E0) | 
-                                      ((finalColor >> 3) & 0x001F);
-                    *reinterpret_cast<uint16_t*>(addr) = r5g6b5;
-                }
-                break;
-                
-            case ColorFormat::X8R8G8B8_Z8R8G8B8:
-            case ColorFormat::X8R8G8B8_X8R8G8B8:
-            case ColorFormat::A8R8G8B8:
-                *reinterpret_cast<uint32_t*>(addr) = finalColor;
-                break;
+        // Fetch current depth and stencil values
+        if constexpr (depthFormat == PixelDepth::Z24S8) {
+            if (depthRowStart + px >= m_depthBufferSize) {
+                LOG("Bad depth buffer offset in WritePixel!\n");
+                continue;
+            }
+            dest32 = depthRow32 + px;
+            depth = *dest32 >> 8;
+            stencil = *dest32 & 0xFF;
+        } else if constexpr (depthFormat == PixelDepth::Z16) {
+            if (depthRowStart + px >= m_depthBufferSize) {
+                LOG("Bad depth buffer offset in WritePixel!\n");
+                continue;
+            }
+            dest16 = depthRow16 + px;
+            depth = (static_cast<uint32_t>(*dest16) << 8) | 0xFF;
+            stencil = 0;
+        } else {
+            depth = 0xFFFFFF;
+            stencil = 0;
+        }
+        
+        // Extract color components
+        int32_t sourceBuffer[4];
+        sourceBuffer[3] = color[i] >> 24;
+        sourceBuffer[2] = (color[i] >> 16) & 0xFF;
+        sourceBuffer[1] = (color[i] >> 8) & 0xFF;
+        sourceBuffer[0] = color[i] & 0xFF;
+        
+        // Alpha test
+        if constexpr (alphaTest) {
+            if (!ComparePixelValue<int>(pipeline.alphaFunc, sourceBuffer[3], m_alphaReference))
+                continue;
+        }
+        
+        // Stencil test
+        if constexpr (stencilTest) {
+            uint32_t stencilRef = m_stencilMask & m_stencilRef;
+            uint32_t stencilValue = m_stencilMask & stencil;
+            
+            if (!ComparePixelValue<uint32_t>(pipeline.stencilFunc, stencilRef, stencilValue)) {
+                stencil = ApplyStencilOp(pipeline.stencilOpFail, stencil, m_stencilRef);
+                if constexpr (depthFormat == PixelDepth::Z24S8)
+                    *dest32 = (depth << 8) | stencil;
+                else if constexpr (depthFormat == PixelDepth::Z16)
+                    *dest16 = static_cast<uint16_t>(depth >> 8);
+                continue;
+            }
+        }
+        
+        // Depth test
+        if constexpr (depthTest) {
+            if (!ComparePixelValue<uint32_t>(pipeline.depthFunc, depthValue, depth)) {
+                stencil = ApplyStencilOp(pipeline.stencilOpZFail, stencil, m_stencilRef);
+                if constexpr (depthFormat == PixelDepth::Z24S8)
+                    *dest32 = (depth << 8) | stencil;
+                else if constexpr (depthFormat == PixelDepth::Z16)
+                    *dest16 = static_cast<uint16_t>(depth >> 8);
+                continue;
+            }
+            
+            stencil = ApplyStencilOp(pipeline.stencilOpZPass, stencil, m_stencilRef);
+        }
+        
+        // Color write
+        if constexpr (badFormat) {
+            continue;
+        } else if constexpr (writeColor) {
+            int32_t frameBuffer[4] = { 0, 0, 0, 0 };
+            uint8_t* addr;
+            
+            if constexpr (mode == PixelColorMode::WRITE) {
+                addr = PixelAddress(px, y);
+            } else {
+                addr = ReadPixelAs<format>(px, y, frameBuffer);
                 
-            case ColorFormat::B8:
+                if (mode == PixelColorMode::BLEND || pipeline.blendingEnabled)
+                    BlendPixel(pipeline, sourceBuffer, frameBuffer);
+                if (mode == PixelColorMode::GENERAL && pipeline.logicalOpEnabled)
+                    LogicalOpPixel(pipeline.logicalOp, sourceBuffer, frameBuffer);
+            }
+            
+            uint32_t finalColor = (sourceBuffer[3] << 24) | (sourceBuffer[2] << 16) | (sourceBuffer[1] << 8) | sourceBuffer[0];
+            
+            // Apply color mask
+            if constexpr (mode == PixelColorMode::GENERAL) {
+                uint32_t currentColor = (frameBuffer[3] << 24) | (frameBuffer[2] << 16) | (frameBuffer[1] << 8) | frameBuffer[0];
+                finalColor = (currentColor & ~m_colorMask) | (finalColor & m_colorMask);
+            }
+            
+            if constexpr (format == PixelFormat::RGB565) {
+                *reinterpret_cast<uint16_t*>(addr) = static_cast<uint16_t>(((finalColor >> 8) & 0xF800) |
+                                                                           ((finalColor >> 5) & 0x07E0) |
+                                                                           ((finalColor >> 3) & 0x001F));
+            } else if constexpr (format == PixelFormat::B8) {
                 *addr = static_cast<uint8_t>(finalColor & 0xFF);
-                break;
-                
-            default:
-                return;
+            } else {
+                *reinterpret_cast<uint32_t*>(addr) = finalColor;
+            }
         }
+        
+        // Update depth buffer if depth writing is enabled
+        if (pipeline.depthWrite) {
+            depth = depthValue;
+            if constexpr (depthFormat == PixelDepth::Z24S8)
+                WidenHierarchicalZ(px, y, depth);
+            else if constexpr (depthFormat == PixelDepth::Z16)
+                WidenHierarchicalZ(px, y, (depth & 0xFFFF00) | 0xFF);
+        }
+        
+        // Write back depth and stencil
+        if constexpr (depthFormat == PixelDepth::Z24S8)
+            *dest32 = (depth << 8) | stencil;
+        else if constexpr (depthFormat == PixelDepth::Z16)
+            *dest16 = static_cast<uint16_t>(depth >> 8);
+    }
+}
+
+void GeForce3::WriteSpan(int x, int y, int count, const uint32_t* color, const int32_t* z)
+{
+    if (m_lazyClears)
+        ResolveClearTile(y);
+    (this->*m_pixelPipeline->writer)(*m_pixelPipeline, x, y, count, color, z);
+}
+
+void GeForce3::WritePixel(int x, int y, uint32_t color, int z)
+{
+    int32_t depth = z;
+    WriteSpan(x, y, 1, &color, &depth);
+}
+
+// Depth test a block of pixels on scanline y before it is shaded
+//
+// Only runs when the pixel pipeline allows it. Without an alpha test the
+// color of a pixel cannot change the outcome of its depth test, so pixels
+// sure to fail need no shading. Runs of the block that cannot pass their
+// hierarchical Z tile are rejected first. If pass is given, the remaining
+// pixels are tested against the depth buffer and pass[i] is cleared for
+// every pixel that fails. Returns false if the block can be dropped without
+// calling WriteSpan().
+bool GeForce3::EarlyDepthTest(int x, int y, int count, const int32_t* z, uint8_t* pass)
+{
+    const PixelPipeline& pipeline = *m_pixelPipeline;
+    if (!pipeline.earlyDepth) {
+        if (pass)
+            memset(pass, 1, count);
+        return true;
     }
     
-    // Update depth buffer if depth writing is enabled
-    if (m_depthWriteEnabled) {
-        depth = depthValue;
+    if (m_lazyClears)
+        ResolveClearTile(y);
+    
+    bool z24 = m_depthFormat == DepthFormat::Z24S8;
+    bool useTiles = m_hiZ.valid && y >= 0 && (y >> HIZ_TILE_SHIFT) < m_hiZ.tilesY;
+    const HiZTile* tileRow = useTiles ? &m_hiZ.tiles[(y >> HIZ_TILE_SHIFT) * m_hiZ.tilesX] : nullptr;
+    uint32_t rowStart = z24 ? (m_depthBufferPitch / 4) * y : (m_depthBufferPitch / 2) * y;
+    int visible = 0;
+    
+    for (int first = 0; first < count; ) {
+        int px = x + first;
+        int run;
+        if (px < 0)
+            run = std::min(count - first, -px);
+        else
+            run = std::min(count - first, HIZ_TILE_SIZE - (px & (HIZ_TILE_SIZE - 1)));
+        
+        // Pixels outside the depth range or left of the target are never written
+        uint32_t zMin = 0xFFFFFFFF;
+        uint32_t zMax = 0;
+        for (int i = first; i < first + run; i++) {
+            if (z[i] >= 0 && z[i] <= 0xFFFFFF) {
+                zMin = std::min(zMin, static_cast<uint32_t>(z[i]));
+                zMax = std::max(zMax, static_cast<uint32_t>(z[i]));
+            }
+        }
+        
+        bool rejected = px < 0 || zMin > zMax;
+        if (!rejected && useTiles && (px >> HIZ_TILE_SHIFT) < m_hiZ.tilesX)
+            rejected = HierarchicalZRejects(pipeline.depthFunc, zMin, zMax, tileRow[px >> HIZ_TILE_SHIFT]);
+        
+        if (rejected) {
+            if (pass)
+                memset(pass + first, 0, run);
+        } else if (!pass) {
+            visible += run;
+        } else {
+            for (int i = first; i < first + run; i++) {
+                uint32_t offset = rowStart + x + i;
+                if (z[i] > 0xFFFFFF || z[i] < 0) {
+                    pass[i] = 0;
+                } else if (offset >= m_depthBufferSize) {
+                    pass[i] = 1;    // WriteSpan reports the bad offset
+                } else {
+                    uint32_t depth;
+                    if (z24)
+                        depth = m_depthBuffer[offset] >> 8;
+                    else
+                        depth = (static_cast<uint32_t>(reinterpret_cast<const uint16_t*>(m_depthBuffer)[offset]) << 8) | 0xFF;
+                    pass[i] = ComparePixelValue<uint32_t>(pipeline.depthFunc, static_cast<uint32_t>(z[i]), depth);
+                }
+                visible += pass[i];
+            }
+        }
+        
+        first += run;
     }
     
-    // Write back depth and stencil
-    if (m_depthFormat == DepthFormat::Z24S8) {
-        if (dest32 != nullptr) {
-            depthAndStencil = (depth << 8) | stencil;
-            *dest32 = depthAndStencil;
+    // Rejected pixels may still have to apply a stencil operation
+    return visible > 0 || !pipeline.silentDepthReject;
+}
+
+// True if no depth in zMin..zMax can pass the depth test anywhere in the tile
+bool GeForce3::HierarchicalZRejects(ComparisonOp op, uint32_t zMin, uint32_t zMax, const HiZTile& tile)
+{
+    switch (op) {
+        case ComparisonOp::NEVER:
+            return true;
+        case ComparisonOp::LESS:
+            return zMin >= tile.maxDepth;
+        case ComparisonOp::LEQUAL:
+            return zMin > tile.maxDepth;
+        case ComparisonOp::GREATER:
+            return zMax <= tile.minDepth;
+        case ComparisonOp::GEQUAL:
+            return zMax < tile.minDepth;
+        case ComparisonOp::EQUAL:
+            return zMax < tile.minDepth || zMin > tile.maxDepth;
+        default:
+            return false;
+    }
+}
+
+bool GeForce3::HierarchicalZMatches() const
+{
+    return m_hiZ.buffer == m_depthBuffer && m_hiZ.pitch == m_depthBufferPitch &&
+           m_hiZ.size == m_depthBufferSize && m_hiZ.format == m_depthFormat;
+}
+
+// Bring the hierarchical Z up to date with the depth buffer before a draw
+void GeForce3::SyncHierarchicalZ()
+{
+    if (!m_pixelPipeline->earlyDepth)
+        return;
+    if (m_hiZ.valid && HierarchicalZMatches() && !HierarchicalZWritten())
+        return;
+    
+    // Queued triangles may still be writing the depth buffer
+    m_rasterizer->Wait();
+    RebuildHierarchicalZ();
+}
+
+void GeForce3::RebuildHierarchicalZ()
+{
+    ResolveClears();
+    
+    m_hiZ.buffer = m_depthBuffer;
+    m_hiZ.pitch = m_depthBufferPitch;
+    m_hiZ.size = m_depthBufferSize;
+    m_hiZ.format = m_depthFormat;
+    m_hiZ.tilesX = 0;
+    m_hiZ.tilesY = 0;
+    m_hiZ.tiles.clear();
+    
+    bool z24 = m_depthFormat == DepthFormat::Z24S8;
+    int rowWidth = m_depthBufferPitch / (z24 ? 4 : 2);
+    int rows = m_renderTargetLimits.bottom() + 1;
+    uint64_t end = m_depthBuffer ? static_cast<uint64_t>(reinterpret_cast<uint8_t*>(m_depthBuffer) - m_ramBase) + m_depthBufferSize : 0;
+    
+    // Without tiles every block goes straight to the per-pixel test. Tiles
+    // need every pixel the rasterizer can reach to lie inside a depth row.
+    if (m_depthBuffer && rowWidth > 0 && rows > 0 && m_renderTargetLimits.right() < rowWidth && end <= m_ramSize) {
+        m_hiZ.tilesX = (rowWidth + HIZ_TILE_SIZE - 1) >> HIZ_TILE_SHIFT;
+        m_hiZ.tilesY = (rows + HIZ_TILE_SIZE - 1) >> HIZ_TILE_SHIFT;
+        m_hiZ.tiles.assign(static_cast<size_t>(m_hiZ.tilesX) * m_hiZ.tilesY, HiZTile{ 0xFFFFFFFF, 0 });
+        
+        for (int y = 0; y < rows; y++) {
+            HiZTile* tileRow = &m_hiZ.tiles[(y >> HIZ_TILE_SHIFT) * m_hiZ.tilesX];
+            for (int x = 0; x < rowWidth; x++) {
+                uint32_t depth;
+                if (z24)
+                    depth = m_depthBuffer[(m_depthBufferPitch / 4) * y + x] >> 8;
+                else
+                    depth = (static_cast<uint32_t>(reinterpret_cast<const uint16_t*>(m_depthBuffer)[(m_depthBufferPitch / 2) * y + x]) << 8) | 0xFF;
+                
+                HiZTile& tile = tileRow[x >> HIZ_TILE_SHIFT];
+                tile.minDepth = std::min(tile.minDepth, depth);
+                tile.maxDepth = std::max(tile.maxDepth, depth);
+            }
         }
     }
-    else if (m_depthFormat == DepthFormat::Z16) {
-        if (dest16 != nullptr) {
-            depthAndStencil = depth >> 8;
-            *dest16 = static_cast<uint16_t>(depthAndStencil);
+    
+    // Writes from now on land in a later epoch than the rebuild
+    m_hiZ.valid = true;
+    m_hiZ.epoch = ++m_textureEpoch;
+    m_hiZ.checkedWrites = m_ramWrites;
+}
+
+// True if memory the tiles describe was written by anything but rendering
+bool GeForce3::HierarchicalZWritten()
+{
+    CollectCpuWrites();
+    if (m_hiZ.checkedWrites == m_ramWrites || !m_hiZ.buffer || m_hiZ.size == 0)
+        return false;
+    
+    uint32_t offset = static_cast<uint32_t>(reinterpret_cast<const uint8_t*>(m_hiZ.buffer) - m_ramBase);
+    uint32_t first = offset >> RAM_PAGE_SHIFT;
+    uint32_t last = (offset + m_hiZ.size - 1) >> RAM_PAGE_SHIFT;
+    for (uint32_t page = first; page <= last && page < m_ramPageEpoch.size(); page++) {
+        if (m_ramPageEpoch[page] >= m_hiZ.epoch)
+            return true;
+    }
+    
+    m_hiZ.checkedWrites = m_ramWrites;
+    return false;
+}
+
+// Apply a depth clear of m_clearRect to the tiles; depth is in the depth test domain
+void GeForce3::ClearHierarchicalZ(uint32_t depth)
+{
+    if (!m_hiZ.valid || !HierarchicalZMatches() || m_hiZ.tilesX == 0)
+        return;
+    
+    int rowWidth = m_hiZ.tilesX * HIZ_TILE_SIZE;
+    int rows = m_hiZ.tilesY * HIZ_TILE_SIZE;
+    int lastX = m_hiZ.pitch / (m_hiZ.format == DepthFormat::Z24S8 ? 4 : 2) - 1;
+    int lastY = m_hiZ.size / m_hiZ.pitch - 1;
+    int left = std::max(m_clearRect.left(), 0);
+    int top = std::max(m_clearRect.top(), 0);
+    int right = std::min(m_clearRect.right(), rowWidth - 1);
+    int bottom = std::min(m_clearRect.bottom(), rows - 1);
+    
+    for (int ty = top >> HIZ_TILE_SHIFT; ty <= (bottom >> HIZ_TILE_SHIFT) && top <= bottom; ty++) {
+        int tileTop = ty << HIZ_TILE_SHIFT;
+        int tileBottom = std::min(tileTop + HIZ_TILE_SIZE - 1, lastY);
+        for (int tx = left >> HIZ_TILE_SHIFT; tx <= (right >> HIZ_TILE_SHIFT) && left <= right; tx++) {
+            int tileLeft = tx << HIZ_TILE_SHIFT;
+            int tileRight = std::min(tileLeft + HIZ_TILE_SIZE - 1, lastX);
+            HiZTile& tile = m_hiZ.tiles[ty * m_hiZ.tilesX + tx];
+            
+            // A fully cleared tile holds the clear value only
+            if (left <= tileLeft && right >= tileRight && top <= tileTop && bottom >= tileBottom) {
+                tile.minDepth = depth;
+                tile.maxDepth = depth;
+            } else {
+                tile.minDepth = std::min(tile.minDepth, depth);
+                tile.maxDepth = std::max(tile.maxDepth, depth);
+            }
         }
     }
 }
 
-uint8_t* GeForce3::ReadPixel(int x, int y, int32_t color[4])
+void GeForce3::WidenHierarchicalZ(int x, int y, uint32_t depth)
+{
+    uint32_t tileX = static_cast<uint32_t>(x) >> HIZ_TILE_SHIFT;
+    uint32_t tileY = static_cast<uint32_t>(y) >> HIZ_TILE_SHIFT;
+    if (tileX >= static_cast<uint32_t>(m_hiZ.tilesX) || tileY >= static_cast<uint32_t>(m_hiZ.tilesY))
+        return;
+    
+    HiZTile& tile = m_hiZ.tiles[tileY * m_hiZ.tilesX + tileX];
+    tile.minDepth = std::min(tile.minDepth, depth);
+    tile.maxDepth = std::max(tile.maxDepth, depth);
+}
+
+uint8_t* GeForce3::PixelAddress(int x, int y)
 {
     uint32_t offset;
-    uint32_t pixelColor;
-    uint32_t* addr32;
-    uint16_t* addr16;
-    uint8_t* addr8;
     
     // Calculate offset based on render target type
     if (m_renderTargetType == RenderTargetType::SWIZZLED) {
@@ -5000,10 +5786,20 @@ uint8_t* GeForce3::ReadPixel(int x, int y, int32_t color[4])
         offset = 0;
     }
     
+    return reinterpret_cast<uint8_t*>(m_renderTarget) + offset;
+}
+
+uint8_t* GeForce3::ReadPixel(int x, int y, int32_t color[4])
+{
+    uint32_t pixelColor;
+    uint32_t* addr32;
+    uint16_t* addr16;
+    uint8_t* addr8;
+    
     // Read color based on format
     switch (m_colorFormat) {
         case ColorFormat::R5G6B5:
-            addr16 = reinterpret_cast<uint16_t*>(reinterpret_cast<uint8_t*>(m_renderTarget) + offset);
+            addr16 = reinterpret_cast<uint16_t*>(PixelAddress(x, y));
             pixelColor = *addr16;
             color[3] = 0xFF;
             color[2] = Pal5bit((pixelColor & 0xF800) >> 11);
@@ -5013,7 +5809,7 @@ uint8_t* GeForce3::ReadPixel(int x, int y, int32_t color[4])
             
         case ColorFormat::X8R8G8B8_Z8R8G8B8:
         case ColorFormat::X8R8G8B8_X8R8G8B8:
-            addr32 = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(m_renderTarget) + offset);
+            addr32 = reinterpret_cast<uint32_t*>(PixelAddress(x, y));
             pixelColor = *addr32;
             color[3] = 0xFF;
             color[2] = (pixelColor >> 16) & 0xFF;
@@ -5022,7 +5818,7 @@ uint8_t* GeForce3::ReadPixel(int x, int y, int32_t color[4])
             return reinterpret_cast<uint8_t*>(addr32);
             
         case ColorFormat::A8R8G8B8:
-            addr32 = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(m_renderTarget) + offset);
+            addr32 = reinterpret_cast<uint32_t*>(PixelAddress(x, y));
             pixelColor = *addr32;
             color[3] = pixelColor >> 24;
             color[2] = (pixelColor >> 16) & 0xFF;
@@ -5031,7 +5827,7 @@ uint8_t* GeForce3::ReadPixel(int x, int y, int32_t color[4])
             return reinterpret_cast<uint8_t*>(addr32);
             
         case ColorFormat::B8:
-            addr8 = reinterpret_cast<uint8_t*>(m_renderTarget) + offset;
+            addr8 = PixelAddress(x, y);
             color[0] = *addr8;
             color[1] = color[2] = 0;
             color[3] = 0xFF;
@@ -5152,6 +5948,12 @@ void GeForce3::ProcessGPUCommands()
         uint32_t* dmaget = &m_channelState.channel[channel][0].regs[0x44/4];
         
         while (*dmaget != *dmaput) {
+            // Packets are atomic to the host; it may step in between them
+            PublishChannel(channel);
+            YieldToHost();
+            if (*dmaget == *dmaput)
+                break;
+            
             // Read command at DMAGET address
             uint32_t cmd = ReadDWORD(*dmaget);
             *dmaget += 4;
@@ -5178,24 +5980,8 @@ void GeForce3::ProcessGPUCommands()
                             *dmaget += 4;
                         } else {
                             LOG("  subch. %d method %04x count %d\n", subchannel, method, count);
-                            int ret = 0;
-                            
-                            while (count > 0) {
-                                uint32_t data = ReadDWORD(*dmaget);
-                                ExecuteMethod(channel, subchannel, method, data);
-                                count--;
-                                method += 4;
-                                *dmaget += 4;
-                                
-                                if (ret != 0)
-                                    break;
-                            }
-                            
-                            if (ret != 0) {
-                                // Method requested special handling (e.g. wait for vblank)
-                                m_pullerWaiting = ret;
-                                return;
-                            }
+                            ExecuteMethods(channel, subchannel, method, *dmaget, count, true);
+                            *dmaget += count * 4;
                         }
                     }
                     break;
@@ -5212,13 +5998,8 @@ void GeForce3::ProcessGPUCommands()
                             *dmaget += 4;
                         } else {
                             LOG("  subch. %d method %04x count %d (non-increasing)\n", subchannel, method, count);
-                            
-                            while (count > 0) {
-                                uint32_t data = ReadDWORD(*dmaget);
-                                ExecuteMethod(channel, subchannel, method, data);
-                                *dmaget += 4;
-                                count--;
-                            }
+                            ExecuteMethods(channel, subchannel, method, *dmaget, count, false);
+                            *dmaget += count * 4;
                         }
                     }
                     break;
@@ -5236,13 +6017,8 @@ void GeForce3::ProcessGPUCommands()
                             *dmaget += 4;
                         } else {
                             LOG("  subch. %d method %04x count %d (long non-increasing)\n", subchannel, method, count);
-                            
-                            while (count > 0) {
-                                uint32_t data = ReadDWORD(*dmaget);
-                                ExecuteMethod(channel, subchannel, method, data);
-                                *dmaget += 4;
-                                count--;
-                            }
+                            ExecuteMethods(channel, subchannel, method, *dmaget, count, false);
+                            *dmaget += count * 4;
                         }
                     }
                     break;
@@ -5256,12 +6032,129 @@ void GeForce3::ProcessGPUCommands()
                     break;
             }
         }
+        PublishChannel(channel);
+    }
+}
+
+bool GeForce3::CommandsPending()
+{
+    for (int channel = 0; channel < 32; channel++) {
+        if (m_channelState.channel[channel].regs[0x44/4] != m_channelState.channel[channel].regs[0x40/4])
+            return true;
+    }
+    return false;
+}
+
+// Start pulling commands; the caller holds m_gpuMutex
+void GeForce3::WakePuller()
+{
+    if (m_asyncPuller)
+        m_pullerWake.notify_one();
+    else
+        ProcessGPUCommands();
+}
+
+void GeForce3::PullerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_gpuMutex);
+    
+    for (;;) {
+        m_pullerWake.wait(lock, [this] {
+            return m_pullerStopping || (m_pullerWaiting == 0 && CommandsPending());
+        });
+        if (m_pullerStopping)
+            return;
+        
+        ProcessGPUCommands();
+        
+        // A guest halted until a notify or fence interrupt is woken now,
+        // not at its next MMIO access or vblank
+        if (m_postedIRQ.load(std::memory_order_acquire) >= 0) {
+            lock.unlock();
+            DeliverIRQ();
+            lock.lock();
+        }
+    }
+}
+
+// Stop the puller thread; pending commands wait for the next WakePuller()
+void GeForce3::StopPuller()
+{
+    if (!m_pullerThread.joinable())
+        return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_gpuMutex);
+        m_pullerStopping = true;
     }
+    m_pullerWake.notify_one();
+    m_pullerThread.join();
+    m_pullerStopping = false;
+}
+
+// Let threads blocked in LockGPU() in; only called on the puller thread
+void GeForce3::YieldToHost()
+{
+    if (!m_asyncPuller || m_gpuLockWaiters.load(std::memory_order_relaxed) == 0)
+        return;
+    
+    m_gpuMutex.unlock();
+    std::this_thread::yield();
+    m_gpuMutex.lock();
+}
+
+std::unique_lock<std::mutex> GeForce3::LockGPU()
+{
+    std::unique_lock<std::mutex> lock(m_gpuMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        m_gpuLockWaiters.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+        m_gpuLockWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return lock;
+}
+
+// Latch an IRQ level change for DeliverIRQ(); the caller holds m_gpuMutex,
+// under which the callback must not run
+void GeForce3::PostIRQ(bool state)
+{
+    m_postedIRQ.store(state ? 1 : 0, std::memory_order_release);
+}
+
+void GeForce3::DeliverIRQ()
+{
+    if (m_postedIRQ.load(std::memory_order_acquire) < 0)
+        return;
+    
+    // Taking the level and passing it on happen together, so a thread that
+    // took an older level cannot overwrite a newer one
+    std::lock_guard<std::mutex> lock(m_irqMutex);
+    int state = m_postedIRQ.exchange(-1, std::memory_order_acq_rel);
+    if (state >= 0 && m_irqCallback)
+        m_irqCallback(state);
+}
+
+// Make a channel's DMAGET and reference counter visible to lock-free MMIO reads
+void GeForce3::PublishChannel(int channel)
+{
+    m_publishedDMAGet[channel].store(m_channelState.channel[channel].regs[0x44/4], std::memory_order_release);
+    m_publishedReference[channel].store(m_channelState.channel[channel].regs[0x48/4], std::memory_order_release);
+}
+
+void GeForce3::PublishConfig()
+{
+    m_publishedMMIOBase.store((m_pciCommand & 0x0002) ? m_mmioMemBase : 0, std::memory_order_release);
 }
 
 // Callback processing
 void GeForce3::OnVBlank(int state)
 {
+    IRQScope irqScope{ *this };
+    std::unique_lock<std::mutex> lock = LockGPU();
+    TraceScope traceScope{ *this };
+    if (m_trace)
+        m_trace->VBlank(state);
+    
     // Update PCRTC registers
     if (state != 0) {
         // VBLANK start
@@ -5293,23 +6186,27 @@ void GeForce3::OnVBlank(int state)
     // Process any waiting GPU commands
     if (state != 0 && m_pullerWaiting == 1) {
         m_pullerWaiting = 0;
-        ProcessGPUCommands();
+        WakePuller();
     }
     
     // Update interrupts
-    if (UpdateInterrupts()) {
-        if (m_irqCallback) {
-            m_irqCallback(1); // Signal IRQ active
-        }
-    } else {
-        if (m_irqCallback) {
-            m_irqCallback(0); // Signal IRQ inactive
-        }
-    }
+    PostIRQ(UpdateInterrupts());
 }
 
 uint32_t GeForce3::ScreenUpdate(uint32_t* bitmap, int width, int height)
 {
+    std::unique_lock<std::mutex> lock = LockGPU();
+    TraceScope traceScope{ *this };
+    m_rasterizer->Wait();
+    ResolveClears();
+    
+    if (m_trace) {
+        m_trace->Screen(width, height);
+        if (m_displayTarget != nullptr)
+            TraceConsume(static_cast<uint32_t>(reinterpret_cast<uint8_t*>(m_displayTarget) - m_ramBase),
+                         static_cast<uint32_t>(width * height * sizeof(uint32_t)));
+    }
+    
     if (m_displayTarget != nullptr) {
         // Copy display buffer to output bitmap
         memcpy(bitmap, m_displayTarget, width * height * sizeof(uint32_t));
@@ -5420,30 +6317,101 @@ uint32_t GeForce3::ReadDWORD(uint32_t address)
         return 0xFFFFFFFF;
     }
     
+    TraceConsume(address, 4);
     return *reinterpret_cast<uint32_t*>(m_ramBase + address);
 }
 
 // Debug helpers
 bool GeForce3::ToggleRegisterCombinerUsage()
 {
+    std::unique_lock<std::mutex> lock = LockGPU();
     m_combinerEnabled = !m_combinerEnabled;
     return m_combinerEnabled;
 }
 
 bool GeForce3::ToggleWaitVBlankSupport()
 {
+    std::unique_lock<std::mutex> lock = LockGPU();
     m_enableWaitVblank = !m_enableWaitVblank;
     return m_enableWaitVblank;
 }
 
 bool GeForce3::ToggleClippingWSupport()
 {
+    std::unique_lock<std::mutex> lock = LockGPU();
     m_enableClippingW = !m_enableClippingW;
     return m_enableClippingW;
 }
 
+void GeForce3::SetClippingWSupport(bool enable)
+{
+    std::unique_lock<std::mutex> lock = LockGPU();
+    m_enableClippingW = enable;
+}
+
+void GeForce3::SetRamWriteCallback(std::function<void(uint32_t offset, uint32_t size)> callback)
+{
+    std::unique_lock<std::mutex> lock = LockGPU();
+    m_ramWriteCallback = callback;
+}
+
+void GeForce3::AttachMemoryManager(MemoryManager* memory, uint32_t address, uint32_t size)
+{
+    SetRamBase(memory->getPointer(address), size);
+    SetRamWriteCallback([memory, address](uint32_t offset, uint32_t length) {
+        memory->notifyWrite(address + offset, length);
+    });
+    
+    // Runs with the MemoryManager lock held, NotifyMemoryWrite() takes no lock
+    uint32_t id = memory->registerCallback(address, size, MemoryManager::AccessType::WRITE,
+                                           [this, address](uint32_t written, uint32_t length) {
+        uint32_t start = std::max(written, address);
+        uint64_t end = static_cast<uint64_t>(written) + length;
+        if (end > start)
+            NotifyMemoryWrite(start - address, static_cast<uint32_t>(end - start));
+    });
+    
+    std::unique_lock<std::mutex> lock = LockGPU();
+    m_memory = memory;
+    m_memoryAddress = address;
+    m_memoryCallbackId = id;
+}
+
+// Stop watching and hearing about the RAM of an attached MemoryManager;
+// called with the GPU lock held or from the destructor
+void GeForce3::DetachMemoryManager()
+{
+    if (!m_memory)
+        return;
+    
+    ClearTextureCache();
+    if (m_memoryCallbackId)
+        m_memory->unregisterCallback(m_memoryCallbackId);
+    m_memory = nullptr;
+    m_memoryCallbackId = 0;
+}
+
 void GeForce3::SetRamBase(void* base, uint32_t size)
 {
+    std::unique_lock<std::mutex> lock = LockGPU();
+    m_rasterizer->Wait();
+    
+    // Decoded textures refer to the previous memory
+    for (int n = 0; n < 4; n++)
+        m_texture[n].decoded = nullptr;
+    DetachMemoryManager();
+    ClearTextureCache();
+    
     m_ramBase = static_cast<uint8_t*>(base);
     m_ramSize = size;
+    if (m_trace)
+        m_trace->Ram(size);
+    
+    m_hiZ.valid = false;
+    for (PendingClear& pending : m_pendingClears)
+        pending.active = false;
+    m_cpuWritesReported = false;
+    m_ramPageEpoch.assign((static_cast<uint64_t>(size) + (1u << RAM_PAGE_SHIFT) - 1) >> RAM_PAGE_SHIFT, 0);
+    m_cpuDirtyPages.reset(new std::atomic<uint8_t>[m_ramPageEpoch.size()]());
+    m_cpuWritesPending = false;
 }
\ No newline at end of file
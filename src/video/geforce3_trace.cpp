@@ -0,0 +1,219 @@
+// GeForce3 command trace writer
+// Copyright (c) 2025 x86Emulator Project
+
+#include "geforce3_trace.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace GeForce3Trace;
+
+namespace {
+    // Records are collected and written in pieces of this size
+    constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+}
+
+GeForce3TraceWriter::GeForce3TraceWriter()
+    : m_file(nullptr), m_bytesWritten(0), m_writeFailed(false)
+{
+}
+
+GeForce3TraceWriter::~GeForce3TraceWriter()
+{
+    Close();
+}
+
+bool GeForce3TraceWriter::Open(const std::string& path)
+{
+    Close();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file)
+        return false;
+
+    m_buffer.clear();
+    m_buffer.reserve(WRITE_BUFFER_SIZE);
+    m_shadow.clear();
+    m_written.clear();
+    m_bytesWritten = 0;
+    m_writeFailed = false;
+
+    PutBytes(reinterpret_cast<const uint8_t*>(MAGIC), sizeof(MAGIC));
+    Put32(VERSION);
+    Put32(0);
+    return true;
+}
+
+bool GeForce3TraceWriter::Close()
+{
+    if (!m_file)
+        return true;
+
+    Flush();
+    if (std::fclose(m_file) != 0)
+        m_writeFailed = true;
+    m_file = nullptr;
+    m_shadow.clear();
+    m_shadow.shrink_to_fit();
+    m_written.clear();
+    return !m_writeFailed;
+}
+
+void GeForce3TraceWriter::Ram(uint32_t size)
+{
+    // The replay starts out with zeroed memory, and so does the shadow
+    m_shadow.assign(size, 0);
+    m_written.clear();
+
+    Put8(TAG_RAM);
+    Put32(size);
+}
+
+void GeForce3TraceWriter::Reset()
+{
+    Put8(TAG_RESET);
+}
+
+void GeForce3TraceWriter::ConfigWrite(uint8_t reg, uint32_t value, int size)
+{
+    Put8(TAG_CONFIG_WRITE);
+    Put8(reg);
+    Put8(static_cast<uint8_t>(size));
+    Put32(value);
+}
+
+void GeForce3TraceWriter::RegisterWrite(uint32_t address, uint32_t value, int size)
+{
+    Put8(TAG_REGISTER_WRITE);
+    Put8(static_cast<uint8_t>(size));
+    Put32(address);
+    Put32(value);
+}
+
+void GeForce3TraceWriter::VBlank(int state)
+{
+    Put8(TAG_VBLANK);
+    Put8(state != 0);
+}
+
+void GeForce3TraceWriter::Screen(int width, int height)
+{
+    Put8(TAG_SCREEN);
+    Put32(static_cast<uint32_t>(width));
+    Put32(static_cast<uint32_t>(height));
+}
+
+void GeForce3TraceWriter::Consume(const uint8_t* ram, uint32_t offset, uint32_t size)
+{
+    if (size == 0 || offset >= m_shadow.size())
+        return;
+
+    // Whole blocks keep records few and their headers small next to the data
+    uint64_t end = std::min<uint64_t>(static_cast<uint64_t>(offset) + size, m_shadow.size());
+    uint64_t start = offset & ~static_cast<uint64_t>(MEMORY_BLOCK - 1);
+    end = std::min<uint64_t>((end + MEMORY_BLOCK - 1) & ~static_cast<uint64_t>(MEMORY_BLOCK - 1), m_shadow.size());
+
+    uint64_t runStart = 0;
+    bool inRun = false;
+    for (uint64_t block = start; ; block += MEMORY_BLOCK) {
+        bool inRange = block < end;
+        bool changed = inRange && memcmp(&m_shadow[block], ram + block, std::min<uint64_t>(MEMORY_BLOCK, end - block)) != 0;
+
+        if (changed && !inRun) {
+            runStart = block;
+            inRun = true;
+        } else if (!changed && inRun) {
+            uint32_t length = static_cast<uint32_t>(std::min(block, end) - runStart);
+            memcpy(&m_shadow[runStart], ram + runStart, length);
+            Put8(TAG_MEMORY);
+            Put32(static_cast<uint32_t>(runStart));
+            Put32(length);
+            PutBytes(ram + runStart, length);
+            inRun = false;
+        }
+
+        if (!inRange)
+            break;
+    }
+}
+
+void GeForce3TraceWriter::Written(uint32_t offset, uint32_t size)
+{
+    if (size == 0 || offset >= m_shadow.size())
+        return;
+
+    uint32_t end = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(offset) + size, m_shadow.size()));
+
+    // Render targets are reported after every draw; grow a range instead of
+    // collecting copies of it
+    for (auto& range : m_written) {
+        if (offset <= range.second && end >= range.first) {
+            range.first = std::min(range.first, offset);
+            range.second = std::max(range.second, end);
+            return;
+        }
+    }
+    m_written.emplace_back(offset, end);
+}
+
+bool GeForce3TraceWriter::WritesOverlap(uint32_t offset, uint32_t size) const
+{
+    uint64_t end = static_cast<uint64_t>(offset) + size;
+    for (const auto& range : m_written) {
+        if (offset < range.second && end > range.first)
+            return true;
+    }
+    return false;
+}
+
+void GeForce3TraceWriter::SyncWrites(const uint8_t* ram)
+{
+    for (const auto& range : m_written)
+        memcpy(&m_shadow[range.first], ram + range.first, range.second - range.first);
+    m_written.clear();
+}
+
+void GeForce3TraceWriter::Put8(uint8_t value)
+{
+    PutBytes(&value, 1);
+}
+
+void GeForce3TraceWriter::Put32(uint32_t value)
+{
+    uint8_t bytes[4] = {
+        static_cast<uint8_t>(value),
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value >> 16),
+        static_cast<uint8_t>(value >> 24)
+    };
+    PutBytes(bytes, sizeof(bytes));
+}
+
+void GeForce3TraceWriter::PutBytes(const uint8_t* data, size_t size)
+{
+    if (!m_file)
+        return;
+
+    if (m_buffer.size() + size > WRITE_BUFFER_SIZE)
+        Flush();
+
+    // Large memory records skip the buffer
+    if (size > WRITE_BUFFER_SIZE) {
+        if (!m_writeFailed && std::fwrite(data, 1, size, m_file) != size)
+            m_writeFailed = true;
+        m_bytesWritten += size;
+        return;
+    }
+
+    m_buffer.insert(m_buffer.end(), data, data + size);
+}
+
+void GeForce3TraceWriter::Flush()
+{
+    if (m_buffer.empty())
+        return;
+
+    if (!m_writeFailed && std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())
+        m_writeFailed = true;
+    m_bytesWritten += m_buffer.size();
+    m_buffer.clear();
+}
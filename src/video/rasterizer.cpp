@@ -0,0 +1,175 @@
+#include "rasterizer.h"
+
+Rasterizer::Rasterizer(int threads)
+    : m_filling(0), m_active(nullptr), m_busyWorkers(0), m_generation(0), m_stopping(false)
+{
+    if (threads <= 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::clamp(threads, 1, MAX_THREADS);
+
+    // Batches never grow past BATCH_SIZE, so queued triangles never move
+    for (Batch& batch : m_batches)
+        batch.triangles.reserve(BATCH_SIZE);
+
+    // The thread calling Wait() renders as thread 0
+    for (int n = 1; n < threads; n++)
+        m_workers.emplace_back(&Rasterizer::WorkerLoop, this, n);
+}
+
+Rasterizer::~Rasterizer()
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+}
+
+void Rasterizer::Wait()
+{
+    if (!m_batches[m_filling].triangles.empty())
+        Flush();
+    if (m_active)
+        Finish();
+}
+
+Rasterizer::Triangle& Rasterizer::Queue()
+{
+    Batch& batch = m_batches[m_filling];
+    batch.triangles.emplace_back();
+    return batch.triangles.back();
+}
+
+void Rasterizer::Flush()
+{
+    // The previous batch may still be rendering the same tiles
+    if (m_active)
+        Finish();
+
+    Batch* batch = &m_batches[m_filling];
+    m_filling ^= 1;
+    Dispatch(batch);
+
+    // Without workers nothing overlaps, so render right away
+    if (m_workers.empty())
+        Finish();
+}
+
+void Rasterizer::Dispatch(Batch* batch)
+{
+    batch->nextTile.store(0, std::memory_order_relaxed);
+    batch->tilesRemaining.store(batch->tileCount, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_active = batch;
+        m_generation++;
+    }
+    m_workAvailable.notify_all();
+}
+
+void Rasterizer::Finish()
+{
+    Batch* batch = m_active;
+
+    // Help out instead of sleeping
+    RenderTiles(batch, 0);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // Once no worker holds the batch it can be refilled safely
+        m_workDone.wait(lock, [this, batch] {
+            return batch->tilesRemaining.load(std::memory_order_acquire) == 0 && m_busyWorkers == 0;
+        });
+        m_active = nullptr;
+    }
+
+    for (int32_t t = 0; t < batch->tileCount; t++)
+        batch->tiles[t].clear();
+    batch->tileCount = 0;
+    batch->triangles.clear();
+}
+
+void Rasterizer::RenderTiles(Batch* batch, int threadId)
+{
+    int32_t tile;
+    while ((tile = batch->nextTile.fetch_add(1, std::memory_order_acq_rel)) < batch->tileCount) {
+        int32_t top = tile * TILE_HEIGHT;
+        int32_t bottom = top + TILE_HEIGHT - 1;
+
+        // Submission order within a tile keeps blending and depth results serial
+        for (uint32_t index : batch->tiles[tile]) {
+            const Triangle& tri = batch->triangles[index];
+            int32_t y1 = std::min(tri.maxY, bottom);
+            for (int32_t y = std::max(tri.minY, top); y <= y1; y++)
+                RenderScanline(tri, y, threadId);
+        }
+
+        if (batch->tilesRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_workDone.notify_all();
+        }
+    }
+}
+
+void Rasterizer::RenderScanline(const Triangle& tri, int32_t y, int threadId)
+{
+    double yc = y + 0.5;
+
+    // Long edge runs from vertex 0 to vertex 2, the short edges meet at vertex 1
+    double xLong = tri.x0 + (yc - tri.y0) * (tri.x2 - tri.x0) / (tri.y2 - tri.y0);
+    double xShort;
+    if (yc < tri.y1)
+        xShort = tri.x0 + (yc - tri.y0) * (tri.x1 - tri.x0) / (tri.y1 - tri.y0);
+    else
+        xShort = tri.x1 + (yc - tri.y1) * (tri.x2 - tri.x1) / (tri.y2 - tri.y1);
+
+    double left = std::min(xLong, xShort);
+    double right = std::max(xLong, xShort);
+
+    // Pixel centers at x + 0.5 inside [left, right)
+    RasterizerExtent_t extent;
+    extent.startx = std::max(static_cast<int32_t>(std::ceil(left - 0.5)), tri.clipLeft);
+    extent.stopx = std::min(static_cast<int32_t>(std::ceil(right - 0.5)), tri.clipRight);
+    if (extent.startx >= extent.stopx)
+        return;
+
+    double dx = extent.startx + 0.5 - tri.x0;
+    double dy = yc - tri.y0;
+    for (int n = 0; n < tri.paramCount; n++) {
+        extent.param[n].start = tri.p0[n] + dx * tri.dpdx[n] + dy * tri.dpdy[n];
+        extent.param[n].dpdx = tri.dpdx[n];
+    }
+
+    (*tri.callback)(y, extent, tri.objectData, threadId);
+}
+
+void Rasterizer::WorkerLoop(int threadId)
+{
+    uint64_t seen = 0;
+
+    for (;;) {
+        Batch* batch;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [this, seen] { return m_stopping || m_generation != seen; });
+            if (m_stopping)
+                return;
+            seen = m_generation;
+            batch = m_active;
+            if (!batch)
+                continue;
+            m_busyWorkers++;
+        }
+
+        RenderTiles(batch, threadId);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0)
+            m_workDone.notify_all();
+    }
+}
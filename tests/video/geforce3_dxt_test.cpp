@@ -0,0 +1,256 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * GeForce3 DXT decoder test
+ *
+ * Checks that the reference block decoder returns the DXT1 texels the
+ * per-texel GetTexel code produced before the block decoder replaced it,
+ * and that the vector decoder matches the reference decoder on random
+ * DXT1, DXT3 and DXT5 images. Any difference fails the test.
+ */
+
+#include "geforce3_dxt.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using GeForce3Dxt::Format;
+
+namespace {
+
+constexpr int DXT1_BLOCKS = 200000;
+
+struct FormatInfo {
+    const char* name;
+    Format format;
+};
+
+const FormatInfo FORMATS[] = {
+    { "dxt1", Format::DXT1 },
+    { "dxt3", Format::DXT3 },
+    { "dxt5", Format::DXT5 },
+};
+
+const int IMAGE_SIZES[] = { 1, 2, 4, 8, 60, 256 };
+
+int pal5bit(int val)
+{
+    return (val << 3) | (val >> 2);
+}
+
+int pal6bit(int val)
+{
+    return (val << 2) | (val >> 4);
+}
+
+uint32_t convertR5G6B5ToRGB8(uint32_t r5g6b5)
+{
+    int cb = pal5bit(r5g6b5 & 0x001F);
+    int cg = pal6bit((r5g6b5 & 0x07E0) >> 5);
+    int cr = pal5bit((r5g6b5 & 0xF800) >> 11);
+    return (cr << 16) | (cg << 8) | cb;
+}
+
+// Texel (x, y) of a DXT1 block as GeForce3::DecodeTexel computed it
+uint32_t oldDxt1Texel(const uint8_t* block, int x, int y)
+{
+    int color0 = GeForce3Dxt::Load16(block);
+    int color1 = GeForce3Dxt::Load16(block + 2);
+    uint32_t codes = GeForce3Dxt::Load32(block + 4);
+    int cr, cg, cb;
+
+    int s = (y << 3) + (x << 1);
+    int c = (codes >> s) & 3;
+    c = c + (color0 > color1 ? 0 : 4);
+    int color0m2 = color0 << 1;
+    int color1m2 = color1 << 1;
+
+    switch (c) {
+        case 0:
+            return 0xFF000000 + convertR5G6B5ToRGB8(color0);
+        case 1:
+            return 0xFF000000 + convertR5G6B5ToRGB8(color1);
+        case 2:
+            cb = pal5bit(((color0m2 & 0x003E) + (color1 & 0x001F)) / 3);
+            cg = pal6bit(((color0m2 & 0x0FC0) + (color1 & 0x07E0)) / 3 >> 5);
+            cr = pal5bit(((color0m2 & 0x1F000) + color1) / 3 >> 11);
+            return 0xFF000000 | (cr << 16) | (cg << 8) | cb;
+        case 3:
+            cb = pal5bit(((color1m2 & 0x003E) + (color0 & 0x001F)) / 3);
+            cg = pal6bit(((color1m2 & 0x0FC0) + (color0 & 0x07E0)) / 3 >> 5);
+            cr = pal5bit(((color1m2 & 0x1F000) + color0) / 3 >> 11);
+            return 0xFF000000 | (cr << 16) | (cg << 8) | cb;
+        case 4:
+            return 0xFF000000 + convertR5G6B5ToRGB8(color0);
+        case 5:
+            return 0xFF000000 + convertR5G6B5ToRGB8(color1);
+        case 6:
+            cb = pal5bit(((color0 & 0x001F) + (color1 & 0x001F)) / 2);
+            cg = pal6bit(((color0 & 0x07E0) + (color1 & 0x07E0)) / 2 >> 5);
+            cr = pal5bit(((color0 & 0xF800) + (color1 & 0xF800)) / 2 >> 11);
+            return 0xFF000000 | (cr << 16) | (cg << 8) | cb;
+        default:
+            return 0xFF000000;
+    }
+}
+
+// Compare one DXT1 block with the old texel code
+void checkDxt1Block(const uint8_t* block, size_t& mismatches)
+{
+    uint32_t decoded[16];
+    GeForce3Dxt::DecodeBlockReference(Format::DXT1, block, decoded, 4);
+
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            uint32_t expected = oldDxt1Texel(block, x, y);
+            if (decoded[y * 4 + x] != expected) {
+                if (mismatches == 0) {
+                    std::fprintf(stderr, "dxt1 block %04X %04X %08X texel %d,%d is %08X, old code %08X\n",
+                                 GeForce3Dxt::Load16(block), GeForce3Dxt::Load16(block + 2),
+                                 GeForce3Dxt::Load32(block + 4), x, y, decoded[y * 4 + x], expected);
+                }
+                mismatches++;
+            }
+        }
+    }
+}
+
+void storeDxt1Block(uint8_t* block, uint16_t color0, uint16_t color1, uint32_t codes)
+{
+    memcpy(block, &color0, sizeof(color0));
+    memcpy(block + 2, &color1, sizeof(color1));
+    memcpy(block + 4, &codes, sizeof(codes));
+}
+
+// DecodeBlockReference() against the old GetTexel DXT1 formulas
+int testDxt1Reference()
+{
+    std::mt19937 random(1234);
+    uint8_t block[8];
+    size_t mismatches = 0;
+    int failures = 0;
+
+    // Random blocks, half of them in the three-color mode
+    for (int n = 0; n < DXT1_BLOCKS; n++) {
+        uint16_t color0 = static_cast<uint16_t>(random());
+        uint16_t color1 = static_cast<uint16_t>(random());
+        if ((n & 1) != (color0 <= color1))
+            std::swap(color0, color1);
+        storeDxt1Block(block, color0, color1, static_cast<uint32_t>(random()));
+        checkDxt1Block(block, mismatches);
+    }
+
+    // Equal colors select the three-color mode as well
+    for (uint32_t color = 0; color < 0x10000; color += 0x0123) {
+        storeDxt1Block(block, static_cast<uint16_t>(color), static_cast<uint16_t>(color), 0xE4E4E4E4);
+        checkDxt1Block(block, mismatches);
+    }
+
+    if (mismatches) {
+        std::fprintf(stderr, "dxt1: %zu texels differ from the old texel code\n", mismatches);
+        failures++;
+    }
+
+    // Index 3 of a three-color block is opaque black
+    uint32_t decoded[16];
+    storeDxt1Block(block, 0x1234, 0xFEDC, 0xFFFFFFFF);
+    GeForce3Dxt::DecodeBlockReference(Format::DXT1, block, decoded, 4);
+    for (int i = 0; i < 16; i++) {
+        if (decoded[i] != 0xFF000000) {
+            std::fprintf(stderr, "dxt1: index 3 of a three-color block is %08X, not opaque black\n", decoded[i]);
+            failures++;
+            break;
+        }
+    }
+
+    if (failures == 0)
+        std::printf("dxt1: reference decoder matches the old texel code\n");
+    return failures;
+}
+
+std::vector<uint8_t> randomImage(Format format, int size, std::mt19937& random)
+{
+    std::vector<uint8_t> image(GeForce3Dxt::ImageBytes(format, size, size));
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = static_cast<uint8_t>(random());
+    }
+
+    // Make both DXT1 color modes and both DXT5 alpha modes common
+    size_t blockBytes = GeForce3Dxt::BlockBytes(format);
+    for (size_t block = 0; block + blockBytes <= image.size(); block += blockBytes) {
+        if ((block / blockBytes) & 1) {
+            uint8_t* color = &image[block + (format == Format::DXT1 ? 0 : 8)];
+            std::swap(color[0], color[2]);
+            std::swap(color[1], color[3]);
+            if (format == Format::DXT5) {
+                std::swap(image[block], image[block + 1]);
+            }
+        }
+    }
+    return image;
+}
+
+// DecodeImage() against DecodeImageReference()
+int testVectorDecoder()
+{
+    std::mt19937 random(1234);
+    int failures = 0;
+
+    for (const auto& info : FORMATS) {
+        size_t mismatches = 0;
+        for (int size : IMAGE_SIZES) {
+            std::vector<uint8_t> image = randomImage(info.format, size, random);
+            std::vector<uint32_t> decoded(static_cast<size_t>(size) * size);
+            std::vector<uint32_t> reference(decoded.size());
+
+            GeForce3Dxt::DecodeImage(info.format, image.data(), size, size, decoded.data());
+            GeForce3Dxt::DecodeImageReference(info.format, image.data(), size, size, reference.data());
+            for (size_t i = 0; i < decoded.size(); i++) {
+                if (decoded[i] != reference[i]) {
+                    if (mismatches == 0) {
+                        std::fprintf(stderr, "%s: %dx%d texel %zu is %08X, reference %08X\n",
+                                     info.name, size, size, i, decoded[i], reference[i]);
+                    }
+                    mismatches++;
+                }
+            }
+        }
+
+        if (mismatches) {
+            std::fprintf(stderr, "%s: %zu texels differ from the reference decoder\n", info.name, mismatches);
+            failures++;
+        } else {
+            std::printf("%s: %d-lane decoder matches the reference decoder\n", info.name, GEFORCE3_DXT_LANES);
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main()
+{
+    int failures = testDxt1Reference();
+    failures += testVectorDecoder();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * GeForce3 span kernel test
+ *
+ * Interpolates random spans with every kernel set the host can run, block
+ * by block as the render callbacks do, and compares each pixel with the
+ * per-pixel interpolation RenderColor and RenderTextureSimple used before
+ * the kernels. Any difference fails the test.
+ */
+
+#include "geforce3_spans.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using GeForce3Spans::BLOCK_SIZE;
+
+namespace {
+
+constexpr int SPANS = 2000;
+constexpr int MAX_PIXELS = 700;
+
+// Vertex parameters of an extent, as the rasterizer hands them out
+struct Param {
+    double start;
+    double dpdx;
+};
+
+struct Extent {
+    int pixels;
+    Param z, w, color[4], s, t;
+    double scaleS, scaleT;
+};
+
+// Output of the color pass and of the texture pass, which steps depth
+// by accumulation and may round it differently
+struct Pixel {
+    int32_t z;
+    uint32_t argb;
+    int32_t textureZ, s, t;
+
+    bool operator!=(const Pixel& other) const
+    {
+        return z != other.z || argb != other.argb || textureZ != other.textureZ || s != other.s || t != other.t;
+    }
+};
+
+Extent randomExtent(std::mt19937& random)
+{
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    Extent extent;
+    extent.pixels = 1 + static_cast<int>(random() % MAX_PIXELS);
+    double length = extent.pixels;
+
+    // 1/W stays positive across the span; colors go somewhat out of
+    // range on either side to exercise the clamp
+    double wFirst = 0.05 + unit(random) * 2.0;
+    double wLast = 0.05 + unit(random) * 2.0;
+    extent.w = { wFirst, (wLast - wFirst) / length };
+    extent.z = { unit(random) * 16777215.0, (unit(random) - 0.5) * 65536.0 };
+    for (Param& color : extent.color) {
+        double first = (unit(random) * 1.4 - 0.2) * wFirst;
+        double last = (unit(random) * 1.4 - 0.2) * wLast;
+        color = { first, (last - first) / length };
+    }
+    extent.s = { unit(random) * wFirst, (unit(random) - 0.5) * 0.01 };
+    extent.t = { unit(random) * wFirst, (unit(random) - 0.5) * 0.01 };
+    extent.scaleS = (1 << (random() % 12)) * 256.0;
+    extent.scaleT = (1 << (random() % 12)) * 256.0;
+    return extent;
+}
+
+// The per-pixel code of RenderColor and RenderTextureSimple
+void referenceSpan(const Extent& extent, std::vector<Pixel>& pixels)
+{
+    for (int x = 0; x < extent.pixels; x++) {
+        Pixel& pixel = pixels[x];
+        pixel.z = static_cast<int>(extent.z.start + (double)x * extent.z.dpdx);
+
+        double wFactor = extent.w.start + (double)x * extent.w.dpdx;
+        wFactor = 1.0f / wFactor;
+
+        int channel[4];
+        for (int c = 0; c < 4; c++) {
+            channel[c] = std::clamp<int>((extent.color[c].start + (double)x * extent.color[c].dpdx) * wFactor * 255.0f,
+                                         0, 255);
+        }
+        pixel.argb = (channel[3] << 24) | (channel[2] << 16) | (channel[1] << 8) | channel[0];
+    }
+
+    double zDepth = extent.z.start;
+    double wFactor = extent.w.start;
+    double sCoord = extent.s.start;
+    double tCoord = extent.t.start;
+    for (int x = 0; x < extent.pixels; x++) {
+        double w = 1.0f / wFactor;
+        double s = sCoord * w;
+        double t = tCoord * w;
+        s = s * extent.scaleS;
+        t = t * extent.scaleT;
+        int z = zDepth;
+
+        pixels[x].textureZ = z;
+        pixels[x].s = static_cast<int>(s);
+        pixels[x].t = static_cast<int>(t);
+
+        zDepth += extent.z.dpdx;
+        wFactor += extent.w.dpdx;
+        sCoord += extent.s.dpdx;
+        tCoord += extent.t.dpdx;
+    }
+}
+
+void kernelSpan(const GeForce3Spans::Kernels& kernels, const Extent& extent, std::vector<Pixel>& pixels)
+{
+    GeForce3Spans::ColorSpan color;
+    color.zStart = extent.z.start;
+    color.zStep = extent.z.dpdx;
+    color.wStart = extent.w.start;
+    color.wStep = extent.w.dpdx;
+    for (int c = 0; c < 4; c++) {
+        color.colorStart[c] = extent.color[c].start;
+        color.colorStep[c] = extent.color[c].dpdx;
+    }
+
+    GeForce3Spans::TextureSpan texture;
+    texture.z = extent.z.start;
+    texture.zStep = extent.z.dpdx;
+    texture.w = extent.w.start;
+    texture.wStep = extent.w.dpdx;
+    texture.s = extent.s.start;
+    texture.sStep = extent.s.dpdx;
+    texture.t = extent.t.start;
+    texture.tStep = extent.t.dpdx;
+    texture.scaleS = extent.scaleS;
+    texture.scaleT = extent.scaleT;
+
+    uint32_t argb[BLOCK_SIZE];
+    int32_t z[BLOCK_SIZE], textureZ[BLOCK_SIZE], s[BLOCK_SIZE], t[BLOCK_SIZE];
+    for (int first = 0; first < extent.pixels; first += BLOCK_SIZE) {
+        int count = std::min(extent.pixels - first, BLOCK_SIZE);
+        kernels.color(color, first, count, argb, z);
+        kernels.texture(texture, count, textureZ, s, t);
+
+        for (int i = 0; i < count; i++) {
+            Pixel& pixel = pixels[first + i];
+            pixel.z = z[i];
+            pixel.argb = argb[i];
+            pixel.textureZ = textureZ[i];
+            pixel.s = s[i];
+            pixel.t = t[i];
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<GeForce3Spans::Kernels> kernelSets = GeForce3Spans::AvailableKernels();
+    std::printf("Selected kernels: %s\n", GeForce3Spans::SelectedKernels().name);
+
+    int failures = 0;
+    for (const auto& kernels : kernelSets) {
+        std::mt19937 random(1234);
+        std::vector<Pixel> expected(MAX_PIXELS), actual(MAX_PIXELS);
+        uint64_t pixels = 0;
+        size_t mismatches = 0;
+
+        for (int span = 0; span < SPANS; span++) {
+            Extent extent = randomExtent(random);
+            referenceSpan(extent, expected);
+            kernelSpan(kernels, extent, actual);
+            pixels += extent.pixels;
+
+            for (int x = 0; x < extent.pixels; x++) {
+                if (actual[x] != expected[x]) {
+                    if (mismatches == 0) {
+                        std::fprintf(stderr, "%s: span %d pixel %d is z %d argb %08X z %d st %d,%d, "
+                                     "reference z %d argb %08X z %d st %d,%d\n", kernels.name, span, x,
+                                     actual[x].z, actual[x].argb, actual[x].textureZ, actual[x].s, actual[x].t,
+                                     expected[x].z, expected[x].argb, expected[x].textureZ, expected[x].s,
+                                     expected[x].t);
+                    }
+                    mismatches++;
+                }
+            }
+        }
+
+        if (mismatches) {
+            std::fprintf(stderr, "%s: %zu pixels differ from the reference\n", kernels.name, mismatches);
+            failures++;
+        } else {
+            std::printf("%s: %llu pixels match\n", kernels.name, static_cast<unsigned long long>(pixels));
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,391 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Headless replay of GeForce3 command traces (GeForce3::StartTrace).
+ *
+ * Usage: gf3-replay [--profile accurate|fast] [--frames <n>] [--size <w>x<h>]
+ *                   [--dump <dir>] [--dump-every <n>] [--summary] trace.gf3
+ *
+ *   --profile     Accuracy profile to run the GPU with (default: fast)
+ *   --frames      Stop after this many frames
+ *   --size        Frame size when the trace holds no screen update
+ *   --dump        Write frames to <dir>/frame_NNNNNN.ppm
+ *   --dump-every  Only dump every n-th frame
+ *   --summary     Print the summary line only
+ *
+ * The trace is loaded into memory and fed to a GeForce3 with nothing else
+ * around it: no CPU, BIOS or GUI. A frame ends at every vblank; it is then
+ * presented to a host bitmap, which waits for its rendering to finish.
+ * Frame times are printed as JSON on stdout, one object per frame,
+ * followed by a summary object that also reports how often draws found
+ * their pixel pipeline in the cache. Dumps are written outside the timed
+ * part.
+ */
+
+#include "geforce3.h"
+#include "geforce3_trace.h"
+#include "accuracy_profile.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using GeForce3Trace::Load32;
+
+namespace {
+
+struct Options {
+    const char* path = nullptr;
+    std::string profile = "fast";
+    uint64_t frames = 0;
+    int width = 640;
+    int height = 480;
+    std::string dumpDir;
+    uint64_t dumpEvery = 1;
+    bool summary = false;
+};
+
+struct Record {
+    uint8_t tag;
+    const uint8_t* data;    // Payload after the tag
+    uint32_t length;        // Memory record data length
+};
+
+struct FrameStats {
+    uint64_t records = 0;
+    uint64_t methods = 0;
+    double seconds = 0.0;
+};
+
+/**
+ * @brief Parse the record at pos and advance pos past it
+ *
+ * @return false on an unknown tag or a truncated record
+ */
+bool nextRecord(const std::vector<uint8_t>& trace, size_t& pos, Record& record)
+{
+    size_t available = trace.size() - pos;
+    const uint8_t* p = &trace[pos];
+    size_t size;
+
+    record.tag = p[0];
+    record.data = p + 1;
+    record.length = 0;
+
+    switch (record.tag) {
+        case GeForce3Trace::TAG_RAM:            size = 5; break;
+        case GeForce3Trace::TAG_RESET:          size = 1; break;
+        case GeForce3Trace::TAG_CONFIG_WRITE:   size = 7; break;
+        case GeForce3Trace::TAG_REGISTER_WRITE: size = 10; break;
+        case GeForce3Trace::TAG_VBLANK:         size = 2; break;
+        case GeForce3Trace::TAG_SCREEN:         size = 9; break;
+        case GeForce3Trace::TAG_MEMORY:
+            if (available < 9) {
+                return false;
+            }
+            record.length = Load32(p + 5);
+            size = 9 + static_cast<size_t>(record.length);
+            break;
+        default:
+            std::fprintf(stderr, "Unknown record tag %02X at offset %zu\n", record.tag, pos);
+            return false;
+    }
+
+    if (available < size) {
+        std::fprintf(stderr, "Truncated record at offset %zu\n", pos);
+        return false;
+    }
+    pos += size;
+    return true;
+}
+
+bool loadTrace(const char* path, std::vector<uint8_t>& trace)
+{
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        std::fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+
+    uint8_t buffer[1 << 16];
+    size_t got;
+    while ((got = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        trace.insert(trace.end(), buffer, buffer + got);
+    }
+    std::fclose(file);
+
+    if (trace.size() < GeForce3Trace::HEADER_SIZE ||
+        std::memcmp(trace.data(), GeForce3Trace::MAGIC, sizeof(GeForce3Trace::MAGIC)) != 0) {
+        std::fprintf(stderr, "%s is not a GeForce3 trace\n", path);
+        return false;
+    }
+    uint32_t version = Load32(trace.data() + 8);
+    if (version != GeForce3Trace::VERSION) {
+        std::fprintf(stderr, "Unsupported trace version %u\n", version);
+        return false;
+    }
+    return true;
+}
+
+bool writePPM(const std::string& path, const std::vector<uint32_t>& bitmap, int width, int height)
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::fprintf(stderr, "Cannot create %s\n", path.c_str());
+        return false;
+    }
+
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    bool ok = true;
+    for (int y = 0; y < height && ok; y++) {
+        for (int x = 0; x < width; x++) {
+            uint32_t pixel = bitmap[static_cast<size_t>(y) * width + x];
+            row[x * 3 + 0] = static_cast<uint8_t>(pixel >> 16);
+            row[x * 3 + 1] = static_cast<uint8_t>(pixel >> 8);
+            row[x * 3 + 2] = static_cast<uint8_t>(pixel);
+        }
+        ok = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+/**
+ * @brief Copy a memory record into RAM and let the GPU know
+ */
+bool applyMemory(GeForce3& gpu, std::vector<uint8_t>& ram, const Record& record)
+{
+    uint32_t offset = Load32(record.data);
+    if (static_cast<uint64_t>(offset) + record.length > ram.size()) {
+        std::fprintf(stderr, "Memory record at %08X outside of RAM\n", offset);
+        return false;
+    }
+    std::memcpy(&ram[offset], record.data + 8, record.length);
+    gpu.NotifyMemoryWrite(offset, record.length);
+    return true;
+}
+
+double percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+int usage()
+{
+    std::fprintf(stderr, "Usage: gf3-replay [--profile accurate|fast] [--frames <n>] [--size <w>x<h>]\n"
+                         "                  [--dump <dir>] [--dump-every <n>] [--summary] trace.gf3\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--profile" && hasValue) {
+            options.profile = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0) {
+                return usage();
+            }
+        } else if (arg == "--dump" && hasValue) {
+            options.dumpDir = argv[++i];
+        } else if (arg == "--dump-every" && hasValue) {
+            options.dumpEvery = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 0));
+        } else if (arg == "--summary") {
+            options.summary = true;
+        } else if (arg[0] != '-' && !options.path) {
+            options.path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!options.path) {
+        return usage();
+    }
+
+    std::vector<uint8_t> trace;
+    if (!loadTrace(options.path, trace)) {
+        return 1;
+    }
+
+    // Keep stdout clean for the JSON stream
+    Logger::GetInstance()->setLevel(Logger::Level::WARN);
+
+    AccuracyProfile* profile = AccuracyProfile::GetInstance();
+    if (!profile->setProfile(options.profile)) {
+        std::fprintf(stderr, "Unknown profile %s\n", options.profile.c_str());
+        return usage();
+    }
+    // Memory records have to land before the commands that read them run
+    profile->setEnabled(AccuracyProfile::Feature::SYNC_PULLER, true);
+
+    auto gpu = std::make_unique<GeForce3>();
+    gpu->SetIRQCallback([](int) {});
+    gpu->Initialize();
+
+    std::vector<uint8_t> ram;
+    std::vector<uint32_t> bitmap;
+    std::vector<double> frameTimes;
+    FrameStats frame;
+    FrameStats total;
+    uint64_t frameCount = 0;
+    uint64_t methodsBefore = 0;
+    int status = 0;
+
+    auto frameStart = std::chrono::steady_clock::now();
+    size_t pos = GeForce3Trace::HEADER_SIZE;
+    while (pos < trace.size()) {
+        Record record;
+        if (!nextRecord(trace, pos, record)) {
+            status = 1;
+            break;
+        }
+        frame.records++;
+
+        if (record.tag == GeForce3Trace::TAG_RAM) {
+            ram.assign(Load32(record.data), 0);
+            gpu->SetRamBase(ram.data(), static_cast<uint32_t>(ram.size()));
+            // Every later change to RAM comes from a memory record
+            gpu->SetCpuWritesReported(true);
+            continue;
+        }
+        if (record.tag == GeForce3Trace::TAG_MEMORY) {
+            if (!applyMemory(*gpu, ram, record)) {
+                status = 1;
+                break;
+            }
+            continue;
+        }
+
+        // The memory the record consumed follows it, and has to be there first
+        size_t memoryPos = pos;
+        Record memory;
+        while (memoryPos < trace.size() && trace[memoryPos] == GeForce3Trace::TAG_MEMORY) {
+            if (!nextRecord(trace, memoryPos, memory) || !applyMemory(*gpu, ram, memory)) {
+                status = 1;
+                break;
+            }
+            frame.records++;
+        }
+        if (status) {
+            break;
+        }
+        pos = memoryPos;
+
+        switch (record.tag) {
+            case GeForce3Trace::TAG_RESET:
+                gpu->Reset();
+                break;
+
+            case GeForce3Trace::TAG_CONFIG_WRITE:
+                gpu->WriteConfig(record.data[0], Load32(record.data + 2), record.data[1]);
+                break;
+
+            case GeForce3Trace::TAG_REGISTER_WRITE:
+                gpu->WriteMemory(Load32(record.data + 1), Load32(record.data + 5), record.data[0]);
+                break;
+
+            case GeForce3Trace::TAG_SCREEN:
+                options.width = static_cast<int>(Load32(record.data));
+                options.height = static_cast<int>(Load32(record.data + 4));
+                break;
+
+            case GeForce3Trace::TAG_VBLANK:
+                gpu->OnVBlank(record.data[0]);
+                break;
+        }
+
+        bool frameEnd = record.tag == GeForce3Trace::TAG_VBLANK && record.data[0] != 0;
+        if (!frameEnd && pos < trace.size()) {
+            continue;
+        }
+
+        // Present the frame, which also waits for its rendering
+        bitmap.resize(static_cast<size_t>(options.width) * options.height);
+        gpu->ScreenUpdate(bitmap.data(), options.width, options.height);
+        frame.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+
+        uint64_t methods = gpu->GetMethodStats().methods;
+        frame.methods = methods - methodsBefore;
+        methodsBefore = methods;
+
+        if (!options.summary) {
+            std::printf("{\"frame\": %llu, \"records\": %llu, \"methods\": %llu, \"host_ns\": %.0f}\n",
+                        static_cast<unsigned long long>(frameCount), static_cast<unsigned long long>(frame.records),
+                        static_cast<unsigned long long>(frame.methods), frame.seconds * 1e9);
+            std::fflush(stdout);
+        }
+
+        if (!options.dumpDir.empty() && frameCount % options.dumpEvery == 0) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "/frame_%06llu.ppm", static_cast<unsigned long long>(frameCount));
+            if (!writePPM(options.dumpDir + name, bitmap, options.width, options.height)) {
+                status = 1;
+                break;
+            }
+        }
+
+        total.records += frame.records;
+        total.methods += frame.methods;
+        total.seconds += frame.seconds;
+        frameTimes.push_back(frame.seconds * 1e3);
+        frameCount++;
+        frame = FrameStats();
+
+        if (options.frames && frameCount >= options.frames) {
+            break;
+        }
+        frameStart = std::chrono::steady_clock::now();
+    }
+
+    double fps = total.seconds > 0.0 ? frameCount / total.seconds : 0.0;
+    GeForce3::PixelPipelineStats pipelines = gpu->GetPixelPipelineStats();
+    std::printf("{\"profile\": \"%s\", \"frames\": %llu, \"records\": %llu, \"methods\": %llu, \"host_ns\": %.0f, "
+                "\"fps\": %.1f, \"frame_ms_min\": %.3f, \"frame_ms_median\": %.3f, \"frame_ms_p95\": %.3f, "
+                "\"frame_ms_max\": %.3f, \"pipeline_lookups\": %llu, \"pipeline_hits\": %llu, "
+                "\"pipeline_states\": %zu}\n",
+                options.profile.c_str(), static_cast<unsigned long long>(frameCount),
+                static_cast<unsigned long long>(total.records), static_cast<unsigned long long>(total.methods),
+                total.seconds * 1e9, fps, percentile(frameTimes, 0.0), percentile(frameTimes, 0.5),
+                percentile(frameTimes, 0.95), percentile(frameTimes, 1.0),
+                static_cast<unsigned long long>(pipelines.lookups), static_cast<unsigned long long>(pipelines.hits),
+                pipelines.states);
+
+    return status;
+}
@@ -0,0 +1,365 @@
+/*
+ * x86Emulator - A portable x86 PC emulator written in C++
+ *
+ * Copyright (C) 2025 frostbite2000
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Offline decoder for instruction traces written by InstructionTracer.
+ *
+ * Usage: trace_decode [-t thread] [-n count] [-s] trace.bin
+ *
+ *   -t thread  Only print records of one emulation thread
+ *   -n count   Stop after this many instructions
+ *   -s         Print a summary only
+ *
+ * Each instruction is printed with the registers that changed since the
+ * previous instruction of the same thread, followed by its memory
+ * accesses.
+ */
+
+#include "instruction_trace.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef X86EMU_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace x86emu;
+
+namespace {
+
+const char* const REGISTER_NAMES[I386_TRACE_REG_COUNT] = {
+    "EAX", "ECX", "EDX", "EBX", "ESP", "EBP", "ESI", "EDI", "EFLAGS"
+};
+
+struct Options {
+    const char* path = nullptr;
+    long thread = -1;
+    uint64_t limit = 0;
+    bool summary = false;
+};
+
+struct Stream {
+    std::vector<uint8_t> pending;   // Bytes of a record split across chunks
+    uint64_t instructions = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+};
+
+struct Totals {
+    uint64_t instructions = 0;
+    uint64_t chunks = 0;
+    uint64_t bytesRaw = 0;
+    uint64_t bytesStored = 0;
+};
+
+uint16_t get16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t get32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+/**
+ * @brief Get the length of the record at p, or 0 if it is incomplete
+ *
+ * Returns SIZE_MAX for an unknown tag.
+ */
+size_t recordLength(const uint8_t* p, size_t available)
+{
+    if (available < 1) {
+        return 0;
+    }
+
+    if (p[0] == trace_format::TAG_INSTRUCTION) {
+        if (available < 10) {
+            return 0;
+        }
+        uint32_t mask = get16(p + 2);
+        size_t length = 10 + p[1];
+        for (int i = 0; i < I386_TRACE_REG_COUNT; i++) {
+            if (mask & (1u << i)) {
+                length += 4;
+            }
+        }
+        return available < length ? 0 : length;
+    }
+
+    if (p[0] & trace_format::TAG_MEMORY) {
+        size_t length = 5;
+        if (p[0] & trace_format::MEM_HAS_VALUE) {
+            length += static_cast<size_t>(1) << (p[0] & trace_format::MEM_SIZE_MASK);
+        }
+        return available < length ? 0 : length;
+    }
+
+    return SIZE_MAX;
+}
+
+/**
+ * @brief Print one record
+ *
+ * @return false once the instruction limit is reached
+ */
+bool printRecord(const Options& options, uint32_t thread, Stream& stream, Totals& totals, const uint8_t* p)
+{
+    if (p[0] == trace_format::TAG_INSTRUCTION) {
+        if (options.limit && totals.instructions >= options.limit) {
+            return false;
+        }
+        stream.instructions++;
+        totals.instructions++;
+        if (options.summary) {
+            return true;
+        }
+
+        uint32_t length = p[1];
+        uint32_t mask = get16(p + 2);
+        std::printf("%u %04X:%08X ", thread, get16(p + 8), get32(p + 4));
+        for (uint32_t i = 0; i < I386_TRACE_MAX_INSN; i++) {
+            if (i < length) {
+                std::printf(" %02X", p[10 + i]);
+            } else if (i < 8) {
+                std::printf("   ");
+            }
+        }
+
+        const uint8_t* r = p + 10 + length;
+        for (int i = 0; i < I386_TRACE_REG_COUNT; i++) {
+            if (mask & (1u << i)) {
+                std::printf("  %s=%08X", REGISTER_NAMES[i], get32(r));
+                r += 4;
+            }
+        }
+        std::printf("\n");
+        return true;
+    }
+
+    bool write = (p[0] & trace_format::MEM_WRITE) != 0;
+    if (write) {
+        stream.writes++;
+    } else {
+        stream.reads++;
+    }
+    if (options.summary) {
+        return true;
+    }
+
+    uint32_t size = 1u << (p[0] & trace_format::MEM_SIZE_MASK);
+    std::printf("%u     %s%u [%08X]", thread, write ? "W" : "R", size, get32(p + 1));
+    if (p[0] & trace_format::MEM_HAS_VALUE) {
+        uint64_t value = 0;
+        for (uint32_t i = 0; i < size && i < 8; i++) {
+            value |= static_cast<uint64_t>(p[5 + i]) << (i * 8);
+        }
+        std::printf(" = %0*" PRIX64, static_cast<int>(size * 2), value);
+    }
+    std::printf("\n");
+    return true;
+}
+
+/**
+ * @brief Append a chunk to a thread stream and print its complete records
+ *
+ * @return false on a corrupt stream or once the instruction limit is reached
+ */
+bool decodeChunk(const Options& options, uint32_t thread, Stream& stream, Totals& totals,
+                 const uint8_t* data, size_t length)
+{
+    std::vector<uint8_t>& buffer = stream.pending;
+    buffer.insert(buffer.end(), data, data + length);
+
+    size_t offset = 0;
+    bool keepGoing = true;
+    while (offset < buffer.size()) {
+        size_t record = recordLength(&buffer[offset], buffer.size() - offset);
+        if (record == 0) {
+            break;
+        }
+        if (record == SIZE_MAX) {
+            std::fprintf(stderr, "Unknown record tag %02X in thread %u\n", buffer[offset], thread);
+            return false;
+        }
+        if (options.thread < 0 || static_cast<uint32_t>(options.thread) == thread) {
+            if (!printRecord(options, thread, stream, totals, &buffer[offset])) {
+                keepGoing = false;
+                break;
+            }
+        }
+        offset += record;
+    }
+
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+    return keepGoing;
+}
+
+int usage()
+{
+    std::fprintf(stderr, "Usage: trace_decode [-t thread] [-n count] [-s] trace.bin\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+            options.thread = std::strtol(argv[++i], nullptr, 0);
+        } else if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+            options.limit = std::strtoull(argv[++i], nullptr, 0);
+        } else if (!std::strcmp(argv[i], "-s")) {
+            options.summary = true;
+        } else if (argv[i][0] != '-' && !options.path) {
+            options.path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!options.path) {
+        return usage();
+    }
+
+    std::FILE* file = std::fopen(options.path, "rb");
+    if (!file) {
+        std::fprintf(stderr, "Cannot open %s\n", options.path);
+        return 1;
+    }
+
+    uint8_t header[trace_format::HEADER_SIZE];
+    if (std::fread(header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header, trace_format::MAGIC, sizeof(trace_format::MAGIC)) != 0) {
+        std::fprintf(stderr, "%s is not an instruction trace\n", options.path);
+        std::fclose(file);
+        return 1;
+    }
+
+    uint32_t version = get32(header + 8);
+    uint32_t codec = get32(header + 12);
+    uint32_t registerMask = get32(header + 16);
+    uint32_t flags = get32(header + 20);
+    if (version != trace_format::VERSION) {
+        std::fprintf(stderr, "Unsupported trace version %u\n", version);
+        std::fclose(file);
+        return 1;
+    }
+#ifndef X86EMU_HAVE_ZSTD
+    if (codec == trace_format::CODEC_ZSTD) {
+        std::fprintf(stderr, "Trace is zstd compressed, but trace_decode was built without zstd\n");
+        std::fclose(file);
+        return 1;
+    }
+#endif
+    if (codec != trace_format::CODEC_NONE && codec != trace_format::CODEC_ZSTD) {
+        std::fprintf(stderr, "Unknown trace codec %u\n", codec);
+        std::fclose(file);
+        return 1;
+    }
+
+    std::map<uint32_t, Stream> streams;
+    Totals totals;
+    std::vector<uint8_t> stored;
+    std::vector<uint8_t> raw;
+    int status = 0;
+
+    for (;;) {
+        uint8_t chunk[trace_format::CHUNK_HEADER_SIZE];
+        size_t got = std::fread(chunk, 1, sizeof(chunk), file);
+        if (got == 0) {
+            break;
+        }
+        if (got != sizeof(chunk)) {
+            std::fprintf(stderr, "Truncated chunk header\n");
+            status = 1;
+            break;
+        }
+
+        uint32_t thread = get32(chunk);
+        uint32_t rawSize = get32(chunk + 4);
+        uint32_t storedSize = get32(chunk + 8);
+        stored.resize(storedSize);
+        if (storedSize && std::fread(stored.data(), storedSize, 1, file) != 1) {
+            std::fprintf(stderr, "Truncated chunk\n");
+            status = 1;
+            break;
+        }
+        totals.chunks++;
+        totals.bytesRaw += rawSize;
+        totals.bytesStored += sizeof(chunk) + storedSize;
+
+        const uint8_t* payload = stored.data();
+        if (storedSize < rawSize) {
+#ifdef X86EMU_HAVE_ZSTD
+            raw.resize(rawSize);
+            size_t size = ZSTD_decompress(raw.data(), rawSize, stored.data(), storedSize);
+            if (ZSTD_isError(size) || size != rawSize) {
+                std::fprintf(stderr, "Corrupt compressed chunk\n");
+                status = 1;
+                break;
+            }
+            payload = raw.data();
+#endif
+        }
+
+        if (!decodeChunk(options, thread, streams[thread], totals, payload, rawSize)) {
+            status = options.limit && totals.instructions >= options.limit ? 0 : 1;
+            break;
+        }
+    }
+    std::fclose(file);
+
+    if (options.summary) {
+        std::printf("Codec:        %s\n", codec == trace_format::CODEC_ZSTD ? "zstd" : "none");
+        std::printf("Registers:    ");
+        for (int i = 0; i < I386_TRACE_REG_COUNT; i++) {
+            if (registerMask & (1u << i)) {
+                std::printf("%s ", REGISTER_NAMES[i]);
+            }
+        }
+        std::printf("\nMemory:       %s\n", (flags & trace_format::FLAG_MEMORY) ? "yes" : "no");
+        std::printf("Chunks:       %" PRIu64 "\n", totals.chunks);
+        std::printf("Bytes:        %" PRIu64 " (%" PRIu64 " uncompressed)\n", totals.bytesStored, totals.bytesRaw);
+        std::printf("Instructions: %" PRIu64 "\n", totals.instructions);
+        if (totals.instructions) {
+            std::printf("Bytes/insn:   %.2f\n", static_cast<double>(totals.bytesStored) / totals.instructions);
+        }
+        for (const auto& entry : streams) {
+            std::printf("Thread %u:     %" PRIu64 " instructions, %" PRIu64 " reads, %" PRIu64 " writes\n",
+                        entry.first, entry.second.instructions, entry.second.reads, entry.second.writes);
+        }
+    }
+
+    for (const auto& entry : streams) {
+        if (!entry.second.pending.empty() && status == 0 && !options.limit) {
+            std::fprintf(stderr, "Thread %u ends with a partial record\n", entry.first);
+        }
+    }
+
+    return status;
+}